@@ -16,6 +16,8 @@
 #include <ifaddrs.h>
 #include <netdb.h>
 
+#include "../godot/metaverse_profiler.h"
+
 #define MOBILE_PORT 9090
 #define MAX_MOBILE_CLIENTS 50
 #define MAX_FRAME_SIZE 1920*1080*3  // 1080p RGB
@@ -86,6 +88,14 @@ typedef struct {
     uint8_t data[256];
 } MobileCommand;
 
+// Frame arena (godot/metaverse_frame_arena.c)
+typedef struct FrameArena FrameArena;
+
+FrameArena* frame_arena_create(size_t initial_size, bool debug, void (*report)(const char*));
+void frame_arena_destroy(FrameArena* arena);
+void* frame_arena_alloc(FrameArena* arena, size_t size);
+void frame_arena_reset(FrameArena* arena);
+
 // Function prototypes
 MobileExtension* create_mobile_extension();
 bool start_mobile_server(MobileExtension* extension);
@@ -95,7 +105,7 @@ void* video_stream_thread(void* arg);
 bool send_video_frame(MobileClient* client, VideoFrame* frame);
 bool send_control_data(MobileClient* client, const char* data_type, void* data, size_t size);
 bool handle_mobile_command(MobileClient* client, MobileCommand* cmd);
-VideoFrame* capture_current_frame(int width, int height);
+VideoFrame* capture_current_frame(FrameArena* arena, int width, int height);
 bool compress_frame(VideoFrame* frame, int quality);
 void disconnect_client(MobileExtension* extension, MobileClient* client);
 
@@ -359,6 +369,13 @@ void* video_stream_thread(void* arg) {
     MobileExtension* extension = (MobileExtension*)arg;
     int frame_counter = 0;
     
+    // Frames live in a thread-owned arena sized for one 1080p frame, so
+    // steady-state streaming does no heap allocation
+    FrameArena* arena = frame_arena_create(sizeof(VideoFrame) + MAX_FRAME_SIZE + 64, false, NULL);
+    if (!arena) return NULL;
+    
+    profiler_set_thread_name("Mobile stream");
+    
     while (extension->running) {
         // Only stream if we have active clients
         if (extension->client_count == 0) {
@@ -366,9 +383,12 @@ void* video_stream_thread(void* arg) {
             continue;
         }
         
+        ProfileZone zone = profiler_begin("Stream frame");
+        
         // Capture current frame (simulated)
-        VideoFrame* frame = capture_current_frame(1920, 1080);
+        VideoFrame* frame = capture_current_frame(arena, 1920, 1080);
         if (!frame) {
+            profiler_end(&zone);
             usleep(33333);  // ~30fps
             continue;
         }
@@ -392,14 +412,15 @@ void* video_stream_thread(void* arg) {
             }
         }
         
-        // Free frame
-        free(frame->data);
-        free(frame);
+        // Release frame
+        frame_arena_reset(arena);
+        profiler_end(&zone);
         
         // Control frame rate
         usleep(33333);  // ~30fps
     }
     
+    frame_arena_destroy(arena);
     return NULL;
 }
 
@@ -441,19 +462,18 @@ bool send_video_frame(MobileClient* client, VideoFrame* frame) {
 }
 
 // Capture current frame (simulated)
-VideoFrame* capture_current_frame(int width, int height) {
-    VideoFrame* frame = malloc(sizeof(VideoFrame));
+// Frame and pixels come from `arena` and are released by its next reset
+VideoFrame* capture_current_frame(FrameArena* arena, int width, int height) {
+    VideoFrame* frame = frame_arena_alloc(arena, sizeof(VideoFrame));
     if (!frame) return NULL;
     
+    memset(frame, 0, sizeof(VideoFrame));
     frame->width = width;
     frame->height = height;
     frame->size = width * height * 3;  // RGB
-    frame->data = malloc(frame->size);
+    frame->data = frame_arena_alloc(arena, frame->size);
     
-    if (!frame->data) {
-        free(frame);
-        return NULL;
-    }
+    if (!frame->data) return NULL;
     
     // Fill with test pattern (simulated video)
     for (int y = 0; y < height; y++) {
@@ -12,6 +12,9 @@
 #include <unistd.h>
 #include <math.h>
 
+#include "../godot/metaverse_math.h"
+#include "../godot/metaverse_profiler.h"
+
 // VR/AR device types
 typedef enum {
     DEVICE_VR = 0,
@@ -131,6 +134,8 @@ void* vr_tracking_thread(void* arg);
 bool render_vr_frame(VRRenderer* renderer, VRDevice* device);
 bool render_ar_frame(VRRenderer* renderer, VRDevice* device);
 HeadPose get_head_pose(VRDevice* device);
+void transform_to_vr_space(const float* position, const float* orientation, HeadPose head_pose,
+                           float* out_position, float* out_orientation);
 ControllerState get_controller_state(VRDevice* device, int controller_idx);
 bool handle_vr_input(VRRenderer* renderer, VRDevice* device);
 void update_vr_scene(VRRenderer* renderer);
@@ -167,11 +172,9 @@ VRRenderer* create_vr_renderer() {
         renderer->scene.display_positions[i][1] = 2.0f;
         renderer->scene.display_positions[i][2] = sin(angle) * 4.0f;
         
-        // Orient displays to face center
-        renderer->scene.display_orientations[i][0] = 0.0f;
-        renderer->scene.display_orientations[i][1] = -angle;
-        renderer->scene.display_orientations[i][2] = 0.0f;
-        renderer->scene.display_orientations[i][3] = 1.0f;  // w
+        // Orient displays to face center (yaw about the up axis)
+        vec4_store(renderer->scene.display_orientations[i],
+                   quat_from_axis_angle(vec3(0.0f, 1.0f, 0.0f), -angle));
     }
     
     renderer->scene.object_count = 0;
@@ -306,8 +309,11 @@ void* vr_render_thread(void* arg) {
     struct timespec last_frame, current_frame;
     clock_gettime(CLOCK_MONOTONIC, &last_frame);
     
+    profiler_set_thread_name("VR render");
+    
     while (renderer->rendering_active) {
         clock_gettime(CLOCK_MONOTONIC, &current_frame);
+        ProfileZone zone = profiler_begin("VR frame");
         
         // Calculate frame time
         double frame_time = (current_frame.tv_sec - last_frame.tv_sec) * 1000.0 +
@@ -353,6 +359,8 @@ void* vr_render_thread(void* arg) {
         // Update scene
         update_vr_scene(renderer);
         
+        profiler_end(&zone);
+        
         // Control frame rate
         double time_to_sleep = target_frame_time - (get_current_time_ms() - 
                               (current_frame.tv_sec * 1000.0 + current_frame.tv_nsec / 1000000.0));
@@ -369,7 +377,11 @@ void* vr_render_thread(void* arg) {
 void* vr_tracking_thread(void* arg) {
     VRRenderer* renderer = (VRRenderer*)arg;
     
+    profiler_set_thread_name("VR tracking");
+    
     while (renderer->rendering_active) {
+        ProfileZone zone = profiler_begin("Tracking update");
+        
         // Update tracking for all devices
         for (int i = 0; i < renderer->device_count; i++) {
             VRDevice* device = &renderer->devices[i];
@@ -393,6 +405,7 @@ void* vr_tracking_thread(void* arg) {
             }
         }
         
+        profiler_end(&zone);
         usleep(2000);  // Update tracking at ~500Hz
     }
     
@@ -552,10 +565,7 @@ HeadPose get_head_pose(VRDevice* device) {
     pose.position[1] = 1.7f;
     pose.position[2] = cos(angle) * 0.5f;
     
-    pose.orientation[0] = 0.0f;
-    pose.orientation[1] = sin(angle * 0.5f);
-    pose.orientation[2] = 0.0f;
-    pose.orientation[3] = cos(angle * 0.5f);
+    vec4_store(pose.orientation, quat_from_axis_angle(vec3(0.0f, 1.0f, 0.0f), angle));
     
     pose.timestamp = get_timestamp_us();
     pose.tracking_valid = true;
@@ -563,6 +573,17 @@ HeadPose get_head_pose(VRDevice* device) {
     return pose;
 }
 
+// Express a room-space pose relative to the head: the inverse head rotation
+// is applied to the offset from the head and composed with the orientation
+void transform_to_vr_space(const float* position, const float* orientation, HeadPose head_pose,
+                           float* out_position, float* out_orientation) {
+    Quat head_inverse = quat_conjugate(vec4_load(head_pose.orientation));
+    Vec3 offset = vec3_sub(vec3_load(position), vec3_load(head_pose.position));
+    
+    vec3_store(out_position, quat_rotate(head_inverse, offset));
+    vec4_store(out_orientation, quat_normalize(quat_mul(head_inverse, vec4_load(orientation))));
+}
+
 ControllerState get_controller_state(VRDevice* device, int controller_idx) {
     ControllerState state;
     
@@ -11,6 +11,8 @@
 #include <string.h>
 #include <math.h>
 
+#include "metaverse_math.h"
+
 // Godot types
 typedef godot_variant Variant;
 typedef godot_string String;
@@ -89,6 +91,9 @@ Variant GDAPI mesh_update_vertices(godot_object* instance, void* method_data,
 Variant GDAPI mesh_batch_draw(godot_object* instance, void* method_data, 
                              void* user_data, int num_args, Variant** args);
 
+// Frame arena (metaverse_frame_arena.c)
+void* frame_alloc(size_t size);
+
 // GDNative initialization
 void GDN_EXPORT godot_gdnative_init(godot_gdnative_init_options* options) {
     api = options->api_struct;
@@ -499,8 +504,12 @@ Variant GDAPI mesh_batch_draw(godot_object* instance, void* method_data,
     godot_array* mesh_array = api->godot_variant_as_array(args[0]);
     int mesh_count = api->godot_array_size(mesh_array);
     
-    // Collect transformation data
-    float* transforms = malloc(mesh_count * 16 * sizeof(float));
+    // Collect transformation data; frame arena memory is released at frame
+    // end, heap only when no arena is bound
+    size_t transforms_size = (size_t)mesh_count * 16 * sizeof(float);
+    float* transforms = frame_alloc(transforms_size);
+    bool transforms_heap = transforms == NULL;
+    if (transforms_heap) transforms = malloc(transforms_size);
     int draw_count = 0;
     
     for (int i = 0; i < mesh_count; i++) {
@@ -541,7 +550,7 @@ Variant GDAPI mesh_batch_draw(godot_object* instance, void* method_data,
         printf("Batch drawing %d meshes\n", draw_count);
     }
     
-    free(transforms);
+    if (transforms_heap) free(transforms);
     
     godot_variant ret;
     api->godot_variant_new_int(&ret, draw_count);
@@ -575,10 +584,24 @@ int* extract_pool_data_int(godot_pool_int_array* pool) {
     return data;
 }
 
+static Vec4 vector3_to_vec4(const godot_vector3* v, float w) {
+    return vec4(api->godot_vector3_get_axis(v, GODOT_VECTOR3_AXIS_X),
+                api->godot_vector3_get_axis(v, GODOT_VECTOR3_AXIS_Y),
+                api->godot_vector3_get_axis(v, GODOT_VECTOR3_AXIS_Z), w);
+}
+
 void transform_to_matrix(godot_transform* transform, float* matrix) {
-    // Convert Godot transform to 4x4 column-major matrix
-    // This is simplified - real implementation would extract basis and origin
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;  // Identity matrix
+    // Convert Godot transform to 4x4 column-major matrix: the basis axes
+    // are the first three columns, the origin is the translation column
+    godot_basis basis = api->godot_transform_get_basis(transform);
+    godot_vector3 origin = api->godot_transform_get_origin(transform);
+    
+    Mat4 m;
+    for (int c = 0; c < 3; c++) {
+        godot_vector3 axis = api->godot_basis_get_axis(&basis, c);
+        m.col[c] = vector3_to_vec4(&axis, 0.0f);
     }
+    m.col[3] = vector3_to_vec4(&origin, 1.0f);
+    
+    mat4_store(matrix, &m);
 }
\ No newline at end of file
@@ -10,14 +10,37 @@
 #include <math.h>
 #include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Headless builds (benchmarks, CI) swap GL for no-op stubs and drop main()
+#ifdef METAVERSE_HEADLESS
+#include "metaverse_gl_stub.h"
+#else
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "metaverse_math.h"
+#include "metaverse_profiler.h"
 
 // Godot Engine interface structures
 typedef struct {
     void* (*godot_alloc)(size_t size);
     void (*godot_free)(void* ptr);
+    void* (*godot_frame_alloc)(size_t size);        // Released at frame end
+    void* (*godot_frame_alloc_carry)(size_t size);  // Survives into the next frame
     void (*godot_print)(const char* message);
     void (*godot_error)(const char* message);
     double (*godot_get_time)();
@@ -38,39 +61,493 @@ typedef struct {
     uint32_t flags;
 } MetaverseEntity;
 
+// Network entity update, as received by the network thread
+typedef struct {
+    uint64_t entity_id;
+    Vector4 position;
+    Vector4 rotation;
+} EntityUpdate;
+
+// Entity flags. Bits 0-15 are behaviour flags, which the archetype layout
+// uses as ECS tags; bits 16-31 hold the material id for the render sort key.
+#define ENTITY_FLAG_VELOCITY  0x01
+#define ENTITY_FLAG_GRAVITY   0x02
+#define ENTITY_MATERIAL_SHIFT 16
+
+// Entity storage layouts
+typedef enum {
+    ENTITY_STORAGE_AOS = 0,  // MetaverseEntity array (default)
+    ENTITY_STORAGE_SOA,      // Separate x/y/z/w streams for SIMD kernels
+    ENTITY_STORAGE_ARCHETYPE // ECS chunks grouped by flag set, branch-free systems
+} EntityStorageMode;
+
+// Structure-of-arrays entity storage
+// Streams are 64-byte aligned and capacity is a multiple of 64 entities, so the
+// integration kernels can run whole vectors past entity_count (padding lanes
+// have no flag bits set and are left untouched).
+typedef struct {
+    float* position[4];       // x, y, z, w streams
+    float* rotation[4];
+    float* scale[4];
+    uint64_t* entity_id;
+    uint8_t* entity_type;
+    uint32_t* flags;
+    uint64_t* velocity_bits;  // One bit per entity (ENTITY_FLAG_VELOCITY)
+    uint64_t* gravity_bits;   // One bit per entity (ENTITY_FLAG_GRAVITY)
+    uint32_t capacity;
+} EntitySoA;
+
+// Sweep-and-prune broadphase (metaverse_broadphase_sap.c)
+typedef struct SweepAndPrune SweepAndPrune;
+
+typedef struct {
+    float min[3];
+    float max[3];
+} SapBox;
+
+typedef struct {
+    uint32_t a;                 // a < b, dense indices
+    uint32_t b;
+} BroadphasePair;
+
+typedef struct {
+    uint32_t axis;
+    uint32_t bodies;
+    uint32_t pairs;
+    uint32_t rebuilds;
+    uint64_t swaps;
+} SapStats;
+
+SweepAndPrune* sap_create(void);
+void sap_destroy(SweepAndPrune* sap);
+SapBox* sap_update_begin(SweepAndPrune* sap, uint32_t count);
+uint32_t sap_update_end(SweepAndPrune* sap, const BroadphasePair** pairs);
+void sap_swap_remove(SweepAndPrune* sap, uint32_t index, uint32_t last);
+void sap_reset(SweepAndPrune* sap);
+void sap_get_stats(SweepAndPrune* sap, SapStats* stats);
+
+// Broadphase backends, switchable between frames
+typedef enum {
+    BROADPHASE_GRID = 0,        // Persistent sparse hashed grid, fixed cell size
+    BROADPHASE_SAP,             // Sweep-and-prune on the axis of greatest variance
+    BROADPHASE_BACKEND_COUNT
+} BroadphaseBackend;
+
+// Last frame run on a backend. Grid pairs are cell neighbours; SAP pairs are
+// AABB overlaps, so SAP hands the narrowphase fewer pairs in mixed scenes.
+typedef struct {
+    uint64_t frames;
+    uint32_t pairs;
+    double update_us;           // Structure update (grid rebucketing, SAP sort)
+    double pair_us;             // Pair generation
+    double narrowphase_us;      // check_collision over all pairs, plus write-back
+} BroadphaseStats;
+
+#define BROADPHASE_PAIR_BATCH 64  // Pairs per check_collision batch
+
+// Persistent sparse broadphase grid
+#define BROADPHASE_CELL_SIZE 10.0f
+#define GRID_NONE            UINT32_MAX
+
+typedef struct {
+    uint64_t key;         // Packed cell coordinates
+    uint32_t* members;    // Dense entity indices
+    uint32_t count;
+    uint32_t capacity;
+} BroadphaseCell;
+
+typedef struct {
+    BroadphaseCell* cells;  // Occupied cells only
+    uint32_t cell_count;
+    uint32_t cell_capacity;
+    
+    uint32_t* buckets;      // Open-addressing hash: cell key -> cells[] index
+    uint32_t bucket_capacity;
+    
+    uint32_t* entity_cell;  // Per entity: current cell, or GRID_NONE
+    uint32_t* entity_slot;  // Per entity: position in that cell's member list
+    uint32_t entity_capacity;
+    uint32_t tracked_count;
+    
+    // Candidate pairs from the last update
+    BroadphasePair* pairs;
+    uint32_t pair_count;
+    uint32_t pair_capacity;
+    
+    float inv_cell_size;
+} BroadphaseGrid;
+
+// Render batching
+#define RENDER_FRAMES_IN_FLIGHT 3
+#define INSTANCE_FLOATS         12  // position, rotation, scale (xyzw each)
+#define INSTANCE_ATTRIB_BASE    4   // Vertex attribute locations 4..6
+
+// Frustum culling
+#define ENTITY_BOUNDING_RADIUS  1.0f  // Mesh-space radius, scaled by the largest scale axis
+#define CULL_VISIBLE            0xFF  // Cached plane id: no plane rejected the entity
+
+typedef struct {
+    uint8_t entity_type;
+    uint8_t shader;
+    uint16_t material;
+    uint32_t first_instance;    // Base instance in the ring buffer
+    uint32_t count;
+} RenderBatch;
+
+// Persistent instance buffer, one segment per frame in flight
+typedef struct {
+    float* data;                // Mapped GL storage, or heap memory when headless
+    GLuint buffer;              // 0 when headless
+    GLsync fences[RENDER_FRAMES_IN_FLIGHT];
+    uint32_t segment_capacity;  // Instances per segment
+    uint32_t frame;
+    uint32_t generation;        // Bumped on every reallocation
+    bool use_gl;
+} InstanceRing;
+
+// Per-frame render work, reused across frames (grows, never shrinks)
+typedef struct {
+    uint32_t* visible;          // Dense indices of visible entities
+    uint32_t visible_count;
+    
+    // Culling: last rejecting plane per dense index
+    uint8_t* cull_plane;
+    
+    // Radix sort keys and payloads, plus ping-pong scratch
+    uint64_t* keys;
+    uint64_t* keys_tmp;
+    uint32_t* items;
+    uint32_t* items_tmp;
+    uint32_t capacity;
+    
+    RenderBatch* batches;
+    uint32_t batch_count;
+    uint32_t batch_capacity;
+    
+    InstanceRing ring;
+    uint32_t ring_base;         // First instance of this frame's segment
+    
+    // Upload target when persistent mapping is unavailable
+    GLuint upload_buffer;
+    
+    // What the instance attributes point at; a deleted buffer's name can be
+    // handed out again, so the ring generation is compared as well
+    GLuint attribs_buffer;
+    uint32_t attribs_generation;
+} RenderQueue;
+
+// Job system (metaverse_jobs.c)
+typedef struct JobSystem JobSystem;
+typedef struct JobGraph JobGraph;
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+JobSystem* job_system_create(uint32_t thread_count);
+void job_system_destroy(JobSystem* system);
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+JobGraph* job_graph_create(void);
+void job_graph_destroy(JobGraph* graph);
+uint32_t job_graph_add(JobGraph* graph, const char* name, JobFunc func, void* data);
+bool job_graph_depend(JobGraph* graph, uint32_t node, uint32_t dependency);
+void job_graph_run(JobSystem* system, JobGraph* graph);
+
+// Entities per parallel-for chunk; a multiple of 64 so SoA chunks never
+// share a flag bitset word or a SIMD vector
+#define WORLD_INTEGRATE_GRAIN 4096
+
+// Entity id index (metaverse_entity_index.c)
+typedef struct EntityIndex EntityIndex;
+typedef uint64_t EntityHandle;
+
+#define ENTITY_HANDLE_INVALID 0
+#define ENTITY_INDEX_NONE     UINT32_MAX
+
+EntityIndex* entity_index_create(uint32_t initial_capacity);
+void entity_index_destroy(EntityIndex* index);
+EntityHandle entity_index_insert(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_remove(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_lookup(const EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_resolve(const EntityIndex* index, EntityHandle handle);
+
+// Archetype ECS (metaverse_ecs.c)
+typedef struct EcsWorld EcsWorld;
+typedef struct EcsChunk EcsChunk;
+typedef uint32_t EcsMask;
+typedef uint64_t EcsEntity;
+typedef void (*EcsSystemFunc)(EcsChunk* chunk, void* data);
+
+#define ECS_ENTITY_INVALID 0
+
+EcsWorld* ecs_world_create(void);
+void ecs_world_destroy(EcsWorld* world);
+bool ecs_register_component(EcsWorld* world, uint32_t component, size_t size);
+EcsEntity ecs_create(EcsWorld* world, EcsMask mask);
+void ecs_destroy(EcsWorld* world, EcsEntity entity);
+bool ecs_set_mask(EcsWorld* world, EcsEntity entity, EcsMask mask);
+EcsMask ecs_get_mask(EcsWorld* world, EcsEntity entity);
+void* ecs_get(EcsWorld* world, EcsEntity entity, uint32_t component);
+uint32_t ecs_chunk_count(const EcsChunk* chunk);
+void* ecs_chunk_column(const EcsChunk* chunk, uint32_t component);
+uint32_t ecs_system_add(EcsWorld* world, const char* name, EcsMask all, EcsMask none,
+                        EcsMask read, EcsMask write, EcsSystemFunc func, void* data);
+void ecs_run_systems(EcsWorld* world, JobSystem* jobs);
+
+// Archetype storage: behaviour flag bits 0-15 are tags, so an entity's
+// archetype is its flag set; the material bits above them stay out of the
+// mask, or every material would get its own chunks. Data components sit
+// above the tags.
+#define ENTITY_TAG_MASK            0x0000FFFFu
+#define ENTITY_TAG_COUNT           16
+#define ENTITY_COMPONENT_POSITION  24  // Vector4
+#define ENTITY_COMPONENT_ROTATION  25  // Vector4
+#define ENTITY_COMPONENT_SCALE     26  // Vector4
+#define ENTITY_COMPONENT_INFO      27  // EntityInfo
+#define ENTITY_ARCHETYPE_BASE      ((1u << ENTITY_COMPONENT_POSITION) | \
+                                    (1u << ENTITY_COMPONENT_ROTATION) | \
+                                    (1u << ENTITY_COMPONENT_SCALE) | \
+                                    (1u << ENTITY_COMPONENT_INFO))
+
 typedef struct {
+    uint64_t entity_id;
+    uint32_t flags;             // Full flags, including bits above the tags
+    uint8_t entity_type;
+} EntityInfo;
+
+typedef struct MeshData {
     float* vertex_data;
     float* normal_data;
     float* uv_data;
+    uint32_t* index_data;       // NULL for unindexed triangle lists
+    uint32_t index_count;
     uint32_t vertex_count;
     uint32_t triangle_count;
     uint32_t lod_level;
+    float lod_error;            // Simplification error relative to the mesh extent
+    struct MeshData* next_lod;  // Next coarser level, or NULL
     bool dynamic;
     bool compressed;
 } MeshData;
 
+// Mesh processing (metaverse_mesh.c)
+MeshData* metaverse_mesh_build_lods(const MeshData* mesh, uint32_t lod_count, float reduction);
+void metaverse_mesh_build_lods_batch(JobSystem* jobs, MeshData** meshes, MeshData** chains,
+                                     uint32_t count, uint32_t lod_count, float reduction);
+void metaverse_mesh_free(MeshData* mesh);
+
+typedef enum {
+    TEXTURE_FORMAT_RGBA8 = 0,   // Uncompressed, `channels` bytes per pixel
+    TEXTURE_FORMAT_BC1,         // 8 bytes per 4x4 block, opaque RGB
+    TEXTURE_FORMAT_BC3,         // 16 bytes per block, RGB + interpolated alpha
+    TEXTURE_FORMAT_BC7          // 16 bytes per block, RGBA (mode 6)
+} TextureFormat;
+
 typedef struct {
-    uint8_t* texture_data;
+    uint8_t* texture_data;      // Mip levels back to back, largest first
+    size_t data_size;           // Bytes in texture_data
     int width;
     int height;
     int channels;
+    TextureFormat format;
+    uint32_t mip_count;         // Levels in texture_data (0 is treated as 1)
     GLuint gl_texture_id;
+    bool srgb;                  // Colour channels are sRGB encoded
     bool mipmapped;
     bool compressed;
 } TextureData;
 
+// Texture compression (metaverse_texture.c)
+void metaverse_texture_set_job_system(JobSystem* jobs);
+size_t metaverse_texture_compressed_size(TextureFormat format, int width, int height);
+bool generate_mipmaps(TextureData* texture);
+
+// Frame arena (metaverse_frame_arena.c)
+typedef struct FrameArena FrameArena;
+
+#define FRAME_ARENA_INITIAL_SIZE ((size_t)1 << 20)
+
+// Poison released frame memory and report each frame's high-water mark
+#ifndef METAVERSE_ARENA_DEBUG
+#define METAVERSE_ARENA_DEBUG 0
+#endif
+
+typedef struct {
+    uint64_t frame;
+    size_t frame_bytes;
+    size_t high_water;
+    size_t reserved;
+    uint32_t threads;
+} FrameArenaStats;
+
+FrameArena* frame_arena_create(size_t initial_size, bool debug, void (*report)(const char*));
+void frame_arena_destroy(FrameArena* arena);
+void* frame_arena_alloc(FrameArena* arena, size_t size);
+void frame_arena_reset(FrameArena* arena);
+void frame_arena_get_stats(FrameArena* arena, FrameArenaStats* stats);
+void frame_arena_bind(FrameArena* arena);
+void* frame_alloc(size_t size);
+void* frame_alloc_carry(size_t size);
+
+// Asset cache (metaverse_asset_cache.c)
+typedef struct AssetCache AssetCache;
+typedef uint64_t AssetKey;
+typedef uint64_t AssetHandle;
+
+#define ASSET_HANDLE_INVALID 0
+#define MESH_CACHE_BUDGET    ((size_t)256 << 20)
+#define TEXTURE_CACHE_BUDGET ((size_t)512 << 20)
+
+#define MESH_IMPORT_LODS      4         // Levels built per imported mesh
+#define MESH_IMPORT_REDUCTION 0.5f      // Triangles kept from one level to the next
+
+typedef enum {
+    ASSET_EVICT_LRU = 0,
+    ASSET_EVICT_CLOCK
+} AssetEvictPolicy;
+
+typedef void (*AssetFreeFunc)(void* asset, void* data);
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t insertions;
+    size_t bytes_resident;
+    size_t bytes_budget;
+    size_t bytes_evicted;
+    uint32_t entries;
+    uint32_t referenced;
+} AssetCacheStats;
+
+AssetCache* asset_cache_create(size_t budget, AssetEvictPolicy policy, AssetFreeFunc free_asset,
+                               void* free_data);
+void asset_cache_destroy(AssetCache* cache);
+AssetKey asset_hash(const void* data, size_t size, AssetKey seed);
+AssetHandle asset_cache_acquire(AssetCache* cache, AssetKey key);
+AssetHandle asset_cache_insert(AssetCache* cache, AssetKey key, void* asset, size_t bytes);
+AssetHandle asset_cache_retain(AssetCache* cache, AssetHandle handle);
+void asset_cache_release(AssetCache* cache, AssetHandle handle);
+void* asset_cache_get(AssetCache* cache, AssetHandle handle);
+void asset_cache_set_budget(AssetCache* cache, size_t budget);
+void asset_cache_get_stats(AssetCache* cache, AssetCacheStats* stats);
+
+// Input ring (metaverse_input.c)
+typedef struct InputRing InputRing;
+
+#define INPUT_RING_CAPACITY     4096
+#define INPUT_MAX_DEVICES       8
+#define INPUT_MAX_CONTROLS      64
+#define INPUT_LATENCY_BUCKETS   32
+
+typedef struct {
+    uint64_t timestamp;
+    uint16_t device;
+    uint16_t control;
+    uint8_t type;
+    float value;
+} InputEvent;
+
+typedef struct {
+    float axes[INPUT_MAX_DEVICES][INPUT_MAX_CONTROLS];
+    uint64_t buttons_down[INPUT_MAX_DEVICES];
+    InputEvent* button_events;
+    uint32_t button_event_count;
+    uint32_t button_event_capacity;
+    uint32_t axis_events;
+    uint32_t axes_changed;
+    uint64_t frame;
+} InputFrame;
+
+typedef struct {
+    uint64_t events;
+    uint64_t axis_events;
+    uint64_t button_events;
+    uint64_t coalesced;
+    uint64_t dropped;
+    uint64_t edges_lost;
+    uint64_t rejected;
+    double latency_max_us;
+    double latency_sum_us;
+    double frame_latency_max_us;
+    uint64_t histogram[INPUT_LATENCY_BUCKETS];
+} InputLatencyStats;
+
+InputRing* input_ring_create(uint32_t capacity);
+void input_ring_destroy(InputRing* ring);
+bool input_push_axis(InputRing* ring, uint16_t device, uint16_t control, float value);
+bool input_push_button(InputRing* ring, uint16_t device, uint16_t control, bool pressed);
+uint32_t input_ring_drain(InputRing* ring, InputFrame* frame);
+void input_ring_get_stats(InputRing* ring, InputLatencyStats* stats);
+double input_latency_percentile(const InputLatencyStats* stats, double percentile);
+bool input_button_down(const InputFrame* frame, uint16_t device, uint16_t control);
+void input_frame_free(InputFrame* frame);
+
+// World snapshots
+// Simulation writes frame N+1 into the live entity storage while render and
+// network serialization read an immutable copy of frame N. Slots rotate so
+// the writer always finds one that is neither the front nor still held by a
+// slow reader; publishing is a single atomic pointer exchange.
+#define WORLD_SNAPSHOT_COUNT 3
+
+typedef struct {
+    uint64_t frame;
+    uint32_t entity_count;
+    uint32_t capacity;
+    MetaverseEntity* entities;  // Dense order, same indices as the live world
+    float* cull_stream[6];      // x, y, z, scale x, y, z for the cull kernels
+    Vector4 camera_position;
+    atomic_uint readers;
+} WorldSnapshot;
+
 // Spatial audio system
+// Emitters live in stable slots (ids stay valid until removed) and grow
+// without a fixed limit. Each update scores every emitter by loudness at the
+// listener times priority; only the top audio_voice_limit hold a real voice
+// and reach the backend. The rest are virtual: their state is kept and they
+// take a voice back as soon as they rank high enough again.
+#define AUDIO_EMITTER_INITIAL   64
+#define AUDIO_EMITTER_INVALID   UINT32_MAX
+#define AUDIO_VOICE_LIMIT       32       // Default real voices
+#define AUDIO_MAX_DISTANCE      100.0f   // Default audible range in metres
+#define AUDIO_AUDIBLE_GAIN      0.001f   // Quieter than this is virtual
+#define AUDIO_VOICE_HYSTERESIS  1.1f     // Rank bonus for voiced emitters, avoids flapping
+#define AUDIO_SPEED_OF_SOUND    343.0f
+
 typedef struct {
     float position[3];
     float velocity[3];
     float orientation[4];
     float volume;
-    float pitch;
+    float pitch;            // Authored pitch; Doppler is applied to the output only
+    float priority;         // Rank weight, 0 = default (1)
+    float max_distance;     // Spatialized range, 0 = AUDIO_MAX_DISTANCE
     bool spatialized;
     bool looping;
     uint32_t source_id;
+    
+    // Voice manager state
+    bool active;            // Slot in use
+    bool voiced;            // Holds a real voice
+    float score;            // Last loudness x priority, 0 when inaudible
+    uint32_t next_free;     // Free slot chain while inactive
 } AudioEmitter;
 
+typedef struct {
+    float position[3];
+    float forward[3];
+    float up[3];
+    float velocity[3];
+} AudioListener;
+
+typedef struct {
+    uint32_t emitters;      // Active emitters
+    uint32_t audible;       // In range and above AUDIO_AUDIBLE_GAIN
+    uint32_t voiced;        // Holding a real voice
+    uint32_t virtualized;   // Active without a voice
+    uint32_t promotions;    // Virtual to voiced this update
+    uint32_t demotions;     // Voiced to virtual this update
+} AudioVoiceStats;
+
 // Godot Metaverse Amplifier
 typedef struct {
     GodotAPI godot;
@@ -80,18 +557,72 @@ typedef struct {
     uint32_t entity_count;
     uint32_t entity_capacity;
     
+    // Entity storage layout (outside AoS mode, entities is a lazily synced mirror)
+    EntityStorageMode storage_mode;
+    EntitySoA soa;
+    EcsWorld* ecs;                  // Archetype mode only
+    EcsEntity* ecs_entities;        // Dense slot -> ECS entity, entity_capacity long
+    float simulate_delta;           // Step read by the ECS systems
+    bool aos_dirty;
+    
+    // entity_id -> dense slot, plus generational handles
+    EntityIndex* entity_index;
+    
+    // Physics broadphase (persists across frames)
+    BroadphaseBackend broadphase_backend;
+    BroadphaseGrid broadphase;
+    SweepAndPrune* sap;             // Created on first switch to BROADPHASE_SAP
+    BroadphaseStats broadphase_stats[BROADPHASE_BACKEND_COUNT];
+    
+    // Published world state; readers pin the front slot, never lock
+    WorldSnapshot snapshots[WORLD_SNAPSHOT_COUNT];
+    _Atomic(WorldSnapshot*) world_front;
+    uint64_t world_frame;
+    uint32_t snapshot_skips;        // Publishes dropped because every back slot was pinned
+    
     // Rendering enhancements
-    MeshData* mesh_cache;
-    TextureData* texture_cache;
-    uint32_t cache_size;
+    RenderQueue render_queue;
+    Vector4 camera_position;
+    AssetCache* mesh_cache;         // Keyed by content hash, refcounted
+    AssetCache* texture_cache;
+    
+    // GL names of evicted textures. Eviction runs on any thread with the cache
+    // locked, so the render thread deletes them at the start of its next frame
+    GLuint* texture_release;
+    uint32_t texture_release_count;
+    uint32_t texture_release_capacity;
+    GLuint* texture_deleting;       // Render thread's side of the swap
+    uint32_t texture_deleting_capacity;
+    pthread_mutex_t texture_release_lock;
     
     // Spatial audio
     AudioEmitter* audio_emitters;
-    uint32_t emitter_count;
-    
-    // Networking
+    uint32_t emitter_count;         // Slots in use or on the free chain
+    uint32_t emitter_capacity;
+    uint32_t emitter_free;          // First free slot, AUDIO_EMITTER_INVALID if none
+    AudioListener audio_listener;
+    uint32_t audio_voice_limit;
+    AudioVoiceStats audio_stats;
+    
+    // Job system and per-frame phase graph
+    JobSystem* jobs;
+    JobGraph* frame_graph;
+    FrameArena* frame_arena;        // Transient per-frame allocations, all threads
+    double frame_delta;
+    
+    // Input: OS threads push into the ring, each frame drains it into input
+    InputRing* input_ring;
+    InputFrame input;
+    
+    // Networking. The network thread only queues remote updates; world_simulate
+    // applies them while it holds world_lock for writing, so entity storage
+    // never changes under the job workers.
     pthread_t net_thread;
     bool network_active;
+    EntityUpdate* remote_updates;
+    uint32_t remote_update_count;
+    uint32_t remote_update_capacity;
+    pthread_mutex_t remote_update_lock;
     uint32_t player_count;
     
     // Performance metrics
@@ -112,16 +643,66 @@ MetaverseAmplifier* metaverse_amplifier_create(GodotAPI* api);
 void metaverse_amplifier_init(MetaverseAmplifier* amp);
 void metaverse_amplifier_destroy(MetaverseAmplifier* amp);
 void metaverse_update_world(MetaverseAmplifier* amp, double delta_time);
+void metaverse_run_frame(MetaverseAmplifier* amp, double delta_time);
+bool metaverse_set_thread_count(MetaverseAmplifier* amp, uint32_t thread_count);
+static JobGraph* metaverse_build_frame_graph(MetaverseAmplifier* amp);
 void metaverse_render_enhanced(MetaverseAmplifier* amp);
-void metaverse_process_input(MetaverseAmplifier* amp, float* input_state);
+uint32_t metaverse_build_render_batches(MetaverseAmplifier* amp, const WorldSnapshot* world,
+                                       RenderQueue* queue);
+uint32_t metaverse_cull_entities(const WorldSnapshot* world, RenderQueue* queue,
+                                 const float planes[6][4]);
+void metaverse_process_input(MetaverseAmplifier* amp, const InputFrame* input);
+InputRing* metaverse_input_ring(MetaverseAmplifier* amp);
+void metaverse_get_input_stats(MetaverseAmplifier* amp, InputLatencyStats* stats);
 void metaverse_network_update(MetaverseAmplifier* amp);
 void metaverse_spatial_audio_update(MetaverseAmplifier* amp);
 void metaverse_physics_optimized(MetaverseAmplifier* amp, double delta_time);
+bool metaverse_set_broadphase(MetaverseAmplifier* amp, BroadphaseBackend backend);
+void metaverse_get_broadphase_stats(MetaverseAmplifier* amp, BroadphaseBackend backend,
+                                    BroadphaseStats* stats);
 MeshData* metaverse_mesh_optimize(MeshData* mesh, int target_vertices);
 TextureData* metaverse_texture_compress(TextureData* texture, int quality);
-void metaverse_entity_add(MetaverseAmplifier* amp, MetaverseEntity* entity);
+AssetKey metaverse_mesh_key(const MeshData* mesh);
+AssetKey metaverse_texture_key(const TextureData* texture);
+AssetHandle metaverse_mesh_acquire(MetaverseAmplifier* amp, MeshData* mesh);
+AssetHandle metaverse_texture_acquire(MetaverseAmplifier* amp, TextureData* texture);
+bool metaverse_import_meshes(MetaverseAmplifier* amp, MeshData** meshes, uint32_t count,
+                             AssetHandle* handles);
+void metaverse_set_cache_budget(MetaverseAmplifier* amp, size_t mesh_bytes, size_t texture_bytes);
+void metaverse_get_cache_stats(MetaverseAmplifier* amp, AssetCacheStats* mesh_stats,
+                               AssetCacheStats* texture_stats);
+static void cache_free_mesh(void* asset, void* data);
+static void cache_free_texture(void* asset, void* data);
+static void metaverse_release_textures(MetaverseAmplifier* amp);
+EntityHandle metaverse_entity_add(MetaverseAmplifier* amp, MetaverseEntity* entity);
 void metaverse_entity_remove(MetaverseAmplifier* amp, uint64_t entity_id);
 void metaverse_entity_update(MetaverseAmplifier* amp, MetaverseEntity* entity);
+uint32_t metaverse_entity_resolve(MetaverseAmplifier* amp, EntityHandle handle);
+void metaverse_entity_get(MetaverseAmplifier* amp, uint32_t index, MetaverseEntity* out);
+void metaverse_entity_set(MetaverseAmplifier* amp, uint32_t index, const MetaverseEntity* entity);
+MetaverseEntity* metaverse_entity_view(MetaverseAmplifier* amp);
+bool metaverse_set_storage_mode(MetaverseAmplifier* amp, EntityStorageMode mode);
+const WorldSnapshot* metaverse_snapshot_acquire(MetaverseAmplifier* amp);
+void metaverse_snapshot_release(const WorldSnapshot* snapshot);
+static void world_publish_snapshot(MetaverseAmplifier* amp);
+static void world_snapshot_free(WorldSnapshot* snapshot);
+static bool render_queue_reserve(RenderQueue* queue, uint32_t count);
+uint32_t metaverse_audio_emitter_add(MetaverseAmplifier* amp, const AudioEmitter* emitter);
+void metaverse_audio_emitter_remove(MetaverseAmplifier* amp, uint32_t emitter_id);
+AudioEmitter* metaverse_audio_emitter_get(MetaverseAmplifier* amp, uint32_t emitter_id);
+void metaverse_audio_set_listener(MetaverseAmplifier* amp, const AudioListener* listener);
+void metaverse_audio_set_voice_limit(MetaverseAmplifier* amp, uint32_t voices);
+void metaverse_audio_get_stats(MetaverseAmplifier* amp, AudioVoiceStats* stats);
+double get_time();
+
+// Engine-side hooks, provided by the host (stubbed in metaverse_bench.c)
+void calculate_frustum(float frustum[6][4]);
+void setup_shader_for_type(uint8_t entity_type);
+int get_vertex_count_for_type(uint8_t entity_type);
+void apply_post_processing(void);
+void update_audio_source(uint32_t source_id, float left_gain, float right_gain, float pitch);
+void check_collision(MetaverseEntity* a, MetaverseEntity* b, double delta_time);
+void metaverse_send_updates(const WorldSnapshot* world, int sockfd);
 
 // Core amplifier creation
 MetaverseAmplifier* metaverse_amplifier_create(GodotAPI* api) {
@@ -135,21 +716,50 @@ MetaverseAmplifier* metaverse_amplifier_create(GodotAPI* api) {
     amp->entity_capacity = 1024;
     amp->entities = malloc(sizeof(MetaverseEntity) * amp->entity_capacity);
     amp->entity_count = 0;
+    amp->storage_mode = ENTITY_STORAGE_AOS;
+    amp->aos_dirty = false;
+    amp->entity_index = entity_index_create(amp->entity_capacity);
     
     // Initialize mesh/texture cache
-    amp->cache_size = 128;
-    amp->mesh_cache = malloc(sizeof(MeshData) * amp->cache_size);
-    amp->texture_cache = malloc(sizeof(TextureData) * amp->cache_size);
+    amp->mesh_cache = asset_cache_create(MESH_CACHE_BUDGET, ASSET_EVICT_LRU, cache_free_mesh,
+                                         NULL);
+    amp->texture_cache = asset_cache_create(TEXTURE_CACHE_BUDGET, ASSET_EVICT_CLOCK,
+                                            cache_free_texture, amp);
     
-    // Initialize audio emitters
+    // Initialize audio emitters; the listener starts at head height facing -Z
     amp->emitter_count = 0;
-    amp->audio_emitters = malloc(sizeof(AudioEmitter) * 64);
+    amp->emitter_capacity = AUDIO_EMITTER_INITIAL;
+    amp->emitter_free = AUDIO_EMITTER_INVALID;
+    amp->audio_emitters = malloc(sizeof(AudioEmitter) * amp->emitter_capacity);
+    amp->audio_listener = (AudioListener){
+        .position = { 0.0f, 1.7f, 0.0f },
+        .forward = { 0.0f, 0.0f, -1.0f },
+        .up = { 0.0f, 1.0f, 0.0f }
+    };
+    amp->audio_voice_limit = AUDIO_VOICE_LIMIT;
+    
+    // Input event ring, fed by OS input threads
+    amp->input_ring = input_ring_create(INPUT_RING_CAPACITY);
     
     // Initialize synchronization primitives
     pthread_mutex_init(&amp->entity_mutex, NULL);
     pthread_mutex_init(&amp->render_mutex, NULL);
+    pthread_mutex_init(&amp->texture_release_lock, NULL);
+    pthread_mutex_init(&amp->remote_update_lock, NULL);
     pthread_rwlock_init(&amp->world_lock, NULL);
     
+    // Job system: one worker per core, calling thread included
+    amp->jobs = job_system_create(0);
+    amp->frame_graph = metaverse_build_frame_graph(amp);
+    metaverse_texture_set_job_system(amp->jobs);
+    
+    // Frame arena behind the GodotAPI frame allocation hooks
+    amp->frame_arena = frame_arena_create(FRAME_ARENA_INITIAL_SIZE, METAVERSE_ARENA_DEBUG,
+                                          amp->godot.godot_print);
+    frame_arena_bind(amp->frame_arena);
+    if (!amp->godot.godot_frame_alloc) amp->godot.godot_frame_alloc = frame_alloc;
+    if (!amp->godot.godot_frame_alloc_carry) amp->godot.godot_frame_alloc_carry = frame_alloc_carry;
+    
     // Initialize network
     amp->network_active = false;
     amp->player_count = 1;
@@ -182,6 +792,10 @@ void metaverse_amplifier_init(MetaverseAmplifier* amp) {
         amp->godot.godot_error("ARB_buffer_storage not supported");
     }
     
+    // Persistently mapped instance ring needs buffer storage; otherwise the
+    // ring stays on the heap and each frame's segment is uploaded
+    amp->render_queue.ring.use_gl = GLEW_ARB_buffer_storage;
+    
     if (!GLEW_ARB_multi_draw_indirect) {
         amp->godot.godot_error("ARB_multi_draw_indirect not supported");
     }
@@ -209,357 +823,2025 @@ void metaverse_amplifier_init(MetaverseAmplifier* amp) {
     amp->godot.godot_print("Metaverse Amplifier initialized successfully");
 }
 
-// World update with spatial partitioning
-void metaverse_update_world(MetaverseAmplifier* amp, double delta_time) {
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    
-    // Acquire read lock for world updates
-    pthread_rwlock_rdlock(&amp->world_lock);
+// Broadphase grid
+// Cells are keyed by packed integer coordinates (21 bits per axis, biased),
+// so the grid is unbounded in practice (+/- 1M cells per axis). Only
+// occupied cells exist; a cell is dropped as soon as its last entity leaves.
+static inline uint64_t grid_cell_key(int32_t x, int32_t y, int32_t z) {
+    const uint64_t bias = 1u << 20;
+    return (((uint64_t)(x + bias) & 0x1FFFFF) << 42) |
+           (((uint64_t)(y + bias) & 0x1FFFFF) << 21) |
+           ((uint64_t)(z + bias) & 0x1FFFFF);
+}
+
+static inline uint32_t grid_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+static inline uint64_t grid_key_for_position(const BroadphaseGrid* grid, Vector4 position) {
+    return grid_cell_key((int32_t)floorf(position.x * grid->inv_cell_size),
+                         (int32_t)floorf(position.y * grid->inv_cell_size),
+                         (int32_t)floorf(position.z * grid->inv_cell_size));
+}
+
+static uint32_t grid_find_bucket(const BroadphaseGrid* grid, uint64_t key) {
+    uint32_t mask = grid->bucket_capacity - 1;
+    uint32_t bucket = grid_hash(key) & mask;
     
-    // Update entity positions with SIMD-like optimization
-    for (uint32_t i = 0; i < amp->entity_count; i++) {
-        MetaverseEntity* entity = &amp->entities[i];
-        
-        // Simple physics simulation
-        // In reality, this would use a proper physics engine
-        
-        // Update based on velocity (if present in flags)
-        if (entity->flags & 0x01) {  // HAS_VELOCITY flag
-            // Update position
-            entity->position.x += 0.1f * delta_time;
-            entity->position.y += 0.05f * delta_time;
-        }
-        
-        // Apply gravity if needed
-        if (entity->flags & 0x02) {  // HAS_GRAVITY flag
-            entity->position.y -= 9.8f * delta_time * delta_time;
-            
-            // Simple ground collision
-            if (entity->position.y < 0.0f) {
-                entity->position.y = 0.0f;
-            }
-        }
+    while (grid->buckets[bucket] != GRID_NONE) {
+        if (grid->cells[grid->buckets[bucket]].key == key) return bucket;
+        bucket = (bucket + 1) & mask;
     }
-    
-    pthread_rwlock_unlock(&amp->world_lock);
-    
-    // Update spatial audio
-    metaverse_spatial_audio_update(amp);
-    
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double elapsed = (end.tv_sec - start.tv_sec) + 
-                    (end.tv_nsec - start.tv_nsec) / 1e9;
-    amp->physics_time = 0.9 * amp->physics_time + 0.1 * elapsed;
+    return bucket;  // Empty bucket where key would go
 }
 
-// Enhanced rendering with batch optimization
-void metaverse_render_enhanced(MetaverseAmplifier* amp) {
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    
-    pthread_mutex_lock(&amp->render_mutex);
+static inline uint32_t grid_find_cell(const BroadphaseGrid* grid, uint64_t key) {
+    return grid->buckets[grid_find_bucket(grid, key)];
+}
+
+static bool grid_rehash(BroadphaseGrid* grid, uint32_t bucket_capacity) {
+    uint32_t* buckets = malloc(sizeof(uint32_t) * bucket_capacity);
+    if (!buckets) return false;
     
-    // Clear buffers
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    memset(buckets, 0xFF, sizeof(uint32_t) * bucket_capacity);
+    free(grid->buckets);
+    grid->buckets = buckets;
+    grid->bucket_capacity = bucket_capacity;
     
-    // Frustum culling preparation
-    float frustum[6][4];
-    calculate_frustum(frustum);
+    for (uint32_t c = 0; c < grid->cell_count; c++) {
+        grid->buckets[grid_find_bucket(grid, grid->cells[c].key)] = c;
+    }
+    return true;
+}
+
+static uint32_t grid_create_cell(BroadphaseGrid* grid, uint64_t key) {
+    // Keep the bucket table at most half full
+    if ((grid->cell_count + 1) * 2 > grid->bucket_capacity &&
+        !grid_rehash(grid, grid->bucket_capacity ? grid->bucket_capacity * 2 : 1024)) {
+        return GRID_NONE;
+    }
     
-    uint32_t visible_count = 0;
-    uint32_t draw_calls = 0;
+    if (grid->cell_count == grid->cell_capacity) {
+        uint32_t new_capacity = grid->cell_capacity ? grid->cell_capacity * 2 : 256;
+        BroadphaseCell* cells = realloc(grid->cells, sizeof(BroadphaseCell) * new_capacity);
+        if (!cells) return GRID_NONE;
+        grid->cells = cells;
+        grid->cell_capacity = new_capacity;
+    }
     
-    // Batch entities by material/shader
-    EntityBatch batches[32];
-    uint32_t batch_count = 0;
+    uint32_t c = grid->cell_count++;
+    grid->cells[c].key = key;
+    grid->cells[c].members = NULL;
+    grid->cells[c].count = 0;
+    grid->cells[c].capacity = 0;
+    grid->buckets[grid_find_bucket(grid, key)] = c;
+    return c;
+}
+
+// Drop an empty cell: backward-shift its bucket out, then move the last
+// cell into its place and patch that cell's bucket and members
+static void grid_destroy_cell(BroadphaseGrid* grid, uint32_t c) {
+    uint32_t mask = grid->bucket_capacity - 1;
+    uint32_t hole = grid_find_bucket(grid, grid->cells[c].key);
+    uint32_t next = (hole + 1) & mask;
+    
+    while (grid->buckets[next] != GRID_NONE) {
+        uint32_t home = grid_hash(grid->cells[grid->buckets[next]].key) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            grid->buckets[hole] = grid->buckets[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    grid->buckets[hole] = GRID_NONE;
     
-    pthread_rwlock_rdlock(&amp->world_lock);
+    free(grid->cells[c].members);
     
-    for (uint32_t i = 0; i < amp->entity_count; i++) {
-        MetaverseEntity* entity = &amp->entities[i];
-        
-        // Frustum culling
-        if (!is_in_frustum(entity->position, frustum)) {
-            continue;
-        }
-        
-        visible_count++;
-        
-        // Find or create batch for this entity type
-        bool found_batch = false;
-        for (uint32_t b = 0; b < batch_count; b++) {
-            if (batches[b].entity_type == entity->entity_type) {
-                batches[b].entities[batches[b].count++] = entity;
-                found_batch = true;
-                break;
-            }
-        }
-        
-        if (!found_batch && batch_count < 32) {
-            batches[batch_count].entity_type = entity->entity_type;
-            batches[batch_count].count = 1;
-            batches[batch_count].entities[0] = entity;
-            batch_count++;
+    uint32_t last = --grid->cell_count;
+    if (c != last) {
+        grid->cells[c] = grid->cells[last];
+        grid->buckets[grid_find_bucket(grid, grid->cells[c].key)] = c;
+        for (uint32_t m = 0; m < grid->cells[c].count; m++) {
+            grid->entity_cell[grid->cells[c].members[m]] = c;
         }
     }
-    
-    // Render batches
-    for (uint32_t b = 0; b < batch_count; b++) {
-        EntityBatch* batch = &batches[b];
-        
-        // Setup shader for this batch
-        setup_shader_for_type(batch->entity_type);
-        
-        // Prepare instanced rendering data
-        float* instance_data = prepare_instance_data(batch);
-        
-        // Single draw call for entire batch
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 
-                             get_vertex_count_for_type(batch->entity_type),
-                             batch->count);
-        
-        draw_calls++;
-        
-        free(instance_data);
+}
+
+static bool grid_cell_push(BroadphaseGrid* grid, uint32_t c, uint32_t entity) {
+    BroadphaseCell* cell = &grid->cells[c];
+    
+    if (cell->count == cell->capacity) {
+        uint32_t new_capacity = cell->capacity ? cell->capacity * 2 : 8;
+        uint32_t* members = realloc(cell->members, sizeof(uint32_t) * new_capacity);
+        if (!members) return false;
+        cell->members = members;
+        cell->capacity = new_capacity;
     }
     
-    pthread_rwlock_unlock(&amp->world_lock);
-    
-    // Post-processing effects
-    if (amp->frame_time < 0.025) {  // Only if we have time
-        apply_post_processing();
-    }
+    grid->entity_cell[entity] = c;
+    grid->entity_slot[entity] = cell->count;
+    cell->members[cell->count++] = entity;
+    return true;
+}
+
+static void grid_cell_pop(BroadphaseGrid* grid, uint32_t entity) {
+    uint32_t c = grid->entity_cell[entity];
+    BroadphaseCell* cell = &grid->cells[c];
+    uint32_t slot = grid->entity_slot[entity];
     
-    pthread_mutex_unlock(&amp->render_mutex);
+    uint32_t moved = cell->members[--cell->count];
+    cell->members[slot] = moved;
+    grid->entity_slot[moved] = slot;
     
-    // Update performance metrics
-    amp->draw_calls = draw_calls;
+    grid->entity_cell[entity] = GRID_NONE;
     
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double elapsed = (end.tv_sec - start.tv_sec) + 
-                    (end.tv_nsec - start.tv_nsec) / 1e9;
-    amp->render_time = 0.9 * amp->render_time + 0.1 * elapsed;
-    amp->fps = (uint32_t)(1.0 / amp->frame_time);
+    if (cell->count == 0) {
+        grid_destroy_cell(grid, c);
+    }
 }
 
-// Mesh optimization with simplification
-MeshData* metaverse_mesh_optimize(MeshData* mesh, int target_vertices) {
-    if (!mesh || mesh->vertex_count <= target_vertices) {
-        return mesh;
-    }
+static bool broadphase_grid_reserve(BroadphaseGrid* grid, uint32_t entity_count) {
+    if (entity_count <= grid->entity_capacity) return true;
     
-    MeshData* optimized = malloc(sizeof(MeshData));
-    optimized->vertex_count = target_vertices;
-    optimized->triangle_count = target_vertices / 3;
-    optimized->lod_level = mesh->lod_level + 1;
-    optimized->dynamic = mesh->dynamic;
-    optimized->compressed = true;
+    uint32_t new_capacity = grid->entity_capacity ? grid->entity_capacity : 1024;
+    while (new_capacity < entity_count) new_capacity *= 2;
     
-    // Allocate memory for optimized mesh
-    size_t vertex_data_size = target_vertices * 3 * sizeof(float);
-    size_t normal_data_size = target_vertices * 3 * sizeof(float);
-    size_t uv_data_size = target_vertices * 2 * sizeof(float);
+    uint32_t* entity_cell = realloc(grid->entity_cell, sizeof(uint32_t) * new_capacity);
+    if (!entity_cell) return false;
+    grid->entity_cell = entity_cell;
     
-    optimized->vertex_data = malloc(vertex_data_size);
-    optimized->normal_data = malloc(normal_data_size);
-    optimized->uv_data = malloc(uv_data_size);
+    uint32_t* entity_slot = realloc(grid->entity_slot, sizeof(uint32_t) * new_capacity);
+    if (!entity_slot) return false;
+    grid->entity_slot = entity_slot;
     
-    // Simple mesh simplification (in reality, use QEM or similar)
-    float reduction_ratio = (float)target_vertices / mesh->vertex_count;
-    
-    for (int i = 0; i < target_vertices; i++) {
-        int src_idx = (int)(i / reduction_ratio);
-        
-        // Copy vertex
-        optimized->vertex_data[i * 3] = mesh->vertex_data[src_idx * 3];
-        optimized->vertex_data[i * 3 + 1] = mesh->vertex_data[src_idx * 3 + 1];
-        optimized->vertex_data[i * 3 + 2] = mesh->vertex_data[src_idx * 3 + 2];
-        
-        // Copy normal
-        optimized->normal_data[i * 3] = mesh->normal_data[src_idx * 3];
-        optimized->normal_data[i * 3 + 1] = mesh->normal_data[src_idx * 3 + 1];
-        optimized->normal_data[i * 3 + 2] = mesh->normal_data[src_idx * 3 + 2];
-        
-        // Copy UV
-        optimized->uv_data[i * 2] = mesh->uv_data[src_idx * 2];
-        optimized->uv_data[i * 2 + 1] = mesh->uv_data[src_idx * 2 + 1];
+    for (uint32_t i = grid->entity_capacity; i < new_capacity; i++) {
+        grid->entity_cell[i] = GRID_NONE;
     }
-    
-    return optimized;
+    grid->entity_capacity = new_capacity;
+    return true;
 }
 
-// Texture compression
-TextureData* metaverse_texture_compress(TextureData* texture, int quality) {
-    if (!texture || texture->compressed) {
-        return texture;
+// Incremental update: only entities that crossed a cell boundary move
+static void broadphase_grid_update(BroadphaseGrid* grid, const MetaverseEntity* entities,
+                                   uint32_t entity_count) {
+    if (grid->bucket_capacity == 0) {
+        grid->inv_cell_size = 1.0f / BROADPHASE_CELL_SIZE;
+        if (!grid_rehash(grid, 1024)) return;
     }
     
-    TextureData* compressed = malloc(sizeof(TextureData));
-    compressed->width = texture->width;
-    compressed->height = texture->height;
-    compressed->channels = texture->channels;
-    compressed->mipmapped = texture->mipmapped;
-    compressed->compressed = true;
-    
-    // Simple block compression simulation
-    // In reality, use libsquish, etc10, or hardware compression
-    size_t compressed_size = (texture->width * texture->height * texture->channels) / 4;
-    compressed->texture_data = malloc(compressed_size);
+    if (!broadphase_grid_reserve(grid, entity_count)) return;
     
-    // Simulate compression by downsampling
-    for (int y = 0; y < texture->height; y += 2) {
-        for (int x = 0; x < texture->width; x += 2) {
-            uint32_t src_idx = (y * texture->width + x) * texture->channels;
-            uint32_t dst_idx = ((y / 2) * (texture->width / 2) + (x / 2)) * texture->channels;
-            
-            // Average 2x2 block
-            for (int c = 0; c < texture->channels; c++) {
-                uint32_t sum = texture->texture_data[src_idx + c] +
-                              texture->texture_data[src_idx + texture->channels + c] +
-                              texture->texture_data[src_idx + texture->width * texture->channels + c] +
-                              texture->texture_data[src_idx + texture->width * texture->channels + texture->channels + c];
-                compressed->texture_data[dst_idx + c] = sum / 4;
-            }
+    // Entities removed since the last update (tail of the dense array)
+    for (uint32_t i = entity_count; i < grid->tracked_count; i++) {
+        if (grid->entity_cell[i] != GRID_NONE) {
+            grid_cell_pop(grid, i);
         }
     }
+    grid->tracked_count = entity_count;
     
-    // Generate mipmaps if requested
-    if (compressed->mipmapped) {
-        generate_mipmaps(compressed);
-    }
-    
-    return compressed;
-}
-
-// Spatial audio update with HRTF
-void metaverse_spatial_audio_update(MetaverseAmplifier* amp) {
-    // Listener position (camera/player)
-    float listener_pos[3] = {0.0f, 1.7f, 0.0f};
-    float listener_forward[3] = {0.0f, 0.0f, -1.0f};
-    float listener_up[3] = {0.0f, 1.0f, 0.0f};
-    
-    for (uint32_t i = 0; i < amp->emitter_count; i++) {
-        AudioEmitter* emitter = &amp->audio_emitters[i];
-        
-        if (!emitter->spatialized) continue;
-        
-        // Calculate distance
-        float dx = emitter->position[0] - listener_pos[0];
-        float dy = emitter->position[1] - listener_pos[1];
-        float dz = emitter->position[2] - listener_pos[2];
-        float distance = sqrtf(dx*dx + dy*dy + dz*dz);
-        
-        // Distance attenuation
-        float distance_attenuation = 1.0f / (1.0f + distance * 0.1f);
-        
-        // Calculate direction vector
-        float direction[3] = {dx, dy, dz};
-        normalize_vector(direction);
+    for (uint32_t i = 0; i < entity_count; i++) {
+        uint64_t key = grid_key_for_position(grid, entities[i].position);
+        uint32_t current = grid->entity_cell[i];
         
-        // Calculate stereo panning based on direction
-        float dot_left = dot_product(direction, get_left_vector(listener_forward, listener_up));
-        float dot_front = dot_product(direction, listener_forward);
-        
-        // Simple stereo panning
-        float left_gain = 0.5f * (1.0f - dot_left);
-        float right_gain = 0.5f * (1.0f + dot_left);
-        
-        // Apply distance attenuation
-        left_gain *= distance_attenuation;
-        right_gain *= distance_attenuation;
-        
-        // Apply Doppler effect based on velocity
-        float relative_velocity = calculate_relative_velocity(emitter->velocity, listener_pos);
-        float doppler_factor = 1.0f + relative_velocity / 343.0f;  // Speed of sound
-        emitter->pitch *= doppler_factor;
+        if (current != GRID_NONE) {
+            if (grid->cells[current].key == key) continue;
+            grid_cell_pop(grid, i);
+        }
         
-        // Update audio source (in real implementation, would use OpenAL or similar)
-        update_audio_source(emitter->source_id, left_gain, right_gain, emitter->pitch);
+        uint32_t c = grid_find_cell(grid, key);
+        if (c == GRID_NONE) {
+            c = grid_create_cell(grid, key);
+            if (c == GRID_NONE) continue;
+        }
+        grid_cell_push(grid, c, i);
     }
 }
 
-// Physics optimization with spatial partitioning
-void metaverse_physics_optimized(MetaverseAmplifier* amp, double delta_time) {
-    // Simple grid-based spatial partitioning
-    const int GRID_SIZE = 32;
-    const float CELL_SIZE = 10.0f;
+// Keep grid membership coherent with a swap-remove of the entity store
+static void broadphase_grid_swap_remove(BroadphaseGrid* grid, uint32_t index, uint32_t last) {
+    if (last >= grid->tracked_count) return;
     
-    // Create spatial grid
-    EntityGridCell grid[GRID_SIZE][GRID_SIZE][GRID_SIZE];
-    memset(grid, 0, sizeof(grid));
+    if (grid->entity_cell[index] != GRID_NONE) {
+        grid_cell_pop(grid, index);
+    }
     
-    // Assign entities to grid cells
-    for (uint32_t i = 0; i < amp->entity_count; i++) {
-        MetaverseEntity* entity = &amp->entities[i];
+    if (index != last && grid->entity_cell[last] != GRID_NONE) {
+        uint32_t c = grid->entity_cell[last];
+        uint32_t slot = grid->entity_slot[last];
         
-        int grid_x = (int)(entity->position.x / CELL_SIZE) + GRID_SIZE/2;
-        int grid_y = (int)(entity->position.y / CELL_SIZE) + GRID_SIZE/2;
-        int grid_z = (int)(entity->position.z / CELL_SIZE) + GRID_SIZE/2;
-        
-        if (grid_x >= 0 && grid_x < GRID_SIZE &&
-            grid_y >= 0 && grid_y < GRID_SIZE &&
-            grid_z >= 0 && grid_z < GRID_SIZE) {
-            
-            EntityGridCell* cell = &grid[grid_x][grid_y][grid_z];
-            if (cell->count < MAX_CELL_ENTITIES) {
-                cell->entities[cell->count++] = entity;
-            }
-        }
+        grid->cells[c].members[slot] = index;
+        grid->entity_cell[index] = c;
+        grid->entity_slot[index] = slot;
+        grid->entity_cell[last] = GRID_NONE;
     }
     
-    // Check collisions only within same or adjacent cells
-    for (int x = 0; x < GRID_SIZE; x++) {
-        for (int y = 0; y < GRID_SIZE; y++) {
-            for (int z = 0; z < GRID_SIZE; z++) {
-                EntityGridCell* cell = &grid[x][y][z];
-                
-                // Check collisions within cell
-                for (int i = 0; i < cell->count; i++) {
-                    for (int j = i + 1; j < cell->count; j++) {
-                        check_collision(cell->entities[i], cell->entities[j], delta_time);
-                    }
-                }
-                
-                // Check collisions with adjacent cells
-                for (int dx = -1; dx <= 1; dx++) {
-                    for (int dy = -1; dy <= 1; dy++) {
-                        for (int dz = -1; dz <= 1; dz++) {
-                            if (dx == 0 && dy == 0 && dz == 0) continue;
-                            
-                            int nx = x + dx;
-                            int ny = y + dy;
-                            int nz = z + dz;
-                            
-                            if (nx >= 0 && nx < GRID_SIZE &&
-                                ny >= 0 && ny < GRID_SIZE &&
-                                nz >= 0 && nz < GRID_SIZE) {
-                                
-                                EntityGridCell* neighbor = &grid[nx][ny][nz];
-                                
-                                for (int i = 0; i < cell->count; i++) {
-                                    for (int j = 0; j < neighbor->count; j++) {
-                                        check_collision(cell->entities[i], neighbor->entities[j], delta_time);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    grid->tracked_count = last;
+}
+
+static void broadphase_grid_free(BroadphaseGrid* grid) {
+    for (uint32_t c = 0; c < grid->cell_count; c++) {
+        free(grid->cells[c].members);
     }
+    free(grid->cells);
+    free(grid->buckets);
+    free(grid->entity_cell);
+    free(grid->entity_slot);
+    free(grid->pairs);
+    memset(grid, 0, sizeof(BroadphaseGrid));
 }
 
-// Network thread for multiplayer
-void* metaverse_network_thread(void* arg) {
-    MetaverseAmplifier* amp = (MetaverseAmplifier*)arg;
-    
-    // Network setup (simplified)
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    struct sockaddr_in server_addr;
-    
+// Entity storage
+static void* soa_stream_alloc(size_t size) {
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, 64, size) != 0) return NULL;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static void* soa_stream_grow(void* old_ptr, size_t old_size, size_t new_size) {
+    void* ptr = soa_stream_alloc(new_size);
+    if (ptr && old_ptr) {
+        memcpy(ptr, old_ptr, old_size);
+    }
+    free(old_ptr);
+    return ptr;
+}
+
+static bool entity_soa_reserve(EntitySoA* soa, uint32_t capacity) {
+    // Round up to whole 8-lane blocks and whole bitset words
+    capacity = (capacity + 63) & ~63u;
+    if (capacity <= soa->capacity) return true;
+    
+    uint32_t old = soa->capacity;
+    for (int c = 0; c < 4; c++) {
+        soa->position[c] = soa_stream_grow(soa->position[c], old * sizeof(float), capacity * sizeof(float));
+        soa->rotation[c] = soa_stream_grow(soa->rotation[c], old * sizeof(float), capacity * sizeof(float));
+        soa->scale[c] = soa_stream_grow(soa->scale[c], old * sizeof(float), capacity * sizeof(float));
+        if (!soa->position[c] || !soa->rotation[c] || !soa->scale[c]) return false;
+    }
+    
+    soa->entity_id = soa_stream_grow(soa->entity_id, old * sizeof(uint64_t), capacity * sizeof(uint64_t));
+    soa->entity_type = soa_stream_grow(soa->entity_type, old, capacity);
+    soa->flags = soa_stream_grow(soa->flags, old * sizeof(uint32_t), capacity * sizeof(uint32_t));
+    soa->velocity_bits = soa_stream_grow(soa->velocity_bits, old / 8, capacity / 8);
+    soa->gravity_bits = soa_stream_grow(soa->gravity_bits, old / 8, capacity / 8);
+    
+    if (!soa->entity_id || !soa->entity_type || !soa->flags ||
+        !soa->velocity_bits || !soa->gravity_bits) {
+        return false;
+    }
+    
+    soa->capacity = capacity;
+    return true;
+}
+
+static void entity_soa_free(EntitySoA* soa) {
+    for (int c = 0; c < 4; c++) {
+        free(soa->position[c]);
+        free(soa->rotation[c]);
+        free(soa->scale[c]);
+    }
+    free(soa->entity_id);
+    free(soa->entity_type);
+    free(soa->flags);
+    free(soa->velocity_bits);
+    free(soa->gravity_bits);
+    memset(soa, 0, sizeof(EntitySoA));
+}
+
+static inline void soa_set_bit(uint64_t* bits, uint32_t index, bool value) {
+    uint64_t mask = 1ULL << (index & 63);
+    if (value) {
+        bits[index >> 6] |= mask;
+    } else {
+        bits[index >> 6] &= ~mask;
+    }
+}
+
+static void entity_soa_store(EntitySoA* soa, uint32_t i, const MetaverseEntity* e) {
+    soa->position[0][i] = e->position.x;
+    soa->position[1][i] = e->position.y;
+    soa->position[2][i] = e->position.z;
+    soa->position[3][i] = e->position.w;
+    soa->rotation[0][i] = e->rotation.x;
+    soa->rotation[1][i] = e->rotation.y;
+    soa->rotation[2][i] = e->rotation.z;
+    soa->rotation[3][i] = e->rotation.w;
+    soa->scale[0][i] = e->scale.x;
+    soa->scale[1][i] = e->scale.y;
+    soa->scale[2][i] = e->scale.z;
+    soa->scale[3][i] = e->scale.w;
+    soa->entity_id[i] = e->entity_id;
+    soa->entity_type[i] = e->entity_type;
+    soa->flags[i] = e->flags;
+    soa_set_bit(soa->velocity_bits, i, e->flags & ENTITY_FLAG_VELOCITY);
+    soa_set_bit(soa->gravity_bits, i, e->flags & ENTITY_FLAG_GRAVITY);
+}
+
+static void entity_soa_load(const EntitySoA* soa, uint32_t i, MetaverseEntity* e) {
+    e->position = (Vector4){soa->position[0][i], soa->position[1][i],
+                            soa->position[2][i], soa->position[3][i]};
+    e->rotation = (Vector4){soa->rotation[0][i], soa->rotation[1][i],
+                            soa->rotation[2][i], soa->rotation[3][i]};
+    e->scale = (Vector4){soa->scale[0][i], soa->scale[1][i],
+                         soa->scale[2][i], soa->scale[3][i]};
+    e->entity_id = soa->entity_id[i];
+    e->entity_type = soa->entity_type[i];
+    e->flags = soa->flags[i];
+}
+
+// Archetype storage
+static void entity_archetype_store(MetaverseAmplifier* amp, uint32_t i, const MetaverseEntity* e) {
+    EcsEntity handle = amp->ecs_entities[i];
+    
+    // A flag change is an archetype move; the transition is cached per flag
+    EcsMask mask = ENTITY_ARCHETYPE_BASE | (e->flags & ENTITY_TAG_MASK);
+    if (ecs_get_mask(amp->ecs, handle) != mask) {
+        ecs_set_mask(amp->ecs, handle, mask);
+    }
+    
+    *(Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_POSITION) = e->position;
+    *(Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_ROTATION) = e->rotation;
+    *(Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_SCALE) = e->scale;
+    EntityInfo* info = ecs_get(amp->ecs, handle, ENTITY_COMPONENT_INFO);
+    info->entity_id = e->entity_id;
+    info->flags = e->flags;
+    info->entity_type = e->entity_type;
+}
+
+static void entity_archetype_load(const MetaverseAmplifier* amp, uint32_t i, MetaverseEntity* e) {
+    EcsEntity handle = amp->ecs_entities[i];
+    e->position = *(const Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_POSITION);
+    e->rotation = *(const Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_ROTATION);
+    e->scale = *(const Vector4*)ecs_get(amp->ecs, handle, ENTITY_COMPONENT_SCALE);
+    const EntityInfo* info = ecs_get(amp->ecs, handle, ENTITY_COMPONENT_INFO);
+    e->entity_id = info->entity_id;
+    e->entity_type = info->entity_type;
+    e->flags = info->flags;
+}
+
+// Velocity and gravity as ECS systems: each visits only the chunks whose
+// archetype carries its flag, so neither tests flags per entity. Both write
+// position and run in this order, as the per-entity branches did.
+static void ecs_system_velocity(EcsChunk* chunk, void* data) {
+    float dt = *(const float*)data;
+    Vector4* position = ecs_chunk_column(chunk, ENTITY_COMPONENT_POSITION);
+    uint32_t count = ecs_chunk_count(chunk);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        position[i].x += 0.1f * dt;
+        position[i].y += 0.05f * dt;
+    }
+}
+
+static void ecs_system_gravity(EcsChunk* chunk, void* data) {
+    float dt = *(const float*)data;
+    float fall = 9.8f * dt * dt;
+    Vector4* position = ecs_chunk_column(chunk, ENTITY_COMPONENT_POSITION);
+    uint32_t count = ecs_chunk_count(chunk);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        // Simple ground collision
+        position[i].y = fmaxf(position[i].y - fall, 0.0f);
+    }
+}
+
+static void entity_archetype_free(MetaverseAmplifier* amp) {
+    ecs_world_destroy(amp->ecs);
+    free(amp->ecs_entities);
+    amp->ecs = NULL;
+    amp->ecs_entities = NULL;
+}
+
+// Move the AoS mirror into a fresh ECS world
+static bool entity_archetype_build(MetaverseAmplifier* amp) {
+    amp->ecs = ecs_world_create();
+    amp->ecs_entities = malloc(sizeof(EcsEntity) * amp->entity_capacity);
+    if (!amp->ecs || !amp->ecs_entities) {
+        entity_archetype_free(amp);
+        return false;
+    }
+    
+    for (uint32_t tag = 0; tag < ENTITY_TAG_COUNT; tag++) {
+        ecs_register_component(amp->ecs, tag, 0);
+    }
+    ecs_register_component(amp->ecs, ENTITY_COMPONENT_POSITION, sizeof(Vector4));
+    ecs_register_component(amp->ecs, ENTITY_COMPONENT_ROTATION, sizeof(Vector4));
+    ecs_register_component(amp->ecs, ENTITY_COMPONENT_SCALE, sizeof(Vector4));
+    ecs_register_component(amp->ecs, ENTITY_COMPONENT_INFO, sizeof(EntityInfo));
+    
+    EcsMask position = 1u << ENTITY_COMPONENT_POSITION;
+    ecs_system_add(amp->ecs, "velocity", position | ENTITY_FLAG_VELOCITY, 0,
+                   position, position, ecs_system_velocity, &amp->simulate_delta);
+    ecs_system_add(amp->ecs, "gravity", position | ENTITY_FLAG_GRAVITY, 0,
+                   position, position, ecs_system_gravity, &amp->simulate_delta);
+    
+    for (uint32_t i = 0; i < amp->entity_count; i++) {
+        amp->ecs_entities[i] = ecs_create(amp->ecs, ENTITY_ARCHETYPE_BASE);
+        if (amp->ecs_entities[i] == ECS_ENTITY_INVALID) {
+            entity_archetype_free(amp);
+            return false;
+        }
+        entity_archetype_store(amp, i, &amp->entities[i]);
+    }
+    return true;
+}
+
+static bool entity_storage_reserve(MetaverseAmplifier* amp, uint32_t count) {
+    if (count > amp->entity_capacity) {
+        uint32_t new_capacity = amp->entity_capacity ? amp->entity_capacity : 1024;
+        while (new_capacity < count) new_capacity *= 2;
+        
+        MetaverseEntity* entities = realloc(amp->entities, sizeof(MetaverseEntity) * new_capacity);
+        if (!entities) return false;
+        amp->entities = entities;
+        
+        if (amp->ecs_entities) {
+            EcsEntity* ecs_entities = realloc(amp->ecs_entities, sizeof(EcsEntity) * new_capacity);
+            if (!ecs_entities) return false;
+            amp->ecs_entities = ecs_entities;
+        }
+        
+        amp->entity_capacity = new_capacity;
+    }
+    
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        return entity_soa_reserve(&amp->soa, amp->entity_capacity);
+    }
+    return true;
+}
+
+void metaverse_entity_get(MetaverseAmplifier* amp, uint32_t index, MetaverseEntity* out) {
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        entity_soa_load(&amp->soa, index, out);
+    } else if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        entity_archetype_load(amp, index, out);
+    } else {
+        *out = amp->entities[index];
+    }
+}
+
+void metaverse_entity_set(MetaverseAmplifier* amp, uint32_t index, const MetaverseEntity* entity) {
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        entity_soa_store(&amp->soa, index, entity);
+    } else if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        entity_archetype_store(amp, index, entity);
+    }
+    // Keep the AoS mirror coherent so a write does not force a full resync
+    amp->entities[index] = *entity;
+}
+
+// AoS view of the world; in SoA and archetype modes the mirror is gathered
+// on demand. Writes through the returned pointer are only honoured in AoS
+// mode, use metaverse_entity_set() otherwise.
+MetaverseEntity* metaverse_entity_view(MetaverseAmplifier* amp) {
+    if (amp->storage_mode != ENTITY_STORAGE_AOS && amp->aos_dirty) {
+        for (uint32_t i = 0; i < amp->entity_count; i++) {
+            metaverse_entity_get(amp, i, &amp->entities[i]);
+        }
+        amp->aos_dirty = false;
+    }
+    return amp->entities;
+}
+
+bool metaverse_set_storage_mode(MetaverseAmplifier* amp, EntityStorageMode mode) {
+    if (mode == amp->storage_mode) return true;
+    
+    pthread_rwlock_wrlock(&amp->world_lock);
+    
+    // Every layout is built from the AoS mirror
+    metaverse_entity_view(amp);
+    EntityStorageMode previous = amp->storage_mode;
+    
+    if (mode == ENTITY_STORAGE_SOA) {
+        if (!entity_soa_reserve(&amp->soa, amp->entity_capacity)) {
+            entity_soa_free(&amp->soa);
+            pthread_rwlock_unlock(&amp->world_lock);
+            amp->godot.godot_error("Failed to allocate SoA entity storage");
+            return false;
+        }
+        for (uint32_t i = 0; i < amp->entity_count; i++) {
+            entity_soa_store(&amp->soa, i, &amp->entities[i]);
+        }
+    } else if (mode == ENTITY_STORAGE_ARCHETYPE) {
+        if (!entity_archetype_build(amp)) {
+            pthread_rwlock_unlock(&amp->world_lock);
+            amp->godot.godot_error("Failed to allocate archetype entity storage");
+            return false;
+        }
+    }
+    
+    // Release the layout being left
+    if (previous == ENTITY_STORAGE_SOA) {
+        entity_soa_free(&amp->soa);
+    } else if (previous == ENTITY_STORAGE_ARCHETYPE) {
+        entity_archetype_free(amp);
+    }
+    
+    amp->aos_dirty = false;
+    amp->storage_mode = mode;
+    pthread_rwlock_unlock(&amp->world_lock);
+    return true;
+}
+
+EntityHandle metaverse_entity_add(MetaverseAmplifier* amp, MetaverseEntity* entity) {
+    pthread_mutex_lock(&amp->entity_mutex);
+    
+    if (!entity_storage_reserve(amp, amp->entity_count + 1)) {
+        pthread_mutex_unlock(&amp->entity_mutex);
+        amp->godot.godot_error("Failed to grow entity storage");
+        return ENTITY_HANDLE_INVALID;
+    }
+    
+    // Index appends at dense slot entity_count; rejects duplicate ids
+    EntityHandle handle = entity_index_insert(amp->entity_index, entity->entity_id);
+    if (handle == ENTITY_HANDLE_INVALID) {
+        pthread_mutex_unlock(&amp->entity_mutex);
+        amp->godot.godot_error("Failed to add entity (duplicate id?)");
+        return ENTITY_HANDLE_INVALID;
+    }
+    
+    if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        amp->ecs_entities[amp->entity_count] = ecs_create(amp->ecs, ENTITY_ARCHETYPE_BASE);
+        if (amp->ecs_entities[amp->entity_count] == ECS_ENTITY_INVALID) {
+            entity_index_remove(amp->entity_index, entity->entity_id);
+            pthread_mutex_unlock(&amp->entity_mutex);
+            amp->godot.godot_error("Failed to grow entity storage");
+            return ENTITY_HANDLE_INVALID;
+        }
+    }
+    
+    metaverse_entity_set(amp, amp->entity_count, entity);
+    amp->entity_count++;
+    
+    pthread_mutex_unlock(&amp->entity_mutex);
+    return handle;
+}
+
+void metaverse_entity_update(MetaverseAmplifier* amp, MetaverseEntity* entity) {
+    pthread_mutex_lock(&amp->entity_mutex);
+    
+    uint32_t index = entity_index_lookup(amp->entity_index, entity->entity_id);
+    if (index != ENTITY_INDEX_NONE) {
+        metaverse_entity_set(amp, index, entity);
+    }
+    
+    pthread_mutex_unlock(&amp->entity_mutex);
+}
+
+// Swap-remove: the last entity moves into the vacated slot. Handles stay
+// valid for every other entity; ones for the removed entity go stale.
+void metaverse_entity_remove(MetaverseAmplifier* amp, uint64_t entity_id) {
+    pthread_mutex_lock(&amp->entity_mutex);
+    
+    uint32_t index = entity_index_remove(amp->entity_index, entity_id);
+    if (index == ENTITY_INDEX_NONE) {
+        pthread_mutex_unlock(&amp->entity_mutex);
+        return;
+    }
+    
+    uint32_t last = amp->entity_count - 1;
+    if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        // The ECS frees the row itself; only the last slot's handle moves
+        ecs_destroy(amp->ecs, amp->ecs_entities[index]);
+        amp->ecs_entities[index] = amp->ecs_entities[last];
+        amp->entities[index] = amp->entities[last];
+    } else if (index != last) {
+        MetaverseEntity moved;
+        metaverse_entity_get(amp, last, &moved);
+        metaverse_entity_set(amp, index, &moved);
+    }
+    
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        // Padding lanes must keep clear flag bits for the vector kernels
+        soa_set_bit(amp->soa.velocity_bits, last, false);
+        soa_set_bit(amp->soa.gravity_bits, last, false);
+    }
+    broadphase_grid_swap_remove(&amp->broadphase, index, last);
+    if (amp->sap) sap_swap_remove(amp->sap, index, last);
+    amp->entity_count--;
+    
+    pthread_mutex_unlock(&amp->entity_mutex);
+}
+
+// Dense index for a handle, or ENTITY_INDEX_NONE if the entity is gone
+uint32_t metaverse_entity_resolve(MetaverseAmplifier* amp, EntityHandle handle) {
+    return entity_index_resolve(amp->entity_index, handle);
+}
+
+// SoA integration kernels
+// Each kernel mirrors the scalar AoS loop in metaverse_update_world: velocity
+// step, then gravity with ground clamp, selected per lane from the flag bitsets.
+#if defined(__AVX2__)
+static void soa_integrate_kernel(EntitySoA* soa, uint32_t begin, uint32_t end, float dt) {
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 vel_dx = _mm256_set1_ps(0.1f * dt);
+    const __m256 vel_dy = _mm256_set1_ps(0.05f * dt);
+    const __m256 grav_dy = _mm256_set1_ps(9.8f * dt * dt);
+    const __m256 ground = _mm256_setzero_ps();
+    
+    for (uint32_t i = begin; i < end; i += 8) {
+        uint32_t vbits = (uint32_t)(soa->velocity_bits[i >> 6] >> (i & 63)) & 0xFF;
+        uint32_t gbits = (uint32_t)(soa->gravity_bits[i >> 6] >> (i & 63)) & 0xFF;
+        if (!(vbits | gbits)) continue;
+        
+        __m256 vmask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)vbits), lane_bits), lane_bits));
+        __m256 gmask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)gbits), lane_bits), lane_bits));
+        
+        __m256 x = _mm256_load_ps(soa->position[0] + i);
+        __m256 y = _mm256_load_ps(soa->position[1] + i);
+        
+        x = _mm256_add_ps(x, _mm256_and_ps(vmask, vel_dx));
+        y = _mm256_add_ps(y, _mm256_and_ps(vmask, vel_dy));
+        y = _mm256_sub_ps(y, _mm256_and_ps(gmask, grav_dy));
+        y = _mm256_blendv_ps(y, _mm256_max_ps(y, ground), gmask);
+        
+        _mm256_store_ps(soa->position[0] + i, x);
+        _mm256_store_ps(soa->position[1] + i, y);
+    }
+}
+#elif defined(__SSE2__)
+static void soa_integrate_kernel(EntitySoA* soa, uint32_t begin, uint32_t end, float dt) {
+    const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128 vel_dx = _mm_set1_ps(0.1f * dt);
+    const __m128 vel_dy = _mm_set1_ps(0.05f * dt);
+    const __m128 grav_dy = _mm_set1_ps(9.8f * dt * dt);
+    const __m128 ground = _mm_setzero_ps();
+    
+    for (uint32_t i = begin; i < end; i += 4) {
+        uint32_t vbits = (uint32_t)(soa->velocity_bits[i >> 6] >> (i & 63)) & 0xF;
+        uint32_t gbits = (uint32_t)(soa->gravity_bits[i >> 6] >> (i & 63)) & 0xF;
+        if (!(vbits | gbits)) continue;
+        
+        __m128 vmask = _mm_castsi128_ps(_mm_cmpeq_epi32(
+            _mm_and_si128(_mm_set1_epi32((int)vbits), lane_bits), lane_bits));
+        __m128 gmask = _mm_castsi128_ps(_mm_cmpeq_epi32(
+            _mm_and_si128(_mm_set1_epi32((int)gbits), lane_bits), lane_bits));
+        
+        __m128 x = _mm_load_ps(soa->position[0] + i);
+        __m128 y = _mm_load_ps(soa->position[1] + i);
+        
+        x = _mm_add_ps(x, _mm_and_ps(vmask, vel_dx));
+        y = _mm_add_ps(y, _mm_and_ps(vmask, vel_dy));
+        y = _mm_sub_ps(y, _mm_and_ps(gmask, grav_dy));
+        
+        // SSE2 has no blendv: select clamped lanes with and/andnot
+        __m128 clamped = _mm_max_ps(y, ground);
+        y = _mm_or_ps(_mm_and_ps(gmask, clamped), _mm_andnot_ps(gmask, y));
+        
+        _mm_store_ps(soa->position[0] + i, x);
+        _mm_store_ps(soa->position[1] + i, y);
+    }
+}
+#else
+static void soa_integrate_kernel(EntitySoA* soa, uint32_t begin, uint32_t end, float dt) {
+    for (uint32_t i = begin; i < end; i++) {
+        uint64_t bit = 1ULL << (i & 63);
+        
+        if (soa->velocity_bits[i >> 6] & bit) {
+            soa->position[0][i] += 0.1f * dt;
+            soa->position[1][i] += 0.05f * dt;
+        }
+        
+        if (soa->gravity_bits[i >> 6] & bit) {
+            soa->position[1][i] -= 9.8f * dt * dt;
+            if (soa->position[1][i] < 0.0f) {
+                soa->position[1][i] = 0.0f;
+            }
+        }
+    }
+}
+#endif
+
+// Entity integration over a dense index range
+typedef struct {
+    MetaverseAmplifier* amp;
+    double delta_time;
+} IntegrateTask;
+
+static void world_integrate_range(void* data, uint32_t begin, uint32_t end) {
+    IntegrateTask* task = (IntegrateTask*)data;
+    MetaverseAmplifier* amp = task->amp;
+    double delta_time = task->delta_time;
+    
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        // Whole-vector kernels over the position streams
+        soa_integrate_kernel(&amp->soa, begin, end, (float)delta_time);
+        return;
+    }
+    
+    for (uint32_t i = begin; i < end; i++) {
+        MetaverseEntity* entity = &amp->entities[i];
+        
+        // Simple physics simulation
+        // In reality, this would use a proper physics engine
+        
+        // Update based on velocity (if present in flags)
+        if (entity->flags & ENTITY_FLAG_VELOCITY) {
+            // Update position
+            entity->position.x += 0.1f * delta_time;
+            entity->position.y += 0.05f * delta_time;
+        }
+        
+        // Apply gravity if needed
+        if (entity->flags & ENTITY_FLAG_GRAVITY) {
+            entity->position.y -= 9.8f * delta_time * delta_time;
+            
+            // Simple ground collision
+            if (entity->position.y < 0.0f) {
+                entity->position.y = 0.0f;
+            }
+        }
+    }
+}
+
+// Apply the updates queued by the network thread, oldest first, so the last
+// one received for an entity wins. Caller holds world_lock for writing.
+static void world_apply_remote_updates(MetaverseAmplifier* amp) {
+    pthread_mutex_lock(&amp->remote_update_lock);
+    pthread_mutex_lock(&amp->entity_mutex);
+    
+    for (uint32_t i = 0; i < amp->remote_update_count; i++) {
+        const EntityUpdate* update = &amp->remote_updates[i];
+        uint32_t index = entity_index_lookup(amp->entity_index, update->entity_id);
+        if (index == ENTITY_INDEX_NONE) continue;  // Removed since it was sent
+        
+        MetaverseEntity entity;
+        metaverse_entity_get(amp, index, &entity);
+        entity.position = update->position;
+        entity.rotation = update->rotation;
+        metaverse_entity_set(amp, index, &entity);
+    }
+    amp->remote_update_count = 0;
+    
+    pthread_mutex_unlock(&amp->entity_mutex);
+    pthread_mutex_unlock(&amp->remote_update_lock);
+}
+
+// Entity simulation step, split across workers by entity range
+static void world_simulate(MetaverseAmplifier* amp, double delta_time) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // Simulation is the writer of the live state; readers use the snapshot
+    pthread_rwlock_wrlock(&amp->world_lock);
+    world_apply_remote_updates(amp);
+    
+    if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        // Systems over matching chunks, non-conflicting ones in parallel
+        amp->simulate_delta = (float)delta_time;
+        ecs_run_systems(amp->ecs, amp->jobs);
+    } else {
+        IntegrateTask task = { amp, delta_time };
+        job_parallel_for(amp->jobs, amp->entity_count, WORLD_INTEGRATE_GRAIN,
+                         world_integrate_range, &task);
+    }
+    
+    if (amp->storage_mode != ENTITY_STORAGE_AOS) {
+        amp->aos_dirty = true;
+    }
+    
+    pthread_rwlock_unlock(&amp->world_lock);
+    
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + 
+                    (end.tv_nsec - start.tv_nsec) / 1e9;
+    amp->physics_time = 0.9 * amp->physics_time + 0.1 * elapsed;
+}
+
+// World snapshots
+// Pinning: bump the front slot's reader count, then confirm it is still the
+// front. The writer only fills slots that are not the front and have no
+// readers, so a reader that loses the race to a publish backs off before it
+// touches anything.
+const WorldSnapshot* metaverse_snapshot_acquire(MetaverseAmplifier* amp) {
+    for (;;) {
+        WorldSnapshot* snapshot = atomic_load(&amp->world_front);
+        if (!snapshot) return NULL;  // Nothing published yet
+        
+        atomic_fetch_add(&snapshot->readers, 1);
+        if (atomic_load(&amp->world_front) == snapshot) return snapshot;
+        atomic_fetch_sub(&snapshot->readers, 1);
+    }
+}
+
+void metaverse_snapshot_release(const WorldSnapshot* snapshot) {
+    if (snapshot) atomic_fetch_sub(&((WorldSnapshot*)snapshot)->readers, 1);
+}
+
+static bool world_snapshot_reserve(WorldSnapshot* snapshot, uint32_t count) {
+    if (count <= snapshot->capacity) return true;
+    
+    uint32_t capacity = snapshot->capacity ? snapshot->capacity : 1024;
+    while (capacity < count) capacity *= 2;
+    
+    MetaverseEntity* entities = realloc(snapshot->entities, sizeof(MetaverseEntity) * capacity);
+    if (!entities) return false;
+    snapshot->entities = entities;
+    
+    for (int s = 0; s < 6; s++) {
+        float* stream = realloc(snapshot->cull_stream[s], sizeof(float) * capacity);
+        if (!stream) return false;
+        snapshot->cull_stream[s] = stream;
+    }
+    
+    snapshot->capacity = capacity;
+    return true;
+}
+
+static void world_snapshot_free(WorldSnapshot* snapshot) {
+    free(snapshot->entities);
+    for (int s = 0; s < 6; s++) {
+        free(snapshot->cull_stream[s]);
+    }
+    memset(snapshot, 0, sizeof(WorldSnapshot));
+}
+
+typedef struct {
+    MetaverseAmplifier* amp;
+    WorldSnapshot* snapshot;
+} SnapshotTask;
+
+// Copy a dense range into the snapshot: entities plus the cull streams, so
+// the render thread never transposes
+static void world_snapshot_copy_range(void* data, uint32_t begin, uint32_t end) {
+    SnapshotTask* task = (SnapshotTask*)data;
+    MetaverseAmplifier* amp = task->amp;
+    WorldSnapshot* snapshot = task->snapshot;
+    
+    if (amp->storage_mode == ENTITY_STORAGE_SOA) {
+        for (uint32_t i = begin; i < end; i++) {
+            entity_soa_load(&amp->soa, i, &snapshot->entities[i]);
+        }
+        size_t bytes = sizeof(float) * (end - begin);
+        for (int axis = 0; axis < 3; axis++) {
+            memcpy(snapshot->cull_stream[axis] + begin, amp->soa.position[axis] + begin, bytes);
+            memcpy(snapshot->cull_stream[3 + axis] + begin, amp->soa.scale[axis] + begin, bytes);
+        }
+        return;
+    }
+    
+    if (amp->storage_mode == ENTITY_STORAGE_ARCHETYPE) {
+        for (uint32_t i = begin; i < end; i++) {
+            entity_archetype_load(amp, i, &snapshot->entities[i]);
+        }
+    } else {
+        memcpy(snapshot->entities + begin, amp->entities + begin,
+               sizeof(MetaverseEntity) * (end - begin));
+    }
+    for (uint32_t i = begin; i < end; i++) {
+        const MetaverseEntity* entity = &snapshot->entities[i];
+        snapshot->cull_stream[0][i] = entity->position.x;
+        snapshot->cull_stream[1][i] = entity->position.y;
+        snapshot->cull_stream[2][i] = entity->position.z;
+        snapshot->cull_stream[3][i] = entity->scale.x;
+        snapshot->cull_stream[4][i] = entity->scale.y;
+        snapshot->cull_stream[5][i] = entity->scale.z;
+    }
+}
+
+// End of the simulation phases: copy the live world into a free back slot
+// and swap it to the front. If every back slot is still pinned (a reader
+// holding on across two frames) the publish is skipped and readers keep
+// the previous frame.
+static void world_publish_snapshot(MetaverseAmplifier* amp) {
+    PROFILE_ZONE("Publish snapshot");
+    WorldSnapshot* front = atomic_load(&amp->world_front);
+    WorldSnapshot* target = NULL;
+    for (uint32_t s = 0; s < WORLD_SNAPSHOT_COUNT; s++) {
+        WorldSnapshot* candidate = &amp->snapshots[s];
+        if (candidate != front && atomic_load(&candidate->readers) == 0) {
+            target = candidate;
+            break;
+        }
+    }
+    if (!target) {
+        amp->snapshot_skips++;
+        return;
+    }
+    
+    // Excludes entity add/remove and network writes during the copy
+    pthread_mutex_lock(&amp->entity_mutex);
+    
+    if (!world_snapshot_reserve(target, amp->entity_count)) {
+        pthread_mutex_unlock(&amp->entity_mutex);
+        amp->godot.godot_error("Failed to grow world snapshot");
+        return;
+    }
+    
+    SnapshotTask task = { amp, target };
+    job_parallel_for(amp->jobs, amp->entity_count, WORLD_INTEGRATE_GRAIN,
+                     world_snapshot_copy_range, &task);
+    target->entity_count = amp->entity_count;
+    target->camera_position = amp->camera_position;
+    target->frame = ++amp->world_frame;
+    
+    pthread_mutex_unlock(&amp->entity_mutex);
+    
+    atomic_exchange(&amp->world_front, target);
+}
+
+// World update with spatial partitioning
+void metaverse_update_world(MetaverseAmplifier* amp, double delta_time) {
+    world_simulate(amp, delta_time);
+    
+    // Update spatial audio
+    metaverse_spatial_audio_update(amp);
+}
+
+// Frustum culling
+// Bounding spheres (position, ENTITY_BOUNDING_RADIUS scaled by the largest
+// scale axis) against the six planes, a vector of entities at a time. Planes
+// are (a, b, c, d) with inward normals; a sphere is culled once any plane
+// puts its centre further than its radius outside.
+//
+// Plane coherency: each entity remembers the plane that rejected it last
+// frame and is tested against that plane first. Entities that stay outside
+// (the common case off-screen) are usually settled after one plane, and a
+// vector whose lanes all fail their cached plane skips the full test.
+typedef struct {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* sx;
+    const float* sy;
+    const float* sz;
+} CullStreams;
+
+static inline float cull_radius_scalar(float sx, float sy, float sz) {
+    float r = fabsf(sx);
+    if (fabsf(sy) > r) r = fabsf(sy);
+    if (fabsf(sz) > r) r = fabsf(sz);
+    return r * ENTITY_BOUNDING_RADIUS;
+}
+
+// Returns the rejecting plane (0-5) or CULL_VISIBLE, testing `first` first
+static inline uint8_t cull_sphere_scalar(const float planes[6][4], uint8_t first,
+                                         float x, float y, float z, float r) {
+    if (first < 6) {
+        const float* p = planes[first];
+        if (p[0]*x + p[1]*y + p[2]*z + p[3] < -r) return first;
+    }
+    for (uint8_t p = 0; p < 6; p++) {
+        if (p == first) continue;
+        const float* plane = planes[p];
+        if (plane[0]*x + plane[1]*y + plane[2]*z + plane[3] < -r) return p;
+    }
+    return CULL_VISIBLE;
+}
+
+// Scalar tail (and fallback kernel)
+static uint32_t cull_spheres_scalar(const CullStreams* in, const float planes[6][4],
+                                    uint8_t* cull_plane, uint32_t begin, uint32_t end,
+                                    uint32_t* visible) {
+    uint32_t count = 0;
+    for (uint32_t i = begin; i < end; i++) {
+        float r = cull_radius_scalar(in->sx[i], in->sy[i], in->sz[i]);
+        uint8_t plane = cull_sphere_scalar(planes, cull_plane[i], in->x[i], in->y[i], in->z[i], r);
+        cull_plane[i] = plane;
+        if (plane == CULL_VISIBLE) visible[count++] = i;
+    }
+    return count;
+}
+
+#if defined(__AVX2__)
+static uint32_t cull_spheres(const CullStreams* in, const float planes[6][4],
+                             uint8_t* cull_plane, uint32_t count, uint32_t* visible) {
+    // Plane components as 8-lane tables so cached planes can be gathered with
+    // a permute; lanes 6 and 7 are never selected
+    __m256 pa, pb, pc, pd;
+    {
+        float a[8] = {0}, b[8] = {0}, c[8] = {0}, d[8] = {0};
+        for (int p = 0; p < 6; p++) {
+            a[p] = planes[p][0]; b[p] = planes[p][1];
+            c[p] = planes[p][2]; d[p] = planes[p][3];
+        }
+        pa = _mm256_loadu_ps(a); pb = _mm256_loadu_ps(b);
+        pc = _mm256_loadu_ps(c); pd = _mm256_loadu_ps(d);
+    }
+    
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 base_radius = _mm256_set1_ps(ENTITY_BOUNDING_RADIUS);
+    const __m256i visible_id = _mm256_set1_epi32(CULL_VISIBLE);
+    
+    uint32_t written = 0;
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in->x + i);
+        __m256 y = _mm256_loadu_ps(in->y + i);
+        __m256 z = _mm256_loadu_ps(in->z + i);
+        __m256 r = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(in->sx + i), abs_mask),
+                                 _mm256_and_ps(_mm256_loadu_ps(in->sy + i), abs_mask));
+        r = _mm256_max_ps(r, _mm256_and_ps(_mm256_loadu_ps(in->sz + i), abs_mask));
+        __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(r, base_radius));
+        
+        // Cached plane per lane (CULL_VISIBLE lanes gather a dummy plane and
+        // are masked out)
+        uint64_t cached_bytes;
+        memcpy(&cached_bytes, cull_plane + i, sizeof(cached_bytes));
+        __m256i cached = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)cached_bytes));
+        __m256i has_cached = _mm256_cmpgt_epi32(_mm256_set1_epi32(6), cached);
+        
+        __m256 dist = _mm256_add_ps(_mm256_mul_ps(_mm256_permutevar8x32_ps(pa, cached), x),
+                                    _mm256_permutevar8x32_ps(pd, cached));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_permutevar8x32_ps(pb, cached), y));
+        dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_permutevar8x32_ps(pc, cached), z));
+        __m256 rejected = _mm256_and_ps(_mm256_cmp_ps(dist, neg_r, _CMP_LT_OQ),
+                                        _mm256_castsi256_ps(has_cached));
+        __m256i plane_id = _mm256_blendv_epi8(visible_id, cached, _mm256_castps_si256(rejected));
+        
+        // Full test for lanes still undecided
+        if (_mm256_movemask_ps(rejected) != 0xFF) {
+            for (int p = 0; p < 6; p++) {
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&planes[p][0]), x),
+                                         _mm256_broadcast_ss(&planes[p][3]));
+                d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_broadcast_ss(&planes[p][1]), y));
+                d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_broadcast_ss(&planes[p][2]), z));
+                __m256 out = _mm256_andnot_ps(rejected, _mm256_cmp_ps(d, neg_r, _CMP_LT_OQ));
+                
+                plane_id = _mm256_blendv_epi8(plane_id, _mm256_set1_epi32(p), _mm256_castps_si256(out));
+                rejected = _mm256_or_ps(rejected, out);
+                if (_mm256_movemask_ps(rejected) == 0xFF) break;
+            }
+        }
+        
+        // Store cached planes back as bytes
+        uint32_t ids[8];
+        _mm256_storeu_si256((__m256i*)ids, plane_id);
+        for (int lane = 0; lane < 8; lane++) {
+            cull_plane[i + lane] = (uint8_t)ids[lane];
+        }
+        
+        // Compact visible lanes
+        uint32_t mask = ~(uint32_t)_mm256_movemask_ps(rejected) & 0xFF;
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            visible[written++] = i + lane;
+            mask &= mask - 1;
+        }
+    }
+    
+    return written + cull_spheres_scalar(in, planes, cull_plane, i, count, visible + written);
+}
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+#if defined(__SSE2__)
+typedef __m128 cull_vec;
+#define CULL_LOAD(p)       _mm_loadu_ps(p)
+#define CULL_SET1(v)       _mm_set1_ps(v)
+#define CULL_SET(a,b,c,d)  _mm_setr_ps(a, b, c, d)
+#define CULL_ADD(a,b)      _mm_add_ps(a, b)
+#define CULL_SUB(a,b)      _mm_sub_ps(a, b)
+#define CULL_MUL(a,b)      _mm_mul_ps(a, b)
+#define CULL_MAX(a,b)      _mm_max_ps(a, b)
+#define CULL_ABS(a)        _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define CULL_LT(a,b)       _mm_cmplt_ps(a, b)
+#define CULL_AND(a,b)      _mm_and_ps(a, b)
+#define CULL_ANDNOT(a,b)   _mm_andnot_ps(a, b)  // ~a & b
+#define CULL_OR(a,b)       _mm_or_ps(a, b)
+#define CULL_MASK(a)       ((uint32_t)_mm_movemask_ps(a))
+#else
+typedef float32x4_t cull_vec;
+static inline uint32_t cull_neon_mask(float32x4_t v) {
+    static const int32_t bits[4] = {1, 2, 4, 8};
+    uint32x4_t m = vandq_u32(vreinterpretq_u32_f32(v), vreinterpretq_u32_s32(vld1q_s32(bits)));
+    return vgetq_lane_u32(m, 0) | vgetq_lane_u32(m, 1) | vgetq_lane_u32(m, 2) | vgetq_lane_u32(m, 3);
+}
+static inline float32x4_t cull_neon_set(float a, float b, float c, float d) {
+    float v[4] = {a, b, c, d};
+    return vld1q_f32(v);
+}
+#define CULL_LOAD(p)       vld1q_f32(p)
+#define CULL_SET1(v)       vdupq_n_f32(v)
+#define CULL_SET(a,b,c,d)  cull_neon_set(a, b, c, d)
+#define CULL_ADD(a,b)      vaddq_f32(a, b)
+#define CULL_SUB(a,b)      vsubq_f32(a, b)
+#define CULL_MUL(a,b)      vmulq_f32(a, b)
+#define CULL_MAX(a,b)      vmaxq_f32(a, b)
+#define CULL_ABS(a)        vabsq_f32(a)
+#define CULL_LT(a,b)       vreinterpretq_f32_u32(vcltq_f32(a, b))
+#define CULL_AND(a,b)      vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define CULL_ANDNOT(a,b)   vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(b), vreinterpretq_u32_f32(a)))
+#define CULL_OR(a,b)       vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)))
+#define CULL_MASK(a)       cull_neon_mask(a)
+#endif
+
+static uint32_t cull_spheres(const CullStreams* in, const float planes[6][4],
+                             uint8_t* cull_plane, uint32_t count, uint32_t* visible) {
+    // Dummy seventh plane for lanes without a cached rejection; never rejects
+    static const float no_plane[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const cull_vec base_radius = CULL_SET1(ENTITY_BOUNDING_RADIUS);
+    
+    uint32_t written = 0;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        cull_vec x = CULL_LOAD(in->x + i);
+        cull_vec y = CULL_LOAD(in->y + i);
+        cull_vec z = CULL_LOAD(in->z + i);
+        cull_vec r = CULL_MAX(CULL_ABS(CULL_LOAD(in->sx + i)), CULL_ABS(CULL_LOAD(in->sy + i)));
+        r = CULL_MAX(r, CULL_ABS(CULL_LOAD(in->sz + i)));
+        cull_vec neg_r = CULL_SUB(CULL_SET1(0.0f), CULL_MUL(r, base_radius));
+        
+        // Cached plane per lane, gathered into lane order
+        const float* cp[4];
+        for (int lane = 0; lane < 4; lane++) {
+            uint8_t cached = cull_plane[i + lane];
+            cp[lane] = cached < 6 ? planes[cached] : no_plane;
+        }
+        cull_vec dist = CULL_ADD(CULL_MUL(CULL_SET(cp[0][0], cp[1][0], cp[2][0], cp[3][0]), x),
+                                 CULL_SET(cp[0][3], cp[1][3], cp[2][3], cp[3][3]));
+        dist = CULL_ADD(dist, CULL_MUL(CULL_SET(cp[0][1], cp[1][1], cp[2][1], cp[3][1]), y));
+        dist = CULL_ADD(dist, CULL_MUL(CULL_SET(cp[0][2], cp[1][2], cp[2][2], cp[3][2]), z));
+        cull_vec rejected = CULL_LT(dist, neg_r);
+        
+        uint32_t cached_mask = CULL_MASK(rejected);
+        uint32_t plane_mask[6] = {0};
+        
+        if (cached_mask != 0xF) {
+            for (int p = 0; p < 6; p++) {
+                cull_vec d = CULL_ADD(CULL_MUL(CULL_SET1(planes[p][0]), x), CULL_SET1(planes[p][3]));
+                d = CULL_ADD(d, CULL_MUL(CULL_SET1(planes[p][1]), y));
+                d = CULL_ADD(d, CULL_MUL(CULL_SET1(planes[p][2]), z));
+                cull_vec out = CULL_ANDNOT(rejected, CULL_LT(d, neg_r));
+                
+                plane_mask[p] = CULL_MASK(out);
+                rejected = CULL_OR(rejected, out);
+                if (CULL_MASK(rejected) == 0xF) break;
+            }
+        }
+        
+        // Record the rejecting plane per lane and compact visible lanes
+        for (int lane = 0; lane < 4; lane++) {
+            uint32_t bit = 1u << lane;
+            if (cached_mask & bit) continue;  // Cached plane still rejects
+            
+            uint8_t plane = CULL_VISIBLE;
+            for (int p = 0; p < 6; p++) {
+                if (plane_mask[p] & bit) { plane = (uint8_t)p; break; }
+            }
+            cull_plane[i + lane] = plane;
+            if (plane == CULL_VISIBLE) visible[written++] = i + lane;
+        }
+    }
+    
+    return written + cull_spheres_scalar(in, planes, cull_plane, i, count, visible + written);
+}
+#else
+static uint32_t cull_spheres(const CullStreams* in, const float planes[6][4],
+                             uint8_t* cull_plane, uint32_t count, uint32_t* visible) {
+    return cull_spheres_scalar(in, planes, cull_plane, 0, count, visible);
+}
+#endif
+
+// Cull a world snapshot into queue->visible, straight from the snapshot's
+// cull streams
+uint32_t metaverse_cull_entities(const WorldSnapshot* world, RenderQueue* queue,
+                                 const float planes[6][4]) {
+    PROFILE_ZONE("Cull");
+    uint32_t count = world->entity_count;
+    if (!render_queue_reserve(queue, count)) return 0;
+    
+    CullStreams in;
+    in.x = world->cull_stream[0];
+    in.y = world->cull_stream[1];
+    in.z = world->cull_stream[2];
+    in.sx = world->cull_stream[3];
+    in.sy = world->cull_stream[4];
+    in.sz = world->cull_stream[5];
+    
+    queue->visible_count = cull_spheres(&in, planes, queue->cull_plane, count, queue->visible);
+    return queue->visible_count;
+}
+
+// Render batching
+// Sort key layout, most significant first: entity type (8) | shader (8) |
+// material (16) | view depth (32). Batches break on the upper 32 bits, and
+// instances inside a batch come out front to back.
+static inline uint64_t render_sort_key(const MetaverseEntity* entity, Vector4 camera) {
+    float dx = entity->position.x - camera.x;
+    float dy = entity->position.y - camera.y;
+    float dz = entity->position.z - camera.z;
+    float depth = dx*dx + dy*dy + dz*dz;  // Non-negative: bit pattern sorts as uint
+    
+    uint32_t depth_bits;
+    memcpy(&depth_bits, &depth, sizeof(depth_bits));
+    
+    uint64_t type = entity->entity_type;
+    uint64_t shader = entity->entity_type;       // One shader per entity type
+    uint64_t material = entity->flags >> ENTITY_MATERIAL_SHIFT;
+    
+    return (type << 56) | (shader << 48) | (material << 32) | depth_bits;
+}
+
+// LSD radix sort of 64-bit keys with a 32-bit payload, 8 bits per pass.
+// Passes where every key shares the digit are skipped, so in practice only
+// the depth bytes and whichever type/material bytes vary are scattered.
+static void radix_sort_keys(uint64_t* keys, uint32_t* items,
+                            uint64_t* keys_tmp, uint32_t* items_tmp, uint32_t count) {
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t key = keys[i];
+        for (int pass = 0; pass < 8; pass++) {
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+    
+    uint64_t* src_keys = keys;
+    uint32_t* src_items = items;
+    uint64_t* dst_keys = keys_tmp;
+    uint32_t* dst_items = items_tmp;
+    
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t* histogram = histograms[pass];
+        if (histogram[(src_keys[0] >> (pass * 8)) & 0xFF] == count) continue;
+        
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            uint32_t n = histogram[digit];
+            histogram[digit] = offset;
+            offset += n;
+        }
+        
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t dst = histogram[(src_keys[i] >> (pass * 8)) & 0xFF]++;
+            dst_keys[dst] = src_keys[i];
+            dst_items[dst] = src_items[i];
+        }
+        
+        uint64_t* swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;
+        uint32_t* swap_items = src_items; src_items = dst_items; dst_items = swap_items;
+    }
+    
+    if (src_keys != keys) {
+        memcpy(keys, src_keys, sizeof(uint64_t) * count);
+        memcpy(items, src_items, sizeof(uint32_t) * count);
+    }
+}
+
+static bool render_queue_reserve(RenderQueue* queue, uint32_t count) {
+    if (count <= queue->capacity) return true;
+    
+    uint32_t capacity = queue->capacity ? queue->capacity : 1024;
+    while (capacity < count) capacity *= 2;
+    
+    uint32_t* visible = realloc(queue->visible, sizeof(uint32_t) * capacity);
+    if (visible) queue->visible = visible;
+    uint64_t* keys = realloc(queue->keys, sizeof(uint64_t) * capacity);
+    if (keys) queue->keys = keys;
+    uint64_t* keys_tmp = realloc(queue->keys_tmp, sizeof(uint64_t) * capacity);
+    if (keys_tmp) queue->keys_tmp = keys_tmp;
+    uint32_t* items = realloc(queue->items, sizeof(uint32_t) * capacity);
+    if (items) queue->items = items;
+    uint32_t* items_tmp = realloc(queue->items_tmp, sizeof(uint32_t) * capacity);
+    if (items_tmp) queue->items_tmp = items_tmp;
+    
+    uint8_t* cull_plane = realloc(queue->cull_plane, capacity);
+    if (cull_plane) {
+        memset(cull_plane + queue->capacity, CULL_VISIBLE, capacity - queue->capacity);
+        queue->cull_plane = cull_plane;
+    }
+    
+    if (!visible || !keys || !keys_tmp || !items || !items_tmp || !cull_plane) return false;
+    
+    queue->capacity = capacity;
+    return true;
+}
+
+static bool render_queue_push_batch(RenderQueue* queue, uint64_t key, uint32_t first_instance) {
+    if (queue->batch_count == queue->batch_capacity) {
+        uint32_t capacity = queue->batch_capacity ? queue->batch_capacity * 2 : 64;
+        RenderBatch* batches = realloc(queue->batches, sizeof(RenderBatch) * capacity);
+        if (!batches) return false;
+        queue->batches = batches;
+        queue->batch_capacity = capacity;
+    }
+    
+    RenderBatch* batch = &queue->batches[queue->batch_count++];
+    batch->entity_type = (uint8_t)(key >> 56);
+    batch->shader = (uint8_t)(key >> 48);
+    batch->material = (uint16_t)(key >> 32);
+    batch->first_instance = first_instance;
+    batch->count = 0;
+    return true;
+}
+
+// Instance ring
+// One segment per frame in flight. With GL the buffer is persistently mapped
+// and each segment is fenced; headless it is plain heap memory.
+static void instance_ring_free(InstanceRing* ring) {
+    if (ring->buffer) {
+        for (int f = 0; f < RENDER_FRAMES_IN_FLIGHT; f++) {
+            if (ring->fences[f]) {
+                glClientWaitSync(ring->fences[f], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+                glDeleteSync(ring->fences[f]);
+                ring->fences[f] = NULL;
+            }
+        }
+        glDeleteBuffers(1, &ring->buffer);
+        ring->buffer = 0;
+    } else {
+        free(ring->data);
+    }
+    ring->data = NULL;
+    ring->segment_capacity = 0;
+}
+
+static bool instance_ring_reserve(InstanceRing* ring, uint32_t instances) {
+    if (instances <= ring->segment_capacity) return true;
+    
+    uint32_t capacity = ring->segment_capacity ? ring->segment_capacity : 4096;
+    while (capacity < instances) capacity *= 2;
+    
+    size_t size = (size_t)capacity * RENDER_FRAMES_IN_FLIGHT * INSTANCE_FLOATS * sizeof(float);
+    
+    if (ring->use_gl) {
+        // Growing a persistent mapping means draining the GPU once
+        instance_ring_free(ring);
+        
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &ring->buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        ring->data = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    } else {
+        free(ring->data);
+        ring->data = malloc(size);
+    }
+    
+    if (!ring->data) {
+        ring->segment_capacity = 0;
+        return false;
+    }
+    
+    ring->segment_capacity = capacity;
+    ring->generation++;
+    return true;
+}
+
+// Returns this frame's segment; base_instance is its offset in instances
+static float* instance_ring_begin(InstanceRing* ring, uint32_t instances, uint32_t* base_instance) {
+    if (!instance_ring_reserve(ring, instances)) return NULL;
+    
+    uint32_t segment = ring->frame % RENDER_FRAMES_IN_FLIGHT;
+    
+    // Wait until the GPU has consumed this segment's previous contents
+    if (ring->fences[segment]) {
+        while (glClientWaitSync(ring->fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                1000000ull) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(ring->fences[segment]);
+        ring->fences[segment] = NULL;
+    }
+    
+    *base_instance = segment * ring->segment_capacity;
+    return ring->data + (size_t)*base_instance * INSTANCE_FLOATS;
+}
+
+static void instance_ring_end(InstanceRing* ring) {
+    if (ring->buffer) {
+        uint32_t segment = ring->frame % RENDER_FRAMES_IN_FLIGHT;
+        ring->fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    ring->frame++;
+}
+
+static void render_queue_free(RenderQueue* queue) {
+    instance_ring_free(&queue->ring);
+    free(queue->visible);
+    free(queue->keys);
+    free(queue->keys_tmp);
+    free(queue->items);
+    free(queue->items_tmp);
+    free(queue->batches);
+    free(queue->cull_plane);
+    memset(queue, 0, sizeof(RenderQueue));
+}
+
+// Build batches for the visible set in queue->visible. Touches no GL state
+// unless the ring is GL-backed, so it runs headless for benchmarking.
+uint32_t metaverse_build_render_batches(MetaverseAmplifier* amp, const WorldSnapshot* world,
+                                       RenderQueue* queue) {
+    PROFILE_ZONE("Build batches");
+    uint32_t count = queue->visible_count;
+    const MetaverseEntity* entities = world->entities;
+    
+    queue->batch_count = 0;
+    if (count == 0) return 0;
+    
+    // Sort keys
+    for (uint32_t i = 0; i < count; i++) {
+        queue->keys[i] = render_sort_key(&entities[queue->visible[i]], world->camera_position);
+        queue->items[i] = queue->visible[i];
+    }
+    radix_sort_keys(queue->keys, queue->items, queue->keys_tmp, queue->items_tmp, count);
+    
+    // Write instances straight into this frame's ring segment
+    uint32_t base_instance = 0;
+    float* out = instance_ring_begin(&queue->ring, count, &base_instance);
+    if (!out) {
+        amp->godot.godot_error("Failed to allocate instance ring");
+        return 0;
+    }
+    queue->ring_base = base_instance;
+    
+    uint64_t current_state = ~0ull;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t state = queue->keys[i] >> 32;
+        if (state != current_state) {
+            if (!render_queue_push_batch(queue, queue->keys[i], base_instance + i)) {
+                // Batches already built still draw; the rest of the frame is lost
+                amp->godot.godot_error("Failed to allocate render batches");
+                break;
+            }
+            current_state = state;
+        }
+        queue->batches[queue->batch_count - 1].count++;
+        
+        const MetaverseEntity* entity = &entities[queue->items[i]];
+        float* instance = out + (size_t)i * INSTANCE_FLOATS;
+        memcpy(instance, &entity->position, 4 * sizeof(float));
+        memcpy(instance + 4, &entity->rotation, 4 * sizeof(float));
+        memcpy(instance + 8, &entity->scale, 4 * sizeof(float));
+    }
+    
+    return queue->batch_count;
+}
+
+// Delete the GL textures queued by cache_free_texture. The queue is swapped
+// out under its lock so evicting threads never wait on the GL call.
+static void metaverse_release_textures(MetaverseAmplifier* amp) {
+    pthread_mutex_lock(&amp->texture_release_lock);
+    GLuint* names = amp->texture_release;
+    uint32_t count = amp->texture_release_count;
+    uint32_t capacity = amp->texture_release_capacity;
+    amp->texture_release = amp->texture_deleting;
+    amp->texture_release_capacity = amp->texture_deleting_capacity;
+    amp->texture_release_count = 0;
+    amp->texture_deleting = names;
+    amp->texture_deleting_capacity = capacity;
+    pthread_mutex_unlock(&amp->texture_release_lock);
+    
+    if (count) glDeleteTextures((GLsizei)count, names);
+}
+
+// Enhanced rendering with batch optimization
+void metaverse_render_enhanced(MetaverseAmplifier* amp) {
+    PROFILE_ZONE("Render");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    pthread_mutex_lock(&amp->render_mutex);
+    metaverse_release_textures(amp);
+    
+    // Clear buffers
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    // Frustum culling preparation
+    float frustum[6][4];
+    calculate_frustum(frustum);
+    
+    RenderQueue* queue = &amp->render_queue;
+    
+    // Last published frame; simulation may already be writing the next one
+    const WorldSnapshot* world = metaverse_snapshot_acquire(amp);
+    if (!world) {
+        pthread_mutex_unlock(&amp->render_mutex);
+        return;
+    }
+    
+    if (!render_queue_reserve(queue, world->entity_count)) {
+        metaverse_snapshot_release(world);
+        pthread_mutex_unlock(&amp->render_mutex);
+        amp->godot.godot_error("Failed to grow render queue");
+        return;
+    }
+    
+    // Bounding-sphere culling into a dense visible list
+    uint32_t visible_count = metaverse_cull_entities(world, queue, (const float (*)[4])frustum);
+    
+    uint32_t batch_count = metaverse_build_render_batches(amp, world, queue);
+    
+    // Instances are in the ring now; the snapshot is free for the writer
+    metaverse_snapshot_release(world);
+    
+    // Point the instance attributes at the ring; per-batch offsets come from
+    // the base instance, so this is rebound only when the buffer changes.
+    // Growing the ring replaces its buffer.
+    GLuint instance_buffer = queue->ring.buffer;
+    if (!instance_buffer && batch_count > 0) {
+        if (!queue->upload_buffer) {
+            glGenBuffers(1, &queue->upload_buffer);
+        }
+        instance_buffer = queue->upload_buffer;
+        
+        // Orphan and refill with just this frame's segment
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        glBufferData(GL_ARRAY_BUFFER,
+                     (size_t)(queue->ring_base + visible_count) * INSTANCE_FLOATS * sizeof(float),
+                     NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER,
+                        (size_t)queue->ring_base * INSTANCE_FLOATS * sizeof(float),
+                        (size_t)visible_count * INSTANCE_FLOATS * sizeof(float),
+                        queue->ring.data + (size_t)queue->ring_base * INSTANCE_FLOATS);
+    }
+    
+    if (instance_buffer && (instance_buffer != queue->attribs_buffer ||
+                            queue->ring.generation != queue->attribs_generation)) {
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        for (GLuint a = 0; a < 3; a++) {
+            glEnableVertexAttribArray(INSTANCE_ATTRIB_BASE + a);
+            glVertexAttribPointer(INSTANCE_ATTRIB_BASE + a, 4, GL_FLOAT, GL_FALSE,
+                                  INSTANCE_FLOATS * sizeof(float),
+                                  (const void*)(a * 4 * sizeof(float)));
+            glVertexAttribDivisor(INSTANCE_ATTRIB_BASE + a, 1);
+        }
+        queue->attribs_buffer = instance_buffer;
+        queue->attribs_generation = queue->ring.generation;
+    }
+    
+    // Render batches; keys are sorted so shader changes are minimal
+    int current_shader = -1;
+    for (uint32_t b = 0; b < batch_count; b++) {
+        RenderBatch* batch = &queue->batches[b];
+        
+        if (batch->shader != current_shader) {
+            setup_shader_for_type(batch->entity_type);
+            current_shader = batch->shader;
+        }
+        
+        // Single draw call for entire batch
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0,
+                                          get_vertex_count_for_type(batch->entity_type),
+                                          batch->count, batch->first_instance);
+    }
+    
+    // Fence this frame's ring segment
+    instance_ring_end(&queue->ring);
+    
+    // Post-processing effects
+    if (amp->frame_time < 0.025) {  // Only if we have time
+        apply_post_processing();
+    }
+    
+    pthread_mutex_unlock(&amp->render_mutex);
+    
+    // Update performance metrics
+    amp->draw_calls = batch_count;
+    
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + 
+                    (end.tv_nsec - start.tv_nsec) / 1e9;
+    amp->render_time = 0.9 * amp->render_time + 0.1 * elapsed;
+    amp->fps = (uint32_t)(1.0 / amp->frame_time);
+}
+
+// Audio emitters
+// Add, remove and listener changes must happen between frames. The pointer
+// from metaverse_audio_emitter_get is valid until the next add.
+uint32_t metaverse_audio_emitter_add(MetaverseAmplifier* amp, const AudioEmitter* emitter) {
+    uint32_t id = amp->emitter_free;
+    
+    if (id != AUDIO_EMITTER_INVALID) {
+        amp->emitter_free = amp->audio_emitters[id].next_free;
+    } else {
+        if (amp->emitter_count == amp->emitter_capacity) {
+            uint32_t capacity = amp->emitter_capacity ? amp->emitter_capacity * 2 : AUDIO_EMITTER_INITIAL;
+            AudioEmitter* emitters = realloc(amp->audio_emitters, sizeof(AudioEmitter) * capacity);
+            if (!emitters) {
+                amp->godot.godot_error("Failed to grow audio emitters");
+                return AUDIO_EMITTER_INVALID;
+            }
+            amp->audio_emitters = emitters;
+            amp->emitter_capacity = capacity;
+        }
+        id = amp->emitter_count++;
+    }
+    
+    AudioEmitter* slot = &amp->audio_emitters[id];
+    *slot = *emitter;
+    if (slot->priority <= 0.0f) slot->priority = 1.0f;
+    if (slot->max_distance <= 0.0f) slot->max_distance = AUDIO_MAX_DISTANCE;
+    slot->active = true;
+    slot->voiced = false;
+    slot->score = 0.0f;
+    slot->next_free = AUDIO_EMITTER_INVALID;
+    return id;
+}
+
+void metaverse_audio_emitter_remove(MetaverseAmplifier* amp, uint32_t emitter_id) {
+    AudioEmitter* emitter = metaverse_audio_emitter_get(amp, emitter_id);
+    if (!emitter) return;
+    
+    // Silence the voice it held; virtual emitters never reached the backend
+    if (emitter->voiced) {
+        update_audio_source(emitter->source_id, 0.0f, 0.0f, emitter->pitch);
+    }
+    
+    emitter->active = false;
+    emitter->voiced = false;
+    emitter->next_free = amp->emitter_free;
+    amp->emitter_free = emitter_id;
+}
+
+AudioEmitter* metaverse_audio_emitter_get(MetaverseAmplifier* amp, uint32_t emitter_id) {
+    if (emitter_id >= amp->emitter_count) return NULL;
+    AudioEmitter* emitter = &amp->audio_emitters[emitter_id];
+    return emitter->active ? emitter : NULL;
+}
+
+void metaverse_audio_set_listener(MetaverseAmplifier* amp, const AudioListener* listener) {
+    amp->audio_listener = *listener;
+}
+
+// Real voices available to emitters; the rest are virtualized
+void metaverse_audio_set_voice_limit(MetaverseAmplifier* amp, uint32_t voices) {
+    amp->audio_voice_limit = voices;
+}
+
+// Counts from the last update
+void metaverse_audio_get_stats(MetaverseAmplifier* amp, AudioVoiceStats* stats) {
+    *stats = amp->audio_stats;
+}
+
+// For OS input threads: push with input_push_axis / input_push_button
+InputRing* metaverse_input_ring(MetaverseAmplifier* amp) {
+    return amp->input_ring;
+}
+
+// Push-to-drain latency and drop counts since creation
+void metaverse_get_input_stats(MetaverseAmplifier* amp, InputLatencyStats* stats) {
+    if (amp->input_ring) {
+        input_ring_get_stats(amp->input_ring, stats);
+    } else {
+        memset(stats, 0, sizeof(InputLatencyStats));
+    }
+}
+
+typedef struct {
+    float rank;             // Score, with the hysteresis bonus for voiced emitters
+    uint32_t emitter;
+} AudioCandidate;
+
+// Loudness at the listener times priority; 0 when out of range or below the
+// gain floor. Range is checked on squared distance before anything else.
+static inline float audio_emitter_score(const AudioEmitter* emitter, Vec3 listener_pos) {
+    float loudness = emitter->volume;
+    
+    if (emitter->spatialized) {
+        Vec3 offset = vec3_sub(vec3_load(emitter->position), listener_pos);
+        float distance_sq = vec3_dot(offset, offset);
+        if (distance_sq > emitter->max_distance * emitter->max_distance) return 0.0f;
+        loudness /= 1.0f + sqrtf(distance_sq) * 0.1f;
+    }
+    
+    return loudness >= AUDIO_AUDIBLE_GAIN ? loudness * emitter->priority : 0.0f;
+}
+
+// Partition so the `keep` highest ranks come first (quickselect, O(n))
+static void audio_select_top(AudioCandidate* candidates, uint32_t count, uint32_t keep) {
+    uint32_t lo = 0, hi = count - 1;
+    
+    while (lo < hi) {
+        float pivot = candidates[lo + (hi - lo) / 2].rank;
+        uint32_t i = lo, j = hi;
+        
+        while (i <= j) {
+            while (candidates[i].rank > pivot) i++;
+            while (candidates[j].rank < pivot) j--;
+            if (i <= j) {
+                AudioCandidate t = candidates[i];
+                candidates[i] = candidates[j];
+                candidates[j] = t;
+                i++;
+                if (j == 0) break;
+                j--;
+            }
+        }
+        
+        if (keep - 1 <= j) {
+            hi = j;
+        } else if (keep - 1 >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+}
+
+// Pan, attenuation and Doppler for one voiced emitter
+static void audio_emitter_output(const AudioEmitter* emitter, const AudioListener* listener,
+                                 Vec3 listener_left) {
+    float left_gain = 0.5f * emitter->volume;
+    float right_gain = 0.5f * emitter->volume;
+    float pitch = emitter->pitch;
+    
+    if (emitter->spatialized) {
+        Vec3 offset = vec3_sub(vec3_load(emitter->position), vec3_load(listener->position));
+        float distance = vec3_length(offset);
+        float attenuation = emitter->volume / (1.0f + distance * 0.1f);
+        
+        // Stereo panning based on direction
+        Vec3 direction = vec3_normalize(offset);
+        float dot_left = vec3_dot(direction, listener_left);
+        left_gain = 0.5f * (1.0f - dot_left) * attenuation;
+        right_gain = 0.5f * (1.0f + dot_left) * attenuation;
+        
+        // Doppler from the closing speed along the line of sight. Applied to
+        // the authored pitch each update, never accumulated into it.
+        Vec3 relative = vec3_sub(vec3_load(emitter->velocity), vec3_load(listener->velocity));
+        float closing = -vec3_dot(relative, direction);
+        float denominator = fminf(fmaxf(AUDIO_SPEED_OF_SOUND - closing, AUDIO_SPEED_OF_SOUND * 0.5f),
+                                  AUDIO_SPEED_OF_SOUND * 2.0f);
+        pitch *= AUDIO_SPEED_OF_SOUND / denominator;
+    }
+    
+    update_audio_source(emitter->source_id, left_gain, right_gain, pitch);
+}
+
+// Spatial audio update with voice management
+void metaverse_spatial_audio_update(MetaverseAmplifier* amp) {
+    PROFILE_ZONE("Audio");
+    const AudioListener* listener = &amp->audio_listener;
+    Vec3 listener_pos = vec3_load(listener->position);
+    Vec3 listener_left = vec3_cross(vec3_load(listener->forward), vec3_load(listener->up));
+    
+    AudioVoiceStats stats;
+    memset(&stats, 0, sizeof(stats));
+    
+    size_t candidates_size = sizeof(AudioCandidate) * (amp->emitter_count ? amp->emitter_count : 1);
+    AudioCandidate* candidates = amp->godot.godot_frame_alloc(candidates_size);
+    bool candidates_heap = candidates == NULL;
+    if (candidates_heap) candidates = malloc(candidates_size);
+    if (!candidates) return;
+    
+    // Score everything; emitters that fell silent give up their voice here
+    uint32_t audible = 0;
+    for (uint32_t i = 0; i < amp->emitter_count; i++) {
+        AudioEmitter* emitter = &amp->audio_emitters[i];
+        if (!emitter->active) continue;
+        stats.emitters++;
+        
+        emitter->score = audio_emitter_score(emitter, listener_pos);
+        if (emitter->score > 0.0f) {
+            float bonus = emitter->voiced ? AUDIO_VOICE_HYSTERESIS : 1.0f;
+            candidates[audible++] = (AudioCandidate){ emitter->score * bonus, i };
+        } else if (emitter->voiced) {
+            update_audio_source(emitter->source_id, 0.0f, 0.0f, emitter->pitch);
+            emitter->voiced = false;
+            stats.demotions++;
+        }
+    }
+    
+    uint32_t voices = audible < amp->audio_voice_limit ? audible : amp->audio_voice_limit;
+    if (voices > 0 && voices < audible) {
+        audio_select_top(candidates, audible, voices);
+    }
+    
+    // Losers are virtualized with one silencing call; no backend work after
+    for (uint32_t c = voices; c < audible; c++) {
+        AudioEmitter* emitter = &amp->audio_emitters[candidates[c].emitter];
+        if (emitter->voiced) {
+            update_audio_source(emitter->source_id, 0.0f, 0.0f, emitter->pitch);
+            emitter->voiced = false;
+            stats.demotions++;
+        }
+    }
+    
+    for (uint32_t c = 0; c < voices; c++) {
+        AudioEmitter* emitter = &amp->audio_emitters[candidates[c].emitter];
+        if (!emitter->voiced) {
+            emitter->voiced = true;
+            stats.promotions++;
+        }
+        audio_emitter_output(emitter, listener, listener_left);
+    }
+    
+    if (candidates_heap) free(candidates);
+    
+    stats.audible = audible;
+    stats.voiced = voices;
+    stats.virtualized = stats.emitters - voices;
+    amp->audio_stats = stats;
+}
+
+// Physics optimization with spatial partitioning
+// Half-neighbourhood stencil: 13 of the 26 neighbours, so each adjacent cell
+// pair is visited from exactly one side
+static const int8_t BROADPHASE_STENCIL[13][3] = {
+    { 1, -1, -1}, { 1, -1,  0}, { 1, -1,  1},
+    { 1,  0, -1}, { 1,  0,  0}, { 1,  0,  1},
+    { 1,  1, -1}, { 1,  1,  0}, { 1,  1,  1},
+    { 0,  1, -1}, { 0,  1,  0}, { 0,  1,  1},
+    { 0,  0,  1}
+};
+
+static bool grid_push_pair(BroadphaseGrid* grid, uint32_t a, uint32_t b) {
+    if (grid->pair_count == grid->pair_capacity) {
+        uint32_t capacity = grid->pair_capacity ? grid->pair_capacity * 2 : 4096;
+        BroadphasePair* pairs = realloc(grid->pairs, sizeof(BroadphasePair) * capacity);
+        if (!pairs) return false;
+        grid->pairs = pairs;
+        grid->pair_capacity = capacity;
+    }
+    
+    grid->pairs[grid->pair_count++] = a < b ? (BroadphasePair){ a, b } : (BroadphasePair){ b, a };
+    return true;
+}
+
+// Same-cell and forward-neighbour pairs; cost scales with occupied cells,
+// not grid volume
+static uint32_t broadphase_grid_pairs(BroadphaseGrid* grid) {
+    grid->pair_count = 0;
+    
+    for (uint32_t c = 0; c < grid->cell_count; c++) {
+        BroadphaseCell* cell = &grid->cells[c];
+        
+        // Pairs within cell
+        for (uint32_t i = 0; i < cell->count; i++) {
+            for (uint32_t j = i + 1; j < cell->count; j++) {
+                if (!grid_push_pair(grid, cell->members[i], cell->members[j])) {
+                    return grid->pair_count;
+                }
+            }
+        }
+        
+        // Check collisions with forward neighbours
+        int32_t x = (int32_t)((cell->key >> 42) & 0x1FFFFF) - (1 << 20);
+        int32_t y = (int32_t)((cell->key >> 21) & 0x1FFFFF) - (1 << 20);
+        int32_t z = (int32_t)(cell->key & 0x1FFFFF) - (1 << 20);
+        
+        for (int s = 0; s < 13; s++) {
+            uint32_t n = grid_find_cell(grid, grid_cell_key(x + BROADPHASE_STENCIL[s][0],
+                                                            y + BROADPHASE_STENCIL[s][1],
+                                                            z + BROADPHASE_STENCIL[s][2]));
+            if (n == GRID_NONE) continue;
+            
+            BroadphaseCell* neighbor = &grid->cells[n];
+            for (uint32_t i = 0; i < cell->count; i++) {
+                for (uint32_t j = 0; j < neighbor->count; j++) {
+                    if (!grid_push_pair(grid, cell->members[i], neighbor->members[j])) {
+                        return grid->pair_count;
+                    }
+                }
+            }
+        }
+    }
+    
+    return grid->pair_count;
+}
+
+// Entity bounds for SAP: the culling sphere's enclosing box
+static void broadphase_sap_boxes(SapBox* boxes, const MetaverseEntity* entities, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const MetaverseEntity* entity = &entities[i];
+        float r = cull_radius_scalar(entity->scale.x, entity->scale.y, entity->scale.z);
+        boxes[i] = (SapBox){
+            { entity->position.x - r, entity->position.y - r, entity->position.z - r },
+            { entity->position.x + r, entity->position.y + r, entity->position.z + r }
+        };
+    }
+}
+
+// Narrowphase in fixed batches, prefetching the next batch's entities while
+// the current one runs
+static void broadphase_dispatch_pairs(MetaverseEntity* entities, const BroadphasePair* pairs,
+                                      uint32_t count, double delta_time) {
+    for (uint32_t base = 0; base < count; base += BROADPHASE_PAIR_BATCH) {
+        uint32_t end = base + BROADPHASE_PAIR_BATCH < count ? base + BROADPHASE_PAIR_BATCH : count;
+        uint32_t ahead = end + BROADPHASE_PAIR_BATCH < count ? end + BROADPHASE_PAIR_BATCH : count;
+        
+        for (uint32_t i = end; i < ahead; i++) {
+            __builtin_prefetch(&entities[pairs[i].a]);
+            __builtin_prefetch(&entities[pairs[i].b]);
+        }
+        for (uint32_t i = base; i < end; i++) {
+            check_collision(&entities[pairs[i].a], &entities[pairs[i].b], delta_time);
+        }
+    }
+}
+
+void metaverse_physics_optimized(MetaverseAmplifier* amp, double delta_time) {
+    PROFILE_ZONE("Broadphase");
+    MetaverseEntity* entities = metaverse_entity_view(amp);
+    BroadphaseStats* stats = &amp->broadphase_stats[amp->broadphase_backend];
+    const BroadphasePair* pairs = NULL;
+    uint32_t pair_count = 0;
+    
+    uint64_t t0 = profiler_now();
+    uint64_t t1 = t0;
+    
+    if (amp->broadphase_backend == BROADPHASE_SAP) {
+        // Sort and sweep happen together in sap_update_end
+        SapBox* boxes = sap_update_begin(amp->sap, amp->entity_count);
+        if (boxes) {
+            broadphase_sap_boxes(boxes, entities, amp->entity_count);
+            pair_count = sap_update_end(amp->sap, &pairs);
+        }
+        t1 = profiler_now();
+    } else {
+        // Move entities that crossed a cell boundary since last frame
+        broadphase_grid_update(&amp->broadphase, entities, amp->entity_count);
+        t1 = profiler_now();
+        pair_count = broadphase_grid_pairs(&amp->broadphase);
+        pairs = amp->broadphase.pairs;
+    }
+    
+    uint64_t t2 = profiler_now();
+    broadphase_dispatch_pairs(entities, pairs, pair_count, delta_time);
+    
+    // Collision response lands in the AoS mirror; the SoA and archetype
+    // layouts would drop it on the next simulate, so store it back. An entity
+    // in several pairs is stored more than once, always with its final value.
+    if (amp->storage_mode != ENTITY_STORAGE_AOS) {
+        for (uint32_t i = 0; i < pair_count; i++) {
+            metaverse_entity_set(amp, pairs[i].a, &entities[pairs[i].a]);
+            metaverse_entity_set(amp, pairs[i].b, &entities[pairs[i].b]);
+        }
+    }
+    uint64_t t3 = profiler_now();
+    
+    stats->frames++;
+    stats->pairs = pair_count;
+    stats->update_us = profiler_ticks_to_us(t1 - t0);
+    stats->pair_us = profiler_ticks_to_us(t2 - t1);
+    stats->narrowphase_us = profiler_ticks_to_us(t3 - t2);
+}
+
+// Select the broadphase. Must be called between frames. The backend being
+// left drops its state, so switching back rebuilds it from scratch.
+bool metaverse_set_broadphase(MetaverseAmplifier* amp, BroadphaseBackend backend) {
+    if (backend >= BROADPHASE_BACKEND_COUNT) return false;
+    if (backend == amp->broadphase_backend) return true;
+    
+    if (backend == BROADPHASE_SAP && !amp->sap) {
+        amp->sap = sap_create();
+        if (!amp->sap) {
+            amp->godot.godot_error("Failed to create sweep-and-prune broadphase");
+            return false;
+        }
+    }
+    
+    if (amp->broadphase_backend == BROADPHASE_SAP) {
+        sap_reset(amp->sap);
+    } else {
+        broadphase_grid_free(&amp->broadphase);
+    }
+    
+    amp->broadphase_backend = backend;
+    return true;
+}
+
+// Last-frame numbers for either backend, for side-by-side comparison
+void metaverse_get_broadphase_stats(MetaverseAmplifier* amp, BroadphaseBackend backend,
+                                    BroadphaseStats* stats) {
+    if (backend >= BROADPHASE_BACKEND_COUNT) {
+        memset(stats, 0, sizeof(BroadphaseStats));
+        return;
+    }
+    *stats = amp->broadphase_stats[backend];
+}
+
+// Append received updates for world_apply_remote_updates
+static bool remote_updates_push(MetaverseAmplifier* amp, const EntityUpdate* updates,
+                                uint32_t count) {
+    pthread_mutex_lock(&amp->remote_update_lock);
+    
+    uint32_t needed = amp->remote_update_count + count;
+    if (needed > amp->remote_update_capacity) {
+        uint32_t capacity = amp->remote_update_capacity ? amp->remote_update_capacity : 256;
+        while (capacity < needed) capacity *= 2;
+        
+        EntityUpdate* queue = realloc(amp->remote_updates, sizeof(EntityUpdate) * capacity);
+        if (!queue) {
+            pthread_mutex_unlock(&amp->remote_update_lock);
+            return false;
+        }
+        amp->remote_updates = queue;
+        amp->remote_update_capacity = capacity;
+    }
+    
+    memcpy(&amp->remote_updates[amp->remote_update_count], updates, sizeof(EntityUpdate) * count);
+    amp->remote_update_count = needed;
+    
+    pthread_mutex_unlock(&amp->remote_update_lock);
+    return true;
+}
+
+// Network thread for multiplayer
+void* metaverse_network_thread(void* arg) {
+    MetaverseAmplifier* amp = (MetaverseAmplifier*)arg;
+    
+    // Network setup (simplified)
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in server_addr;
+    
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(7777);
@@ -576,25 +2858,19 @@ void* metaverse_network_thread(void* arg) {
                                    NULL, &addr_len);
         
         if (received > 0) {
-            pthread_mutex_lock(&amp->entity_mutex);
-            
-            int update_count = received / sizeof(EntityUpdate);
-            for (int i = 0; i < update_count; i++) {
-                // Find and update entity
-                for (uint32_t j = 0; j < amp->entity_count; j++) {
-                    if (amp->entities[j].entity_id == updates[i].entity_id) {
-                        amp->entities[j].position = updates[i].position;
-                        amp->entities[j].rotation = updates[i].rotation;
-                        break;
-                    }
-                }
+            // Queued for the next simulate phase; storage is not touched here
+            uint32_t update_count = (uint32_t)(received / sizeof(EntityUpdate));
+            if (!remote_updates_push(amp, updates, update_count)) {
+                amp->godot.godot_error("Failed to queue remote entity updates");
             }
-            
-            pthread_mutex_unlock(&amp->entity_mutex);
         }
         
-        // Send updates to other players
-        metaverse_send_updates(amp, sockfd);
+        // Send updates to other players, serialized from the published frame
+        const WorldSnapshot* world = metaverse_snapshot_acquire(amp);
+        if (world) {
+            metaverse_send_updates(world, sockfd);
+            metaverse_snapshot_release(world);
+        }
         
         usleep(16667);  // ~60Hz network update
     }
@@ -603,6 +2879,304 @@ void* metaverse_network_thread(void* arg) {
     return NULL;
 }
 
+// Asset cache
+static void cache_free_mesh(void* asset, void* data) {
+    (void)data;
+    metaverse_mesh_free(asset);  // Whole LOD chain
+}
+
+// No GL context here: queue the texture name for metaverse_release_textures
+static void cache_free_texture(void* asset, void* data) {
+    MetaverseAmplifier* amp = data;
+    TextureData* texture = asset;
+    if (texture->gl_texture_id) {
+        pthread_mutex_lock(&amp->texture_release_lock);
+        if (amp->texture_release_count == amp->texture_release_capacity) {
+            uint32_t capacity = amp->texture_release_capacity ? amp->texture_release_capacity * 2 : 64;
+            GLuint* names = realloc(amp->texture_release, sizeof(GLuint) * capacity);
+            if (names) {
+                amp->texture_release = names;
+                amp->texture_release_capacity = capacity;
+            }
+        }
+        if (amp->texture_release_count < amp->texture_release_capacity) {
+            amp->texture_release[amp->texture_release_count++] = texture->gl_texture_id;
+        } else {
+            // The GL texture lives until the context goes away
+            amp->godot.godot_error("Failed to queue evicted texture for deletion");
+        }
+        pthread_mutex_unlock(&amp->texture_release_lock);
+    }
+    free(texture->texture_data);
+    free(texture);
+}
+
+static size_t mesh_resident_bytes(const MeshData* mesh) {
+    size_t bytes = 0;
+    for (; mesh; mesh = mesh->next_lod) {
+        bytes += sizeof(MeshData);
+        if (mesh->vertex_data) bytes += sizeof(float) * 3 * mesh->vertex_count;
+        if (mesh->normal_data) bytes += sizeof(float) * 3 * mesh->vertex_count;
+        if (mesh->uv_data) bytes += sizeof(float) * 2 * mesh->vertex_count;
+        if (mesh->index_data) bytes += sizeof(uint32_t) * mesh->index_count;
+    }
+    return bytes;
+}
+
+static size_t texture_data_bytes(const TextureData* texture) {
+    if (texture->data_size) return texture->data_size;
+    return (size_t)texture->width * texture->height * texture->channels;
+}
+
+// Content key of a mesh: counts and every attribute stream of the base level
+AssetKey metaverse_mesh_key(const MeshData* mesh) {
+    uint32_t header[2] = { mesh->vertex_count, mesh->index_data ? mesh->index_count : 0 };
+    AssetKey key = asset_hash(header, sizeof(header), 0x6d657368);  // "mesh"
+    size_t vertices = mesh->vertex_count;
+    
+    if (mesh->vertex_data) key = asset_hash(mesh->vertex_data, sizeof(float) * 3 * vertices, key);
+    if (mesh->normal_data) key = asset_hash(mesh->normal_data, sizeof(float) * 3 * vertices, key ^ 1);
+    if (mesh->uv_data) key = asset_hash(mesh->uv_data, sizeof(float) * 2 * vertices, key ^ 2);
+    if (mesh->index_data) {
+        key = asset_hash(mesh->index_data, sizeof(uint32_t) * mesh->index_count, key ^ 3);
+    }
+    return key;
+}
+
+// Content key of a texture: layout plus pixel data
+AssetKey metaverse_texture_key(const TextureData* texture) {
+    uint32_t header[6] = {
+        (uint32_t)texture->width, (uint32_t)texture->height, (uint32_t)texture->channels,
+        (uint32_t)texture->format, texture->mip_count, texture->srgb
+    };
+    AssetKey key = asset_hash(header, sizeof(header), 0x74657874);  // "text"
+    return asset_hash(texture->texture_data, texture_data_bytes(texture), key);
+}
+
+// Hand a loaded mesh (and its LOD chain) to the cache and get a reference.
+// The cache owns the mesh afterwards: if identical content is already
+// resident, `mesh` is freed and the resident copy's handle is returned, so
+// read the data back through asset_cache_get(amp->mesh_cache, handle).
+// Acquiring the resident mesh again only adds a reference; on failure the
+// mesh has been freed.
+// Callers that know the key before loading can try asset_cache_acquire()
+// first and skip the load on a hit. Meshes from metaverse_import_meshes()
+// are keyed by their source, so take more references to those with
+// asset_cache_retain() rather than acquiring the resident chain.
+AssetHandle metaverse_mesh_acquire(MetaverseAmplifier* amp, MeshData* mesh) {
+    if (!mesh) return ASSET_HANDLE_INVALID;
+    return asset_cache_insert(amp->mesh_cache, metaverse_mesh_key(mesh), mesh,
+                              mesh_resident_bytes(mesh));
+}
+
+// Same for textures; once the entry is evicted, the GL texture is deleted by
+// the next metaverse_render_enhanced
+AssetHandle metaverse_texture_acquire(MetaverseAmplifier* amp, TextureData* texture) {
+    if (!texture) return ASSET_HANDLE_INVALID;
+    return asset_cache_insert(amp->texture_cache, metaverse_texture_key(texture), texture,
+                              sizeof(TextureData) + texture_data_bytes(texture));
+}
+
+typedef struct {
+    AssetKey key;
+    uint32_t index;
+} MeshImportKey;
+
+static int mesh_import_key_compare(const void* a, const void* b) {
+    AssetKey x = ((const MeshImportKey*)a)->key;
+    AssetKey y = ((const MeshImportKey*)b)->key;
+    return x < y ? -1 : x > y;
+}
+
+// Import a batch of loaded meshes (e.g. one scene). Each mesh is keyed by
+// its source content, metaverse_mesh_key() of the mesh as loaded, so a
+// loader can probe asset_cache_acquire() with that key and skip the load.
+// Only sources missing from the cache get an LOD chain, built on the job
+// system with one mesh per job; a source repeated within the batch is built
+// once. The chain is cached under its source's key, or the source itself if
+// no chain could be built. Takes ownership of every mesh; handles[i] is the
+// reference for meshes[i]. Returns false if the batch scratch could not be
+// allocated, in which case nothing was imported.
+bool metaverse_import_meshes(MetaverseAmplifier* amp, MeshData** meshes, uint32_t count,
+                             AssetHandle* handles) {
+    PROFILE_ZONE("Mesh import");
+    uint32_t capacity = count ? count : 1;
+    MeshImportKey* keys = malloc(sizeof(MeshImportKey) * capacity);
+    MeshData** sources = malloc(sizeof(MeshData*) * capacity);
+    MeshData** chains = malloc(sizeof(MeshData*) * capacity);
+    uint32_t* builds = malloc(sizeof(uint32_t) * capacity);
+    if (!keys || !sources || !chains || !builds) {
+        free(keys);
+        free(sources);
+        free(chains);
+        free(builds);
+        return false;
+    }
+    
+    // Sorted by key, repeats of one source sit together
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = (MeshImportKey){ metaverse_mesh_key(meshes[i]), i };
+    }
+    qsort(keys, count, sizeof(MeshImportKey), mesh_import_key_compare);
+    
+    // Probe once per distinct source; a hit needs no build
+    uint32_t build_count = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t i = keys[k].index;
+        handles[i] = ASSET_HANDLE_INVALID;
+        if (k > 0 && keys[k].key == keys[k - 1].key) continue;
+        
+        handles[i] = asset_cache_acquire(amp->mesh_cache, keys[k].key);
+        if (handles[i] != ASSET_HANDLE_INVALID) {
+            metaverse_mesh_free(meshes[i]);
+        } else {
+            sources[build_count] = meshes[i];
+            builds[build_count++] = k;
+        }
+    }
+    
+    metaverse_mesh_build_lods_batch(amp->jobs, sources, chains, build_count, MESH_IMPORT_LODS,
+                                    MESH_IMPORT_REDUCTION);
+    
+    for (uint32_t b = 0; b < build_count; b++) {
+        MeshData* mesh = sources[b];
+        if (chains[b]) {
+            metaverse_mesh_free(mesh);
+            mesh = chains[b];
+        }
+        const MeshImportKey* entry = &keys[builds[b]];
+        handles[entry->index] = asset_cache_insert(amp->mesh_cache, entry->key, mesh,
+                                                   mesh_resident_bytes(mesh));
+    }
+    
+    // Repeats share the first copy's entry; if that insert failed, each
+    // repeat is cached as loaded
+    uint32_t first = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t i = keys[k].index;
+        if (k == 0 || keys[k].key != keys[k - 1].key) {
+            first = i;
+            continue;
+        }
+        handles[i] = asset_cache_retain(amp->mesh_cache, handles[first]);
+        if (handles[i] != ASSET_HANDLE_INVALID) {
+            metaverse_mesh_free(meshes[i]);
+        } else {
+            handles[i] = asset_cache_insert(amp->mesh_cache, keys[k].key, meshes[i],
+                                            mesh_resident_bytes(meshes[i]));
+        }
+    }
+    
+    free(keys);
+    free(sources);
+    free(chains);
+    free(builds);
+    return true;
+}
+
+void metaverse_set_cache_budget(MetaverseAmplifier* amp, size_t mesh_bytes, size_t texture_bytes) {
+    asset_cache_set_budget(amp->mesh_cache, mesh_bytes);
+    asset_cache_set_budget(amp->texture_cache, texture_bytes);
+}
+
+// Hit/miss/eviction counters; either output may be NULL
+void metaverse_get_cache_stats(MetaverseAmplifier* amp, AssetCacheStats* mesh_stats,
+                               AssetCacheStats* texture_stats) {
+    if (mesh_stats) asset_cache_get_stats(amp->mesh_cache, mesh_stats);
+    if (texture_stats) asset_cache_get_stats(amp->texture_cache, texture_stats);
+}
+
+// Frame phase graph
+// simulate -> input -> physics -> network, with audio overlapping input and
+// physics once simulation is done. Rendering stays on the calling thread,
+// which owns the GL context.
+static void frame_node_simulate(void* data) {
+    MetaverseAmplifier* amp = (MetaverseAmplifier*)data;
+    world_simulate(amp, amp->frame_delta);
+}
+
+// Drain everything pushed since the last frame, then hand the game the
+// coalesced axes and every button edge in order
+static void metaverse_input_update(MetaverseAmplifier* amp) {
+    PROFILE_ZONE("Input");
+    if (amp->input_ring) input_ring_drain(amp->input_ring, &amp->input);
+    metaverse_process_input(amp, &amp->input);
+}
+
+static void frame_node_input(void* data) {
+    metaverse_input_update((MetaverseAmplifier*)data);
+}
+
+static void frame_node_audio(void* data) {
+    metaverse_spatial_audio_update((MetaverseAmplifier*)data);
+}
+
+static void frame_node_physics(void* data) {
+    MetaverseAmplifier* amp = (MetaverseAmplifier*)data;
+    metaverse_physics_optimized(amp, amp->frame_delta);
+}
+
+static void frame_node_network(void* data) {
+    metaverse_network_update((MetaverseAmplifier*)data);
+}
+
+static JobGraph* metaverse_build_frame_graph(MetaverseAmplifier* amp) {
+    JobGraph* graph = job_graph_create();
+    if (!graph) return NULL;
+    
+    uint32_t simulate = job_graph_add(graph, "simulate", frame_node_simulate, amp);
+    uint32_t input = job_graph_add(graph, "input", frame_node_input, amp);
+    uint32_t audio = job_graph_add(graph, "audio", frame_node_audio, amp);
+    uint32_t physics = job_graph_add(graph, "physics", frame_node_physics, amp);
+    uint32_t network = job_graph_add(graph, "network", frame_node_network, amp);
+    
+    job_graph_depend(graph, input, simulate);
+    job_graph_depend(graph, audio, simulate);
+    job_graph_depend(graph, physics, input);
+    job_graph_depend(graph, network, physics);
+    
+    return graph;
+}
+
+// Run one frame: simulation phases on the job system, then render
+void metaverse_run_frame(MetaverseAmplifier* amp, double delta_time) {
+    PROFILE_ZONE("Frame");
+    amp->frame_delta = delta_time;
+    
+    if (amp->frame_graph) {
+        job_graph_run(amp->jobs, amp->frame_graph);
+    } else {
+        // Serial fallback, original phase order
+        metaverse_update_world(amp, delta_time);
+        metaverse_input_update(amp);
+        metaverse_physics_optimized(amp, delta_time);
+        metaverse_network_update(amp);
+    }
+    
+    // Frame N becomes visible to readers; next frame's simulation may start
+    // writing the live state as soon as this returns
+    world_publish_snapshot(amp);
+    
+    metaverse_render_enhanced(amp);
+    
+    // Everything from godot_frame_alloc this frame is released
+    frame_arena_reset(amp->frame_arena);
+}
+
+// Restart the job system with a new worker count (0 = one per core,
+// 1 = serial). Must be called between frames from the render thread.
+bool metaverse_set_thread_count(MetaverseAmplifier* amp, uint32_t thread_count) {
+    job_system_destroy(amp->jobs);
+    amp->jobs = job_system_create(thread_count);
+    metaverse_texture_set_job_system(amp->jobs);
+    
+    if (!amp->jobs) {
+        amp->godot.godot_error("Failed to create job system, running serially");
+        return false;
+    }
+    return true;
+}
+
 // Cleanup
 void metaverse_amplifier_destroy(MetaverseAmplifier* amp) {
     if (!amp) return;
@@ -611,24 +3185,45 @@ void metaverse_amplifier_destroy(MetaverseAmplifier* amp) {
     
     // Free entities
     free(amp->entities);
-    
-    // Free cache
-    for (uint32_t i = 0; i < amp->cache_size; i++) {
-        if (amp->mesh_cache[i].vertex_data) {
-            free(amp->mesh_cache[i].vertex_data);
-        }
-        if (amp->texture_cache[i].texture_data) {
-            free(amp->texture_cache[i].texture_data);
-        }
+    entity_soa_free(&amp->soa);
+    entity_archetype_free(amp);
+    entity_index_destroy(amp->entity_index);
+    broadphase_grid_free(&amp->broadphase);
+    sap_destroy(amp->sap);
+    for (uint32_t s = 0; s < WORLD_SNAPSHOT_COUNT; s++) {
+        world_snapshot_free(&amp->snapshots[s]);
     }
     
-    free(amp->mesh_cache);
-    free(amp->texture_cache);
+    // Free cache, including assets still referenced
+    asset_cache_destroy(amp->mesh_cache);
+    asset_cache_destroy(amp->texture_cache);
+    metaverse_release_textures(amp);
+    free(amp->texture_release);
+    free(amp->texture_deleting);
+    free(amp->remote_updates);
     free(amp->audio_emitters);
     
+    // Producers must have stopped pushing by now
+    input_ring_destroy(amp->input_ring);
+    input_frame_free(&amp->input);
+    
+    // Free render queue and instance ring
+    if (amp->render_queue.upload_buffer) {
+        glDeleteBuffers(1, &amp->render_queue.upload_buffer);
+    }
+    render_queue_free(&amp->render_queue);
+    
+    // Stop workers
+    metaverse_texture_set_job_system(NULL);
+    job_graph_destroy(amp->frame_graph);
+    job_system_destroy(amp->jobs);
+    frame_arena_destroy(amp->frame_arena);
+    
     // Destroy synchronization primitives
     pthread_mutex_destroy(&amp->entity_mutex);
     pthread_mutex_destroy(&amp->render_mutex);
+    pthread_mutex_destroy(&amp->texture_release_lock);
+    pthread_mutex_destroy(&amp->remote_update_lock);
     pthread_rwlock_destroy(&amp->world_lock);
     
     free(amp);
@@ -636,42 +3231,23 @@ void metaverse_amplifier_destroy(MetaverseAmplifier* amp) {
     printf("Metaverse Amplifier destroyed\n");
 }
 
-// Utility functions
-float calculate_relative_velocity(float* emitter_vel, float* listener_pos) {
-    // Simplified relative velocity calculation
-    return sqrtf(emitter_vel[0]*emitter_vel[0] + 
-                emitter_vel[1]*emitter_vel[1] + 
-                emitter_vel[2]*emitter_vel[2]);
-}
-
-void normalize_vector(float* v) {
-    float length = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
-    if (length > 0.0001f) {
-        v[0] /= length;
-        v[1] /= length;
-        v[2] /= length;
-    }
-}
-
-float dot_product(float* a, float* b) {
-    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
-}
-
-void* get_left_vector(float* forward, float* up) {
-    static float left[3];
-    left[0] = forward[1]*up[2] - forward[2]*up[1];
-    left[1] = forward[2]*up[0] - forward[0]*up[2];
-    left[2] = forward[0]*up[1] - forward[1]*up[0];
-    return left;
-}
-
+#ifndef METAVERSE_HEADLESS
 int main() {
     printf("Godot Metaverse Amplifier - C Core\n");
     
+    // METAVERSE_TRACE=<file> records zones and writes a Chrome trace on exit
+    const char* trace_path = getenv("METAVERSE_TRACE");
+    if (trace_path) {
+        profiler_set_thread_name("Main");
+        profiler_set_enabled(true);
+    }
+    
     // Simulate Godot API
     GodotAPI api = {
         .godot_alloc = malloc,
         .godot_free = free,
+        .godot_frame_alloc = frame_alloc,
+        .godot_frame_alloc_carry = frame_alloc_carry,
         .godot_print = printf,
         .godot_error = printf,
         .godot_get_time = get_time
@@ -703,21 +3279,9 @@ int main() {
                            (current_frame.tv_nsec - last_frame.tv_nsec) / 1e9;
         last_frame = current_frame;
         
-        // Update world
-        metaverse_update_world(amp, delta_time);
-        
-        // Process input
-        float input_state[16] = {0};
-        metaverse_process_input(amp, input_state);
-        
-        // Update physics
-        metaverse_physics_optimized(amp, delta_time);
-        
-        // Render
-        metaverse_render_enhanced(amp);
-        
-        // Network update
-        metaverse_network_update(amp);
+        // Update world, input, physics, audio and network in parallel
+        // phases, then render
+        metaverse_run_frame(amp, delta_time);
         
         // Update frame timing
         amp->frame_time = 0.9 * amp->frame_time + 0.1 * delta_time;
@@ -742,8 +3306,16 @@ int main() {
     // Cleanup
     metaverse_amplifier_destroy(amp);
     
+    if (trace_path) {
+        if (profiler_export_chrome_trace(trace_path)) {
+            printf("Trace written to %s\n", trace_path);
+        }
+        profiler_shutdown();
+    }
+    
     return 0;
 }
+#endif
 
 double get_time() {
     struct timespec ts;
@@ -0,0 +1,666 @@
+/*******************************************************************************
+ * METAVERSE ASSET CACHE
+ * Content-addressed, refcounted asset cache with a byte budget
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+// Assets are keyed by a 64-bit hash of their content, so the same mesh or
+// texture requested by several owners (e.g. LOD objects sharing a base mesh)
+// is resident once. Owners hold handles: generation in the high 32 bits,
+// entry slot in the low 32, as with entity handles. An entry whose refcount
+// drops to zero stays resident until the byte budget forces it out.
+typedef uint64_t AssetKey;
+typedef uint64_t AssetHandle;
+
+#define ASSET_HANDLE_INVALID 0
+#define ASSET_KEY_EMPTY      0          // Reserved; asset_hash() never returns it
+#define ASSET_NONE           UINT32_MAX
+
+typedef enum {
+    ASSET_EVICT_LRU = 0,        // Least recently released first
+    ASSET_EVICT_CLOCK           // Second-chance sweep over entry slots
+} AssetEvictPolicy;
+
+// Called with the cache lock held, on whichever thread evicts; data is the
+// pointer given to asset_cache_create
+typedef void (*AssetFreeFunc)(void* asset, void* data);
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t insertions;
+    size_t bytes_resident;
+    size_t bytes_budget;
+    size_t bytes_evicted;
+    uint32_t entries;
+    uint32_t referenced;        // Entries with outstanding handles (not evictable)
+} AssetCacheStats;
+
+typedef struct {
+    AssetKey key;               // ASSET_KEY_EMPTY when the slot is free
+    void* asset;
+    size_t bytes;
+    uint32_t refcount;
+    uint32_t generation;
+    uint32_t prev;              // LRU list links (unreferenced entries only)
+    uint32_t next;              // Also the free-slot list link
+    bool clock_bit;
+} AssetEntry;
+
+typedef struct AssetCache {
+    AssetEvictPolicy policy;
+    AssetFreeFunc free_asset;
+    void* free_data;
+    size_t budget;
+    
+    // Open-addressing hash, key -> entry slot (linear probing, power-of-two)
+    AssetKey* keys;
+    uint32_t* values;
+    uint32_t hash_capacity;
+    
+    AssetEntry* entries;
+    uint32_t entry_count;       // Slots ever used
+    uint32_t entry_capacity;
+    uint32_t free_entry;
+    
+    // LRU list of unreferenced entries, head is the eviction candidate
+    uint32_t lru_head;
+    uint32_t lru_tail;
+    
+    // CLOCK hand over entry slots
+    uint32_t clock_hand;
+    
+    AssetCacheStats stats;
+    pthread_mutex_t lock;
+} AssetCache;
+
+// Function prototypes
+AssetCache* asset_cache_create(size_t budget, AssetEvictPolicy policy, AssetFreeFunc free_asset,
+                               void* free_data);
+void asset_cache_destroy(AssetCache* cache);
+AssetKey asset_hash(const void* data, size_t size, AssetKey seed);
+AssetHandle asset_cache_acquire(AssetCache* cache, AssetKey key);
+AssetHandle asset_cache_insert(AssetCache* cache, AssetKey key, void* asset, size_t bytes);
+AssetHandle asset_cache_retain(AssetCache* cache, AssetHandle handle);
+void asset_cache_release(AssetCache* cache, AssetHandle handle);
+void* asset_cache_get(AssetCache* cache, AssetHandle handle);
+void asset_cache_set_budget(AssetCache* cache, size_t budget);
+uint32_t asset_cache_trim(AssetCache* cache);
+void asset_cache_get_stats(AssetCache* cache, AssetCacheStats* stats);
+
+static inline uint32_t asset_key_bucket(AssetKey key, uint32_t mask) {
+    // Keys are already well mixed
+    return (uint32_t)(key ^ (key >> 32)) & mask;
+}
+
+static inline AssetHandle make_asset_handle(uint32_t slot, uint32_t generation) {
+    return ((uint64_t)generation << 32) | slot;
+}
+
+static inline uint64_t asset_mix(uint64_t h, uint64_t v) {
+    h ^= v * 0x9e3779b97f4a7c15ULL;
+    h = (h << 31) | (h >> 33);
+    return h * 0xbf58476d1ce4e5b9ULL;
+}
+
+// 64-bit content hash, eight bytes per step. Chain calls through `seed` to
+// hash several buffers as one key. Not cryptographic: a collision would alias
+// two assets, which at 64 bits is acceptable for a resident set of this size.
+AssetKey asset_hash(const void* data, size_t size, AssetKey seed) {
+    const uint8_t* bytes = data;
+    uint64_t h = seed ^ (size * 0xff51afd7ed558ccdULL);
+    
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, bytes + i, sizeof(v));
+        h = asset_mix(h, v);
+    }
+    if (i < size) {
+        uint64_t v = 0;
+        memcpy(&v, bytes + i, size - i);
+        h = asset_mix(h, v ^ 0x80);
+    }
+    
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h == ASSET_KEY_EMPTY ? 1 : h;
+}
+
+// Hash table (same scheme as the entity index)
+static bool asset_hash_alloc(AssetCache* cache, uint32_t capacity) {
+    AssetKey* keys = malloc(sizeof(AssetKey) * capacity);
+    uint32_t* values = malloc(sizeof(uint32_t) * capacity);
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < capacity; i++) {
+        keys[i] = ASSET_KEY_EMPTY;
+    }
+    cache->keys = keys;
+    cache->values = values;
+    cache->hash_capacity = capacity;
+    return true;
+}
+
+static void asset_hash_put(AssetCache* cache, AssetKey key, uint32_t value) {
+    uint32_t mask = cache->hash_capacity - 1;
+    uint32_t bucket = asset_key_bucket(key, mask);
+    
+    while (cache->keys[bucket] != ASSET_KEY_EMPTY && cache->keys[bucket] != key) {
+        bucket = (bucket + 1) & mask;
+    }
+    
+    cache->keys[bucket] = key;
+    cache->values[bucket] = value;
+}
+
+static uint32_t asset_hash_find(const AssetCache* cache, AssetKey key) {
+    uint32_t mask = cache->hash_capacity - 1;
+    uint32_t bucket = asset_key_bucket(key, mask);
+    
+    while (cache->keys[bucket] != ASSET_KEY_EMPTY) {
+        if (cache->keys[bucket] == key) return bucket;
+        bucket = (bucket + 1) & mask;
+    }
+    return ASSET_NONE;
+}
+
+// Backward-shift deletion
+static void asset_hash_erase(AssetCache* cache, uint32_t bucket) {
+    uint32_t mask = cache->hash_capacity - 1;
+    uint32_t hole = bucket;
+    uint32_t next = (hole + 1) & mask;
+    
+    while (cache->keys[next] != ASSET_KEY_EMPTY) {
+        uint32_t home = asset_key_bucket(cache->keys[next], mask);
+        
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            cache->keys[hole] = cache->keys[next];
+            cache->values[hole] = cache->values[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    
+    cache->keys[hole] = ASSET_KEY_EMPTY;
+}
+
+static bool asset_hash_grow(AssetCache* cache) {
+    AssetKey* old_keys = cache->keys;
+    uint32_t* old_values = cache->values;
+    uint32_t old_capacity = cache->hash_capacity;
+    
+    if (!asset_hash_alloc(cache, old_capacity * 2)) return false;
+    
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] != ASSET_KEY_EMPTY) {
+            asset_hash_put(cache, old_keys[i], old_values[i]);
+        }
+    }
+    
+    free(old_keys);
+    free(old_values);
+    return true;
+}
+
+// LRU list
+static void lru_unlink(AssetCache* cache, uint32_t slot) {
+    AssetEntry* entry = &cache->entries[slot];
+    
+    if (entry->prev != ASSET_NONE) cache->entries[entry->prev].next = entry->next;
+    else cache->lru_head = entry->next;
+    
+    if (entry->next != ASSET_NONE) cache->entries[entry->next].prev = entry->prev;
+    else cache->lru_tail = entry->prev;
+    
+    entry->prev = ASSET_NONE;
+    entry->next = ASSET_NONE;
+}
+
+static void lru_push_tail(AssetCache* cache, uint32_t slot) {
+    AssetEntry* entry = &cache->entries[slot];
+    
+    entry->prev = cache->lru_tail;
+    entry->next = ASSET_NONE;
+    if (cache->lru_tail != ASSET_NONE) cache->entries[cache->lru_tail].next = slot;
+    else cache->lru_head = slot;
+    cache->lru_tail = slot;
+}
+
+// Take a reference on a resident entry
+static AssetHandle entry_retain(AssetCache* cache, uint32_t slot) {
+    AssetEntry* entry = &cache->entries[slot];
+    
+    if (entry->refcount++ == 0) {
+        if (cache->policy == ASSET_EVICT_LRU) lru_unlink(cache, slot);
+        cache->stats.referenced++;
+    }
+    entry->clock_bit = true;
+    return make_asset_handle(slot, entry->generation);
+}
+
+// Slot for a live handle, or ASSET_NONE if it is stale
+static uint32_t handle_slot(const AssetCache* cache, AssetHandle handle) {
+    uint32_t slot = (uint32_t)handle;
+    uint32_t generation = (uint32_t)(handle >> 32);
+    
+    if (slot >= cache->entry_count) return ASSET_NONE;
+    
+    const AssetEntry* entry = &cache->entries[slot];
+    if (entry->key == ASSET_KEY_EMPTY || entry->generation != generation) return ASSET_NONE;
+    return slot;
+}
+
+// Drop an unreferenced entry and free its asset
+static void entry_evict(AssetCache* cache, uint32_t slot) {
+    AssetEntry* entry = &cache->entries[slot];
+    
+    if (cache->policy == ASSET_EVICT_LRU) lru_unlink(cache, slot);
+    asset_hash_erase(cache, asset_hash_find(cache, entry->key));
+    
+    if (cache->free_asset) cache->free_asset(entry->asset, cache->free_data);
+    
+    cache->stats.bytes_resident -= entry->bytes;
+    cache->stats.bytes_evicted += entry->bytes;
+    cache->stats.entries--;
+    cache->stats.evictions++;
+    
+    // Outstanding stale handles are caught by the generation
+    entry->key = ASSET_KEY_EMPTY;
+    entry->asset = NULL;
+    entry->bytes = 0;
+    entry->generation++;
+    if (entry->generation == 0) entry->generation = 1;
+    entry->next = cache->free_entry;
+    cache->free_entry = slot;
+}
+
+// Next eviction candidate, or ASSET_NONE if every entry is referenced
+static uint32_t pick_victim(AssetCache* cache) {
+    if (cache->policy == ASSET_EVICT_LRU) return cache->lru_head;
+    
+    // Two sweeps clear every clock bit, so a third finds a victim if one exists
+    uint32_t limit = cache->entry_count * 2 + 1;
+    for (uint32_t step = 0; step < limit && cache->entry_count > 0; step++) {
+        uint32_t slot = cache->clock_hand;
+        cache->clock_hand = (cache->clock_hand + 1) % cache->entry_count;
+        
+        AssetEntry* entry = &cache->entries[slot];
+        if (entry->key == ASSET_KEY_EMPTY || entry->refcount > 0) continue;
+        
+        if (entry->clock_bit) {
+            entry->clock_bit = false;
+            continue;
+        }
+        return slot;
+    }
+    return ASSET_NONE;
+}
+
+// Evict until `incoming` more bytes fit the budget. Referenced entries are
+// never evicted, so the cache may run over budget while they are held.
+static uint32_t evict_to_fit(AssetCache* cache, size_t incoming) {
+    uint32_t evicted = 0;
+    
+    while (cache->stats.bytes_resident + incoming > cache->budget) {
+        uint32_t victim = pick_victim(cache);
+        if (victim == ASSET_NONE) break;
+        
+        entry_evict(cache, victim);
+        evicted++;
+    }
+    return evicted;
+}
+
+static uint32_t alloc_entry(AssetCache* cache) {
+    uint32_t slot = cache->free_entry;
+    if (slot != ASSET_NONE) {
+        cache->free_entry = cache->entries[slot].next;
+        return slot;
+    }
+    
+    if (cache->entry_count == cache->entry_capacity) {
+        uint32_t capacity = cache->entry_capacity * 2;
+        AssetEntry* grown = realloc(cache->entries, sizeof(AssetEntry) * capacity);
+        if (!grown) return ASSET_NONE;
+        
+        cache->entries = grown;
+        cache->entry_capacity = capacity;
+    }
+    
+    slot = cache->entry_count++;
+    cache->entries[slot].generation = 1;
+    return slot;
+}
+
+// Create cache
+AssetCache* asset_cache_create(size_t budget, AssetEvictPolicy policy, AssetFreeFunc free_asset,
+                               void* free_data) {
+    AssetCache* cache = malloc(sizeof(AssetCache));
+    if (!cache) return NULL;
+    
+    memset(cache, 0, sizeof(AssetCache));
+    cache->policy = policy;
+    cache->free_asset = free_asset;
+    cache->free_data = free_data;
+    cache->budget = budget;
+    cache->stats.bytes_budget = budget;
+    
+    cache->entry_capacity = 64;
+    cache->entries = malloc(sizeof(AssetEntry) * cache->entry_capacity);
+    cache->free_entry = ASSET_NONE;
+    cache->lru_head = ASSET_NONE;
+    cache->lru_tail = ASSET_NONE;
+    
+    if (!cache->entries || !asset_hash_alloc(cache, 128)) {
+        free(cache->entries);
+        free(cache);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+// Look up an asset by content key. A hit returns a new reference; a miss
+// returns ASSET_HANDLE_INVALID and the caller loads and inserts the asset.
+AssetHandle asset_cache_acquire(AssetCache* cache, AssetKey key) {
+    AssetHandle handle = ASSET_HANDLE_INVALID;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t bucket = key == ASSET_KEY_EMPTY ? ASSET_NONE : asset_hash_find(cache, key);
+    if (bucket != ASSET_NONE) {
+        handle = entry_retain(cache, cache->values[bucket]);
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    
+    pthread_mutex_unlock(&cache->lock);
+    return handle;
+}
+
+// Insert an asset under its content key, taking ownership, and return a
+// reference to it. If the key is already resident (another owner loaded the
+// same content first), the new copy is freed and the resident one returned;
+// inserting the resident pointer itself just takes another reference. On
+// ASSET_HANDLE_INVALID the asset has been freed as well (unless it was NULL).
+AssetHandle asset_cache_insert(AssetCache* cache, AssetKey key, void* asset, size_t bytes) {
+    if (key == ASSET_KEY_EMPTY || !asset) return ASSET_HANDLE_INVALID;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t bucket = asset_hash_find(cache, key);
+    if (bucket != ASSET_NONE) {
+        uint32_t slot = cache->values[bucket];
+        bool resident = cache->entries[slot].asset == asset;
+        AssetHandle handle = entry_retain(cache, slot);
+        pthread_mutex_unlock(&cache->lock);
+        
+        if (!resident && cache->free_asset) cache->free_asset(asset, cache->free_data);
+        return handle;
+    }
+    
+    evict_to_fit(cache, bytes);
+    
+    // Hash kept at most half full
+    uint32_t slot = ASSET_NONE;
+    if ((cache->stats.entries + 1) * 2 <= cache->hash_capacity || asset_hash_grow(cache)) {
+        slot = alloc_entry(cache);
+    }
+    if (slot == ASSET_NONE) {
+        pthread_mutex_unlock(&cache->lock);
+        if (cache->free_asset) cache->free_asset(asset, cache->free_data);
+        return ASSET_HANDLE_INVALID;
+    }
+    
+    AssetEntry* entry = &cache->entries[slot];
+    entry->key = key;
+    entry->asset = asset;
+    entry->bytes = bytes;
+    entry->refcount = 1;        // Not on the LRU list until released
+    entry->prev = ASSET_NONE;
+    entry->next = ASSET_NONE;
+    entry->clock_bit = true;
+    asset_hash_put(cache, key, slot);
+    
+    cache->stats.bytes_resident += bytes;
+    cache->stats.entries++;
+    cache->stats.insertions++;
+    cache->stats.referenced++;
+    
+    AssetHandle handle = make_asset_handle(slot, entry->generation);
+    
+    pthread_mutex_unlock(&cache->lock);
+    return handle;
+}
+
+// Take another reference through an existing handle
+AssetHandle asset_cache_retain(AssetCache* cache, AssetHandle handle) {
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t slot = handle_slot(cache, handle);
+    AssetHandle result = slot == ASSET_NONE ? ASSET_HANDLE_INVALID : entry_retain(cache, slot);
+    
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+// Drop a reference. The entry becomes evictable but stays resident.
+void asset_cache_release(AssetCache* cache, AssetHandle handle) {
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t slot = handle_slot(cache, handle);
+    if (slot != ASSET_NONE && cache->entries[slot].refcount > 0) {
+        if (--cache->entries[slot].refcount == 0) {
+            if (cache->policy == ASSET_EVICT_LRU) lru_push_tail(cache, slot);
+            cache->stats.referenced--;
+            
+            // Anything held over budget can go now
+            evict_to_fit(cache, 0);
+        }
+    }
+    
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Asset behind a handle. Valid while the handle's reference is held.
+void* asset_cache_get(AssetCache* cache, AssetHandle handle) {
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t slot = handle_slot(cache, handle);
+    void* asset = slot == ASSET_NONE ? NULL : cache->entries[slot].asset;
+    
+    pthread_mutex_unlock(&cache->lock);
+    return asset;
+}
+
+// Change the byte budget, evicting immediately if it shrank
+void asset_cache_set_budget(AssetCache* cache, size_t budget) {
+    pthread_mutex_lock(&cache->lock);
+    
+    cache->budget = budget;
+    cache->stats.bytes_budget = budget;
+    evict_to_fit(cache, 0);
+    
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Evict every unreferenced entry; returns the number evicted
+uint32_t asset_cache_trim(AssetCache* cache) {
+    uint32_t evicted = 0;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    uint32_t victim;
+    while ((victim = pick_victim(cache)) != ASSET_NONE) {
+        entry_evict(cache, victim);
+        evicted++;
+    }
+    
+    pthread_mutex_unlock(&cache->lock);
+    return evicted;
+}
+
+// Counters snapshot
+void asset_cache_get_stats(AssetCache* cache, AssetCacheStats* stats) {
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Cleanup; frees every resident asset, referenced or not
+void asset_cache_destroy(AssetCache* cache) {
+    if (!cache) return;
+    
+    for (uint32_t i = 0; i < cache->entry_count; i++) {
+        if (cache->entries[i].key != ASSET_KEY_EMPTY && cache->free_asset) {
+            cache->free_asset(cache->entries[i].asset, cache->free_data);
+        }
+    }
+    
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->keys);
+    free(cache->values);
+    free(cache->entries);
+    free(cache);
+}
+
+static uint32_t test_frees;
+static void test_free_asset(void* asset, void* data) {
+    (void)data;
+    test_frees++;
+    free(asset);
+}
+
+typedef struct {
+    int order[8];               // Ids in the order they were evicted
+    uint32_t count;
+} TestEvictionLog;
+
+static void test_log_asset(void* asset, void* data) {
+    TestEvictionLog* log = data;
+    if (log->count < 8) log->order[log->count] = *(int*)asset;
+    log->count++;
+    free(asset);
+}
+
+static AssetHandle test_insert_id(AssetCache* cache, int id) {
+    int* asset = malloc(sizeof(int));
+    *asset = id;
+    return asset_cache_insert(cache, asset_hash(&id, sizeof(id), 0), asset, 100);
+}
+
+// Four 100-byte entries fill a 400-byte CLOCK cache; entry 1 stays referenced
+// throughout and entry 2 is touched to earn a second chance
+static bool test_clock_eviction(void) {
+    TestEvictionLog log = {0};
+    AssetCache* cache = asset_cache_create(400, ASSET_EVICT_CLOCK, test_log_asset, &log);
+    if (!cache) return false;
+    
+    AssetHandle held = ASSET_HANDLE_INVALID;
+    for (int id = 0; id < 4; id++) {
+        AssetHandle handle = test_insert_id(cache, id);
+        if (id == 1) held = handle;
+        else asset_cache_release(cache, handle);
+    }
+    
+    // The first sweep clears every bit and skips the held entry: 0 goes
+    asset_cache_release(cache, test_insert_id(cache, 4));
+    
+    int touched = 2;
+    asset_cache_release(cache, asset_cache_acquire(cache, asset_hash(&touched, sizeof(touched), 0)));
+    
+    // 2 is next under the hand but was touched, so 3 goes first, then 2
+    asset_cache_release(cache, test_insert_id(cache, 5));
+    asset_cache_release(cache, test_insert_id(cache, 6));
+    
+    AssetCacheStats stats;
+    asset_cache_get_stats(cache, &stats);
+    bool ordered = log.count == 3 && log.order[0] == 0 && log.order[1] == 3 && log.order[2] == 2;
+    bool within_budget = stats.bytes_resident == 400 && stats.evictions == 3;
+    
+    // Shrinking the budget evicts everything unreferenced; the held entry survives
+    asset_cache_set_budget(cache, 0);
+    asset_cache_get_stats(cache, &stats);
+    int* survivor = asset_cache_get(cache, held);
+    bool held_kept = stats.entries == 1 && stats.bytes_resident == 100 && survivor && *survivor == 1;
+    
+    // Releasing it while over budget evicts it at once
+    asset_cache_release(cache, held);
+    asset_cache_get_stats(cache, &stats);
+    bool released = stats.entries == 0 && log.count == 7 && log.order[6] == 1;
+    
+    asset_cache_destroy(cache);
+    return ordered && within_budget && held_kept && released;
+}
+
+int main_asset_cache_test() {
+    printf("Metaverse Asset Cache Test\n");
+    
+    AssetCache* cache = asset_cache_create(1 << 20, ASSET_EVICT_LRU, test_free_asset, NULL);
+    if (!cache) {
+        fprintf(stderr, "Failed to create asset cache\n");
+        return 1;
+    }
+    
+    const char content[] = "mesh bytes";
+    AssetKey key = asset_hash(content, sizeof(content), 0);
+    char* asset = malloc(sizeof(content));
+    memcpy(asset, content, sizeof(content));
+    
+    AssetHandle first = asset_cache_insert(cache, key, asset, sizeof(content));
+    
+    // Re-inserting the resident pointer must not free it
+    AssetHandle again = asset_cache_insert(cache, key, asset, sizeof(content));
+    if (again != first || test_frees != 0 || asset_cache_get(cache, again) != asset ||
+        memcmp(asset_cache_get(cache, again), content, sizeof(content)) != 0) {
+        fprintf(stderr, "Re-inserting a resident asset freed it\n");
+        asset_cache_destroy(cache);
+        return 1;
+    }
+    
+    // A separate copy of the same content is freed in favour of the resident one
+    char* copy = malloc(sizeof(content));
+    memcpy(copy, content, sizeof(content));
+    AssetHandle shared = asset_cache_insert(cache, key, copy, sizeof(content));
+    if (shared != first || test_frees != 1 || asset_cache_get(cache, shared) != asset) {
+        fprintf(stderr, "Duplicate content was not deduplicated\n");
+        asset_cache_destroy(cache);
+        return 1;
+    }
+    
+    asset_cache_release(cache, first);
+    asset_cache_release(cache, again);
+    asset_cache_release(cache, shared);
+    uint32_t evicted = asset_cache_trim(cache);
+    asset_cache_destroy(cache);
+    
+    if (evicted != 1 || test_frees != 2) {
+        fprintf(stderr, "Released asset was not evicted exactly once\n");
+        return 1;
+    }
+    
+    if (!test_clock_eviction()) {
+        fprintf(stderr, "CLOCK eviction did not follow the budget and second-chance order\n");
+        return 1;
+    }
+    printf("Asset cache tests completed\n");
+    return 0;
+}
@@ -14,6 +14,9 @@
 #include <OpenAL/al.h>
 #include <OpenAL/alc.h>
 
+#include "metaverse_math.h"
+#include "metaverse_profiler.h"
+
 // Audio Engine Structures
 typedef struct {
     ALCdevice* device;
@@ -482,7 +485,11 @@ void* audio_update_thread(void* arg) {
     struct timespec last_update, current_update;
     clock_gettime(CLOCK_MONOTONIC, &last_update);
     
+    profiler_set_thread_name("Audio");
+    
     while (mixer->audio_active) {
+        ProfileZone zone = profiler_begin("Audio update");
+        
         clock_gettime(CLOCK_MONOTONIC, &current_update);
         
         double elapsed = (current_update.tv_sec - last_update.tv_sec) + 
@@ -518,6 +525,8 @@ void* audio_update_thread(void* arg) {
         update_time = 0.9 * update_time + 0.1 * elapsed;
         mixer->cpu_usage = update_time / (1.0 / 60.0) * 100.0;  // Percentage of frame
         
+        profiler_end(&zone);
+        
         // Sleep to maintain update rate
         double target_time = 1.0 / 60.0;  // 60Hz audio update
         if (elapsed < target_time) {
@@ -533,10 +542,8 @@ void audio_update_source_spatial(AudioMixer* mixer, SpatialAudioSource* source)
     if (!source->spatialized) return;
     
     // Calculate distance to listener
-    float dx = source->position[0] - mixer->listener_position[0];
-    float dy = source->position[1] - mixer->listener_position[1];
-    float dz = source->position[2] - mixer->listener_position[2];
-    float distance = sqrtf(dx*dx + dy*dy + dz*dz);
+    Vec3 offset = vec3_sub(vec3_load(source->position), vec3_load(mixer->listener_position));
+    float distance = vec3_length(offset);
     
     // Calculate attenuation
     float attenuation = audio_calculate_attenuation(distance,
@@ -552,9 +559,8 @@ void audio_update_source_spatial(AudioMixer* mixer, SpatialAudioSource* source)
     
     // Calculate direction vector for HRTF
     if (source->hrtf_enabled && mixer->hrtf.enabled) {
-        float direction[3] = {dx, dy, dz};
-        normalize_vector(direction);
-        audio_apply_hrtf(source, &mixer->hrtf, direction);
+        Vec3 direction = vec3_normalize(offset);
+        audio_apply_hrtf(source, &mixer->hrtf, &direction.x);
     }
     
     // Check occlusion
@@ -589,26 +595,13 @@ float audio_calculate_attenuation(float distance, float ref_distance,
 // Calculate Doppler effect
 void audio_calculate_doppler(SpatialAudioSource* source, float* listener_velocity) {
     // Calculate relative velocity
-    float rel_velocity[3] = {
-        source->velocity[0] - listener_velocity[0],
-        source->velocity[1] - listener_velocity[1],
-        source->velocity[2] - listener_velocity[2]
-    };
+    Vec3 rel_velocity = vec3_sub(vec3_load(source->velocity), vec3_load(listener_velocity));
     
     // Calculate direction vector
-    float direction[3] = {
-        source->position[0] - listener_velocity[0],
-        source->position[1] - listener_velocity[1],
-        source->position[2] - listener_velocity[2]
-    };
-    
-    normalize_vector(direction);
+    Vec3 direction = vec3_normalize(vec3_sub(vec3_load(source->position), vec3_load(listener_velocity)));
     
     // Project relative velocity onto direction
-    float projected_velocity = 
-        rel_velocity[0] * direction[0] +
-        rel_velocity[1] * direction[1] +
-        rel_velocity[2] * direction[2];
+    float projected_velocity = vec3_dot(rel_velocity, direction);
     
     // Calculate Doppler factor (simplified)
     float speed_of_sound = 343.0f;  // m/s
@@ -730,15 +723,6 @@ void audio_mixer_destroy(AudioMixer* mixer) {
 }
 
 // Utility functions
-void normalize_vector(float* v) {
-    float length = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
-    if (length > 0.0001f) {
-        v[0] /= length;
-        v[1] /= length;
-        v[2] /= length;
-    }
-}
-
 bool aabb_contains_point(float* bounds, float* point) {
     return (point[0] >= bounds[0] && point[0] <= bounds[1] &&
             point[1] >= bounds[2] && point[1] <= bounds[3] &&
@@ -816,7 +800,7 @@ int main_audio_test() {
         float dz = 0.0f - listener_pos[2];
         listener_ori[0] = dx;
         listener_ori[2] = dz;
-        normalize_vector(listener_ori);
+        vec3_store(listener_ori, vec3_normalize(vec3_load(listener_ori)));
         
         audio_update_listener(mixer, listener_pos, listener_ori);
         
@@ -0,0 +1,555 @@
+/*******************************************************************************
+ * METAVERSE BENCHMARK
+ * Headless world simulation over synthetic worlds, per-phase percentiles as JSON
+ ******************************************************************************/
+
+// The core is compiled into this translation unit, so its phases can be
+// driven and timed one at a time. Every module is built with
+// METAVERSE_HEADLESS: GL is stubbed (metaverse_gl_stub.h) and the core's
+// main() is dropped, so no GL context, display or Godot host is needed.
+// One command:
+//
+//   cc -std=gnu11 -O2 -pthread -DMETAVERSE_HEADLESS -o metaverse_bench
+//      metaverse_bench.c metaverse_jobs.c metaverse_profiler.c
+//      metaverse_frame_arena.c metaverse_entity_index.c metaverse_asset_cache.c
+//      metaverse_mesh.c metaverse_texture.c metaverse_broadphase_sap.c
+//      metaverse_ecs.c metaverse_input.c -lm
+//
+//   metaverse_bench [--entities N[,N...]] [--frames N] [--warmup N]
+//                   [--velocity F] [--gravity F] [--threads N]
+//                   [--storage aos|soa|archetype] [--broadphase grid|sap]
+//                   [--seed N] [--output FILE]
+//
+// Each world size runs warmup + frames fixed-step frames without sleeping.
+// JSON goes to stdout (or --output); engine log lines are sent to stderr so
+// the JSON stays parseable. Exit status is non-zero if a world cannot be
+// built, so CI can gate on it.
+
+#include <getopt.h>
+#include <errno.h>
+
+#ifndef METAVERSE_HEADLESS
+#define METAVERSE_HEADLESS 1
+#endif
+#include "godot_metaverse_core.c"
+
+#define BENCH_MAX_WORLDS   16
+#define BENCH_MAX_THREADS  64     // JOB_MAX_WORKERS (metaverse_jobs.c)
+#define BENCH_DELTA        (1.0 / 60.0)
+#define BENCH_DENSITY      0.001f // Entities per cubic metre (about one per grid cell)
+#define BENCH_ENTITY_TYPES 8
+#define BENCH_FOV_DEGREES  90.0f
+#define BENCH_FAR_PLANE    1000.0f
+
+// Timed phases, in frame order
+typedef enum {
+    BENCH_PHASE_UPDATE = 0,  // Integration and spatial audio
+    BENCH_PHASE_PHYSICS,     // Broadphase and narrowphase dispatch
+    BENCH_PHASE_SNAPSHOT,    // World snapshot publish
+    BENCH_PHASE_CULL,        // Frustum culling into the visible list
+    BENCH_PHASE_BATCH,       // Sort keys, batches and instance ring fill
+    BENCH_PHASE_FRAME,       // All of the above
+    BENCH_PHASE_COUNT
+} BenchPhase;
+
+static const char* BENCH_PHASE_NAMES[BENCH_PHASE_COUNT] = {
+    "update", "physics", "snapshot", "cull", "batch_build", "frame"
+};
+
+typedef struct {
+    uint32_t entity_counts[BENCH_MAX_WORLDS];
+    uint32_t world_count;
+    uint32_t frames;
+    uint32_t warmup;
+    float velocity_fraction;  // Share of entities with ENTITY_FLAG_VELOCITY
+    float gravity_fraction;   // Share of entities with ENTITY_FLAG_GRAVITY
+    uint32_t threads;         // 0 = one per core
+    EntityStorageMode storage;
+    BroadphaseBackend broadphase;
+    uint64_t seed;
+    const char* output;
+} BenchConfig;
+
+typedef struct {
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+} BenchPercentiles;
+
+typedef struct {
+    uint32_t entities;
+    uint32_t visible;
+    uint32_t batches;
+    double pairs;            // Mean broadphase pairs per measured frame
+    double contacts;         // Mean sphere contacts per measured frame
+    double populate_ms;
+    BenchPercentiles phases[BENCH_PHASE_COUNT];
+} BenchResult;
+
+static const char* BENCH_STORAGE_NAMES[] = { "aos", "soa", "archetype" };
+static const char* BENCH_BROADPHASE_NAMES[] = { "grid", "sap" };
+
+// Function prototypes
+static bool bench_parse_args(int argc, char** argv, BenchConfig* config);
+static bool bench_run_world(const BenchConfig* config, uint32_t entity_count, BenchResult* result);
+static void bench_write_json(FILE* file, const BenchConfig* config,
+                             const BenchResult* results, uint32_t count);
+
+// Host hooks
+// The benchmark has no engine behind it. Narrowphase does a real sphere
+// overlap test so pair dispatch is not optimised away; the rest are no-ops.
+static uint64_t bench_contacts;
+static Vector4 bench_camera;
+
+void setup_shader_for_type(uint8_t entity_type) {
+    (void)entity_type;
+}
+
+int get_vertex_count_for_type(uint8_t entity_type) {
+    (void)entity_type;
+    return 36;
+}
+
+void apply_post_processing(void) {
+}
+
+void update_audio_source(uint32_t source_id, float left_gain, float right_gain, float pitch) {
+    (void)source_id; (void)left_gain; (void)right_gain; (void)pitch;
+}
+
+void check_collision(MetaverseEntity* a, MetaverseEntity* b, double delta_time) {
+    (void)delta_time;
+    float dx = a->position.x - b->position.x;
+    float dy = a->position.y - b->position.y;
+    float dz = a->position.z - b->position.z;
+    float r = cull_radius_scalar(a->scale.x, a->scale.y, a->scale.z) +
+              cull_radius_scalar(b->scale.x, b->scale.y, b->scale.z);
+    if (dx*dx + dy*dy + dz*dz < r*r) bench_contacts++;
+}
+
+void metaverse_send_updates(const WorldSnapshot* world, int sockfd) {
+    (void)world; (void)sockfd;
+}
+
+void metaverse_process_input(MetaverseAmplifier* amp, const InputFrame* input) {
+    (void)amp; (void)input;
+}
+
+void metaverse_network_update(MetaverseAmplifier* amp) {
+    (void)amp;
+}
+
+// Camera at bench_camera looking down -Z; inward plane normals
+void calculate_frustum(float frustum[6][4]) {
+    float half = BENCH_FOV_DEGREES * 0.5f * (float)M_PI / 180.0f;
+    float c = cosf(half);
+    float s = sinf(half);
+    
+    const float normals[6][4] = {
+        {  c,    0.0f, -s,    0.0f },            // Left
+        { -c,    0.0f, -s,    0.0f },            // Right
+        {  0.0f,  c,   -s,    0.0f },            // Bottom
+        {  0.0f, -c,   -s,    0.0f },            // Top
+        {  0.0f, 0.0f, -1.0f, -0.1f },           // Near
+        {  0.0f, 0.0f,  1.0f, BENCH_FAR_PLANE }  // Far
+    };
+    for (int p = 0; p < 6; p++) {
+        frustum[p][0] = normals[p][0];
+        frustum[p][1] = normals[p][1];
+        frustum[p][2] = normals[p][2];
+        frustum[p][3] = normals[p][3] - (normals[p][0] * bench_camera.x +
+                                         normals[p][1] * bench_camera.y +
+                                         normals[p][2] * bench_camera.z);
+    }
+}
+
+// GodotAPI stubs: routine messages are dropped, errors go to stderr
+static void bench_print(const char* message) {
+    (void)message;
+}
+
+static void bench_error(const char* message) {
+    fprintf(stderr, "[BENCH] %s\n", message);
+}
+
+static double bench_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64*, so worlds are reproducible from the seed
+static inline float bench_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return (float)((x * 0x2545F4914F6CDD1Dull) >> 40) / (float)(1u << 24);
+}
+
+// Uniform cube standing on the ground plane at BENCH_DENSITY, so pair
+// counts per entity stay comparable across world sizes. The camera sits in
+// the middle of the +Z face looking into the cube.
+static bool bench_populate(MetaverseAmplifier* amp, const BenchConfig* config, uint32_t count) {
+    uint64_t rng = config->seed ? config->seed : 1;
+    float extent = cbrtf((float)count / BENCH_DENSITY);
+    
+    bench_camera = (Vector4){ 0.0f, extent * 0.5f, extent * 0.5f, 1.0f };
+    amp->camera_position = bench_camera;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        MetaverseEntity entity;
+        memset(&entity, 0, sizeof(entity));
+        
+        entity.position = (Vector4){ (bench_random(&rng) - 0.5f) * extent,
+                                     bench_random(&rng) * extent,
+                                     (bench_random(&rng) - 0.5f) * extent, 1.0f };
+        entity.rotation = (Vector4){ 0.0f, 0.0f, 0.0f, 1.0f };
+        
+        float scale = 0.5f + bench_random(&rng);
+        entity.scale = (Vector4){ scale, scale, scale, 1.0f };
+        entity.entity_id = (uint64_t)i + 1;
+        entity.entity_type = (uint8_t)(i % BENCH_ENTITY_TYPES);
+        
+        if (bench_random(&rng) < config->velocity_fraction) entity.flags |= ENTITY_FLAG_VELOCITY;
+        if (bench_random(&rng) < config->gravity_fraction) entity.flags |= ENTITY_FLAG_GRAVITY;
+        
+        if (metaverse_entity_add(amp, &entity) == ENTITY_HANDLE_INVALID) return false;
+    }
+    return true;
+}
+
+static int bench_compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentiles; sorts samples in place
+static BenchPercentiles bench_percentiles(double* samples, uint32_t count) {
+    BenchPercentiles p;
+    memset(&p, 0, sizeof(p));
+    if (count == 0) return p;
+    
+    qsort(samples, count, sizeof(double), bench_compare_double);
+    
+    double sum = 0.0;
+    for (uint32_t i = 0; i < count; i++) sum += samples[i];
+    
+    p.mean = sum / count;
+    p.p50 = samples[(uint32_t)ceil(0.50 * count) - 1];
+    p.p90 = samples[(uint32_t)ceil(0.90 * count) - 1];
+    p.p99 = samples[(uint32_t)ceil(0.99 * count) - 1];
+    p.max = samples[count - 1];
+    return p;
+}
+
+// Build one world and time its frames phase by phase. The phases run in the
+// same order as metaverse_run_frame, but serially so each can be attributed;
+// each phase still uses the job system internally.
+static bool bench_run_world(const BenchConfig* config, uint32_t entity_count, BenchResult* result) {
+    memset(result, 0, sizeof(BenchResult));
+    result->entities = entity_count;
+    
+    GodotAPI api = {
+        .godot_alloc = malloc,
+        .godot_free = free,
+        .godot_print = bench_print,
+        .godot_error = bench_error,
+        .godot_get_time = bench_get_time
+    };
+    
+    MetaverseAmplifier* amp = metaverse_amplifier_create(&api);
+    if (!amp) return false;
+    
+    bool ok = metaverse_set_thread_count(amp, config->threads) &&
+              metaverse_set_broadphase(amp, config->broadphase);
+    
+    uint64_t start = bench_now_ns();
+    ok = ok && bench_populate(amp, config, entity_count) &&
+         metaverse_set_storage_mode(amp, config->storage);
+    result->populate_ms = (bench_now_ns() - start) / 1e6;
+    
+    double* samples = malloc(sizeof(double) * BENCH_PHASE_COUNT * (config->frames ? config->frames : 1));
+    if (!ok || !samples) {
+        free(samples);
+        metaverse_amplifier_destroy(amp);
+        return false;
+    }
+    
+    float frustum[6][4];
+    calculate_frustum(frustum);
+    
+    RenderQueue* queue = &amp->render_queue;
+    uint64_t pair_total = 0;
+    uint64_t contact_total = 0;
+    
+    for (uint32_t frame = 0; frame < config->warmup + config->frames; frame++) {
+        uint64_t t[BENCH_PHASE_COUNT + 1];
+        
+        t[0] = bench_now_ns();
+        metaverse_update_world(amp, BENCH_DELTA);
+        t[1] = bench_now_ns();
+        bench_contacts = 0;
+        metaverse_physics_optimized(amp, BENCH_DELTA);
+        t[2] = bench_now_ns();
+        world_publish_snapshot(amp);
+        t[3] = bench_now_ns();
+        
+        const WorldSnapshot* world = metaverse_snapshot_acquire(amp);
+        result->visible = metaverse_cull_entities(world, queue, (const float (*)[4])frustum);
+        t[4] = bench_now_ns();
+        result->batches = metaverse_build_render_batches(amp, world, queue);
+        instance_ring_end(&queue->ring);
+        metaverse_snapshot_release(world);
+        frame_arena_reset(amp->frame_arena);
+        t[5] = bench_now_ns();
+        
+        if (frame < config->warmup) continue;
+        
+        pair_total += amp->broadphase_stats[amp->broadphase_backend].pairs;
+        contact_total += bench_contacts;
+        
+        uint32_t sample = frame - config->warmup;
+        for (int p = 0; p < BENCH_PHASE_FRAME; p++) {
+            samples[p * config->frames + sample] = (t[p + 1] - t[p]) / 1e3;
+        }
+        samples[BENCH_PHASE_FRAME * config->frames + sample] = (t[5] - t[0]) / 1e3;
+    }
+    
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+        result->phases[p] = bench_percentiles(&samples[p * config->frames], config->frames);
+    }
+    
+    if (config->frames) {
+        result->pairs = (double)pair_total / config->frames;
+        result->contacts = (double)contact_total / config->frames;
+    }
+    
+    free(samples);
+    metaverse_amplifier_destroy(amp);
+    return true;
+}
+
+static void bench_write_json(FILE* file, const BenchConfig* config,
+                             const BenchResult* results, uint32_t count) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"metaverse_world\",\n");
+    fprintf(file, "  \"config\": {\"frames\": %u, \"warmup\": %u, \"velocity_fraction\": %.3f, "
+                  "\"gravity_fraction\": %.3f, \"threads\": %u, \"storage\": \"%s\", "
+                  "\"broadphase\": \"%s\", \"seed\": %llu, \"delta\": %.6f},\n",
+            config->frames, config->warmup, config->velocity_fraction, config->gravity_fraction,
+            config->threads, BENCH_STORAGE_NAMES[config->storage],
+            BENCH_BROADPHASE_NAMES[config->broadphase], (unsigned long long)config->seed,
+            BENCH_DELTA);
+    fprintf(file, "  \"worlds\": [");
+    
+    for (uint32_t w = 0; w < count; w++) {
+        const BenchResult* r = &results[w];
+        fprintf(file, "%s\n    {\"entities\": %u, \"populate_ms\": %.3f, \"visible\": %u, "
+                      "\"batches\": %u, \"pairs_per_frame\": %.1f, \"contacts_per_frame\": %.1f,\n",
+                w ? "," : "", r->entities, r->populate_ms, r->visible, r->batches, r->pairs,
+                r->contacts);
+        fprintf(file, "     \"phases_us\": {");
+        
+        for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+            const BenchPercentiles* q = &r->phases[p];
+            fprintf(file, "%s\n       \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                          "\"p99\": %.3f, \"max\": %.3f}",
+                    p ? "," : "", BENCH_PHASE_NAMES[p], q->mean, q->p50, q->p90, q->p99, q->max);
+        }
+        fprintf(file, "\n     }}");
+    }
+    
+    fprintf(file, "\n  ]\n}\n");
+}
+
+static bool bench_parse_uint(const char* text, uint64_t max, uint64_t* out) {
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno || end == text || *end || value > max) return false;
+    *out = value;
+    return true;
+}
+
+static bool bench_parse_fraction(const char* text, float* out) {
+    char* end;
+    float value = strtof(text, &end);
+    if (end == text || *end || value < 0.0f || value > 1.0f) return false;
+    *out = value;
+    return true;
+}
+
+static bool bench_parse_name(const char* text, const char** names, int count, int* out) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(text, names[i]) == 0) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Comma-separated world sizes, e.g. 1000,10000,100000
+static bool bench_parse_entities(const char* text, BenchConfig* config) {
+    char buffer[256];
+    if (strlen(text) >= sizeof(buffer)) return false;
+    strcpy(buffer, text);
+    
+    config->world_count = 0;
+    for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+        uint64_t count;
+        if (config->world_count == BENCH_MAX_WORLDS) return false;
+        if (!bench_parse_uint(token, ENTITY_INDEX_NONE - 1, &count) || count == 0) return false;
+        config->entity_counts[config->world_count++] = (uint32_t)count;
+    }
+    return config->world_count > 0;
+}
+
+static void bench_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--entities N[,N...]] [--frames N] [--warmup N]\n"
+            "          [--velocity F] [--gravity F] [--threads N]\n"
+            "          [--storage aos|soa|archetype] [--broadphase grid|sap]\n"
+            "          [--seed N] [--output FILE]\n", program);
+}
+
+static bool bench_parse_args(int argc, char** argv, BenchConfig* config) {
+    static const struct option options[] = {
+        { "entities",   required_argument, NULL, 'e' },
+        { "frames",     required_argument, NULL, 'f' },
+        { "warmup",     required_argument, NULL, 'w' },
+        { "velocity",   required_argument, NULL, 'v' },
+        { "gravity",    required_argument, NULL, 'g' },
+        { "threads",    required_argument, NULL, 't' },
+        { "storage",    required_argument, NULL, 's' },
+        { "broadphase", required_argument, NULL, 'b' },
+        { "seed",       required_argument, NULL, 'r' },
+        { "output",     required_argument, NULL, 'o' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    
+    // Defaults: 1k to 1M in decades
+    static const uint32_t default_counts[] = { 1000, 10000, 100000, 1000000 };
+    memset(config, 0, sizeof(BenchConfig));
+    memcpy(config->entity_counts, default_counts, sizeof(default_counts));
+    config->world_count = 4;
+    config->frames = 120;
+    config->warmup = 10;
+    config->velocity_fraction = 0.5f;
+    config->gravity_fraction = 0.25f;
+    config->storage = ENTITY_STORAGE_AOS;
+    config->broadphase = BROADPHASE_GRID;
+    config->seed = 1;
+    
+    int option;
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        uint64_t value = 0;
+        int index = 0;
+        bool ok = true;
+        
+        switch (option) {
+            case 'e':
+                ok = bench_parse_entities(optarg, config);
+                break;
+            case 'f':
+                ok = bench_parse_uint(optarg, 1000000, &value) && value > 0;
+                config->frames = (uint32_t)value;
+                break;
+            case 'w':
+                ok = bench_parse_uint(optarg, 1000000, &value);
+                config->warmup = (uint32_t)value;
+                break;
+            case 'v':
+                ok = bench_parse_fraction(optarg, &config->velocity_fraction);
+                break;
+            case 'g':
+                ok = bench_parse_fraction(optarg, &config->gravity_fraction);
+                break;
+            case 't':
+                ok = bench_parse_uint(optarg, BENCH_MAX_THREADS, &value);
+                config->threads = (uint32_t)value;
+                break;
+            case 's':
+                ok = bench_parse_name(optarg, BENCH_STORAGE_NAMES, 3, &index);
+                config->storage = (EntityStorageMode)index;
+                break;
+            case 'b':
+                ok = bench_parse_name(optarg, BENCH_BROADPHASE_NAMES, BROADPHASE_BACKEND_COUNT, &index);
+                config->broadphase = (BroadphaseBackend)index;
+                break;
+            case 'r':
+                ok = bench_parse_uint(optarg, UINT64_MAX, &config->seed);
+                break;
+            case 'o':
+                config->output = optarg;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        
+        if (!ok) {
+            if (optarg) fprintf(stderr, "Invalid value '%s'\n", optarg);
+            bench_usage(argv[0]);
+            return false;
+        }
+    }
+    
+    if (optind < argc) {
+        bench_usage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!bench_parse_args(argc, argv, &config)) return 2;
+    
+    // Keep stdout for JSON only: the modules log with printf, so point the
+    // process's stdout at stderr and write results through a saved copy
+    FILE* json = NULL;
+    if (config.output) {
+        json = fopen(config.output, "w");
+    } else {
+        int fd = dup(STDOUT_FILENO);
+        if (fd >= 0) json = fdopen(fd, "w");
+    }
+    if (!json) {
+        fprintf(stderr, "Cannot open output: %s\n", strerror(errno));
+        return 2;
+    }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    
+    BenchResult results[BENCH_MAX_WORLDS];
+    uint32_t completed = 0;
+    int status = 0;
+    
+    for (uint32_t w = 0; w < config.world_count; w++) {
+        fprintf(stderr, "[BENCH] %u entities...\n", config.entity_counts[w]);
+        if (!bench_run_world(&config, config.entity_counts[w], &results[completed])) {
+            fprintf(stderr, "[BENCH] Failed to build a world of %u entities\n",
+                    config.entity_counts[w]);
+            status = 1;
+            continue;
+        }
+        completed++;
+    }
+    
+    bench_write_json(json, &config, results, completed);
+    if (fclose(json) != 0) status = 1;
+    return status;
+}
@@ -0,0 +1,485 @@
+/*******************************************************************************
+ * METAVERSE SWEEP-AND-PRUNE BROADPHASE
+ * Persistent endpoint list on the axis of greatest variance, pair sweep
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Each body contributes a min and a max endpoint on one axis. The endpoint
+// list is kept between frames and re-sorted with insertion sort, which is
+// close to linear while bodies move a little per frame. A sweep over the
+// sorted list then tests the two remaining axes against the bodies whose
+// interval is open, so every overlapping pair comes out exactly once.
+//
+// The sweep axis follows the spread of the bodies: when another axis has
+// clearly more variance (crowds strung along a road, a flat plaza), the list
+// is rebuilt on that axis.
+//
+// Bodies are identified by dense index, as in the entity store; mirror its
+// swap-removes with sap_swap_remove().
+#define SAP_DEAD             UINT32_MAX  // Endpoint of a removed body
+#define SAP_AXIS_HYSTERESIS  1.5f        // Variance ratio needed to change axis
+#define SAP_REBUILD_FRACTION 4           // Rebuild when more than 1/4 of the bodies are new
+
+typedef struct {
+    float min[3];
+    float max[3];
+} SapBox;
+
+typedef struct {
+    uint32_t a;                 // a < b, dense indices
+    uint32_t b;
+} BroadphasePair;
+
+typedef struct {
+    uint32_t axis;
+    uint32_t bodies;
+    uint32_t pairs;
+    uint32_t rebuilds;          // Total full re-sorts (axis change, bulk insert)
+    uint64_t swaps;             // Insertion sort moves in the last update
+} SapStats;
+
+typedef struct {
+    float value;
+    uint32_t id;                // body << 1 | is_max, or SAP_DEAD
+} SapEndpoint;
+
+typedef struct SweepAndPrune {
+    SapBox* boxes;              // Filled by the caller between begin/end
+    uint32_t* body_endpoint;    // Per body: list position of min, then max
+    uint32_t body_capacity;
+    uint32_t tracked_count;     // Bodies present in the endpoint list
+    uint32_t pending_count;     // Bodies in the current update
+    
+    SapEndpoint* endpoints;
+    uint32_t endpoint_count;
+    uint32_t endpoint_capacity;
+    uint32_t dead_count;
+    uint32_t axis;
+    
+    // Sweep scratch: bodies with an open interval
+    uint32_t* active;
+    uint32_t* active_slot;
+    
+    BroadphasePair* pairs;
+    uint32_t pair_count;
+    uint32_t pair_capacity;
+    
+    SapStats stats;
+} SweepAndPrune;
+
+// Function prototypes
+SweepAndPrune* sap_create(void);
+void sap_destroy(SweepAndPrune* sap);
+SapBox* sap_update_begin(SweepAndPrune* sap, uint32_t count);
+uint32_t sap_update_end(SweepAndPrune* sap, const BroadphasePair** pairs);
+void sap_swap_remove(SweepAndPrune* sap, uint32_t index, uint32_t last);
+void sap_reset(SweepAndPrune* sap);
+void sap_get_stats(SweepAndPrune* sap, SapStats* stats);
+
+SweepAndPrune* sap_create(void) {
+    return calloc(1, sizeof(SweepAndPrune));
+}
+
+void sap_destroy(SweepAndPrune* sap) {
+    if (!sap) return;
+    
+    free(sap->boxes);
+    free(sap->body_endpoint);
+    free(sap->endpoints);
+    free(sap->active);
+    free(sap->active_slot);
+    free(sap->pairs);
+    free(sap);
+}
+
+// Forget every body; the next update rebuilds the list from scratch
+void sap_reset(SweepAndPrune* sap) {
+    sap->tracked_count = 0;
+    sap->endpoint_count = 0;
+    sap->dead_count = 0;
+    sap->pair_count = 0;
+}
+
+static bool sap_reserve(SweepAndPrune* sap, uint32_t count) {
+    if (count <= sap->body_capacity) return true;
+    
+    uint32_t capacity = sap->body_capacity ? sap->body_capacity : 1024;
+    while (capacity < count) capacity *= 2;
+    
+    SapBox* boxes = realloc(sap->boxes, sizeof(SapBox) * capacity);
+    if (!boxes) return false;
+    sap->boxes = boxes;
+    
+    uint32_t* body_endpoint = realloc(sap->body_endpoint, sizeof(uint32_t) * 2 * capacity);
+    if (!body_endpoint) return false;
+    sap->body_endpoint = body_endpoint;
+    
+    SapEndpoint* endpoints = realloc(sap->endpoints, sizeof(SapEndpoint) * 2 * capacity);
+    if (!endpoints) return false;
+    sap->endpoints = endpoints;
+    sap->endpoint_capacity = 2 * capacity;
+    
+    uint32_t* active = realloc(sap->active, sizeof(uint32_t) * capacity);
+    if (!active) return false;
+    sap->active = active;
+    
+    uint32_t* active_slot = realloc(sap->active_slot, sizeof(uint32_t) * capacity);
+    if (!active_slot) return false;
+    sap->active_slot = active_slot;
+    
+    sap->body_capacity = capacity;
+    return true;
+}
+
+// Returns storage for count boxes in dense order, valid until sap_update_end
+SapBox* sap_update_begin(SweepAndPrune* sap, uint32_t count) {
+    if (!sap_reserve(sap, count)) return NULL;
+    
+    sap->pending_count = count;
+    return sap->boxes;
+}
+
+// Min endpoints sort before max endpoints at the same value, so touching
+// boxes count as overlapping
+static inline bool endpoint_less(SapEndpoint a, SapEndpoint b) {
+    return a.value < b.value || (a.value == b.value && !(a.id & 1) && (b.id & 1));
+}
+
+static int endpoint_compare(const void* pa, const void* pb) {
+    SapEndpoint a = *(const SapEndpoint*)pa;
+    SapEndpoint b = *(const SapEndpoint*)pb;
+    if (endpoint_less(a, b)) return -1;
+    if (endpoint_less(b, a)) return 1;
+    return 0;
+}
+
+static inline float endpoint_value(const SapBox* box, uint32_t axis, uint32_t id) {
+    return (id & 1) ? box->max[axis] : box->min[axis];
+}
+
+static void sap_rebuild(SweepAndPrune* sap, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        sap->endpoints[2 * i] = (SapEndpoint){ sap->boxes[i].min[sap->axis], 2 * i };
+        sap->endpoints[2 * i + 1] = (SapEndpoint){ sap->boxes[i].max[sap->axis], 2 * i + 1 };
+    }
+    sap->endpoint_count = 2 * count;
+    sap->dead_count = 0;
+    
+    qsort(sap->endpoints, sap->endpoint_count, sizeof(SapEndpoint), endpoint_compare);
+    for (uint32_t p = 0; p < sap->endpoint_count; p++) {
+        sap->body_endpoint[sap->endpoints[p].id] = p;
+    }
+    
+    sap->tracked_count = count;
+    sap->stats.rebuilds++;
+}
+
+// Drop endpoints of removed bodies, keeping the rest in order
+static void sap_compact(SweepAndPrune* sap) {
+    uint32_t written = 0;
+    for (uint32_t p = 0; p < sap->endpoint_count; p++) {
+        SapEndpoint endpoint = sap->endpoints[p];
+        if (endpoint.id == SAP_DEAD) continue;
+        sap->endpoints[written] = endpoint;
+        sap->body_endpoint[endpoint.id] = written;
+        written++;
+    }
+    sap->endpoint_count = written;
+    sap->dead_count = 0;
+}
+
+// Axis with the largest variance of box centres
+static uint32_t sap_choose_axis(const SweepAndPrune* sap, uint32_t count) {
+    double sum[3] = {0}, sum_sq[3] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        for (int a = 0; a < 3; a++) {
+            double c = 0.5 * ((double)sap->boxes[i].min[a] + sap->boxes[i].max[a]);
+            sum[a] += c;
+            sum_sq[a] += c * c;
+        }
+    }
+    
+    double variance[3];
+    for (int a = 0; a < 3; a++) {
+        double mean = sum[a] / count;
+        variance[a] = sum_sq[a] / count - mean * mean;
+    }
+    
+    uint32_t best = sap->axis;
+    for (uint32_t a = 0; a < 3; a++) {
+        if (variance[a] > variance[best]) best = a;
+    }
+    if (best != sap->axis && variance[best] > SAP_AXIS_HYSTERESIS * variance[sap->axis]) {
+        return best;
+    }
+    return sap->axis;
+}
+
+static bool sap_push_pair(SweepAndPrune* sap, uint32_t a, uint32_t b) {
+    if (sap->pair_count == sap->pair_capacity) {
+        uint32_t capacity = sap->pair_capacity ? sap->pair_capacity * 2 : 4096;
+        BroadphasePair* pairs = realloc(sap->pairs, sizeof(BroadphasePair) * capacity);
+        if (!pairs) return false;
+        sap->pairs = pairs;
+        sap->pair_capacity = capacity;
+    }
+    
+    sap->pairs[sap->pair_count++] = a < b ? (BroadphasePair){ a, b } : (BroadphasePair){ b, a };
+    return true;
+}
+
+// Open intervals are tested on the other two axes as each min endpoint
+// enters; the sweep axis overlap is implied by the interval being open
+static void sap_sweep(SweepAndPrune* sap) {
+    uint32_t axis_u = (sap->axis + 1) % 3;
+    uint32_t axis_v = (sap->axis + 2) % 3;
+    uint32_t active_count = 0;
+    sap->pair_count = 0;
+    
+    for (uint32_t p = 0; p < sap->endpoint_count; p++) {
+        uint32_t id = sap->endpoints[p].id;
+        uint32_t body = id >> 1;
+        
+        if (id & 1) {
+            // Interval closes: swap-remove from the active set
+            uint32_t slot = sap->active_slot[body];
+            uint32_t moved = sap->active[--active_count];
+            sap->active[slot] = moved;
+            sap->active_slot[moved] = slot;
+            continue;
+        }
+        
+        const SapBox* box = &sap->boxes[body];
+        for (uint32_t k = 0; k < active_count; k++) {
+            const SapBox* other = &sap->boxes[sap->active[k]];
+            if (box->min[axis_u] > other->max[axis_u] || other->min[axis_u] > box->max[axis_u] ||
+                box->min[axis_v] > other->max[axis_v] || other->min[axis_v] > box->max[axis_v]) {
+                continue;
+            }
+            if (!sap_push_pair(sap, body, sap->active[k])) return;
+        }
+        
+        sap->active_slot[body] = active_count;
+        sap->active[active_count++] = body;
+    }
+}
+
+// Bring the endpoint list up to date with the boxes written since
+// sap_update_begin and return the overlapping pairs (each once, a < b).
+// The pair array stays valid until the next update.
+uint32_t sap_update_end(SweepAndPrune* sap, const BroadphasePair** pairs) {
+    uint32_t count = sap->pending_count;
+    sap->stats.swaps = 0;
+    
+    // Bodies dropped off the tail since the last update
+    for (uint32_t i = count; i < sap->tracked_count; i++) {
+        sap->endpoints[sap->body_endpoint[2 * i]].id = SAP_DEAD;
+        sap->endpoints[sap->body_endpoint[2 * i + 1]].id = SAP_DEAD;
+        sap->dead_count += 2;
+    }
+    if (count < sap->tracked_count) sap->tracked_count = count;
+    
+    uint32_t axis = count > 0 ? sap_choose_axis(sap, count) : sap->axis;
+    uint32_t added = count - sap->tracked_count;
+    
+    if (axis != sap->axis || sap->tracked_count == 0 ||
+        added > count / SAP_REBUILD_FRACTION) {
+        sap->axis = axis;
+        sap_rebuild(sap, count);
+    } else {
+        if (sap->dead_count > 0) sap_compact(sap);
+        
+        // New bodies go on the end and are carried into place by the sort
+        for (uint32_t i = sap->tracked_count; i < count; i++) {
+            sap->endpoints[sap->endpoint_count++] = (SapEndpoint){ 0.0f, 2 * i };
+            sap->endpoints[sap->endpoint_count++] = (SapEndpoint){ 0.0f, 2 * i + 1 };
+        }
+        sap->tracked_count = count;
+        
+        for (uint32_t p = 0; p < sap->endpoint_count; p++) {
+            SapEndpoint* endpoint = &sap->endpoints[p];
+            endpoint->value = endpoint_value(&sap->boxes[endpoint->id >> 1], axis, endpoint->id);
+        }
+        
+        // Insertion sort; coherent motion keeps each shift short
+        SapEndpoint* endpoints = sap->endpoints;
+        for (uint32_t p = 1; p < sap->endpoint_count; p++) {
+            SapEndpoint endpoint = endpoints[p];
+            uint32_t q = p;
+            while (q > 0 && endpoint_less(endpoint, endpoints[q - 1])) {
+                endpoints[q] = endpoints[q - 1];
+                sap->body_endpoint[endpoints[q].id] = q;
+                q--;
+            }
+            if (q != p) {
+                endpoints[q] = endpoint;
+                sap->stats.swaps += p - q;
+            }
+            sap->body_endpoint[endpoint.id] = q;
+        }
+    }
+    
+    sap_sweep(sap);
+    
+    sap->stats.axis = sap->axis;
+    sap->stats.bodies = count;
+    sap->stats.pairs = sap->pair_count;
+    
+    *pairs = sap->pairs;
+    return sap->pair_count;
+}
+
+// Keep the endpoint list coherent with a swap-remove of the entity store
+void sap_swap_remove(SweepAndPrune* sap, uint32_t index, uint32_t last) {
+    if (last >= sap->tracked_count) return;
+    
+    sap->endpoints[sap->body_endpoint[2 * index]].id = SAP_DEAD;
+    sap->endpoints[sap->body_endpoint[2 * index + 1]].id = SAP_DEAD;
+    sap->dead_count += 2;
+    
+    if (index != last) {
+        // The last body takes over the vacated index, keeping its endpoints
+        uint32_t min_pos = sap->body_endpoint[2 * last];
+        uint32_t max_pos = sap->body_endpoint[2 * last + 1];
+        sap->endpoints[min_pos].id = 2 * index;
+        sap->endpoints[max_pos].id = 2 * index + 1;
+        sap->body_endpoint[2 * index] = min_pos;
+        sap->body_endpoint[2 * index + 1] = max_pos;
+    }
+    
+    sap->tracked_count = last;
+}
+
+void sap_get_stats(SweepAndPrune* sap, SapStats* stats) {
+    *stats = sap->stats;
+}
+
+#define SAP_TEST_BODIES 600
+
+static uint32_t sap_test_seed = 24681u;
+
+static float sap_test_random(float lo, float hi) {
+    sap_test_seed = sap_test_seed * 1664525u + 1013904223u;
+    return lo + (hi - lo) * (float)(sap_test_seed >> 8) / (float)(1u << 24);
+}
+
+static bool sap_test_overlap(const SapBox* a, const SapBox* b) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (a->min[axis] > b->max[axis] || b->min[axis] > a->max[axis]) return false;
+    }
+    return true;
+}
+
+// Run one update over `bodies` and compare against an O(n^2) sweep: same
+// count, every pair overlapping and none reported twice
+static bool sap_test_update(SweepAndPrune* sap, const SapBox* bodies, uint32_t count,
+                            uint8_t* seen) {
+    SapBox* boxes = sap_update_begin(sap, count);
+    if (!boxes) return false;
+    memcpy(boxes, bodies, sizeof(SapBox) * count);
+    
+    const BroadphasePair* pairs;
+    uint32_t pair_count = sap_update_end(sap, &pairs);
+    
+    uint32_t expected = 0;
+    for (uint32_t a = 0; a < count; a++) {
+        for (uint32_t b = a + 1; b < count; b++) {
+            if (sap_test_overlap(&bodies[a], &bodies[b])) expected++;
+        }
+    }
+    
+    memset(seen, 0, (size_t)count * count);
+    bool ok = pair_count == expected;
+    for (uint32_t i = 0; ok && i < pair_count; i++) {
+        uint32_t a = pairs[i].a, b = pairs[i].b;
+        uint8_t* mark = &seen[(size_t)a * count + b];
+        if (a >= b || b >= count || *mark || !sap_test_overlap(&bodies[a], &bodies[b])) ok = false;
+        else *mark = 1;
+    }
+    
+    printf("%u bodies: %u pairs, %u expected\n", count, pair_count, expected);
+    return ok;
+}
+
+static void sap_test_place(SapBox* box) {
+    float size = sap_test_random(1.0f, 4.0f);
+    for (int axis = 0; axis < 3; axis++) {
+        box->min[axis] = sap_test_random(0.0f, axis == 1 ? 20.0f : 100.0f);
+        box->max[axis] = box->min[axis] + size;
+    }
+}
+
+int main_broadphase_sap_test() {
+    printf("Metaverse Sweep-and-Prune Test\n");
+    
+    SweepAndPrune* sap = sap_create();
+    SapBox* bodies = malloc(sizeof(SapBox) * SAP_TEST_BODIES);
+    uint8_t* seen = malloc((size_t)SAP_TEST_BODIES * SAP_TEST_BODIES);
+    if (!sap || !bodies || !seen) {
+        fprintf(stderr, "Failed to allocate SAP test state\n");
+        sap_destroy(sap);
+        free(bodies);
+        free(seen);
+        return 1;
+    }
+    
+    uint32_t count = SAP_TEST_BODIES - 50;
+    for (uint32_t i = 0; i < SAP_TEST_BODIES; i++) sap_test_place(&bodies[i]);
+    
+    // Full build, then incremental frames with small motion
+    bool ok = sap_test_update(sap, bodies, count, seen);
+    for (int frame = 0; ok && frame < 3; frame++) {
+        for (uint32_t i = 0; i < count; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                float step = sap_test_random(-1.0f, 1.0f);
+                bodies[i].min[axis] += step;
+                bodies[i].max[axis] += step;
+            }
+        }
+        ok = sap_test_update(sap, bodies, count, seen);
+    }
+    
+    // Swap-removes mirrored from the entity store, then a few bodies appended
+    for (uint32_t i = 0; ok && i < 20; i++) {
+        uint32_t index = (i * 37) % count;
+        uint32_t last = --count;
+        bodies[index] = bodies[last];
+        sap_swap_remove(sap, index, last);
+    }
+    if (ok) ok = sap_test_update(sap, bodies, count, seen);
+    
+    count += 50;
+    if (ok) ok = sap_test_update(sap, bodies, count, seen);
+    
+    // Spreading the bodies along Z moves the sweep to that axis
+    SapStats stats;
+    sap_get_stats(sap, &stats);
+    uint32_t axis_before = stats.axis;
+    for (uint32_t i = 0; i < count; i++) {
+        bodies[i].min[2] *= 20.0f;
+        bodies[i].max[2] = bodies[i].min[2] + (bodies[i].max[0] - bodies[i].min[0]);
+    }
+    if (ok) ok = sap_test_update(sap, bodies, count, seen);
+    sap_get_stats(sap, &stats);
+    
+    sap_destroy(sap);
+    free(bodies);
+    free(seen);
+    
+    if (!ok) {
+        fprintf(stderr, "SAP pairs differ from the brute-force overlap set\n");
+        return 1;
+    }
+    if (stats.axis != 2 || axis_before == 2) {
+        fprintf(stderr, "SAP did not switch to the axis of greatest spread\n");
+        return 1;
+    }
+    
+    printf("Sweep-and-prune tests completed\n");
+    return 0;
+}
@@ -0,0 +1,816 @@
+/*******************************************************************************
+ * METAVERSE ECS
+ * Archetype-chunked entity storage with access-declaring, scheduled systems
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Entities with the same component set (an archetype, one bit per component)
+// live together in fixed-size chunks, one column per component. A system
+// names the components it needs and visits only the chunks of matching
+// archetypes, so its inner loop never tests flags. Zero-sized components are
+// tags: they select archetypes but take no column space.
+//
+// Chunks of an archetype are kept packed (only the last one is partly
+// full), so removing an entity moves the archetype's last row into the hole.
+// Changing an entity's component set moves it to another archetype: a row
+// copy plus that swap-remove, with archetype transitions cached per edge.
+//
+// Structural changes (create, destroy, set_mask) must not overlap
+// ecs_run_systems(); systems only read and write component data in place.
+#define ECS_MAX_COMPONENTS 32
+#define ECS_MAX_SYSTEMS    64           // One job graph node each
+#define ECS_CHUNK_BYTES    (16 * 1024)
+#define ECS_NONE           UINT32_MAX
+
+typedef uint32_t EcsMask;
+typedef uint64_t EcsEntity;             // generation << 32 | record slot
+
+#define ECS_ENTITY_INVALID 0
+
+typedef struct EcsArchetype EcsArchetype;
+
+typedef struct EcsChunk {
+    EcsArchetype* archetype;
+    uint32_t count;
+    EcsEntity* entities;                // Row -> entity
+    uint8_t* columns[ECS_MAX_COMPONENTS];
+} EcsChunk;
+
+struct EcsArchetype {
+    EcsMask mask;
+    uint32_t rows;                      // Rows per chunk
+    size_t chunk_bytes;
+    size_t column_offset[ECS_MAX_COMPONENTS];
+    
+    EcsChunk** chunks;                  // All full except the last
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    EcsChunk* spare;                    // Emptied chunk kept to absorb churn
+    uint32_t entity_count;
+    
+    uint32_t edges[ECS_MAX_COMPONENTS]; // Archetype after toggling a component
+};
+
+typedef struct {
+    uint32_t archetype;
+    uint32_t chunk;
+    uint32_t row;
+    uint32_t generation;                // Odd while alive
+} EcsRecord;
+
+// Job system (metaverse_jobs.c)
+typedef struct JobSystem JobSystem;
+typedef struct JobGraph JobGraph;
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+JobGraph* job_graph_create(void);
+void job_graph_destroy(JobGraph* graph);
+uint32_t job_graph_add(JobGraph* graph, const char* name, JobFunc func, void* data);
+bool job_graph_depend(JobGraph* graph, uint32_t node, uint32_t dependency);
+void job_graph_run(JobSystem* system, JobGraph* graph);
+
+typedef void (*EcsSystemFunc)(EcsChunk* chunk, void* data);
+
+typedef struct EcsWorld EcsWorld;
+
+typedef struct {
+    EcsWorld* world;
+    const char* name;
+    EcsMask all;                        // Archetype must have all of these
+    EcsMask none;                       // ... and none of these
+    EcsMask read;
+    EcsMask write;
+    EcsSystemFunc func;
+    void* data;
+    
+    // Matching archetypes, refreshed as new archetypes appear
+    uint32_t* archetypes;
+    uint32_t archetype_count;
+    uint32_t archetypes_seen;
+    
+    // Chunks gathered for this run
+    EcsChunk** chunks;
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+} EcsSystem;
+
+struct EcsWorld {
+    size_t component_size[ECS_MAX_COMPONENTS];
+    EcsMask registered;
+    
+    EcsArchetype* archetypes;
+    uint32_t archetype_count;
+    uint32_t archetype_capacity;
+    
+    // Open-addressing hash: mask -> archetype (linear probing, power of two)
+    uint32_t* archetype_hash;
+    uint32_t hash_capacity;
+    
+    EcsRecord* records;
+    uint32_t record_count;
+    uint32_t record_capacity;
+    uint32_t* free_records;
+    uint32_t free_count;
+    uint32_t entity_count;
+    
+    EcsSystem systems[ECS_MAX_SYSTEMS];
+    uint32_t system_count;
+    JobGraph* schedule;                 // Rebuilt when systems are added
+    JobSystem* run_jobs;                // Set for the duration of ecs_run_systems
+    bool schedule_dirty;
+    bool schedule_serial;               // Dependencies did not fit the graph
+};
+
+// Function prototypes
+EcsWorld* ecs_world_create(void);
+void ecs_world_destroy(EcsWorld* world);
+bool ecs_register_component(EcsWorld* world, uint32_t component, size_t size);
+EcsEntity ecs_create(EcsWorld* world, EcsMask mask);
+void ecs_destroy(EcsWorld* world, EcsEntity entity);
+bool ecs_set_mask(EcsWorld* world, EcsEntity entity, EcsMask mask);
+EcsMask ecs_get_mask(EcsWorld* world, EcsEntity entity);
+void* ecs_get(EcsWorld* world, EcsEntity entity, uint32_t component);
+uint32_t ecs_entity_count(EcsWorld* world);
+uint32_t ecs_chunk_count(const EcsChunk* chunk);
+void* ecs_chunk_column(const EcsChunk* chunk, uint32_t component);
+const EcsEntity* ecs_chunk_entities(const EcsChunk* chunk);
+uint32_t ecs_system_add(EcsWorld* world, const char* name, EcsMask all, EcsMask none,
+                        EcsMask read, EcsMask write, EcsSystemFunc func, void* data);
+void ecs_run_systems(EcsWorld* world, JobSystem* jobs);
+void ecs_query_each(EcsWorld* world, EcsMask all, EcsMask none, EcsSystemFunc func, void* data);
+
+EcsWorld* ecs_world_create(void) {
+    EcsWorld* world = calloc(1, sizeof(EcsWorld));
+    if (!world) return NULL;
+    
+    world->hash_capacity = 64;
+    world->archetype_hash = malloc(sizeof(uint32_t) * world->hash_capacity);
+    if (!world->archetype_hash) {
+        free(world);
+        return NULL;
+    }
+    memset(world->archetype_hash, 0xFF, sizeof(uint32_t) * world->hash_capacity);
+    
+    world->schedule_dirty = true;
+    return world;
+}
+
+static void ecs_chunk_free(EcsChunk* chunk) {
+    free(chunk);
+}
+
+void ecs_world_destroy(EcsWorld* world) {
+    if (!world) return;
+    
+    for (uint32_t a = 0; a < world->archetype_count; a++) {
+        EcsArchetype* archetype = &world->archetypes[a];
+        for (uint32_t c = 0; c < archetype->chunk_count; c++) {
+            ecs_chunk_free(archetype->chunks[c]);
+        }
+        ecs_chunk_free(archetype->spare);
+        free(archetype->chunks);
+    }
+    for (uint32_t s = 0; s < world->system_count; s++) {
+        free(world->systems[s].archetypes);
+        free(world->systems[s].chunks);
+    }
+    
+    job_graph_destroy(world->schedule);
+    free(world->archetypes);
+    free(world->archetype_hash);
+    free(world->records);
+    free(world->free_records);
+    free(world);
+}
+
+// size 0 registers a tag. Columns are 64-byte aligned, which covers any
+// component alignment. Components must be registered before any archetype
+// uses them.
+bool ecs_register_component(EcsWorld* world, uint32_t component, size_t size) {
+    if (component >= ECS_MAX_COMPONENTS) return false;
+    
+    world->component_size[component] = size;
+    world->registered |= 1u << component;
+    return true;
+}
+
+// Archetypes
+static inline uint32_t mask_hash(EcsMask mask) {
+    uint32_t h = mask * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+static uint32_t archetype_find(EcsWorld* world, EcsMask mask) {
+    uint32_t hmask = world->hash_capacity - 1;
+    for (uint32_t b = mask_hash(mask) & hmask;; b = (b + 1) & hmask) {
+        uint32_t a = world->archetype_hash[b];
+        if (a == ECS_NONE || world->archetypes[a].mask == mask) return a;
+    }
+}
+
+static bool archetype_rehash(EcsWorld* world, uint32_t capacity) {
+    uint32_t* hash = malloc(sizeof(uint32_t) * capacity);
+    if (!hash) return false;
+    memset(hash, 0xFF, sizeof(uint32_t) * capacity);
+    
+    for (uint32_t a = 0; a < world->archetype_count; a++) {
+        uint32_t b = mask_hash(world->archetypes[a].mask) & (capacity - 1);
+        while (hash[b] != ECS_NONE) b = (b + 1) & (capacity - 1);
+        hash[b] = a;
+    }
+    
+    free(world->archetype_hash);
+    world->archetype_hash = hash;
+    world->hash_capacity = capacity;
+    return true;
+}
+
+// Column layout: entity handles first, then each sized component, every
+// column 64-byte aligned so systems can stream them with vector loads
+static void archetype_layout(EcsWorld* world, EcsArchetype* archetype) {
+    size_t row_bytes = sizeof(EcsEntity);
+    uint32_t columns = 1;
+    for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+        if ((archetype->mask & (1u << c)) && world->component_size[c]) {
+            row_bytes += world->component_size[c];
+            columns++;
+        }
+    }
+    
+    size_t header = (sizeof(EcsChunk) + 63) & ~(size_t)63;
+    size_t usable = ECS_CHUNK_BYTES - header - 64 * columns;
+    uint32_t rows = (uint32_t)(usable / row_bytes);
+    if (rows < 16) rows = 16;  // Oversized components get bigger chunks
+    
+    // Entity handles sit right after the header
+    size_t offset = header + ((rows * sizeof(EcsEntity) + 63) & ~(size_t)63);
+    for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+        archetype->column_offset[c] = 0;
+        if ((archetype->mask & (1u << c)) && world->component_size[c]) {
+            archetype->column_offset[c] = offset;
+            offset += (rows * world->component_size[c] + 63) & ~(size_t)63;
+        }
+    }
+    
+    archetype->rows = rows;
+    archetype->chunk_bytes = offset;
+}
+
+static uint32_t archetype_get(EcsWorld* world, EcsMask mask) {
+    uint32_t found = archetype_find(world, mask);
+    if (found != ECS_NONE) return found;
+    if ((mask & world->registered) != mask) return ECS_NONE;
+    
+    // Keep the hash at most half full
+    if ((world->archetype_count + 1) * 2 > world->hash_capacity &&
+        !archetype_rehash(world, world->hash_capacity * 2)) {
+        return ECS_NONE;
+    }
+    
+    if (world->archetype_count == world->archetype_capacity) {
+        uint32_t capacity = world->archetype_capacity ? world->archetype_capacity * 2 : 16;
+        EcsArchetype* archetypes = realloc(world->archetypes, sizeof(EcsArchetype) * capacity);
+        if (!archetypes) return ECS_NONE;
+        world->archetypes = archetypes;
+        world->archetype_capacity = capacity;
+        
+        // Chunks point back at their archetype
+        for (uint32_t a = 0; a < world->archetype_count; a++) {
+            EcsArchetype* archetype = &world->archetypes[a];
+            for (uint32_t c = 0; c < archetype->chunk_count; c++) {
+                archetype->chunks[c]->archetype = archetype;
+            }
+            if (archetype->spare) archetype->spare->archetype = archetype;
+        }
+    }
+    
+    uint32_t a = world->archetype_count++;
+    EcsArchetype* archetype = &world->archetypes[a];
+    memset(archetype, 0, sizeof(EcsArchetype));
+    archetype->mask = mask;
+    memset(archetype->edges, 0xFF, sizeof(archetype->edges));
+    archetype_layout(world, archetype);
+    
+    uint32_t hmask = world->hash_capacity - 1;
+    uint32_t b = mask_hash(mask) & hmask;
+    while (world->archetype_hash[b] != ECS_NONE) b = (b + 1) & hmask;
+    world->archetype_hash[b] = a;
+    
+    return a;
+}
+
+// O(1) after the first transition along an edge
+static uint32_t archetype_transition(EcsWorld* world, uint32_t from, EcsMask mask) {
+    EcsMask diff = world->archetypes[from].mask ^ mask;
+    if (diff == 0) return from;
+    
+    if ((diff & (diff - 1)) == 0) {
+        uint32_t c = (uint32_t)__builtin_ctz(diff);
+        uint32_t to = world->archetypes[from].edges[c];
+        if (to == ECS_NONE) {
+            to = archetype_get(world, mask);
+            if (to != ECS_NONE) world->archetypes[from].edges[c] = to;
+        }
+        return to;
+    }
+    return archetype_get(world, mask);
+}
+
+static EcsChunk* chunk_create(EcsArchetype* archetype) {
+    EcsChunk* chunk = archetype->spare;
+    if (chunk) {
+        archetype->spare = NULL;
+        return chunk;
+    }
+    
+    void* memory = NULL;
+    if (posix_memalign(&memory, 64, archetype->chunk_bytes) != 0) return NULL;
+    
+    chunk = (EcsChunk*)memory;
+    memset(chunk, 0, sizeof(EcsChunk));
+    chunk->archetype = archetype;
+    
+    size_t header = (sizeof(EcsChunk) + 63) & ~(size_t)63;
+    chunk->entities = (EcsEntity*)((uint8_t*)memory + header);
+    for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+        if (archetype->column_offset[c]) {
+            chunk->columns[c] = (uint8_t*)memory + archetype->column_offset[c];
+        }
+    }
+    return chunk;
+}
+
+// Reserve the next row of an archetype; returns false on allocation failure
+static bool archetype_push(EcsArchetype* archetype, uint32_t* chunk_index, uint32_t* row) {
+    EcsChunk* last = archetype->chunk_count ? archetype->chunks[archetype->chunk_count - 1] : NULL;
+    
+    if (!last || last->count == archetype->rows) {
+        if (archetype->chunk_count == archetype->chunk_capacity) {
+            uint32_t capacity = archetype->chunk_capacity ? archetype->chunk_capacity * 2 : 8;
+            EcsChunk** chunks = realloc(archetype->chunks, sizeof(EcsChunk*) * capacity);
+            if (!chunks) return false;
+            archetype->chunks = chunks;
+            archetype->chunk_capacity = capacity;
+        }
+        last = chunk_create(archetype);
+        if (!last) return false;
+        archetype->chunks[archetype->chunk_count++] = last;
+    }
+    
+    *chunk_index = archetype->chunk_count - 1;
+    *row = last->count++;
+    archetype->entity_count++;
+    return true;
+}
+
+// Fill the hole at (chunk_index, row) with the archetype's last row
+static void archetype_swap_remove(EcsWorld* world, EcsArchetype* archetype,
+                                  uint32_t chunk_index, uint32_t row) {
+    EcsChunk* last = archetype->chunks[archetype->chunk_count - 1];
+    uint32_t last_row = last->count - 1;
+    EcsChunk* chunk = archetype->chunks[chunk_index];
+    
+    if (chunk != last || row != last_row) {
+        EcsEntity moved = last->entities[last_row];
+        chunk->entities[row] = moved;
+        for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+            if (!chunk->columns[c]) continue;
+            size_t size = world->component_size[c];
+            memcpy(chunk->columns[c] + row * size, last->columns[c] + last_row * size, size);
+        }
+        
+        EcsRecord* record = &world->records[(uint32_t)moved];
+        record->chunk = chunk_index;
+        record->row = row;
+    }
+    
+    last->count--;
+    archetype->entity_count--;
+    
+    if (last->count == 0) {
+        archetype->chunk_count--;
+        if (archetype->spare) {
+            ecs_chunk_free(last);
+        } else {
+            archetype->spare = last;
+        }
+    }
+}
+
+// Entities
+static inline EcsRecord* ecs_record(EcsWorld* world, EcsEntity entity) {
+    uint32_t slot = (uint32_t)entity;
+    if (slot >= world->record_count) return NULL;
+    
+    EcsRecord* record = &world->records[slot];
+    if (record->generation != (uint32_t)(entity >> 32) || !(record->generation & 1)) return NULL;
+    return record;
+}
+
+// New entity with zeroed components
+EcsEntity ecs_create(EcsWorld* world, EcsMask mask) {
+    uint32_t a = archetype_get(world, mask);
+    if (a == ECS_NONE) return ECS_ENTITY_INVALID;
+    
+    uint32_t slot;
+    if (world->free_count > 0) {
+        slot = world->free_records[--world->free_count];
+    } else {
+        if (world->record_count == world->record_capacity) {
+            uint32_t capacity = world->record_capacity ? world->record_capacity * 2 : 1024;
+            EcsRecord* records = realloc(world->records, sizeof(EcsRecord) * capacity);
+            if (!records) return ECS_ENTITY_INVALID;
+            world->records = records;
+            
+            uint32_t* free_records = realloc(world->free_records, sizeof(uint32_t) * capacity);
+            if (!free_records) return ECS_ENTITY_INVALID;
+            world->free_records = free_records;
+            world->record_capacity = capacity;
+        }
+        slot = world->record_count++;
+        world->records[slot].generation = 0;
+    }
+    
+    EcsArchetype* archetype = &world->archetypes[a];
+    EcsRecord* record = &world->records[slot];
+    if (!archetype_push(archetype, &record->chunk, &record->row)) {
+        world->free_records[world->free_count++] = slot;
+        return ECS_ENTITY_INVALID;
+    }
+    
+    record->archetype = a;
+    record->generation++;
+    EcsEntity entity = ((EcsEntity)record->generation << 32) | slot;
+    
+    EcsChunk* chunk = archetype->chunks[record->chunk];
+    chunk->entities[record->row] = entity;
+    for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+        if (!chunk->columns[c]) continue;
+        size_t size = world->component_size[c];
+        memset(chunk->columns[c] + record->row * size, 0, size);
+    }
+    
+    world->entity_count++;
+    return entity;
+}
+
+void ecs_destroy(EcsWorld* world, EcsEntity entity) {
+    EcsRecord* record = ecs_record(world, entity);
+    if (!record) return;
+    
+    archetype_swap_remove(world, &world->archetypes[record->archetype], record->chunk, record->row);
+    
+    record->generation++;
+    world->free_records[world->free_count++] = (uint32_t)entity;
+    world->entity_count--;
+}
+
+// Move an entity to the archetype for mask. Components in both sets keep
+// their values, added ones start zeroed.
+bool ecs_set_mask(EcsWorld* world, EcsEntity entity, EcsMask mask) {
+    EcsRecord* record = ecs_record(world, entity);
+    if (!record) return false;
+    
+    uint32_t from = record->archetype;
+    uint32_t to = archetype_transition(world, from, mask);
+    if (to == ECS_NONE) return false;
+    if (to == from) return true;
+    
+    // archetype_transition may have grown (moved) the archetype array
+    EcsArchetype* source = &world->archetypes[from];
+    EcsArchetype* target = &world->archetypes[to];
+    
+    uint32_t chunk_index, row;
+    if (!archetype_push(target, &chunk_index, &row)) return false;
+    
+    EcsChunk* src = source->chunks[record->chunk];
+    EcsChunk* dst = target->chunks[chunk_index];
+    dst->entities[row] = entity;
+    for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+        if (!dst->columns[c]) continue;
+        size_t size = world->component_size[c];
+        if (src->columns[c]) {
+            memcpy(dst->columns[c] + row * size, src->columns[c] + record->row * size, size);
+        } else {
+            memset(dst->columns[c] + row * size, 0, size);
+        }
+    }
+    
+    archetype_swap_remove(world, source, record->chunk, record->row);
+    
+    record->archetype = to;
+    record->chunk = chunk_index;
+    record->row = row;
+    return true;
+}
+
+EcsMask ecs_get_mask(EcsWorld* world, EcsEntity entity) {
+    EcsRecord* record = ecs_record(world, entity);
+    return record ? world->archetypes[record->archetype].mask : 0;
+}
+
+// Component storage for one entity, NULL if it lacks the component (or it is
+// a tag). Valid until the next structural change.
+void* ecs_get(EcsWorld* world, EcsEntity entity, uint32_t component) {
+    EcsRecord* record = ecs_record(world, entity);
+    if (!record || component >= ECS_MAX_COMPONENTS) return NULL;
+    
+    EcsChunk* chunk = world->archetypes[record->archetype].chunks[record->chunk];
+    if (!chunk->columns[component]) return NULL;
+    return chunk->columns[component] + record->row * world->component_size[component];
+}
+
+uint32_t ecs_entity_count(EcsWorld* world) {
+    return world->entity_count;
+}
+
+uint32_t ecs_chunk_count(const EcsChunk* chunk) {
+    return chunk->count;
+}
+
+void* ecs_chunk_column(const EcsChunk* chunk, uint32_t component) {
+    return component < ECS_MAX_COMPONENTS ? chunk->columns[component] : NULL;
+}
+
+const EcsEntity* ecs_chunk_entities(const EcsChunk* chunk) {
+    return chunk->entities;
+}
+
+// Systems
+static inline bool archetype_matches(EcsMask mask, EcsMask all, EcsMask none) {
+    return (mask & all) == all && (mask & none) == 0;
+}
+
+// Register a system. read and write name the components the system touches
+// (tags it only filters on need not be listed); systems whose accesses
+// conflict run in registration order, the rest run in parallel.
+uint32_t ecs_system_add(EcsWorld* world, const char* name, EcsMask all, EcsMask none,
+                        EcsMask read, EcsMask write, EcsSystemFunc func, void* data) {
+    if (world->system_count >= ECS_MAX_SYSTEMS) return ECS_NONE;
+    
+    uint32_t id = world->system_count++;
+    EcsSystem* system = &world->systems[id];
+    memset(system, 0, sizeof(EcsSystem));
+    system->world = world;
+    system->name = name;
+    system->all = all;
+    system->none = none;
+    system->read = read;
+    system->write = write;
+    system->func = func;
+    system->data = data;
+    
+    world->schedule_dirty = true;
+    return id;
+}
+
+// Pick up archetypes created since the system last ran
+static bool system_refresh(EcsSystem* system) {
+    EcsWorld* world = system->world;
+    
+    for (uint32_t a = system->archetypes_seen; a < world->archetype_count; a++) {
+        if (!archetype_matches(world->archetypes[a].mask, system->all, system->none)) continue;
+        
+        uint32_t* archetypes = realloc(system->archetypes,
+                                       sizeof(uint32_t) * (system->archetype_count + 1));
+        if (!archetypes) return false;
+        system->archetypes = archetypes;
+        system->archetypes[system->archetype_count++] = a;
+    }
+    system->archetypes_seen = world->archetype_count;
+    
+    system->chunk_count = 0;
+    for (uint32_t i = 0; i < system->archetype_count; i++) {
+        EcsArchetype* archetype = &world->archetypes[system->archetypes[i]];
+        
+        if (system->chunk_count + archetype->chunk_count > system->chunk_capacity) {
+            uint32_t capacity = system->chunk_capacity ? system->chunk_capacity : 64;
+            while (capacity < system->chunk_count + archetype->chunk_count) capacity *= 2;
+            EcsChunk** chunks = realloc(system->chunks, sizeof(EcsChunk*) * capacity);
+            if (!chunks) return false;
+            system->chunks = chunks;
+            system->chunk_capacity = capacity;
+        }
+        memcpy(system->chunks + system->chunk_count, archetype->chunks,
+               sizeof(EcsChunk*) * archetype->chunk_count);
+        system->chunk_count += archetype->chunk_count;
+    }
+    return true;
+}
+
+static void system_run_range(void* data, uint32_t begin, uint32_t end) {
+    EcsSystem* system = (EcsSystem*)data;
+    for (uint32_t c = begin; c < end; c++) {
+        system->func(system->chunks[c], system->data);
+    }
+}
+
+// One chunk per parallel-for item; chunks are sized to be worth a task
+static void system_node(void* data) {
+    EcsSystem* system = (EcsSystem*)data;
+    if (!system_refresh(system)) return;
+    job_parallel_for(system->world->run_jobs, system->chunk_count, 1, system_run_range, system);
+}
+
+static inline bool systems_conflict(const EcsSystem* a, const EcsSystem* b) {
+    return (a->write & (b->read | b->write)) || (b->write & a->read);
+}
+
+// One graph node per system. Each system depends on the latest earlier
+// writer of anything it touches and, if it writes, on the readers since;
+// older conflicts follow transitively, which keeps the edge count low.
+static bool ecs_build_schedule(EcsWorld* world) {
+    job_graph_destroy(world->schedule);
+    world->schedule = job_graph_create();
+    if (!world->schedule) return false;
+    
+    uint32_t last_writer[ECS_MAX_COMPONENTS];
+    EcsMask readers_since[ECS_MAX_SYSTEMS];  // Per system: components read since their last write
+    memset(last_writer, 0xFF, sizeof(last_writer));
+    memset(readers_since, 0, sizeof(readers_since));
+    
+    for (uint32_t s = 0; s < world->system_count; s++) {
+        EcsSystem* system = &world->systems[s];
+        if (job_graph_add(world->schedule, system->name, system_node, system) != s) return false;
+        
+        bool depends[ECS_MAX_SYSTEMS] = { false };
+        EcsMask touched = system->read | system->write;
+        for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+            if (!(touched & (1u << c))) continue;
+            if (last_writer[c] != ECS_NONE) depends[last_writer[c]] = true;
+            
+            if (system->write & (1u << c)) {
+                for (uint32_t r = 0; r < s; r++) {
+                    if (readers_since[r] & (1u << c)) depends[r] = true;
+                }
+            }
+        }
+        
+        for (uint32_t d = 0; d < s; d++) {
+            if (depends[d] && systems_conflict(&world->systems[d], system) &&
+                !job_graph_depend(world->schedule, s, d)) {
+                return false;
+            }
+        }
+        
+        for (uint32_t c = 0; c < ECS_MAX_COMPONENTS; c++) {
+            if (system->write & (1u << c)) {
+                last_writer[c] = s;
+                for (uint32_t r = 0; r < s; r++) readers_since[r] &= ~(1u << c);
+            }
+        }
+        readers_since[s] = system->read & ~system->write;
+    }
+    return true;
+}
+
+// Run every system once. Without a job system (or when the dependencies
+// overflow the job graph) systems run serially in registration order.
+void ecs_run_systems(EcsWorld* world, JobSystem* jobs) {
+    if (world->schedule_dirty) {
+        world->schedule_serial = !ecs_build_schedule(world);
+        world->schedule_dirty = false;
+    }
+    
+    if (!jobs || world->schedule_serial) {
+        for (uint32_t s = 0; s < world->system_count; s++) {
+            EcsSystem* system = &world->systems[s];
+            if (!system_refresh(system)) continue;
+            system_run_range(system, 0, system->chunk_count);
+        }
+        return;
+    }
+    
+    world->run_jobs = jobs;
+    job_graph_run(jobs, world->schedule);
+    world->run_jobs = NULL;
+}
+
+// Ad hoc serial query over matching chunks, outside the schedule
+void ecs_query_each(EcsWorld* world, EcsMask all, EcsMask none, EcsSystemFunc func, void* data) {
+    for (uint32_t a = 0; a < world->archetype_count; a++) {
+        EcsArchetype* archetype = &world->archetypes[a];
+        if (!archetype_matches(archetype->mask, all, none)) continue;
+        
+        for (uint32_t c = 0; c < archetype->chunk_count; c++) {
+            func(archetype->chunks[c], data);
+        }
+    }
+}
+
+#define ECS_TEST_POSITION 0             // float[3], x holds the entity's test index
+#define ECS_TEST_VELOCITY 1             // float[3], x holds minus the index
+#define ECS_TEST_TAG      2
+#define ECS_TEST_ENTITIES 3000          // Several chunks per archetype
+
+static void ecs_test_count_rows(EcsChunk* chunk, void* data) {
+    *(uint32_t*)data += ecs_chunk_count(chunk);
+}
+
+// Each live entity must have the expected mask and carry its own values
+static bool ecs_test_verify(EcsWorld* world, const EcsEntity* entities, const EcsMask* masks) {
+    for (uint32_t i = 0; i < ECS_TEST_ENTITIES; i++) {
+        if (!masks[i]) {
+            if (ecs_get_mask(world, entities[i]) != 0) return false;
+            continue;
+        }
+        if (ecs_get_mask(world, entities[i]) != masks[i]) return false;
+        
+        const float* position = ecs_get(world, entities[i], ECS_TEST_POSITION);
+        const float* velocity = ecs_get(world, entities[i], ECS_TEST_VELOCITY);
+        if (!position || position[0] != (float)i) return false;
+        if ((masks[i] & (1u << ECS_TEST_VELOCITY)) ? !velocity || velocity[0] != -(float)i
+                                                   : velocity != NULL) {
+            return false;
+        }
+        if (ecs_get(world, entities[i], ECS_TEST_TAG) != NULL) return false;
+    }
+    return true;
+}
+
+int main_ecs_test() {
+    printf("Metaverse ECS Test\n");
+    
+    EcsWorld* world = ecs_world_create();
+    EcsEntity* entities = malloc(sizeof(EcsEntity) * ECS_TEST_ENTITIES);
+    EcsMask* masks = malloc(sizeof(EcsMask) * ECS_TEST_ENTITIES);
+    if (!world || !entities || !masks) {
+        fprintf(stderr, "Failed to allocate ECS test state\n");
+        ecs_world_destroy(world);
+        free(entities);
+        free(masks);
+        return 1;
+    }
+    
+    ecs_register_component(world, ECS_TEST_POSITION, sizeof(float) * 3);
+    ecs_register_component(world, ECS_TEST_VELOCITY, sizeof(float) * 3);
+    ecs_register_component(world, ECS_TEST_TAG, 0);
+    
+    const EcsMask position = 1u << ECS_TEST_POSITION;
+    const EcsMask velocity = 1u << ECS_TEST_VELOCITY;
+    const EcsMask tag = 1u << ECS_TEST_TAG;
+    bool ok = true;
+    
+    for (uint32_t i = 0; ok && i < ECS_TEST_ENTITIES; i++) {
+        entities[i] = ecs_create(world, position);
+        masks[i] = position;
+        float* p = ecs_get(world, entities[i], ECS_TEST_POSITION);
+        if (!p) ok = false;
+        else p[0] = (float)i;
+    }
+    
+    // Add a component to half, tag a third, then drop the component again
+    // from a quarter; every move swap-removes from the source archetype
+    for (uint32_t i = 0; ok && i < ECS_TEST_ENTITIES; i += 2) {
+        masks[i] |= velocity;
+        ok = ecs_set_mask(world, entities[i], masks[i]);
+        float* v = ok ? ecs_get(world, entities[i], ECS_TEST_VELOCITY) : NULL;
+        if (!v || v[0] != 0.0f) ok = false;
+        else v[0] = -(float)i;
+    }
+    for (uint32_t i = 0; ok && i < ECS_TEST_ENTITIES; i += 3) {
+        masks[i] |= tag;
+        ok = ecs_set_mask(world, entities[i], masks[i]);
+    }
+    for (uint32_t i = 0; ok && i < ECS_TEST_ENTITIES; i += 4) {
+        masks[i] &= ~velocity;
+        ok = ecs_set_mask(world, entities[i], masks[i]);
+    }
+    if (ok) ok = ecs_test_verify(world, entities, masks);
+    
+    // Destroy a fifth; stale handles must stop resolving
+    uint32_t alive = ECS_TEST_ENTITIES;
+    for (uint32_t i = 0; ok && i < ECS_TEST_ENTITIES; i += 5) {
+        ecs_destroy(world, entities[i]);
+        masks[i] = 0;
+        alive--;
+    }
+    if (ok) ok = ecs_test_verify(world, entities, masks) && ecs_entity_count(world) == alive;
+    
+    uint32_t tagged = 0, expected_tagged = 0;
+    for (uint32_t i = 0; i < ECS_TEST_ENTITIES; i++) {
+        if (masks[i] & tag) expected_tagged++;
+    }
+    ecs_query_each(world, tag, 0, ecs_test_count_rows, &tagged);
+    if (tagged != expected_tagged) ok = false;
+    
+    ecs_world_destroy(world);
+    free(entities);
+    free(masks);
+    
+    if (!ok) {
+        fprintf(stderr, "Archetype migration lost or mixed up component data\n");
+        return 1;
+    }
+    
+    printf("ECS tests completed\n");
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*******************************************************************************
+ * METAVERSE ENTITY INDEX
+ * O(1) entity_id -> dense slot lookup with generational handles
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Entity handles: generation in the high 32 bits, handle slot in the low 32.
+// Handles name a slot in an indirection table rather than a dense array
+// position, so they survive array growth and swap-removal; a stale handle
+// is detected by its generation.
+typedef uint64_t EntityHandle;
+
+#define ENTITY_HANDLE_INVALID 0
+#define ENTITY_INDEX_NONE     UINT32_MAX
+#define ENTITY_ID_EMPTY       UINT64_MAX  // Reserved key marking an empty hash bucket
+
+typedef struct EntityIndex {
+    // Open-addressing hash (linear probing, power-of-two capacity)
+    uint64_t* keys;
+    uint32_t* values;           // Dense index for each key
+    uint32_t hash_capacity;
+    
+    // Dense side, mirrors the owner's entity array
+    uint64_t* dense_id;
+    uint32_t* dense_slot;
+    uint32_t dense_count;
+    uint32_t dense_capacity;
+    
+    // Handle slots
+    uint32_t* slot_dense;       // Dense index, or next free slot when unused
+    uint32_t* slot_generation;
+    uint32_t slot_count;
+    uint32_t slot_capacity;
+    uint32_t free_slot;
+} EntityIndex;
+
+// Function prototypes
+EntityIndex* entity_index_create(uint32_t initial_capacity);
+void entity_index_destroy(EntityIndex* index);
+EntityHandle entity_index_insert(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_remove(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_lookup(const EntityIndex* index, uint64_t entity_id);
+EntityHandle entity_index_handle(const EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_resolve(const EntityIndex* index, EntityHandle handle);
+void entity_index_clear(EntityIndex* index);
+
+static inline uint32_t entity_hash(uint64_t id) {
+    // splitmix64 finalizer
+    id ^= id >> 30;
+    id *= 0xbf58476d1ce4e5b9ULL;
+    id ^= id >> 27;
+    id *= 0x94d049bb133111ebULL;
+    id ^= id >> 31;
+    return (uint32_t)id;
+}
+
+static inline EntityHandle make_handle(uint32_t slot, uint32_t generation) {
+    return ((uint64_t)generation << 32) | slot;
+}
+
+static bool hash_alloc(EntityIndex* index, uint32_t capacity) {
+    index->keys = malloc(sizeof(uint64_t) * capacity);
+    index->values = malloc(sizeof(uint32_t) * capacity);
+    if (!index->keys || !index->values) {
+        free(index->keys);
+        free(index->values);
+        index->keys = NULL;
+        index->values = NULL;
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < capacity; i++) {
+        index->keys[i] = ENTITY_ID_EMPTY;
+    }
+    index->hash_capacity = capacity;
+    return true;
+}
+
+static void hash_put(EntityIndex* index, uint64_t entity_id, uint32_t value) {
+    uint32_t mask = index->hash_capacity - 1;
+    uint32_t bucket = entity_hash(entity_id) & mask;
+    
+    while (index->keys[bucket] != ENTITY_ID_EMPTY && index->keys[bucket] != entity_id) {
+        bucket = (bucket + 1) & mask;
+    }
+    
+    index->keys[bucket] = entity_id;
+    index->values[bucket] = value;
+}
+
+static uint32_t hash_find_bucket(const EntityIndex* index, uint64_t entity_id) {
+    uint32_t mask = index->hash_capacity - 1;
+    uint32_t bucket = entity_hash(entity_id) & mask;
+    
+    while (index->keys[bucket] != ENTITY_ID_EMPTY) {
+        if (index->keys[bucket] == entity_id) return bucket;
+        bucket = (bucket + 1) & mask;
+    }
+    return ENTITY_INDEX_NONE;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void hash_erase_bucket(EntityIndex* index, uint32_t bucket) {
+    uint32_t mask = index->hash_capacity - 1;
+    uint32_t hole = bucket;
+    uint32_t next = (hole + 1) & mask;
+    
+    while (index->keys[next] != ENTITY_ID_EMPTY) {
+        uint32_t home = entity_hash(index->keys[next]) & mask;
+        
+        // Move the entry back if its home bucket is not in (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->keys[hole] = index->keys[next];
+            index->values[hole] = index->values[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    
+    index->keys[hole] = ENTITY_ID_EMPTY;
+}
+
+static bool hash_grow(EntityIndex* index) {
+    uint64_t* old_keys = index->keys;
+    uint32_t* old_values = index->values;
+    uint32_t old_capacity = index->hash_capacity;
+    
+    if (!hash_alloc(index, old_capacity * 2)) {
+        index->keys = old_keys;
+        index->values = old_values;
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] != ENTITY_ID_EMPTY) {
+            hash_put(index, old_keys[i], old_values[i]);
+        }
+    }
+    
+    free(old_keys);
+    free(old_values);
+    return true;
+}
+
+static bool grow_array(void** array, uint32_t* capacity, size_t element_size) {
+    uint32_t new_capacity = *capacity * 2;
+    void* grown = realloc(*array, element_size * new_capacity);
+    if (!grown) return false;
+    
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Create index
+EntityIndex* entity_index_create(uint32_t initial_capacity) {
+    EntityIndex* index = malloc(sizeof(EntityIndex));
+    if (!index) return NULL;
+    
+    memset(index, 0, sizeof(EntityIndex));
+    
+    if (initial_capacity < 16) initial_capacity = 16;
+    
+    // Hash kept at most half full
+    uint32_t hash_capacity = 32;
+    while (hash_capacity < initial_capacity * 2) hash_capacity *= 2;
+    
+    index->dense_capacity = initial_capacity;
+    index->dense_id = malloc(sizeof(uint64_t) * initial_capacity);
+    index->dense_slot = malloc(sizeof(uint32_t) * initial_capacity);
+    
+    index->slot_capacity = initial_capacity;
+    index->slot_dense = malloc(sizeof(uint32_t) * initial_capacity);
+    index->slot_generation = malloc(sizeof(uint32_t) * initial_capacity);
+    index->free_slot = ENTITY_INDEX_NONE;
+    
+    if (!hash_alloc(index, hash_capacity) ||
+        !index->dense_id || !index->dense_slot ||
+        !index->slot_dense || !index->slot_generation) {
+        entity_index_destroy(index);
+        return NULL;
+    }
+    
+    return index;
+}
+
+// Insert entity at the end of the dense array
+EntityHandle entity_index_insert(EntityIndex* index, uint64_t entity_id) {
+    if (entity_id == ENTITY_ID_EMPTY) return ENTITY_HANDLE_INVALID;
+    if (hash_find_bucket(index, entity_id) != ENTITY_INDEX_NONE) {
+        return ENTITY_HANDLE_INVALID;  // Duplicate id
+    }
+    
+    if ((index->dense_count + 1) * 2 > index->hash_capacity && !hash_grow(index)) {
+        return ENTITY_HANDLE_INVALID;
+    }
+    
+    if (index->dense_count == index->dense_capacity) {
+        uint32_t capacity = index->dense_capacity;
+        if (!grow_array((void**)&index->dense_id, &capacity, sizeof(uint64_t))) {
+            return ENTITY_HANDLE_INVALID;
+        }
+        capacity = index->dense_capacity;
+        if (!grow_array((void**)&index->dense_slot, &capacity, sizeof(uint32_t))) {
+            return ENTITY_HANDLE_INVALID;
+        }
+        index->dense_capacity = capacity;
+    }
+    
+    // Reuse a free slot; its generation was already advanced on removal
+    uint32_t slot = index->free_slot;
+    if (slot != ENTITY_INDEX_NONE) {
+        index->free_slot = index->slot_dense[slot];
+    } else {
+        if (index->slot_count == index->slot_capacity) {
+            uint32_t capacity = index->slot_capacity;
+            if (!grow_array((void**)&index->slot_dense, &capacity, sizeof(uint32_t))) {
+                return ENTITY_HANDLE_INVALID;
+            }
+            capacity = index->slot_capacity;
+            if (!grow_array((void**)&index->slot_generation, &capacity, sizeof(uint32_t))) {
+                return ENTITY_HANDLE_INVALID;
+            }
+            index->slot_capacity = capacity;
+        }
+        slot = index->slot_count++;
+        index->slot_generation[slot] = 1;
+    }
+    
+    uint32_t dense = index->dense_count++;
+    index->dense_id[dense] = entity_id;
+    index->dense_slot[dense] = slot;
+    index->slot_dense[slot] = dense;
+    
+    hash_put(index, entity_id, dense);
+    
+    return make_handle(slot, index->slot_generation[slot]);
+}
+
+// Remove entity by swapping the last dense entry into its place.
+// Returns the dense index that was vacated (the caller must perform the same
+// swap on its own arrays), or ENTITY_INDEX_NONE if the id is unknown.
+uint32_t entity_index_remove(EntityIndex* index, uint64_t entity_id) {
+    uint32_t bucket = hash_find_bucket(index, entity_id);
+    if (bucket == ENTITY_INDEX_NONE) return ENTITY_INDEX_NONE;
+    
+    uint32_t dense = index->values[bucket];
+    uint32_t last = index->dense_count - 1;
+    uint32_t slot = index->dense_slot[dense];
+    
+    hash_erase_bucket(index, bucket);
+    
+    if (dense != last) {
+        uint64_t moved_id = index->dense_id[last];
+        uint32_t moved_slot = index->dense_slot[last];
+        
+        index->dense_id[dense] = moved_id;
+        index->dense_slot[dense] = moved_slot;
+        index->slot_dense[moved_slot] = dense;
+        index->values[hash_find_bucket(index, moved_id)] = dense;
+    }
+    index->dense_count--;
+    
+    // Invalidate outstanding handles and push slot on the free list
+    index->slot_generation[slot]++;
+    if (index->slot_generation[slot] == 0) index->slot_generation[slot] = 1;
+    index->slot_dense[slot] = index->free_slot;
+    index->free_slot = slot;
+    
+    return dense;
+}
+
+// Dense index for an entity id
+uint32_t entity_index_lookup(const EntityIndex* index, uint64_t entity_id) {
+    uint32_t bucket = hash_find_bucket(index, entity_id);
+    return bucket == ENTITY_INDEX_NONE ? ENTITY_INDEX_NONE : index->values[bucket];
+}
+
+// Current handle for an entity id
+EntityHandle entity_index_handle(const EntityIndex* index, uint64_t entity_id) {
+    uint32_t dense = entity_index_lookup(index, entity_id);
+    if (dense == ENTITY_INDEX_NONE) return ENTITY_HANDLE_INVALID;
+    
+    uint32_t slot = index->dense_slot[dense];
+    return make_handle(slot, index->slot_generation[slot]);
+}
+
+// Dense index for a handle, or ENTITY_INDEX_NONE if the handle is stale
+uint32_t entity_index_resolve(const EntityIndex* index, EntityHandle handle) {
+    uint32_t slot = (uint32_t)handle;
+    uint32_t generation = (uint32_t)(handle >> 32);
+    
+    if (slot >= index->slot_count || index->slot_generation[slot] != generation) {
+        return ENTITY_INDEX_NONE;
+    }
+    return index->slot_dense[slot];
+}
+
+// Drop all entities; outstanding handles become stale
+void entity_index_clear(EntityIndex* index) {
+    for (uint32_t i = 0; i < index->dense_count; i++) {
+        uint32_t slot = index->dense_slot[i];
+        index->slot_generation[slot]++;
+        if (index->slot_generation[slot] == 0) index->slot_generation[slot] = 1;
+        index->slot_dense[slot] = index->free_slot;
+        index->free_slot = slot;
+    }
+    
+    for (uint32_t i = 0; i < index->hash_capacity; i++) {
+        index->keys[i] = ENTITY_ID_EMPTY;
+    }
+    index->dense_count = 0;
+}
+
+// Cleanup
+void entity_index_destroy(EntityIndex* index) {
+    if (!index) return;
+    
+    free(index->keys);
+    free(index->values);
+    free(index->dense_id);
+    free(index->dense_slot);
+    free(index->slot_dense);
+    free(index->slot_generation);
+    free(index);
+}
@@ -0,0 +1,349 @@
+/*******************************************************************************
+ * METAVERSE FRAME ARENA
+ * Per-thread bump allocation for transient frame data, reset once per frame
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define FRAME_ARENA_MAX_THREADS 64
+#define FRAME_ARENA_ALIGN       16
+#define FRAME_ARENA_POISON      0xDD      // Debug fill for memory released by a reset
+
+// Each thread bumps through its own regions, so allocation never takes a
+// lock. A region is one chunk sized to its peak use: when a frame
+// outgrows it, a chunk twice the size replaces it and the old one is kept
+// until the next rewind, after which the frame runs without mallocs again.
+//
+// Three regions per thread:
+//   TRANSIENT  released by the next frame_arena_reset()
+//   CARRY x2   alternate by frame parity; released by the reset after next,
+//              so data survives into the following frame
+typedef enum {
+    ARENA_REGION_TRANSIENT = 0,
+    ARENA_REGION_CARRY_EVEN,
+    ARENA_REGION_CARRY_ODD,
+    ARENA_REGION_COUNT
+} ArenaRegionKind;
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;    // Retired list link
+    size_t size;
+    size_t used;
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk* chunk;
+    ArenaChunk* retired;        // Outgrown chunks still holding live data
+} ArenaRegion;
+
+// Cache-line aligned so per-allocation counter updates stay thread-local
+typedef struct {
+    _Alignas(64) ArenaRegion regions[ARENA_REGION_COUNT];
+    uint64_t frame;             // Frame the regions were last rewound for
+    _Atomic size_t frame_bytes; // Bytes handed out during `frame`
+    _Atomic size_t reserved;    // Bytes held in chunks
+    pthread_t thread;
+    atomic_bool ready;
+} ArenaThread;
+
+typedef struct {
+    uint64_t frame;             // Frames completed
+    size_t frame_bytes;         // Bytes allocated during the last completed frame
+    size_t high_water;          // Largest frame_bytes so far
+    size_t reserved;            // Bytes held across all threads
+    uint32_t threads;
+} FrameArenaStats;
+
+typedef struct FrameArena {
+    ArenaThread threads[FRAME_ARENA_MAX_THREADS];
+    atomic_uint thread_count;
+    pthread_mutex_t shared_lock; // Guards the last slot, shared by threads past the table
+    
+    _Atomic uint64_t frame;
+    uint64_t id;                // Distinguishes arenas in the thread-local cache
+    size_t initial_size;
+    
+    bool debug;
+    void (*report)(const char* message);
+    
+    size_t last_frame_bytes;
+    size_t high_water;
+} FrameArena;
+
+// Function prototypes
+FrameArena* frame_arena_create(size_t initial_size, bool debug, void (*report)(const char*));
+void frame_arena_destroy(FrameArena* arena);
+void* frame_arena_alloc(FrameArena* arena, size_t size);
+void* frame_arena_alloc_carry(FrameArena* arena, size_t size);
+void frame_arena_reset(FrameArena* arena);
+void frame_arena_get_stats(FrameArena* arena, FrameArenaStats* stats);
+void frame_arena_bind(FrameArena* arena);
+void* frame_alloc(size_t size);
+void* frame_alloc_carry(size_t size);
+
+static _Atomic uint64_t next_arena_id = 1;
+
+// Last arena this thread allocated from, and its slot in that arena
+static _Thread_local uint64_t tls_arena_id;
+static _Thread_local ArenaThread* tls_state;
+
+// Arena behind the GodotAPI frame allocation hooks
+static FrameArena* bound_arena;
+
+static ArenaChunk* chunk_create(size_t size) {
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk) + size);
+    if (!chunk) return NULL;
+    
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+static void region_rewind(FrameArena* arena, ArenaThread* state, ArenaRegion* region) {
+    while (region->retired) {
+        ArenaChunk* next = region->retired->next;
+        atomic_fetch_sub_explicit(&state->reserved, region->retired->size, memory_order_relaxed);
+        free(region->retired);
+        region->retired = next;
+    }
+    
+    if (region->chunk) {
+        if (arena->debug) memset(region->chunk + 1, FRAME_ARENA_POISON, region->chunk->used);
+        region->chunk->used = 0;
+    }
+}
+
+static void region_free(ArenaRegion* region) {
+    while (region->retired) {
+        ArenaChunk* next = region->retired->next;
+        free(region->retired);
+        region->retired = next;
+    }
+    free(region->chunk);
+    region->chunk = NULL;
+}
+
+// Rewind a thread's regions for a new frame. Carry data from the frame just
+// before `frame` is kept; anything older is released.
+static void thread_advance(FrameArena* arena, ArenaThread* state, uint64_t frame) {
+    ArenaRegionKind current = (frame & 1) ? ARENA_REGION_CARRY_ODD : ARENA_REGION_CARRY_EVEN;
+    ArenaRegionKind previous = (frame & 1) ? ARENA_REGION_CARRY_EVEN : ARENA_REGION_CARRY_ODD;
+    
+    region_rewind(arena, state, &state->regions[ARENA_REGION_TRANSIENT]);
+    region_rewind(arena, state, &state->regions[current]);
+    if (state->frame + 1 != frame) {
+        region_rewind(arena, state, &state->regions[previous]);
+    }
+    
+    state->frame = frame;
+    atomic_store_explicit(&state->frame_bytes, 0, memory_order_relaxed);
+}
+
+// Calling thread's slot, registering it on first use
+static ArenaThread* thread_state(FrameArena* arena) {
+    if (tls_arena_id == arena->id) return tls_state;
+    
+    pthread_t self = pthread_self();
+    uint32_t count = atomic_load_explicit(&arena->thread_count, memory_order_acquire);
+    if (count > FRAME_ARENA_MAX_THREADS) count = FRAME_ARENA_MAX_THREADS;
+    
+    ArenaThread* state = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        ArenaThread* candidate = &arena->threads[i];
+        if (atomic_load_explicit(&candidate->ready, memory_order_acquire) &&
+            pthread_equal(candidate->thread, self)) {
+            state = candidate;
+            break;
+        }
+    }
+    
+    if (!state) {
+        uint32_t slot = atomic_fetch_add(&arena->thread_count, 1);
+        if (slot >= FRAME_ARENA_MAX_THREADS - 1) {
+            // Shared slot, see arena_alloc()
+            tls_arena_id = arena->id;
+            tls_state = NULL;
+            return NULL;
+        }
+        
+        state = &arena->threads[slot];
+        state->thread = self;
+        state->frame = atomic_load_explicit(&arena->frame, memory_order_acquire);
+        atomic_store_explicit(&state->ready, true, memory_order_release);
+    }
+    
+    tls_arena_id = arena->id;
+    tls_state = state;
+    return state;
+}
+
+static void* region_alloc(FrameArena* arena, ArenaThread* state, ArenaRegion* region, size_t size) {
+    ArenaChunk* chunk = region->chunk;
+    
+    if (chunk) {
+        uintptr_t base = (uintptr_t)(chunk + 1);
+        uintptr_t p = (base + chunk->used + FRAME_ARENA_ALIGN - 1) & ~(uintptr_t)(FRAME_ARENA_ALIGN - 1);
+        if (p + size <= base + chunk->size) {
+            chunk->used = p + size - base;
+            return (void*)p;
+        }
+    }
+    
+    // Outgrown: start a larger chunk, retire the old one until the next rewind
+    size_t grown = chunk ? chunk->size * 2 : arena->initial_size;
+    while (grown < size + FRAME_ARENA_ALIGN) grown *= 2;
+    
+    ArenaChunk* fresh = chunk_create(grown);
+    if (!fresh) return NULL;
+    atomic_fetch_add_explicit(&state->reserved, grown, memory_order_relaxed);
+    
+    if (chunk) {
+        chunk->next = region->retired;
+        region->retired = chunk;
+    }
+    region->chunk = fresh;
+    
+    uintptr_t base = (uintptr_t)(fresh + 1);
+    uintptr_t p = (base + FRAME_ARENA_ALIGN - 1) & ~(uintptr_t)(FRAME_ARENA_ALIGN - 1);
+    fresh->used = p + size - base;
+    return (void*)p;
+}
+
+static void* arena_alloc(FrameArena* arena, bool carry, size_t size) {
+    if (!arena || size == 0) return NULL;
+    
+    uint64_t frame = atomic_load_explicit(&arena->frame, memory_order_acquire);
+    ArenaThread* state = thread_state(arena);
+    bool shared = state == NULL;
+    
+    // Threads beyond the table share the last slot under a lock
+    if (shared) {
+        state = &arena->threads[FRAME_ARENA_MAX_THREADS - 1];
+        pthread_mutex_lock(&arena->shared_lock);
+    }
+    
+    if (state->frame != frame) thread_advance(arena, state, frame);
+    
+    ArenaRegionKind kind = ARENA_REGION_TRANSIENT;
+    if (carry) kind = (frame & 1) ? ARENA_REGION_CARRY_ODD : ARENA_REGION_CARRY_EVEN;
+    
+    void* p = region_alloc(arena, state, &state->regions[kind], size);
+    
+    // Single writer (or under the shared lock), so no read-modify-write needed
+    size_t bytes = atomic_load_explicit(&state->frame_bytes, memory_order_relaxed);
+    atomic_store_explicit(&state->frame_bytes, bytes + size, memory_order_relaxed);
+    
+    if (shared) pthread_mutex_unlock(&arena->shared_lock);
+    return p;
+}
+
+// Create arena; `initial_size` is the first chunk of each thread region
+FrameArena* frame_arena_create(size_t initial_size, bool debug, void (*report)(const char*)) {
+    FrameArena* arena = aligned_alloc(64, (sizeof(FrameArena) + 63) & ~(size_t)63);
+    if (!arena) return NULL;
+    
+    memset(arena, 0, sizeof(FrameArena));
+    arena->id = atomic_fetch_add(&next_arena_id, 1);
+    arena->initial_size = initial_size < 4096 ? 4096 : initial_size;
+    arena->debug = debug;
+    arena->report = report;
+    
+    pthread_mutex_init(&arena->shared_lock, NULL);
+    return arena;
+}
+
+// Transient allocation, 16-byte aligned; released by the next reset
+void* frame_arena_alloc(FrameArena* arena, size_t size) {
+    return arena_alloc(arena, false, size);
+}
+
+// Allocation that survives into the next frame; released by the reset after it
+void* frame_arena_alloc_carry(FrameArena* arena, size_t size) {
+    return arena_alloc(arena, true, size);
+}
+
+// End of frame. O(1) in the number of allocations: threads rewind their own
+// regions on their next allocation. Call from the thread that owns the
+// frame once workers are done with its allocations.
+void frame_arena_reset(FrameArena* arena) {
+    uint64_t frame = atomic_load_explicit(&arena->frame, memory_order_relaxed);
+    uint32_t count = atomic_load_explicit(&arena->thread_count, memory_order_acquire);
+    if (count > FRAME_ARENA_MAX_THREADS) count = FRAME_ARENA_MAX_THREADS;
+    
+    // Sum this frame's use for the high-water mark
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        ArenaThread* state = &arena->threads[i];
+        if (state->frame == frame) {
+            bytes += atomic_load_explicit(&state->frame_bytes, memory_order_relaxed);
+        }
+    }
+    arena->last_frame_bytes = bytes;
+    if (bytes > arena->high_water) arena->high_water = bytes;
+    
+    atomic_store_explicit(&arena->frame, frame + 1, memory_order_release);
+    
+    if (arena->debug) {
+        // Release eagerly so stale pointers read poison right away
+        for (uint32_t i = 0; i < count; i++) {
+            thread_advance(arena, &arena->threads[i], frame + 1);
+        }
+        
+        if (arena->report) {
+            char message[128];
+            snprintf(message, sizeof(message),
+                     "Frame arena: frame %llu used %zu bytes (high water %zu)",
+                     (unsigned long long)frame, bytes, arena->high_water);
+            arena->report(message);
+        }
+    }
+}
+
+void frame_arena_get_stats(FrameArena* arena, FrameArenaStats* stats) {
+    uint32_t count = atomic_load_explicit(&arena->thread_count, memory_order_acquire);
+    if (count > FRAME_ARENA_MAX_THREADS) count = FRAME_ARENA_MAX_THREADS;
+    
+    stats->frame = atomic_load_explicit(&arena->frame, memory_order_relaxed);
+    stats->frame_bytes = arena->last_frame_bytes;
+    stats->high_water = arena->high_water;
+    stats->threads = count;
+    stats->reserved = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        stats->reserved += atomic_load_explicit(&arena->threads[i].reserved, memory_order_relaxed);
+    }
+}
+
+// Route the GodotAPI frame allocation hooks to `arena` (NULL unbinds)
+void frame_arena_bind(FrameArena* arena) {
+    bound_arena = arena;
+}
+
+void* frame_alloc(size_t size) {
+    return frame_arena_alloc(bound_arena, size);
+}
+
+void* frame_alloc_carry(size_t size) {
+    return frame_arena_alloc_carry(bound_arena, size);
+}
+
+// Cleanup; no thread may allocate from the arena afterwards
+void frame_arena_destroy(FrameArena* arena) {
+    if (!arena) return;
+    if (bound_arena == arena) bound_arena = NULL;
+    
+    for (uint32_t i = 0; i < FRAME_ARENA_MAX_THREADS; i++) {
+        for (int r = 0; r < ARENA_REGION_COUNT; r++) {
+            region_free(&arena->threads[i].regions[r]);
+        }
+    }
+    
+    pthread_mutex_destroy(&arena->shared_lock);
+    free(arena);
+}
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * METAVERSE GL STUB
+ * No-op GL/GLEW surface for headless builds (METAVERSE_HEADLESS)
+ ******************************************************************************/
+
+#ifndef METAVERSE_GL_STUB_H
+#define METAVERSE_GL_STUB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Covers exactly what the core and texture modules call. Objects get
+// non-zero names so "not created yet" checks behave as with a driver, but
+// nothing is allocated; glMapBufferRange returns NULL and the extension
+// queries report false, so the instance ring stays on the heap.
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef unsigned int GLbitfield;
+typedef unsigned char GLboolean;
+typedef int GLint;
+typedef int GLsizei;
+typedef float GLfloat;
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+typedef uint64_t GLuint64;
+typedef struct __GLsync* GLsync;
+
+#define GL_FALSE                      0
+#define GL_TRUE                       1
+#define GL_TRIANGLES                  0x0004
+#define GL_FLOAT                      0x1406
+#define GL_DEPTH_BUFFER_BIT           0x00000100
+#define GL_COLOR_BUFFER_BIT           0x00004000
+#define GL_LEQUAL                     0x0203
+#define GL_SRC_ALPHA                  0x0302
+#define GL_ONE_MINUS_SRC_ALPHA        0x0303
+#define GL_BACK                       0x0405
+#define GL_CULL_FACE                  0x0B44
+#define GL_DEPTH_TEST                 0x0B71
+#define GL_BLEND                      0x0BE2
+#define GL_CCW                        0x0901
+#define GL_ARRAY_BUFFER               0x8892
+#define GL_STREAM_DRAW                0x88E0
+#define GL_FRAMEBUFFER                0x8D40
+#define GL_MAP_WRITE_BIT              0x0002
+#define GL_MAP_PERSISTENT_BIT         0x0040
+#define GL_MAP_COHERENT_BIT           0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT    0x00000001
+#define GL_ALREADY_SIGNALED           0x911A
+#define GL_TIMEOUT_EXPIRED            0x911B
+
+#define GLEW_OK                         0
+#define GLEW_ARB_buffer_storage         GL_FALSE
+#define GLEW_ARB_multi_draw_indirect    GL_FALSE
+#define GLEW_ARB_bindless_texture       GL_FALSE
+
+static GLboolean glewExperimental __attribute__((unused));
+static GLuint gl_stub_next_name;
+
+static inline GLenum glewInit(void) { return GLEW_OK; }
+
+static inline void gl_stub_gen(GLsizei n, GLuint* names) {
+    for (GLsizei i = 0; i < n; i++) names[i] = ++gl_stub_next_name;
+}
+
+static inline void glGenBuffers(GLsizei n, GLuint* buffers) { gl_stub_gen(n, buffers); }
+static inline void glGenFramebuffers(GLsizei n, GLuint* framebuffers) { gl_stub_gen(n, framebuffers); }
+static inline void glDeleteBuffers(GLsizei n, const GLuint* buffers) { (void)n; (void)buffers; }
+static inline void glDeleteTextures(GLsizei n, const GLuint* textures) { (void)n; (void)textures; }
+
+static inline void glBindBuffer(GLenum target, GLuint buffer) { (void)target; (void)buffer; }
+static inline void glBindFramebuffer(GLenum target, GLuint framebuffer) { (void)target; (void)framebuffer; }
+static inline void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    (void)target; (void)size; (void)data; (void)usage;
+}
+static inline void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    (void)target; (void)offset; (void)size; (void)data;
+}
+static inline void glBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+    (void)target; (void)size; (void)data; (void)flags;
+}
+static inline void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
+                                     GLbitfield access) {
+    (void)target; (void)offset; (void)length; (void)access;
+    return NULL;
+}
+
+static inline GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+    (void)condition; (void)flags;
+    return NULL;
+}
+static inline GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    (void)sync; (void)flags; (void)timeout;
+    return GL_ALREADY_SIGNALED;
+}
+static inline void glDeleteSync(GLsync sync) { (void)sync; }
+
+static inline void glEnable(GLenum cap) { (void)cap; }
+static inline void glCullFace(GLenum mode) { (void)mode; }
+static inline void glFrontFace(GLenum mode) { (void)mode; }
+static inline void glDepthFunc(GLenum func) { (void)func; }
+static inline void glBlendFunc(GLenum sfactor, GLenum dfactor) { (void)sfactor; (void)dfactor; }
+static inline void glClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    (void)r; (void)g; (void)b; (void)a;
+}
+static inline void glClear(GLbitfield mask) { (void)mask; }
+
+static inline void glEnableVertexAttribArray(GLuint index) { (void)index; }
+static inline void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                         GLsizei stride, const void* pointer) {
+    (void)index; (void)size; (void)type; (void)normalized; (void)stride; (void)pointer;
+}
+static inline void glVertexAttribDivisor(GLuint index, GLuint divisor) { (void)index; (void)divisor; }
+static inline void glDrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count,
+                                                     GLsizei instances, GLuint base_instance) {
+    (void)mode; (void)first; (void)count; (void)instances; (void)base_instance;
+}
+
+#endif // METAVERSE_GL_STUB_H
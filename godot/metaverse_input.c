@@ -0,0 +1,355 @@
+/*******************************************************************************
+ * METAVERSE INPUT
+ * Lock-free MPSC ring of timestamped input events, drained once per frame
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+
+#include "metaverse_profiler.h"
+
+#define INPUT_RING_CAPACITY     4096  // Events, power of two
+#define INPUT_MAX_DEVICES       8
+#define INPUT_MAX_CONTROLS      64    // Per device; buttons are one bit each
+#define INPUT_LATENCY_BUCKETS   32    // log2(microseconds) histogram
+
+// Any number of OS/driver threads push; the frame is the single consumer.
+// Events are stamped with profiler_now() when pushed. Draining applies them
+// to an InputFrame:
+// - axes coalesce: only the latest value per axis survives a frame
+// - buttons are exact: every edge is kept in order, so a press and release
+//   between two frames still shows up as both
+// A full ring rejects the push and counts it as dropped; nothing already in
+// the ring is overwritten.
+typedef enum {
+    INPUT_EVENT_AXIS = 0,
+    INPUT_EVENT_BUTTON
+} InputEventType;
+
+typedef struct {
+    uint64_t timestamp;     // profiler_now() ticks at push
+    uint16_t device;
+    uint16_t control;
+    uint8_t type;           // InputEventType
+    float value;            // Axis position, or 1 / 0 for press / release
+} InputEvent;
+
+typedef struct {
+    float axes[INPUT_MAX_DEVICES][INPUT_MAX_CONTROLS];  // Latest value per axis
+    uint64_t buttons_down[INPUT_MAX_DEVICES];           // After this frame's edges
+    InputEvent* button_events;      // This frame's button edges, in push order
+    uint32_t button_event_count;
+    uint32_t button_event_capacity;
+    uint32_t axis_events;           // Axis events drained, before coalescing
+    uint32_t axes_changed;          // Distinct axes they updated
+    uint64_t frame;
+} InputFrame;
+
+typedef struct {
+    uint64_t events;
+    uint64_t axis_events;
+    uint64_t button_events;
+    uint64_t coalesced;             // Axis events superseded within their frame
+    uint64_t dropped;               // Rejected because the ring was full
+    uint64_t edges_lost;            // Button edges lost: frame array could not grow
+    uint64_t rejected;              // Device or control out of range
+    double latency_max_us;
+    double latency_sum_us;
+    double frame_latency_max_us;    // Worst event in the last drain
+    uint64_t histogram[INPUT_LATENCY_BUCKETS];  // Bucket b: [2^b - 1, 2^(b+1) - 1) us
+} InputLatencyStats;
+
+// Bounded MPSC queue (Vyukov): each cell's sequence says whose turn it is.
+// Producers claim a position with one CAS on head; the consumer owns tail.
+typedef struct {
+    _Atomic uint64_t sequence;
+    InputEvent event;
+} InputCell;
+
+typedef struct InputRing {
+    InputCell* cells;
+    uint64_t mask;
+    alignas(64) _Atomic uint64_t head;
+    alignas(64) uint64_t tail;
+    _Atomic uint64_t dropped;
+    _Atomic uint64_t rejected;
+    InputLatencyStats stats;        // Consumer only
+} InputRing;
+
+// Function prototypes
+InputRing* input_ring_create(uint32_t capacity);
+void input_ring_destroy(InputRing* ring);
+bool input_push_axis(InputRing* ring, uint16_t device, uint16_t control, float value);
+bool input_push_button(InputRing* ring, uint16_t device, uint16_t control, bool pressed);
+uint32_t input_ring_drain(InputRing* ring, InputFrame* frame);
+void input_ring_get_stats(InputRing* ring, InputLatencyStats* stats);
+double input_latency_percentile(const InputLatencyStats* stats, double percentile);
+bool input_button_down(const InputFrame* frame, uint16_t device, uint16_t control);
+void input_frame_free(InputFrame* frame);
+
+InputRing* input_ring_create(uint32_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1))) capacity = INPUT_RING_CAPACITY;
+    
+    InputRing* ring = aligned_alloc(64, sizeof(InputRing));
+    if (!ring) return NULL;
+    memset(ring, 0, sizeof(InputRing));
+    
+    ring->cells = malloc(sizeof(InputCell) * capacity);
+    if (!ring->cells) {
+        free(ring);
+        return NULL;
+    }
+    
+    ring->mask = capacity - 1;
+    for (uint64_t i = 0; i < capacity; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+    }
+    return ring;
+}
+
+void input_ring_destroy(InputRing* ring) {
+    if (!ring) return;
+    free(ring->cells);
+    free(ring);
+}
+
+static bool input_push(InputRing* ring, uint16_t device, uint16_t control, uint8_t type,
+                       float value) {
+    if (device >= INPUT_MAX_DEVICES || control >= INPUT_MAX_CONTROLS) {
+        atomic_fetch_add_explicit(&ring->rejected, 1, memory_order_relaxed);
+        return false;
+    }
+    
+    uint64_t timestamp = profiler_now();
+    uint64_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    InputCell* cell;
+    
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        uint64_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int64_t diff = (int64_t)(sequence - pos);
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The consumer has not freed this cell yet: full
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+    
+    cell->event = (InputEvent){ timestamp, device, control, type, value };
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+// Producer side, safe from any thread
+bool input_push_axis(InputRing* ring, uint16_t device, uint16_t control, float value) {
+    return input_push(ring, device, control, INPUT_EVENT_AXIS, value);
+}
+
+bool input_push_button(InputRing* ring, uint16_t device, uint16_t control, bool pressed) {
+    return input_push(ring, device, control, INPUT_EVENT_BUTTON, pressed ? 1.0f : 0.0f);
+}
+
+static bool input_frame_push_button(InputFrame* frame, const InputEvent* event) {
+    if (frame->button_event_count == frame->button_event_capacity) {
+        uint32_t capacity = frame->button_event_capacity ? frame->button_event_capacity * 2 : 64;
+        InputEvent* events = realloc(frame->button_events, sizeof(InputEvent) * capacity);
+        if (!events) return false;
+        frame->button_events = events;
+        frame->button_event_capacity = capacity;
+    }
+    frame->button_events[frame->button_event_count++] = *event;
+    return true;
+}
+
+static void input_record_latency(InputLatencyStats* stats, double latency_us) {
+    uint32_t bucket = 0;
+    for (uint64_t v = (uint64_t)latency_us + 1; v > 1 && bucket < INPUT_LATENCY_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    stats->histogram[bucket]++;
+    stats->latency_sum_us += latency_us;
+    if (latency_us > stats->latency_max_us) stats->latency_max_us = latency_us;
+    if (latency_us > stats->frame_latency_max_us) stats->frame_latency_max_us = latency_us;
+}
+
+// Consumer side, one thread (the frame). Applies everything pushed before
+// the call; events still being written, or pushed meanwhile, wait for the
+// next frame so button order is preserved. Returns events drained.
+uint32_t input_ring_drain(InputRing* ring, InputFrame* frame) {
+    InputLatencyStats* stats = &ring->stats;
+    uint64_t now = profiler_now();
+    uint64_t end = atomic_load_explicit(&ring->head, memory_order_acquire);
+    
+    // Which axes this frame already saw, to count coalescing
+    uint64_t touched[INPUT_MAX_DEVICES] = { 0 };
+    
+    frame->button_event_count = 0;
+    frame->axis_events = 0;
+    frame->axes_changed = 0;
+    frame->frame++;
+    stats->frame_latency_max_us = 0.0;
+    
+    uint32_t drained = 0;
+    while (ring->tail < end) {
+        InputCell* cell = &ring->cells[ring->tail & ring->mask];
+        uint64_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        if (sequence != ring->tail + 1) break;  // Claimed but not yet written
+        
+        InputEvent event = cell->event;
+        atomic_store_explicit(&cell->sequence, ring->tail + ring->mask + 1, memory_order_release);
+        ring->tail++;
+        drained++;
+        
+        uint64_t bit = 1ull << event.control;
+        if (event.type == INPUT_EVENT_AXIS) {
+            if (touched[event.device] & bit) {
+                stats->coalesced++;
+            } else {
+                touched[event.device] |= bit;
+                frame->axes_changed++;
+            }
+            frame->axes[event.device][event.control] = event.value;
+            frame->axis_events++;
+            stats->axis_events++;
+        } else {
+            if (event.value != 0.0f) {
+                frame->buttons_down[event.device] |= bit;
+            } else {
+                frame->buttons_down[event.device] &= ~bit;
+            }
+            if (!input_frame_push_button(frame, &event)) stats->edges_lost++;
+            stats->button_events++;
+        }
+        
+        double latency_us = now > event.timestamp ? profiler_ticks_to_us(now - event.timestamp) : 0.0;
+        input_record_latency(stats, latency_us);
+    }
+    
+    // One sample per drain; per event, a burst would flush real zones out of
+    // the profiler's ring
+    if (drained > 0) profiler_counter("Input latency (us)", stats->frame_latency_max_us);
+    stats->events += drained;
+    return drained;
+}
+
+void input_ring_get_stats(InputRing* ring, InputLatencyStats* stats) {
+    *stats = ring->stats;
+    stats->dropped += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&ring->rejected, memory_order_relaxed);
+}
+
+// Upper bound of the histogram bucket holding the given percentile (0-100)
+double input_latency_percentile(const InputLatencyStats* stats, double percentile) {
+    uint64_t total = 0;
+    for (int b = 0; b < INPUT_LATENCY_BUCKETS; b++) total += stats->histogram[b];
+    if (total == 0) return 0.0;
+    
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+    
+    uint64_t seen = 0;
+    for (int b = 0; b < INPUT_LATENCY_BUCKETS; b++) {
+        seen += stats->histogram[b];
+        if (seen >= rank) return (double)((2ull << b) - 1);
+    }
+    return stats->latency_max_us;
+}
+
+bool input_button_down(const InputFrame* frame, uint16_t device, uint16_t control) {
+    if (device >= INPUT_MAX_DEVICES || control >= INPUT_MAX_CONTROLS) return false;
+    return (frame->buttons_down[device] >> control) & 1;
+}
+
+void input_frame_free(InputFrame* frame) {
+    free(frame->button_events);
+    frame->button_events = NULL;
+    frame->button_event_count = 0;
+    frame->button_event_capacity = 0;
+}
+
+int main_input_test() {
+    printf("Metaverse Input Test\n");
+    
+    InputRing* ring = input_ring_create(16);
+    if (!ring) {
+        fprintf(stderr, "Failed to create input ring\n");
+        return 1;
+    }
+    
+    InputFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    InputLatencyStats stats;
+    bool ok = true;
+    
+    // A full ring rejects new events and keeps the ones it holds
+    uint32_t accepted = 0;
+    for (int i = 0; i < 20; i++) {
+        if (input_push_axis(ring, 0, 0, (float)i)) accepted++;
+    }
+    input_ring_get_stats(ring, &stats);
+    if (accepted != 16 || stats.dropped != 4) {
+        fprintf(stderr, "Full ring accepted %u events, dropped %llu\n", accepted,
+                (unsigned long long)stats.dropped);
+        ok = false;
+    }
+    
+    // The 16 queued values coalesce to the last accepted one
+    uint32_t drained = input_ring_drain(ring, &frame);
+    input_ring_get_stats(ring, &stats);
+    if (drained != 16 || frame.axes[0][0] != 15.0f || frame.axes_changed != 1 ||
+        stats.coalesced != 15) {
+        fprintf(stderr, "Axis events did not coalesce to the latest value\n");
+        ok = false;
+    }
+    
+    // Room again once drained; a press and release within one frame keep
+    // both edges, in order
+    bool pushed = input_push_button(ring, 1, 5, true) &&
+                  input_push_axis(ring, 1, 0, 0.5f) &&
+                  input_push_button(ring, 1, 5, false);
+    drained = input_ring_drain(ring, &frame);
+    if (!pushed || drained != 3 || frame.button_event_count != 2 ||
+        frame.button_events[0].value != 1.0f || frame.button_events[1].value != 0.0f ||
+        input_button_down(&frame, 1, 5)) {
+        fprintf(stderr, "Press and release within one frame were not both kept\n");
+        ok = false;
+    }
+    
+    // A press alone stays down across a frame with no edges
+    input_push_button(ring, 1, 5, true);
+    input_ring_drain(ring, &frame);
+    input_ring_drain(ring, &frame);
+    if (!input_button_down(&frame, 1, 5) || frame.button_event_count != 0) {
+        fprintf(stderr, "Held button was not carried into the next frame\n");
+        ok = false;
+    }
+    
+    // Out-of-range controls are rejected, not dropped
+    input_push_button(ring, INPUT_MAX_DEVICES, 0, true);
+    input_ring_get_stats(ring, &stats);
+    if (stats.rejected != 1 || stats.dropped != 4) {
+        fprintf(stderr, "Out-of-range event was not counted as rejected\n");
+        ok = false;
+    }
+    
+    input_frame_free(&frame);
+    input_ring_destroy(ring);
+    if (!ok) return 1;
+    
+    printf("Input tests completed\n");
+    return 0;
+}
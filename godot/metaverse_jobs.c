@@ -0,0 +1,542 @@
+/*******************************************************************************
+ * METAVERSE JOB SYSTEM
+ * Work-stealing task scheduler with parallel-for and per-frame job graphs
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "metaverse_profiler.h"
+
+#define JOB_MAX_WORKERS          64
+#define JOB_DEQUE_SIZE           4096  // Power of two
+#define JOB_INJECT_SIZE          1024  // Power of two
+#define JOB_GRAPH_MAX_NODES      64
+#define JOB_GRAPH_MAX_SUCCESSORS 8
+#define JOB_SPIN_COUNT           64
+
+typedef void (*JobFunc)(void* data);
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+// A unit of work. Storage is owned by the submitter and must outlive execution
+// (graph nodes embed theirs, parallel-for keeps them on the waiting stack).
+typedef struct Job {
+    JobFunc func;
+    void* data;
+    atomic_int* counter;  // Decremented after func returns, may be NULL
+} Job;
+
+// Chase-Lev deque: the owner pushes/pops at bottom, thieves steal from top
+typedef struct {
+    alignas(64) atomic_long top;
+    alignas(64) atomic_long bottom;
+    _Atomic(Job*) buffer[JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct JobSystem JobSystem;
+
+typedef struct {
+    JobDeque deque;
+    JobSystem* system;
+    pthread_t thread;
+    uint32_t index;
+    uint32_t rng_state;
+} JobWorker;
+
+struct JobSystem {
+    JobWorker* workers;     // workers[0] is the creating (main) thread
+    uint32_t worker_count;
+    atomic_bool running;
+    
+    // Submissions from threads that are not workers (network, audio...)
+    Job* inject[JOB_INJECT_SIZE];
+    uint32_t inject_head;
+    uint32_t inject_tail;
+    atomic_int inject_count;
+    pthread_mutex_t inject_mutex;
+    
+    // Parking for idle workers
+    atomic_uint work_epoch;
+    atomic_int sleeping;
+    pthread_mutex_t sleep_mutex;
+    pthread_cond_t sleep_cond;
+};
+
+// Per-frame dependency graph. Built once, re-run every frame.
+typedef struct JobGraphNode {
+    Job job;
+    JobFunc func;
+    void* data;
+    const char* name;
+    struct JobGraph* graph;
+    atomic_int pending;  // Unfinished dependencies this run
+    uint32_t dependency_count;
+    uint32_t successors[JOB_GRAPH_MAX_SUCCESSORS];
+    uint32_t successor_count;
+} JobGraphNode;
+
+typedef struct JobGraph {
+    JobGraphNode nodes[JOB_GRAPH_MAX_NODES];
+    uint32_t node_count;
+    JobSystem* system;
+    atomic_int remaining;
+} JobGraph;
+
+// Function prototypes
+JobSystem* job_system_create(uint32_t thread_count);
+void job_system_destroy(JobSystem* system);
+uint32_t job_system_worker_count(JobSystem* system);
+void job_system_submit(JobSystem* system, Job* job);
+void job_system_wait(JobSystem* system, atomic_int* counter);
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+JobGraph* job_graph_create(void);
+void job_graph_destroy(JobGraph* graph);
+uint32_t job_graph_add(JobGraph* graph, const char* name, JobFunc func, void* data);
+bool job_graph_depend(JobGraph* graph, uint32_t node, uint32_t dependency);
+void job_graph_run(JobSystem* system, JobGraph* graph);
+void* job_worker_thread(void* arg);
+
+// Worker identity of the calling thread
+static __thread JobSystem* tls_system = NULL;
+static __thread int tls_worker = -1;
+
+// Deque operations (C11 formulation of Chase-Lev, Le et al. 2013)
+static bool deque_push(JobDeque* deque, Job* job) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    
+    if (b - t >= JOB_DEQUE_SIZE) return false;  // Full
+    
+    atomic_store_explicit(&deque->buffer[b & (JOB_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+static Job* deque_pop(JobDeque* deque) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    
+    if (t > b) {
+        // Empty
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    
+    Job* job = atomic_load_explicit(&deque->buffer[b & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Last item: race against thieves
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            job = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+static Job* deque_steal(JobDeque* deque) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    
+    if (t >= b) return NULL;
+    
+    Job* job = atomic_load_explicit(&deque->buffer[t & (JOB_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;  // Lost the race
+    }
+    return job;
+}
+
+static void job_execute(Job* job) {
+    job->func(job->data);
+    if (job->counter) {
+        atomic_fetch_sub_explicit(job->counter, 1, memory_order_release);
+    }
+}
+
+static Job* inject_pop(JobSystem* system) {
+    if (atomic_load_explicit(&system->inject_count, memory_order_relaxed) == 0) return NULL;
+    
+    Job* job = NULL;
+    pthread_mutex_lock(&system->inject_mutex);
+    if (system->inject_head != system->inject_tail) {
+        job = system->inject[system->inject_head & (JOB_INJECT_SIZE - 1)];
+        system->inject_head++;
+        atomic_fetch_sub(&system->inject_count, 1);
+    }
+    pthread_mutex_unlock(&system->inject_mutex);
+    return job;
+}
+
+static bool inject_push(JobSystem* system, Job* job) {
+    bool pushed = false;
+    pthread_mutex_lock(&system->inject_mutex);
+    if (system->inject_tail - system->inject_head < JOB_INJECT_SIZE) {
+        system->inject[system->inject_tail & (JOB_INJECT_SIZE - 1)] = job;
+        system->inject_tail++;
+        atomic_fetch_add(&system->inject_count, 1);
+        pushed = true;
+    }
+    pthread_mutex_unlock(&system->inject_mutex);
+    return pushed;
+}
+
+// Own deque first, then external submissions, then steal from a random victim
+static Job* job_find_work(JobSystem* system, int worker_index) {
+    Job* job = NULL;
+    uint32_t start = 0;
+    
+    if (worker_index >= 0) {
+        JobWorker* self = &system->workers[worker_index];
+        job = deque_pop(&self->deque);
+        if (job) return job;
+        
+        // xorshift32 victim selection
+        self->rng_state ^= self->rng_state << 13;
+        self->rng_state ^= self->rng_state >> 17;
+        self->rng_state ^= self->rng_state << 5;
+        start = self->rng_state;
+    }
+    
+    job = inject_pop(system);
+    if (job) return job;
+    
+    for (uint32_t i = 0; i < system->worker_count; i++) {
+        uint32_t victim = (start + i) % system->worker_count;
+        if ((int)victim == worker_index) continue;
+        
+        job = deque_steal(&system->workers[victim].deque);
+        if (job) return job;
+    }
+    
+    return NULL;
+}
+
+static void job_wake_one(JobSystem* system) {
+    atomic_fetch_add(&system->work_epoch, 1);
+    if (atomic_load(&system->sleeping) > 0) {
+        pthread_mutex_lock(&system->sleep_mutex);
+        pthread_cond_signal(&system->sleep_cond);
+        pthread_mutex_unlock(&system->sleep_mutex);
+    }
+}
+
+// Create job system. thread_count counts the calling thread; 0 picks one
+// worker per online CPU, 1 runs everything inline (serial fallback).
+JobSystem* job_system_create(uint32_t thread_count) {
+    JobSystem* system = malloc(sizeof(JobSystem));
+    if (!system) return NULL;
+    
+    memset(system, 0, sizeof(JobSystem));
+    
+    if (thread_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (thread_count > JOB_MAX_WORKERS) thread_count = JOB_MAX_WORKERS;
+    
+    // Deques are large and cache-line aligned
+    if (posix_memalign((void**)&system->workers, 64, sizeof(JobWorker) * thread_count) != 0) {
+        free(system);
+        return NULL;
+    }
+    memset(system->workers, 0, sizeof(JobWorker) * thread_count);
+    
+    pthread_mutex_init(&system->inject_mutex, NULL);
+    pthread_mutex_init(&system->sleep_mutex, NULL);
+    pthread_cond_init(&system->sleep_cond, NULL);
+    atomic_store(&system->running, true);
+    
+    system->worker_count = thread_count;
+    for (uint32_t i = 0; i < thread_count; i++) {
+        system->workers[i].system = system;
+        system->workers[i].index = i;
+        system->workers[i].rng_state = 0x9E3779B9u * (i + 1);
+    }
+    
+    // Calling thread becomes worker 0
+    tls_system = system;
+    tls_worker = 0;
+    
+    for (uint32_t i = 1; i < thread_count; i++) {
+        if (pthread_create(&system->workers[i].thread, NULL,
+                           job_worker_thread, &system->workers[i]) != 0) {
+            // Run with however many workers we managed to start
+            fprintf(stderr, "[JOBS] Failed to start worker %u, continuing with %u\n", i, i);
+            system->worker_count = i;
+            break;
+        }
+    }
+    
+    printf("[JOBS] Job system started with %u worker(s)%s\n", system->worker_count,
+           system->worker_count == 1 ? " (serial)" : "");
+    return system;
+}
+
+uint32_t job_system_worker_count(JobSystem* system) {
+    return system ? system->worker_count : 1;
+}
+
+// Worker thread
+void* job_worker_thread(void* arg) {
+    JobWorker* worker = (JobWorker*)arg;
+    JobSystem* system = worker->system;
+    
+    tls_system = system;
+    tls_worker = (int)worker->index;
+    
+    char name[32];
+    snprintf(name, sizeof(name), "Job worker %u", worker->index);
+    profiler_set_thread_name(name);
+    
+    while (atomic_load_explicit(&system->running, memory_order_acquire)) {
+        unsigned epoch = atomic_load(&system->work_epoch);
+        
+        Job* job = NULL;
+        for (int spin = 0; spin < JOB_SPIN_COUNT && !job; spin++) {
+            job = job_find_work(system, tls_worker);
+            if (!job) sched_yield();
+        }
+        
+        if (job) {
+            job_execute(job);
+            continue;
+        }
+        
+        // Park until something is submitted
+        pthread_mutex_lock(&system->sleep_mutex);
+        atomic_fetch_add(&system->sleeping, 1);
+        if (atomic_load(&system->work_epoch) == epoch &&
+            atomic_load(&system->running)) {
+            pthread_cond_wait(&system->sleep_cond, &system->sleep_mutex);
+        }
+        atomic_fetch_sub(&system->sleeping, 1);
+        pthread_mutex_unlock(&system->sleep_mutex);
+    }
+    
+    return NULL;
+}
+
+// Submit job. Serial systems and full queues execute inline.
+void job_system_submit(JobSystem* system, Job* job) {
+    if (!system || system->worker_count == 1) {
+        job_execute(job);
+        return;
+    }
+    
+    bool queued;
+    if (tls_system == system && tls_worker >= 0) {
+        queued = deque_push(&system->workers[tls_worker].deque, job);
+    } else {
+        queued = inject_push(system, job);
+    }
+    
+    if (!queued) {
+        job_execute(job);
+        return;
+    }
+    
+    job_wake_one(system);
+}
+
+// Block until counter reaches zero, executing other jobs meanwhile
+void job_system_wait(JobSystem* system, atomic_int* counter) {
+    int worker_index = (tls_system == system) ? tls_worker : -1;
+    
+    while (atomic_load_explicit(counter, memory_order_acquire) > 0) {
+        Job* job = system ? job_find_work(system, worker_index) : NULL;
+        if (job) {
+            job_execute(job);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// Parallel-for: chunks of `grain` items handed out through an atomic cursor,
+// so one job per worker is enough and stealing balances the rest
+typedef struct {
+    JobRangeFunc func;
+    void* data;
+    uint32_t count;
+    uint32_t grain;
+    uint32_t chunk_count;
+    atomic_uint next_chunk;
+} ParallelForState;
+
+static void parallel_for_job(void* arg) {
+    ParallelForState* state = (ParallelForState*)arg;
+    
+    for (;;) {
+        uint32_t chunk = atomic_fetch_add_explicit(&state->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= state->chunk_count) break;
+        
+        uint32_t begin = chunk * state->grain;
+        uint32_t end = begin + state->grain;
+        if (end > state->count) end = state->count;
+        
+        state->func(state->data, begin, end);
+    }
+}
+
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+    
+    uint32_t chunk_count = (count + grain - 1) / grain;
+    uint32_t workers = job_system_worker_count(system);
+    
+    if (workers == 1 || chunk_count == 1) {
+        func(data, 0, count);
+        return;
+    }
+    
+    ParallelForState state;
+    state.func = func;
+    state.data = data;
+    state.count = count;
+    state.grain = grain;
+    state.chunk_count = chunk_count;
+    atomic_init(&state.next_chunk, 0);
+    
+    uint32_t job_count = chunk_count < workers ? chunk_count : workers;
+    atomic_int pending;
+    atomic_init(&pending, (int)job_count - 1);
+    
+    Job jobs[JOB_MAX_WORKERS];
+    for (uint32_t i = 1; i < job_count; i++) {
+        jobs[i].func = parallel_for_job;
+        jobs[i].data = &state;
+        jobs[i].counter = &pending;
+        job_system_submit(system, &jobs[i]);
+    }
+    
+    // Caller takes a share, then helps until every helper has drained
+    parallel_for_job(&state);
+    job_system_wait(system, &pending);
+}
+
+// Job graph
+JobGraph* job_graph_create(void) {
+    JobGraph* graph = malloc(sizeof(JobGraph));
+    if (!graph) return NULL;
+    
+    memset(graph, 0, sizeof(JobGraph));
+    return graph;
+}
+
+void job_graph_destroy(JobGraph* graph) {
+    free(graph);
+}
+
+static void job_graph_node_run(void* arg) {
+    JobGraphNode* node = (JobGraphNode*)arg;
+    JobGraph* graph = node->graph;
+    
+    // One zone per frame phase, named after the node
+    ProfileZone zone = profiler_begin(node->name ? node->name : "Graph node");
+    node->func(node->data);
+    profiler_end(&zone);
+    
+    // Release successors whose last dependency this was
+    for (uint32_t i = 0; i < node->successor_count; i++) {
+        JobGraphNode* successor = &graph->nodes[node->successors[i]];
+        if (atomic_fetch_sub_explicit(&successor->pending, 1, memory_order_acq_rel) == 1) {
+            job_system_submit(graph->system, &successor->job);
+        }
+    }
+}
+
+// Add node, returns its id (or UINT32_MAX if the graph is full)
+uint32_t job_graph_add(JobGraph* graph, const char* name, JobFunc func, void* data) {
+    if (graph->node_count >= JOB_GRAPH_MAX_NODES) return UINT32_MAX;
+    
+    uint32_t id = graph->node_count++;
+    JobGraphNode* node = &graph->nodes[id];
+    
+    memset(node, 0, sizeof(JobGraphNode));
+    node->func = func;
+    node->data = data;
+    node->name = name;
+    node->graph = graph;
+    node->job.func = job_graph_node_run;
+    node->job.data = node;
+    node->job.counter = &graph->remaining;
+    
+    return id;
+}
+
+// node runs after dependency. Nodes are added in order, so requiring
+// dependency < node keeps the graph acyclic by construction.
+bool job_graph_depend(JobGraph* graph, uint32_t node, uint32_t dependency) {
+    if (node >= graph->node_count || dependency >= node) return false;
+    
+    JobGraphNode* dep = &graph->nodes[dependency];
+    if (dep->successor_count >= JOB_GRAPH_MAX_SUCCESSORS) return false;
+    
+    dep->successors[dep->successor_count++] = node;
+    graph->nodes[node].dependency_count++;
+    return true;
+}
+
+// Run every node once, respecting dependencies; returns when all are done
+void job_graph_run(JobSystem* system, JobGraph* graph) {
+    graph->system = system;
+    atomic_store(&graph->remaining, (int)graph->node_count);
+    
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        atomic_store(&graph->nodes[i].pending, (int)graph->nodes[i].dependency_count);
+    }
+    
+    for (uint32_t i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i].dependency_count == 0) {
+            job_system_submit(system, &graph->nodes[i].job);
+        }
+    }
+    
+    job_system_wait(system, &graph->remaining);
+}
+
+// Cleanup
+void job_system_destroy(JobSystem* system) {
+    if (!system) return;
+    
+    pthread_mutex_lock(&system->sleep_mutex);
+    atomic_store(&system->running, false);
+    pthread_cond_broadcast(&system->sleep_cond);
+    pthread_mutex_unlock(&system->sleep_mutex);
+    
+    for (uint32_t i = 1; i < system->worker_count; i++) {
+        pthread_join(system->workers[i].thread, NULL);
+    }
+    
+    if (tls_system == system) {
+        tls_system = NULL;
+        tls_worker = -1;
+    }
+    
+    pthread_mutex_destroy(&system->inject_mutex);
+    pthread_mutex_destroy(&system->sleep_mutex);
+    pthread_cond_destroy(&system->sleep_cond);
+    
+    free(system->workers);
+    free(system);
+    
+    printf("[JOBS] Job system stopped\n");
+}
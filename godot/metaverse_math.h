@@ -0,0 +1,452 @@
+/*******************************************************************************
+ * METAVERSE MATH
+ * Shared vector, quaternion and matrix math with SSE/AVX2/NEON batch paths
+ ******************************************************************************/
+
+#ifndef METAVERSE_MATH_H
+#define METAVERSE_MATH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define MV_SSE 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MV_NEON 1
+#endif
+
+// Everything here is static inline and reentrant: results are returned by
+// value, never through static storage.
+//
+// Vec3 is three packed floats, so it overlays the float[3] arrays used by
+// audio and tracking code. Vec4, Quat (x, y, z, w) and Mat4 (column-major,
+// as OpenGL expects) are 16-byte aligned and map onto one SIMD register per
+// vector or column. Single-vector helpers are scalar where a register round
+// trip would cost more than it saves; the _batch functions process arrays
+// four elements at a time (SSE, fused multiply-add when the build enables FMA
+// as AVX2 targets do, or NEON)
+// and finish the tail in scalar code.
+#define MV_NORMALIZE_EPSILON 0.0001f   // Shorter vectors are left unchanged
+#define MV_SLERP_LINEAR      0.9995f   // Above this |cos|, slerp falls back to nlerp
+
+typedef struct {
+    float x, y, z;
+} Vec3;
+
+typedef union {
+    struct { float x, y, z, w; };
+    float v[4];
+#if defined(MV_SSE)
+    __m128 m;
+#elif defined(MV_NEON)
+    float32x4_t m;
+#endif
+} __attribute__((aligned(16))) Vec4;
+
+typedef Vec4 Quat;
+
+typedef union {
+    float m[16];
+    Vec4 col[4];
+} Mat4;
+
+// Vec3
+static inline Vec3 vec3(float x, float y, float z) {
+    return (Vec3){ x, y, z };
+}
+
+static inline Vec3 vec3_load(const float* p) {
+    return (Vec3){ p[0], p[1], p[2] };
+}
+
+static inline void vec3_store(float* p, Vec3 v) {
+    p[0] = v.x;
+    p[1] = v.y;
+    p[2] = v.z;
+}
+
+static inline Vec3 vec3_add(Vec3 a, Vec3 b) {
+    return (Vec3){ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+static inline Vec3 vec3_sub(Vec3 a, Vec3 b) {
+    return (Vec3){ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static inline Vec3 vec3_scale(Vec3 v, float s) {
+    return (Vec3){ v.x * s, v.y * s, v.z * s };
+}
+
+static inline float vec3_dot(Vec3 a, Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline Vec3 vec3_cross(Vec3 a, Vec3 b) {
+    return (Vec3){ a.y * b.z - a.z * b.y,
+                   a.z * b.x - a.x * b.z,
+                   a.x * b.y - a.y * b.x };
+}
+
+static inline float vec3_length(Vec3 v) {
+    return sqrtf(vec3_dot(v, v));
+}
+
+static inline float vec3_distance(Vec3 a, Vec3 b) {
+    return vec3_length(vec3_sub(a, b));
+}
+
+static inline Vec3 vec3_normalize(Vec3 v) {
+    float length = vec3_length(v);
+    return length > MV_NORMALIZE_EPSILON ? vec3_scale(v, 1.0f / length) : v;
+}
+
+// Vec4
+static inline Vec4 vec4(float x, float y, float z, float w) {
+    Vec4 r;
+#if defined(MV_SSE)
+    r.m = _mm_setr_ps(x, y, z, w);
+#else
+    r.x = x; r.y = y; r.z = z; r.w = w;
+#endif
+    return r;
+}
+
+// Unaligned load/store, e.g. from the engine's Vector4
+static inline Vec4 vec4_load(const float* p) {
+    Vec4 r;
+#if defined(MV_SSE)
+    r.m = _mm_loadu_ps(p);
+#elif defined(MV_NEON)
+    r.m = vld1q_f32(p);
+#else
+    r.x = p[0]; r.y = p[1]; r.z = p[2]; r.w = p[3];
+#endif
+    return r;
+}
+
+static inline void vec4_store(float* p, Vec4 v) {
+#if defined(MV_SSE)
+    _mm_storeu_ps(p, v.m);
+#elif defined(MV_NEON)
+    vst1q_f32(p, v.m);
+#else
+    p[0] = v.x; p[1] = v.y; p[2] = v.z; p[3] = v.w;
+#endif
+}
+
+static inline Vec4 vec4_add(Vec4 a, Vec4 b) {
+#if defined(MV_SSE)
+    a.m = _mm_add_ps(a.m, b.m);
+#elif defined(MV_NEON)
+    a.m = vaddq_f32(a.m, b.m);
+#else
+    a.x += b.x; a.y += b.y; a.z += b.z; a.w += b.w;
+#endif
+    return a;
+}
+
+static inline Vec4 vec4_sub(Vec4 a, Vec4 b) {
+#if defined(MV_SSE)
+    a.m = _mm_sub_ps(a.m, b.m);
+#elif defined(MV_NEON)
+    a.m = vsubq_f32(a.m, b.m);
+#else
+    a.x -= b.x; a.y -= b.y; a.z -= b.z; a.w -= b.w;
+#endif
+    return a;
+}
+
+static inline Vec4 vec4_scale(Vec4 v, float s) {
+#if defined(MV_SSE)
+    v.m = _mm_mul_ps(v.m, _mm_set1_ps(s));
+#elif defined(MV_NEON)
+    v.m = vmulq_n_f32(v.m, s);
+#else
+    v.x *= s; v.y *= s; v.z *= s; v.w *= s;
+#endif
+    return v;
+}
+
+// a + b * s
+static inline Vec4 vec4_madd(Vec4 a, Vec4 b, float s) {
+#if defined(MV_SSE) && defined(__FMA__)
+    a.m = _mm_fmadd_ps(b.m, _mm_set1_ps(s), a.m);
+#elif defined(MV_SSE)
+    a.m = _mm_add_ps(a.m, _mm_mul_ps(b.m, _mm_set1_ps(s)));
+#elif defined(MV_NEON)
+    a.m = vmlaq_n_f32(a.m, b.m, s);
+#else
+    a.x += b.x * s; a.y += b.y * s; a.z += b.z * s; a.w += b.w * s;
+#endif
+    return a;
+}
+
+static inline float vec4_dot(Vec4 a, Vec4 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+// Quat
+static inline Quat quat_identity(void) {
+    return vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+static inline Quat quat_from_axis_angle(Vec3 axis, float angle) {
+    Vec3 n = vec3_normalize(axis);
+    float s = sinf(angle * 0.5f);
+    return vec4(n.x * s, n.y * s, n.z * s, cosf(angle * 0.5f));
+}
+
+static inline Quat quat_conjugate(Quat q) {
+    return vec4(-q.x, -q.y, -q.z, q.w);
+}
+
+static inline Quat quat_normalize(Quat q) {
+    float length = sqrtf(vec4_dot(q, q));
+    return length > MV_NORMALIZE_EPSILON ? vec4_scale(q, 1.0f / length) : quat_identity();
+}
+
+// a * b: rotation b, then a
+static inline Quat quat_mul(Quat a, Quat b) {
+    return vec4(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+// v' = v + 2w(q x v) + 2q x (q x v), for unit q
+static inline Vec3 quat_rotate(Quat q, Vec3 v) {
+    Vec3 u = { q.x, q.y, q.z };
+    Vec3 t = vec3_scale(vec3_cross(u, v), 2.0f);
+    return vec3_add(vec3_add(v, vec3_scale(t, q.w)), vec3_cross(u, t));
+}
+
+// Interpolation weights for slerp from a to b (b already on a's hemisphere)
+static inline void quat_slerp_weights(float cos_theta, float t, float* wa, float* wb) {
+    if (cos_theta > MV_SLERP_LINEAR) {
+        *wa = 1.0f - t;
+        *wb = t;
+        return;
+    }
+    float theta = acosf(cos_theta);
+    float inv_sin = 1.0f / sinf(theta);
+    *wa = sinf((1.0f - t) * theta) * inv_sin;
+    *wb = sinf(t * theta) * inv_sin;
+}
+
+// Shortest-path slerp; the result is renormalised
+static inline Quat quat_slerp(Quat a, Quat b, float t) {
+    float cos_theta = vec4_dot(a, b);
+    if (cos_theta < 0.0f) {
+        b = vec4_scale(b, -1.0f);
+        cos_theta = -cos_theta;
+    }
+
+    float wa, wb;
+    quat_slerp_weights(cos_theta, t, &wa, &wb);
+    return quat_normalize(vec4_madd(vec4_scale(a, wa), b, wb));
+}
+
+// Mat4
+static inline Mat4 mat4_identity(void) {
+    Mat4 r;
+    r.col[0] = vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    r.col[1] = vec4(0.0f, 1.0f, 0.0f, 0.0f);
+    r.col[2] = vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    r.col[3] = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return r;
+}
+
+// Linear combination of a's columns weighted by v
+static inline Vec4 mat4_mul_vec4(const Mat4* a, Vec4 v) {
+    Vec4 r = vec4_scale(a->col[0], v.x);
+    r = vec4_madd(r, a->col[1], v.y);
+    r = vec4_madd(r, a->col[2], v.z);
+    return vec4_madd(r, a->col[3], v.w);
+}
+
+static inline Mat4 mat4_mul(const Mat4* a, const Mat4* b) {
+    Mat4 r;
+    for (int c = 0; c < 4; c++) {
+        r.col[c] = mat4_mul_vec4(a, b->col[c]);
+    }
+    return r;
+}
+
+// Translation * rotation * scale
+static inline Mat4 mat4_from_trs(Vec3 translation, Quat rotation, Vec3 scale) {
+    float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+    Mat4 r;
+    r.col[0] = vec4((1.0f - 2.0f * (y * y + z * z)) * scale.x,
+                    (2.0f * (x * y + w * z)) * scale.x,
+                    (2.0f * (x * z - w * y)) * scale.x, 0.0f);
+    r.col[1] = vec4((2.0f * (x * y - w * z)) * scale.y,
+                    (1.0f - 2.0f * (x * x + z * z)) * scale.y,
+                    (2.0f * (y * z + w * x)) * scale.y, 0.0f);
+    r.col[2] = vec4((2.0f * (x * z + w * y)) * scale.z,
+                    (2.0f * (y * z - w * x)) * scale.z,
+                    (1.0f - 2.0f * (x * x + y * y)) * scale.z, 0.0f);
+    r.col[3] = vec4(translation.x, translation.y, translation.z, 1.0f);
+    return r;
+}
+
+static inline Vec3 mat4_transform_point(const Mat4* m, Vec3 p) {
+    Vec4 r = mat4_mul_vec4(m, vec4(p.x, p.y, p.z, 1.0f));
+    return (Vec3){ r.x, r.y, r.z };
+}
+
+static inline void mat4_store(float* out, const Mat4* m) {
+    for (int c = 0; c < 4; c++) {
+        vec4_store(out + 4 * c, m->col[c]);
+    }
+}
+
+// Batch operations
+#if defined(MV_SSE)
+// acc + a * b, fused (one rounding) when the build enables FMA
+static inline __m128 mv_madd_ps(__m128 acc, __m128 a, __m128 b) {
+#if defined(__FMA__)
+    return _mm_fmadd_ps(a, b, acc);
+#else
+    return _mm_add_ps(acc, _mm_mul_ps(a, b));
+#endif
+}
+#endif
+
+// Transform count points by m (w = 1); in and out may alias
+static inline void mv_transform_points(const Mat4* m, const Vec3* in, Vec3* out, size_t count) {
+    size_t i = 0;
+#if defined(MV_SSE)
+    // Four points per step: deinterleave xyz, then three column FMAs per lane set
+    for (; i + 4 <= count; i += 4) {
+        const float* p = &in[i].x;
+        __m128 a = _mm_loadu_ps(p);         // x0 y0 z0 x1
+        __m128 b = _mm_loadu_ps(p + 4);     // y1 z1 x2 y2
+        __m128 c = _mm_loadu_ps(p + 8);     // z2 x3 y3 z3
+        __m128 x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                  _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+        float result[3][4];
+        for (int r = 0; r < 3; r++) {
+            __m128 acc = _mm_set1_ps(m->m[12 + r]);
+            acc = mv_madd_ps(acc, x, _mm_set1_ps(m->m[r]));
+            acc = mv_madd_ps(acc, y, _mm_set1_ps(m->m[4 + r]));
+            acc = mv_madd_ps(acc, z, _mm_set1_ps(m->m[8 + r]));
+            _mm_storeu_ps(result[r], acc);
+        }
+        for (int k = 0; k < 4; k++) {
+            out[i + k] = (Vec3){ result[0][k], result[1][k], result[2][k] };
+        }
+    }
+#elif defined(MV_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x4x3_t p = vld3q_f32(&in[i].x);
+        float32x4x3_t r;
+        for (int k = 0; k < 3; k++) {
+            float32x4_t acc = vdupq_n_f32(m->m[12 + k]);
+            acc = vmlaq_n_f32(acc, p.val[0], m->m[k]);
+            acc = vmlaq_n_f32(acc, p.val[1], m->m[4 + k]);
+            acc = vmlaq_n_f32(acc, p.val[2], m->m[8 + k]);
+            r.val[k] = acc;
+        }
+        vst3q_f32(&out[i].x, r);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = mat4_transform_point(m, in[i]);
+    }
+}
+
+// Normalize count vectors in place (vectors shorter than the epsilon are
+// left as they are, matching vec3_normalize)
+static inline void mv_normalize_batch(Vec3* v, size_t count) {
+    size_t i = 0;
+#if defined(MV_SSE)
+    const __m128 epsilon = _mm_set1_ps(MV_NORMALIZE_EPSILON);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        float* p = &v[i].x;
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                  _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+        __m128 length = _mm_sqrt_ps(mv_madd_ps(mv_madd_ps(_mm_mul_ps(x, x), y, y), z, z));
+        __m128 valid = _mm_cmpgt_ps(length, epsilon);
+        __m128 scale = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, length)),
+                                 _mm_andnot_ps(valid, one));
+
+        // Scale the interleaved registers directly: (s0 s0 s0 s1) (s1 s1 s2 s2) (s2 s3 s3 s3)
+        _mm_storeu_ps(p, _mm_mul_ps(a, _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(1, 0, 0, 0))));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(b, _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(2, 2, 1, 1))));
+        _mm_storeu_ps(p + 8, _mm_mul_ps(c, _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(3, 3, 3, 2))));
+    }
+#elif defined(MV_NEON)
+    const float32x4_t epsilon = vdupq_n_f32(MV_NORMALIZE_EPSILON);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        float32x4x3_t p = vld3q_f32(&v[i].x);
+        float32x4_t length_sq = vmulq_f32(p.val[0], p.val[0]);
+        length_sq = vmlaq_f32(length_sq, p.val[1], p.val[1]);
+        length_sq = vmlaq_f32(length_sq, p.val[2], p.val[2]);
+        float32x4_t length = vsqrtq_f32(length_sq);
+        float32x4_t scale = vbslq_f32(vcgtq_f32(length, epsilon), vdivq_f32(one, length), one);
+        for (int k = 0; k < 3; k++) {
+            p.val[k] = vmulq_f32(p.val[k], scale);
+        }
+        vst3q_f32(&v[i].x, p);
+    }
+#endif
+    for (; i < count; i++) {
+        v[i] = vec3_normalize(v[i]);
+    }
+}
+
+// out[i] = slerp(a[i], b[i], t[i]). Weights need acos/sin per element and
+// are computed in scalar code; the blend and renormalisation are vectorized.
+static inline void mv_slerp_batch(const Quat* a, const Quat* b, const float* t,
+                                  Quat* out, size_t count) {
+    size_t i = 0;
+#if defined(MV_SSE) || defined(MV_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float wa[4], wb[4];
+        for (int k = 0; k < 4; k++) {
+            float cos_theta = vec4_dot(a[i + k], b[i + k]);
+            float sign = cos_theta < 0.0f ? -1.0f : 1.0f;
+            quat_slerp_weights(cos_theta * sign, t[i + k], &wa[k], &wb[k]);
+            wb[k] *= sign;  // Shortest path: blend towards -b
+        }
+        for (int k = 0; k < 4; k++) {
+            Vec4 q = vec4_madd(vec4_scale(a[i + k], wa[k]), b[i + k], wb[k]);
+#if defined(MV_SSE)
+            __m128 length_sq = _mm_mul_ps(q.m, q.m);
+            length_sq = _mm_add_ps(length_sq, _mm_shuffle_ps(length_sq, length_sq, _MM_SHUFFLE(2, 3, 0, 1)));
+            length_sq = _mm_add_ps(length_sq, _mm_shuffle_ps(length_sq, length_sq, _MM_SHUFFLE(1, 0, 3, 2)));
+            out[i + k].m = _mm_div_ps(q.m, _mm_sqrt_ps(length_sq));
+#else
+            float32x4_t length_sq = vmulq_f32(q.m, q.m);
+            float32x2_t sum = vpadd_f32(vget_low_f32(length_sq), vget_high_f32(length_sq));
+            sum = vpadd_f32(sum, sum);
+            out[i + k].m = vdivq_f32(q.m, vdupq_lane_f32(vsqrt_f32(sum), 0));
+#endif
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = quat_slerp(a[i], b[i], t[i]);
+    }
+}
+
+#endif // METAVERSE_MATH_H
@@ -0,0 +1,1081 @@
+/*******************************************************************************
+ * METAVERSE MESH PROCESSING
+ * Quadric-error simplification, LOD chains and vertex cache optimization
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+// Mesh layout (shared with godot_metaverse_core.c)
+typedef struct MeshData {
+    float* vertex_data;
+    float* normal_data;
+    float* uv_data;
+    uint32_t* index_data;       // NULL for unindexed triangle lists
+    uint32_t index_count;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    uint32_t lod_level;
+    float lod_error;            // Simplification error relative to the mesh extent
+    struct MeshData* next_lod;  // Next coarser level, or NULL
+    bool dynamic;
+    bool compressed;
+} MeshData;
+
+// Job system (metaverse_jobs.c)
+typedef struct JobSystem JobSystem;
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+
+// Simplifier attributes: position xyz, normal xyz, uv. Positions are scaled
+// to the unit box so the attribute weights mean the same for every mesh.
+#define MESH_ATTR_DIM         8
+#define MESH_QUADRIC_TERMS    36      // Upper triangle of an 8x8 matrix
+#define MESH_NORMAL_WEIGHT    0.5f
+#define MESH_UV_WEIGHT        1.0f
+#define MESH_BOUNDARY_WEIGHT  10.0    // Keeps open borders and UV/normal seams in place
+#define MESH_FLIP_THRESHOLD   0.2f    // Min cosine between a face normal before/after collapse
+#define MESH_CACHE_SIZE       32      // Post-transform cache size assumed by the optimizer
+
+// Generalized quadric (Garland & Heckbert 1998): error(x) = x'Ax + 2b'x + c
+typedef struct {
+    double a[MESH_QUADRIC_TERMS];
+    double b[MESH_ATTR_DIM];
+    double c;
+} Quadric;
+
+typedef struct {
+    double cost;
+    uint32_t from;              // Vertex removed
+    uint32_t to;                // Vertex kept
+    uint32_t from_version;
+    uint32_t to_version;
+} EdgeCollapse;
+
+typedef struct {
+    // Source attributes (welded), used for output
+    const float* positions;
+    const float* normals;       // May be NULL
+    const float* uvs;           // May be NULL
+    float* owned;               // Welded attribute storage, if any
+    uint32_t vertex_count;
+    
+    // Normalized attributes and error quadrics
+    float* attr;
+    Quadric* quadrics;
+    
+    // Triangles; collapsed vertices are rewritten in place
+    uint32_t* indices;
+    uint32_t triangle_count;
+    uint32_t alive_triangles;
+    uint32_t alive_vertices;
+    bool* tri_dead;
+    
+    // Vertex state and vertex -> triangle adjacency
+    bool* vert_dead;
+    uint32_t* version;
+    uint32_t** vert_tris;
+    uint32_t* vert_tri_count;
+    uint32_t* vert_tri_capacity;
+    uint32_t* mark;
+    uint32_t mark_stamp;
+    
+    // Collapse candidates (binary min-heap, stale entries dropped on pop)
+    EdgeCollapse* heap;
+    uint32_t heap_count;
+    uint32_t heap_capacity;
+    
+    float max_error;
+} MeshSimplifier;
+
+// Function prototypes
+MeshData* metaverse_mesh_optimize(MeshData* mesh, int target_vertices);
+MeshData* metaverse_mesh_build_lods(const MeshData* mesh, uint32_t lod_count, float reduction);
+void metaverse_mesh_build_lods_batch(JobSystem* jobs, MeshData** meshes, MeshData** chains,
+                                     uint32_t count, uint32_t lod_count, float reduction);
+void metaverse_mesh_optimize_vertex_cache(uint32_t* indices, uint32_t index_count,
+                                          uint32_t vertex_count);
+void metaverse_mesh_free(MeshData* mesh);
+
+// Quadric helpers
+static uint8_t quadric_term[MESH_ATTR_DIM][MESH_ATTR_DIM];
+static pthread_once_t quadric_terms_once = PTHREAD_ONCE_INIT;
+
+static void quadric_init_terms(void) {
+    uint8_t t = 0;
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        for (int j = i; j < MESH_ATTR_DIM; j++) {
+            quadric_term[i][j] = t;
+            quadric_term[j][i] = t;
+            t++;
+        }
+    }
+}
+
+static void quadric_add(Quadric* q, const Quadric* other) {
+    for (int i = 0; i < MESH_QUADRIC_TERMS; i++) q->a[i] += other->a[i];
+    for (int i = 0; i < MESH_ATTR_DIM; i++) q->b[i] += other->b[i];
+    q->c += other->c;
+}
+
+static double quadric_error(const Quadric* q, const float* x) {
+    double error = q->c;
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        double xi = x[i];
+        error += 2.0 * q->b[i] * xi + q->a[quadric_term[i][i]] * xi * xi;
+        for (int j = i + 1; j < MESH_ATTR_DIM; j++) {
+            error += 2.0 * q->a[quadric_term[i][j]] * xi * x[j];
+        }
+    }
+    return error > 0.0 ? error : 0.0;
+}
+
+// Quadric of the 2D plane through three attribute-space points, area weighted
+static void quadric_from_triangle(Quadric* q, const float* p, const float* v1, const float* v2,
+                                  double weight) {
+    double e1[MESH_ATTR_DIM], e2[MESH_ATTR_DIM];
+    double len1 = 0.0, dot = 0.0, len2 = 0.0;
+    
+    memset(q, 0, sizeof(Quadric));
+    
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        e1[i] = (double)v1[i] - p[i];
+        len1 += e1[i] * e1[i];
+    }
+    if (len1 <= 1e-24) return;
+    len1 = sqrt(len1);
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        e1[i] /= len1;
+        e2[i] = (double)v2[i] - p[i];
+        dot += e1[i] * e2[i];
+    }
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        e2[i] -= dot * e1[i];
+        len2 += e2[i] * e2[i];
+    }
+    if (len2 <= 1e-24) return;
+    len2 = sqrt(len2);
+    
+    double pe1 = 0.0, pe2 = 0.0, pp = 0.0;
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        e2[i] /= len2;
+        pe1 += p[i] * e1[i];
+        pe2 += p[i] * e2[i];
+        pp += (double)p[i] * p[i];
+    }
+    
+    for (int i = 0; i < MESH_ATTR_DIM; i++) {
+        for (int j = i; j < MESH_ATTR_DIM; j++) {
+            double a = (i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j];
+            q->a[quadric_term[i][j]] = a * weight;
+        }
+        q->b[i] = (pe1 * e1[i] + pe2 * e2[i] - p[i]) * weight;
+    }
+    q->c = (pp - pe1 * pe1 - pe2 * pe2) * weight;
+}
+
+// Position-only plane quadric: n'x + d = 0
+static void quadric_add_plane(Quadric* q, const float* n, float d, double weight) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            q->a[quadric_term[i][j]] += (double)n[i] * n[j] * weight;
+        }
+        q->b[i] += (double)n[i] * d * weight;
+    }
+    q->c += (double)d * d * weight;
+}
+
+static void face_normal(const float* a, const float* b, const float* c, float* n) {
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Welding
+// Unindexed meshes are welded on exact attribute equality, so UV and normal
+// seams stay split and are preserved as borders.
+static inline uint32_t weld_hash(const float* key) {
+    uint32_t h = 2166136261u;
+    const uint8_t* bytes = (const uint8_t*)key;
+    for (size_t i = 0; i < MESH_ATTR_DIM * sizeof(float); i++) {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    return h;
+}
+
+static bool mesh_weld(MeshSimplifier* s, const MeshData* mesh) {
+    uint32_t count = mesh->vertex_count;
+    uint32_t table_size = 64;
+    while (table_size < count * 2) table_size *= 2;
+    
+    uint32_t* table = malloc(sizeof(uint32_t) * table_size);
+    float* keys = malloc(sizeof(float) * MESH_ATTR_DIM * count);
+    s->owned = malloc(sizeof(float) * 8 * count);
+    s->indices = malloc(sizeof(uint32_t) * count);
+    if (!table || !keys || !s->owned || !s->indices) {
+        free(table);
+        free(keys);
+        return false;
+    }
+    memset(table, 0xFF, sizeof(uint32_t) * table_size);
+    
+    float* positions = s->owned;
+    float* normals = s->owned + 3 * count;
+    float* uvs = s->owned + 6 * count;
+    uint32_t unique = 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        float key[MESH_ATTR_DIM] = {0};
+        memcpy(key, &mesh->vertex_data[i * 3], 3 * sizeof(float));
+        if (mesh->normal_data) memcpy(key + 3, &mesh->normal_data[i * 3], 3 * sizeof(float));
+        if (mesh->uv_data) memcpy(key + 6, &mesh->uv_data[i * 2], 2 * sizeof(float));
+        
+        uint32_t bucket = weld_hash(key) & (table_size - 1);
+        while (table[bucket] != UINT32_MAX &&
+               memcmp(&keys[table[bucket] * MESH_ATTR_DIM], key, sizeof(key)) != 0) {
+            bucket = (bucket + 1) & (table_size - 1);
+        }
+        
+        if (table[bucket] == UINT32_MAX) {
+            table[bucket] = unique;
+            memcpy(&keys[unique * MESH_ATTR_DIM], key, sizeof(key));
+            memcpy(&positions[unique * 3], key, 3 * sizeof(float));
+            memcpy(&normals[unique * 3], key + 3, 3 * sizeof(float));
+            memcpy(&uvs[unique * 2], key + 6, 2 * sizeof(float));
+            unique++;
+        }
+        s->indices[i] = table[bucket];
+    }
+    
+    free(table);
+    free(keys);
+    
+    // Compact the three streams into the front of the allocation
+    memmove(s->owned + 3 * unique, normals, sizeof(float) * 3 * unique);
+    memmove(s->owned + 6 * unique, uvs, sizeof(float) * 2 * unique);
+    s->positions = s->owned;
+    s->normals = mesh->normal_data ? s->owned + 3 * unique : NULL;
+    s->uvs = mesh->uv_data ? s->owned + 6 * unique : NULL;
+    s->vertex_count = unique;
+    s->triangle_count = count / 3;
+    return true;
+}
+
+// Simplifier setup
+static void simplifier_free(MeshSimplifier* s) {
+    if (s->vert_tris) {
+        for (uint32_t v = 0; v < s->vertex_count; v++) free(s->vert_tris[v]);
+    }
+    free(s->owned);
+    free(s->attr);
+    free(s->quadrics);
+    free(s->indices);
+    free(s->tri_dead);
+    free(s->vert_dead);
+    free(s->version);
+    free(s->vert_tris);
+    free(s->vert_tri_count);
+    free(s->vert_tri_capacity);
+    free(s->mark);
+    free(s->heap);
+    memset(s, 0, sizeof(MeshSimplifier));
+}
+
+static bool vert_tri_push(MeshSimplifier* s, uint32_t v, uint32_t t) {
+    if (s->vert_tri_count[v] == s->vert_tri_capacity[v]) {
+        uint32_t capacity = s->vert_tri_capacity[v] ? s->vert_tri_capacity[v] * 2 : 8;
+        uint32_t* tris = realloc(s->vert_tris[v], sizeof(uint32_t) * capacity);
+        if (!tris) return false;
+        s->vert_tris[v] = tris;
+        s->vert_tri_capacity[v] = capacity;
+    }
+    s->vert_tris[v][s->vert_tri_count[v]++] = t;
+    return true;
+}
+
+static bool heap_push(MeshSimplifier* s, EdgeCollapse collapse) {
+    if (s->heap_count == s->heap_capacity) {
+        uint32_t capacity = s->heap_capacity ? s->heap_capacity * 2 : 1024;
+        EdgeCollapse* heap = realloc(s->heap, sizeof(EdgeCollapse) * capacity);
+        if (!heap) return false;
+        s->heap = heap;
+        s->heap_capacity = capacity;
+    }
+    
+    uint32_t i = s->heap_count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (s->heap[parent].cost <= collapse.cost) break;
+        s->heap[i] = s->heap[parent];
+        i = parent;
+    }
+    s->heap[i] = collapse;
+    return true;
+}
+
+static EdgeCollapse heap_pop(MeshSimplifier* s) {
+    EdgeCollapse top = s->heap[0];
+    EdgeCollapse last = s->heap[--s->heap_count];
+    
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= s->heap_count) break;
+        if (child + 1 < s->heap_count && s->heap[child + 1].cost < s->heap[child].cost) child++;
+        if (last.cost <= s->heap[child].cost) break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    if (s->heap_count > 0) s->heap[i] = last;
+    return top;
+}
+
+// Queue the cheaper direction of edge (a, b)
+static bool push_edge(MeshSimplifier* s, uint32_t a, uint32_t b) {
+    const float* xa = &s->attr[a * MESH_ATTR_DIM];
+    const float* xb = &s->attr[b * MESH_ATTR_DIM];
+    
+    double cost_ab = quadric_error(&s->quadrics[a], xb) + quadric_error(&s->quadrics[b], xb);
+    double cost_ba = quadric_error(&s->quadrics[a], xa) + quadric_error(&s->quadrics[b], xa);
+    
+    EdgeCollapse collapse;
+    if (cost_ab <= cost_ba) {
+        collapse.cost = cost_ab; collapse.from = a; collapse.to = b;
+    } else {
+        collapse.cost = cost_ba; collapse.from = b; collapse.to = a;
+    }
+    collapse.from_version = s->version[collapse.from];
+    collapse.to_version = s->version[collapse.to];
+    return heap_push(s, collapse);
+}
+
+static int compare_edge_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static bool simplifier_init(MeshSimplifier* s, const MeshData* mesh) {
+    memset(s, 0, sizeof(MeshSimplifier));
+    
+    if (mesh->index_data) {
+        s->positions = mesh->vertex_data;
+        s->normals = mesh->normal_data;
+        s->uvs = mesh->uv_data;
+        s->vertex_count = mesh->vertex_count;
+        s->triangle_count = mesh->index_count / 3;
+        s->indices = malloc(sizeof(uint32_t) * s->triangle_count * 3);
+        if (!s->indices) return false;
+        memcpy(s->indices, mesh->index_data, sizeof(uint32_t) * s->triangle_count * 3);
+    } else if (!mesh_weld(s, mesh)) {
+        simplifier_free(s);
+        return false;
+    }
+    
+    uint32_t vc = s->vertex_count;
+    uint32_t tc = s->triangle_count;
+    
+    s->attr = malloc(sizeof(float) * MESH_ATTR_DIM * vc);
+    s->quadrics = calloc(vc, sizeof(Quadric));
+    s->tri_dead = calloc(tc, sizeof(bool));
+    s->vert_dead = calloc(vc, sizeof(bool));
+    s->version = calloc(vc, sizeof(uint32_t));
+    s->vert_tris = calloc(vc, sizeof(uint32_t*));
+    s->vert_tri_count = calloc(vc, sizeof(uint32_t));
+    s->vert_tri_capacity = calloc(vc, sizeof(uint32_t));
+    s->mark = calloc(vc, sizeof(uint32_t));
+    uint64_t* edges = malloc(sizeof(uint64_t) * tc * 3);
+    
+    if (!s->attr || !s->quadrics || !s->tri_dead || !s->vert_dead || !s->version ||
+        !s->vert_tris || !s->vert_tri_count || !s->vert_tri_capacity || !s->mark || !edges) {
+        free(edges);
+        simplifier_free(s);
+        return false;
+    }
+    s->mark_stamp = 1;
+    
+    // Normalize positions to the unit box
+    float lo[3] = {INFINITY, INFINITY, INFINITY}, hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t v = 0; v < vc; v++) {
+        for (int k = 0; k < 3; k++) {
+            float x = s->positions[v * 3 + k];
+            if (x < lo[k]) lo[k] = x;
+            if (x > hi[k]) hi[k] = x;
+        }
+    }
+    float extent = fmaxf(hi[0] - lo[0], fmaxf(hi[1] - lo[1], hi[2] - lo[2]));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    
+    for (uint32_t v = 0; v < vc; v++) {
+        float* x = &s->attr[v * MESH_ATTR_DIM];
+        for (int k = 0; k < 3; k++) {
+            x[k] = (s->positions[v * 3 + k] - lo[k]) * scale;
+            x[3 + k] = s->normals ? s->normals[v * 3 + k] * MESH_NORMAL_WEIGHT : 0.0f;
+        }
+        x[6] = s->uvs ? s->uvs[v * 2] * MESH_UV_WEIGHT : 0.0f;
+        x[7] = s->uvs ? s->uvs[v * 2 + 1] * MESH_UV_WEIGHT : 0.0f;
+    }
+    
+    // Face quadrics and adjacency
+    uint32_t edge_count = 0;
+    for (uint32_t t = 0; t < tc; t++) {
+        uint32_t* tri = &s->indices[t * 3];
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2] ||
+            tri[0] >= vc || tri[1] >= vc || tri[2] >= vc) {
+            s->tri_dead[t] = true;
+            continue;
+        }
+        s->alive_triangles++;
+        
+        const float* p0 = &s->attr[tri[0] * MESH_ATTR_DIM];
+        const float* p1 = &s->attr[tri[1] * MESH_ATTR_DIM];
+        const float* p2 = &s->attr[tri[2] * MESH_ATTR_DIM];
+        float n[3];
+        face_normal(p0, p1, p2, n);
+        double area = 0.5 * sqrt((double)n[0]*n[0] + (double)n[1]*n[1] + (double)n[2]*n[2]);
+        
+        Quadric q;
+        quadric_from_triangle(&q, p0, p1, p2, area);
+        
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = tri[k], b = tri[(k + 1) % 3];
+            quadric_add(&s->quadrics[a], &q);
+            if (!vert_tri_push(s, a, t)) {
+                free(edges);
+                simplifier_free(s);
+                return false;
+            }
+            // Undirected edge key, one entry per triangle side
+            uint64_t lo_v = a < b ? a : b, hi_v = a < b ? b : a;
+            edges[edge_count++] = (lo_v << 32) | hi_v;
+        }
+    }
+    
+    // Border edges (used by one triangle) get a perpendicular plane quadric
+    qsort(edges, edge_count, sizeof(uint64_t), compare_edge_keys);
+    for (uint32_t t = 0; t < tc; t++) {
+        if (s->tri_dead[t]) continue;
+        uint32_t* tri = &s->indices[t * 3];
+        const float* p[3] = {&s->attr[tri[0] * MESH_ATTR_DIM], &s->attr[tri[1] * MESH_ATTR_DIM],
+                             &s->attr[tri[2] * MESH_ATTR_DIM]};
+        float n[3];
+        face_normal(p[0], p[1], p[2], n);
+        
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = tri[k], b = tri[(k + 1) % 3];
+            uint64_t lo_v = a < b ? a : b, hi_v = a < b ? b : a;
+            uint64_t key = (lo_v << 32) | hi_v;
+            uint64_t* found = bsearch(&key, edges, edge_count, sizeof(uint64_t), compare_edge_keys);
+            
+            bool shared = (found > edges && found[-1] == key) ||
+                          (found + 1 < edges + edge_count && found[1] == key);
+            if (shared) continue;
+            
+            const float* pa = p[k];
+            const float* pb = p[(k + 1) % 3];
+            float e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            float m[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0]};
+            float len = sqrtf(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+            if (len <= 0.0f) continue;
+            m[0] /= len; m[1] /= len; m[2] /= len;
+            
+            float d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+            double weight = MESH_BOUNDARY_WEIGHT * (e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+            quadric_add_plane(&s->quadrics[a], m, d, weight);
+            quadric_add_plane(&s->quadrics[b], m, d, weight);
+        }
+    }
+    
+    // Count referenced vertices, then seed the heap with every unique edge
+    for (uint32_t v = 0; v < vc; v++) {
+        if (s->vert_tri_count[v] > 0) s->alive_vertices++;
+        else s->vert_dead[v] = true;
+    }
+    for (uint32_t i = 0; i < edge_count; i++) {
+        if (i > 0 && edges[i] == edges[i - 1]) continue;
+        if (!push_edge(s, (uint32_t)(edges[i] >> 32), (uint32_t)edges[i])) {
+            free(edges);
+            simplifier_free(s);
+            return false;
+        }
+    }
+    
+    free(edges);
+    return true;
+}
+
+// Collapse
+static bool collapse_is_valid(MeshSimplifier* s, uint32_t from, uint32_t to) {
+    const float* p_to = &s->attr[to * MESH_ATTR_DIM];
+    uint32_t shared_tris = 0;
+    
+    // No face around `from` may flip or degenerate
+    for (uint32_t i = 0; i < s->vert_tri_count[from]; i++) {
+        uint32_t t = s->vert_tris[from][i];
+        if (s->tri_dead[t]) continue;
+        
+        uint32_t* tri = &s->indices[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            shared_tris++;
+            continue;
+        }
+        
+        const float* p[3];
+        const float* q[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = &s->attr[tri[k] * MESH_ATTR_DIM];
+            q[k] = tri[k] == from ? p_to : p[k];
+        }
+        float n0[3], n1[3];
+        face_normal(p[0], p[1], p[2], n0);
+        face_normal(q[0], q[1], q[2], n1);
+        
+        float dot = n0[0]*n1[0] + n0[1]*n1[1] + n0[2]*n1[2];
+        float len0 = sqrtf(n0[0]*n0[0] + n0[1]*n0[1] + n0[2]*n0[2]);
+        float len1 = sqrtf(n1[0]*n1[0] + n1[1]*n1[1] + n1[2]*n1[2]);
+        if (len1 <= 1e-12f || dot < MESH_FLIP_THRESHOLD * len0 * len1) return false;
+    }
+    
+    // Link condition: the endpoints may only share the vertices opposite the
+    // collapsed edge, otherwise the collapse pinches the surface
+    uint32_t stamp = s->mark_stamp;
+    s->mark_stamp += 2;
+    
+    for (uint32_t i = 0; i < s->vert_tri_count[from]; i++) {
+        uint32_t t = s->vert_tris[from][i];
+        if (s->tri_dead[t]) continue;
+        for (int k = 0; k < 3; k++) s->mark[s->indices[t * 3 + k]] = stamp;
+    }
+    
+    uint32_t shared_verts = 0;
+    for (uint32_t i = 0; i < s->vert_tri_count[to]; i++) {
+        uint32_t t = s->vert_tris[to][i];
+        if (s->tri_dead[t]) continue;
+        for (int k = 0; k < 3; k++) {
+            uint32_t w = s->indices[t * 3 + k];
+            if (w != from && w != to && s->mark[w] == stamp) {
+                s->mark[w] = stamp + 1;
+                shared_verts++;
+            }
+        }
+    }
+    
+    return shared_tris > 0 && shared_verts == shared_tris;
+}
+
+static bool collapse_apply(MeshSimplifier* s, uint32_t from, uint32_t to) {
+    for (uint32_t i = 0; i < s->vert_tri_count[from]; i++) {
+        uint32_t t = s->vert_tris[from][i];
+        if (s->tri_dead[t]) continue;
+        
+        uint32_t* tri = &s->indices[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            s->tri_dead[t] = true;
+            s->alive_triangles--;
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            if (tri[k] == from) tri[k] = to;
+        }
+        if (!vert_tri_push(s, to, t)) return false;
+    }
+    
+    // Drop dead triangles from the kept vertex's list
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < s->vert_tri_count[to]; i++) {
+        uint32_t t = s->vert_tris[to][i];
+        if (!s->tri_dead[t]) s->vert_tris[to][kept++] = t;
+    }
+    s->vert_tri_count[to] = kept;
+    
+    // Opposite vertices of the removed triangles may now be unreferenced
+    for (uint32_t i = 0; i < s->vert_tri_count[from]; i++) {
+        uint32_t* tri = &s->indices[s->vert_tris[from][i] * 3];
+        for (int k = 0; k < 3; k++) {
+            uint32_t w = tri[k];
+            if (w == from || w == to || s->vert_dead[w]) continue;
+            
+            bool referenced = false;
+            for (uint32_t j = 0; j < s->vert_tri_count[w] && !referenced; j++) {
+                referenced = !s->tri_dead[s->vert_tris[w][j]];
+            }
+            if (!referenced) {
+                s->vert_dead[w] = true;
+                s->alive_vertices--;
+            }
+        }
+    }
+    
+    quadric_add(&s->quadrics[to], &s->quadrics[from]);
+    s->vert_dead[from] = true;
+    s->vert_tri_count[from] = 0;
+    s->alive_vertices--;
+    s->version[to]++;
+    
+    // Requeue every edge around the kept vertex
+    uint32_t stamp = s->mark_stamp++;
+    for (uint32_t i = 0; i < s->vert_tri_count[to]; i++) {
+        uint32_t* tri = &s->indices[s->vert_tris[to][i] * 3];
+        for (int k = 0; k < 3; k++) {
+            uint32_t w = tri[k];
+            if (w == to || s->mark[w] == stamp) continue;
+            s->mark[w] = stamp;
+            if (!push_edge(s, to, w)) return false;
+        }
+    }
+    if (kept == 0) {
+        s->vert_dead[to] = true;
+        s->alive_vertices--;
+    }
+    
+    return true;
+}
+
+// Collapse until the mesh is at or below both targets. Returns false once no
+// valid collapse is left.
+static bool simplify_to(MeshSimplifier* s, uint32_t target_triangles, uint32_t target_vertices) {
+    while (s->alive_triangles > target_triangles || s->alive_vertices > target_vertices) {
+        if (s->heap_count == 0) return false;
+        
+        EdgeCollapse c = heap_pop(s);
+        if (s->vert_dead[c.from] || s->vert_dead[c.to] ||
+            s->version[c.from] != c.from_version || s->version[c.to] != c.to_version) {
+            continue;  // Stale
+        }
+        if (!collapse_is_valid(s, c.from, c.to)) continue;
+        
+        if (!collapse_apply(s, c.from, c.to)) return false;
+        if ((float)c.cost > s->max_error) s->max_error = (float)c.cost;
+    }
+    return true;
+}
+
+// Build a MeshData from the surviving triangles: vertex cache order for the
+// indices, then vertices renumbered in first-use order for fetch locality
+static MeshData* simplifier_emit(MeshSimplifier* s, uint32_t lod_level, bool dynamic) {
+    MeshData* out = calloc(1, sizeof(MeshData));
+    if (!out) return NULL;
+    
+    uint32_t index_count = s->alive_triangles * 3;
+    uint32_t* remap = malloc(sizeof(uint32_t) * s->vertex_count);
+    out->index_data = malloc(sizeof(uint32_t) * (index_count ? index_count : 1));
+    if (!remap || !out->index_data) {
+        free(remap);
+        metaverse_mesh_free(out);
+        return NULL;
+    }
+    memset(remap, 0xFF, sizeof(uint32_t) * s->vertex_count);
+    
+    // Compact to referenced vertices
+    uint32_t vertex_count = 0;
+    uint32_t w = 0;
+    for (uint32_t t = 0; t < s->triangle_count; t++) {
+        if (s->tri_dead[t]) continue;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = s->indices[t * 3 + k];
+            if (remap[v] == UINT32_MAX) remap[v] = vertex_count++;
+            out->index_data[w++] = remap[v];
+        }
+    }
+    
+    metaverse_mesh_optimize_vertex_cache(out->index_data, index_count, vertex_count);
+    
+    // Source vertex for each compacted id, then first-use order
+    uint32_t* source = malloc(sizeof(uint32_t) * (vertex_count ? vertex_count : 1));
+    uint32_t* order = malloc(sizeof(uint32_t) * (vertex_count ? vertex_count : 1));
+    out->vertex_data = malloc(sizeof(float) * 3 * (vertex_count ? vertex_count : 1));
+    if (s->normals) out->normal_data = malloc(sizeof(float) * 3 * (vertex_count ? vertex_count : 1));
+    if (s->uvs) out->uv_data = malloc(sizeof(float) * 2 * (vertex_count ? vertex_count : 1));
+    if (!source || !order || !out->vertex_data ||
+        (s->normals && !out->normal_data) || (s->uvs && !out->uv_data)) {
+        free(remap);
+        free(source);
+        free(order);
+        metaverse_mesh_free(out);
+        return NULL;
+    }
+    
+    for (uint32_t v = 0; v < s->vertex_count; v++) {
+        if (remap[v] != UINT32_MAX) source[remap[v]] = v;
+    }
+    memset(order, 0xFF, sizeof(uint32_t) * vertex_count);
+    
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint32_t v = out->index_data[i];
+        if (order[v] == UINT32_MAX) {
+            uint32_t src = source[v];
+            order[v] = next;
+            memcpy(&out->vertex_data[next * 3], &s->positions[src * 3], 3 * sizeof(float));
+            if (s->normals) memcpy(&out->normal_data[next * 3], &s->normals[src * 3], 3 * sizeof(float));
+            if (s->uvs) memcpy(&out->uv_data[next * 2], &s->uvs[src * 2], 2 * sizeof(float));
+            next++;
+        }
+        out->index_data[i] = order[v];
+    }
+    
+    free(remap);
+    free(source);
+    free(order);
+    
+    out->index_count = index_count;
+    out->vertex_count = vertex_count;
+    out->triangle_count = s->alive_triangles;
+    out->lod_level = lod_level;
+    out->lod_error = sqrtf(s->max_error);
+    out->dynamic = dynamic;
+    out->compressed = false;
+    return out;
+}
+
+// Tom Forsyth's linear-speed vertex cache optimization
+static float vertex_cache_score(int cache_position, uint32_t remaining_triangles) {
+    if (remaining_triangles == 0) return -1.0f;
+    
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            score = 0.75f;  // Last triangle's vertices, no bonus for reuse order
+        } else {
+            float scaler = 1.0f / (MESH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+    return score + 2.0f * powf((float)remaining_triangles, -0.5f);
+}
+
+void metaverse_mesh_optimize_vertex_cache(uint32_t* indices, uint32_t index_count,
+                                          uint32_t vertex_count) {
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count < 2) return;
+    
+    uint32_t* offsets = calloc(vertex_count + 1, sizeof(uint32_t));
+    uint32_t* remaining = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t* adjacency = malloc(sizeof(uint32_t) * index_count);
+    int* cache_position = malloc(sizeof(int) * vertex_count);
+    float* vertex_score = malloc(sizeof(float) * vertex_count);
+    float* triangle_score = malloc(sizeof(float) * triangle_count);
+    bool* emitted = calloc(triangle_count, sizeof(bool));
+    uint32_t* output = malloc(sizeof(uint32_t) * index_count);
+    
+    if (!offsets || !remaining || !adjacency || !cache_position || !vertex_score ||
+        !triangle_score || !emitted || !output) {
+        goto cleanup;
+    }
+    
+    // Vertex -> triangle adjacency (CSR)
+    for (uint32_t i = 0; i < index_count; i++) remaining[indices[i]]++;
+    for (uint32_t v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + remaining[v];
+    for (uint32_t v = 0; v < vertex_count; v++) remaining[v] = 0;
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint32_t v = indices[i];
+        adjacency[offsets[v] + remaining[v]++] = i / 3;
+    }
+    
+    for (uint32_t v = 0; v < vertex_count; v++) {
+        cache_position[v] = -1;
+        vertex_score[v] = vertex_cache_score(-1, remaining[v]);
+    }
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                            vertex_score[indices[t * 3 + 2]];
+    }
+    
+    uint32_t cache[MESH_CACHE_SIZE + 3];
+    uint32_t cache_count = 0;
+    uint32_t scan = 0;
+    uint32_t best = 0;
+    
+    for (uint32_t t = 1; t < triangle_count; t++) {
+        if (triangle_score[t] > triangle_score[best]) best = t;
+    }
+    
+    for (uint32_t written = 0; written < triangle_count; written++) {
+        if (best == UINT32_MAX) {
+            // Nothing in cache touches a pending triangle; take the next one in order
+            while (emitted[scan]) scan++;
+            best = scan;
+        }
+        
+        emitted[best] = true;
+        const uint32_t* tri = &indices[best * 3];
+        memcpy(&output[written * 3], tri, 3 * sizeof(uint32_t));
+        
+        // Move the triangle's vertices to the front of the LRU cache
+        uint32_t new_cache[MESH_CACHE_SIZE + 3];
+        uint32_t new_count = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = tri[k];
+            new_cache[new_count++] = v;
+            
+            // Remove the triangle from the vertex's pending list
+            uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                if (list[i] == best) {
+                    list[i] = list[--remaining[v]];
+                    break;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < cache_count; i++) {
+            uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) new_cache[new_count++] = v;
+        }
+        
+        // Vertices falling out of the cache lose their position score
+        for (uint32_t i = MESH_CACHE_SIZE; i < new_count; i++) {
+            cache_position[new_cache[i]] = -1;
+            vertex_score[new_cache[i]] = vertex_cache_score(-1, remaining[new_cache[i]]);
+        }
+        cache_count = new_count < MESH_CACHE_SIZE ? new_count : MESH_CACHE_SIZE;
+        memcpy(cache, new_cache, sizeof(uint32_t) * cache_count);
+        
+        for (uint32_t i = 0; i < cache_count; i++) {
+            uint32_t v = cache[i];
+            cache_position[v] = (int)i;
+            vertex_score[v] = vertex_cache_score((int)i, remaining[v]);
+        }
+        
+        // Rescore pending triangles of cached vertices and pick the best
+        best = UINT32_MAX;
+        float best_score = -1.0f;
+        for (uint32_t i = 0; i < cache_count; i++) {
+            uint32_t v = cache[i];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t t = adjacency[offsets[v] + j];
+                const uint32_t* ti = &indices[t * 3];
+                float score = vertex_score[ti[0]] + vertex_score[ti[1]] + vertex_score[ti[2]];
+                triangle_score[t] = score;
+                if (score > best_score) {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+    }
+    
+    memcpy(indices, output, sizeof(uint32_t) * index_count);
+    
+cleanup:
+    free(offsets);
+    free(remaining);
+    free(adjacency);
+    free(cache_position);
+    free(vertex_score);
+    free(triangle_score);
+    free(emitted);
+    free(output);
+}
+
+// Simplify to at most target_vertices (single level, replaces the old
+// every-Nth-vertex reduction). Returns the input if it is already small enough.
+MeshData* metaverse_mesh_optimize(MeshData* mesh, int target_vertices) {
+    if (!mesh || target_vertices < 3 || mesh->vertex_count <= (uint32_t)target_vertices) {
+        return mesh;
+    }
+    
+    pthread_once(&quadric_terms_once, quadric_init_terms);
+    
+    MeshSimplifier s;
+    if (!simplifier_init(&s, mesh)) return NULL;
+    
+    simplify_to(&s, UINT32_MAX, (uint32_t)target_vertices);
+    MeshData* optimized = simplifier_emit(&s, mesh->lod_level + 1, mesh->dynamic);
+    
+    simplifier_free(&s);
+    return optimized;
+}
+
+// Build a LOD chain in one pass: level 0 is the welded, cache-optimized
+// source and each next level keeps `reduction` of the previous triangles.
+// The chain stops early once no further collapse is possible.
+MeshData* metaverse_mesh_build_lods(const MeshData* mesh, uint32_t lod_count, float reduction) {
+    if (!mesh || lod_count == 0 || reduction <= 0.0f || reduction >= 1.0f) return NULL;
+    
+    pthread_once(&quadric_terms_once, quadric_init_terms);
+    
+    MeshSimplifier s;
+    if (!simplifier_init(&s, mesh)) return NULL;
+    
+    MeshData* head = simplifier_emit(&s, 0, mesh->dynamic);
+    MeshData* tail = head;
+    
+    float target = (float)s.alive_triangles;
+    for (uint32_t level = 1; tail && level < lod_count; level++) {
+        uint32_t before = s.alive_triangles;
+        target *= reduction;
+        
+        bool reached = simplify_to(&s, (uint32_t)target, UINT32_MAX);
+        if (s.alive_triangles == before || s.alive_triangles == 0) break;
+        
+        tail->next_lod = simplifier_emit(&s, level, mesh->dynamic);
+        tail = tail->next_lod;
+        if (!reached) break;
+    }
+    
+    simplifier_free(&s);
+    return head;
+}
+
+// Parallel LOD generation for many meshes (e.g. a scene import). Meshes are
+// independent, so each worker takes whole meshes.
+typedef struct {
+    MeshData** meshes;
+    MeshData** chains;
+    uint32_t lod_count;
+    float reduction;
+} MeshLodBatch;
+
+static void mesh_lod_batch_range(void* data, uint32_t begin, uint32_t end) {
+    MeshLodBatch* batch = (MeshLodBatch*)data;
+    for (uint32_t i = begin; i < end; i++) {
+        batch->chains[i] = metaverse_mesh_build_lods(batch->meshes[i], batch->lod_count,
+                                                     batch->reduction);
+    }
+}
+
+void metaverse_mesh_build_lods_batch(JobSystem* jobs, MeshData** meshes, MeshData** chains,
+                                     uint32_t count, uint32_t lod_count, float reduction) {
+    MeshLodBatch batch = {meshes, chains, lod_count, reduction};
+    
+    if (jobs) {
+        job_parallel_for(jobs, count, 1, mesh_lod_batch_range, &batch);
+    } else {
+        mesh_lod_batch_range(&batch, 0, count);
+    }
+}
+
+// Free a mesh and every coarser level chained after it
+void metaverse_mesh_free(MeshData* mesh) {
+    while (mesh) {
+        MeshData* next = mesh->next_lod;
+        free(mesh->vertex_data);
+        free(mesh->normal_data);
+        free(mesh->uv_data);
+        free(mesh->index_data);
+        free(mesh);
+        mesh = next;
+    }
+}
+
+// Wavy n x n quad grid; open borders and curvature give the simplifier real work
+static MeshData* mesh_test_grid(uint32_t n) {
+    MeshData* mesh = calloc(1, sizeof(MeshData));
+    if (!mesh) return NULL;
+    
+    mesh->vertex_count = (n + 1) * (n + 1);
+    mesh->triangle_count = n * n * 2;
+    mesh->index_count = mesh->triangle_count * 3;
+    mesh->vertex_data = malloc(sizeof(float) * 3 * mesh->vertex_count);
+    mesh->index_data = malloc(sizeof(uint32_t) * mesh->index_count);
+    if (!mesh->vertex_data || !mesh->index_data) {
+        metaverse_mesh_free(mesh);
+        return NULL;
+    }
+    
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            float* p = &mesh->vertex_data[(y * (n + 1) + x) * 3];
+            p[0] = (float)x;
+            p[1] = sinf(x * 0.3f) * cosf(y * 0.2f);
+            p[2] = (float)y;
+        }
+    }
+    
+    uint32_t* index = mesh->index_data;
+    for (uint32_t y = 0; y < n; y++) {
+        for (uint32_t x = 0; x < n; x++) {
+            uint32_t a = y * (n + 1) + x;
+            uint32_t c = a + n + 1;
+            *index++ = a; *index++ = c; *index++ = a + 1;
+            *index++ = a + 1; *index++ = c; *index++ = c + 1;
+        }
+    }
+    return mesh;
+}
+
+// Average cache miss ratio: post-transform misses per triangle with an LRU
+// cache of MESH_CACHE_SIZE entries
+static float mesh_test_acmr(const uint32_t* indices, uint32_t index_count) {
+    uint32_t cache[MESH_CACHE_SIZE];
+    uint32_t cached = 0;
+    uint32_t misses = 0;
+    
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint32_t v = indices[i];
+        uint32_t hit = 0;
+        while (hit < cached && cache[hit] != v) hit++;
+        if (hit == cached) {
+            misses++;
+            if (cached < MESH_CACHE_SIZE) cached++;
+            hit = cached - 1;
+        }
+        memmove(&cache[1], &cache[0], sizeof(uint32_t) * hit);
+        cache[0] = v;
+    }
+    return (float)misses / (float)(index_count / 3);
+}
+
+int main_mesh_test() {
+    printf("Metaverse Mesh Test\n");
+    
+    MeshData* mesh = mesh_test_grid(32);
+    if (!mesh) {
+        fprintf(stderr, "Failed to create test mesh\n");
+        return 1;
+    }
+    
+    // Shuffle triangles (fixed seed) so the source order has poor locality
+    uint32_t seed = 12345u;
+    for (uint32_t t = mesh->triangle_count - 1; t > 0; t--) {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t other = (seed >> 8) % (t + 1);
+        uint32_t tri[3];
+        memcpy(tri, &mesh->index_data[t * 3], sizeof(tri));
+        memcpy(&mesh->index_data[t * 3], &mesh->index_data[other * 3], sizeof(tri));
+        memcpy(&mesh->index_data[other * 3], tri, sizeof(tri));
+    }
+    
+    float shuffled_acmr = mesh_test_acmr(mesh->index_data, mesh->index_count);
+    metaverse_mesh_optimize_vertex_cache(mesh->index_data, mesh->index_count, mesh->vertex_count);
+    float optimized_acmr = mesh_test_acmr(mesh->index_data, mesh->index_count);
+    printf("ACMR: shuffled %.2f, optimized %.2f\n", shuffled_acmr, optimized_acmr);
+    
+    if (optimized_acmr >= shuffled_acmr) {
+        fprintf(stderr, "Vertex cache optimization did not lower ACMR\n");
+        metaverse_mesh_free(mesh);
+        return 1;
+    }
+    
+    // Each LOD level must have fewer triangles and only valid indices
+    MeshData* chain = metaverse_mesh_build_lods(mesh, 4, 0.5f);
+    uint32_t levels = 0;
+    bool valid = chain != NULL;
+    for (MeshData* lod = chain; lod && valid; lod = lod->next_lod) {
+        printf("LOD %u: %u triangles, %u vertices\n", lod->lod_level, lod->triangle_count,
+               lod->vertex_count);
+        if (lod->next_lod && lod->next_lod->triangle_count >= lod->triangle_count) valid = false;
+        for (uint32_t i = 0; i < lod->index_count; i++) {
+            if (lod->index_data[i] >= lod->vertex_count) valid = false;
+        }
+        levels++;
+    }
+    metaverse_mesh_free(chain);
+    metaverse_mesh_free(mesh);
+    
+    if (!valid || levels < 2) {
+        fprintf(stderr, "Simplification did not reduce the triangle count\n");
+        return 1;
+    }
+    
+    printf("Mesh tests completed\n");
+    return 0;
+}
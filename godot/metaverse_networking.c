@@ -16,6 +16,9 @@
 #include <netdb.h>
 #include <errno.h>
 
+#include "metaverse_math.h"
+#include "metaverse_profiler.h"
+
 // Network Protocol Definitions
 #define METAVERSE_PROTOCOL_VERSION 1
 #define MAX_PACKET_SIZE 1400  // MTU safe
@@ -53,6 +56,20 @@ typedef struct {
     uint32_t interpolation_time;
 } NetworkEntity;
 
+// Entity id index (metaverse_entity_index.c)
+typedef struct EntityIndex EntityIndex;
+typedef uint64_t EntityHandle;
+
+#define ENTITY_HANDLE_INVALID 0
+#define ENTITY_INDEX_NONE     UINT32_MAX
+
+EntityIndex* entity_index_create(uint32_t initial_capacity);
+void entity_index_destroy(EntityIndex* index);
+EntityHandle entity_index_insert(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_remove(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_lookup(const EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_resolve(const EntityIndex* index, EntityHandle handle);
+
 // Network Player
 typedef struct {
     uint32_t player_id;
@@ -116,6 +133,7 @@ typedef struct {
     NetworkEntity* entities;
     uint32_t entity_count;
     uint32_t entity_capacity;
+    EntityIndex* entity_index;  // entity_id -> entities[] slot
     
     // Snapshots
     NetworkSnapshot snapshots[64];
@@ -190,6 +208,9 @@ void network_send_voice(NetworkManager* manager, uint8_t* audio_data,
 void network_interpolate_entities(NetworkManager* manager);
 void network_reconcile_state(NetworkManager* manager);
 void network_handle_packet_loss(NetworkManager* manager);
+EntityHandle network_entity_add(NetworkManager* manager, NetworkEntity* entity);
+void network_entity_remove(NetworkManager* manager, uint64_t entity_id);
+NetworkEntity* network_entity_resolve(NetworkManager* manager, EntityHandle handle);
 
 // Create network manager
 NetworkManager* network_manager_create(bool is_server, const char* server_ip, int port) {
@@ -255,6 +276,7 @@ NetworkManager* network_manager_create(bool is_server, const char* server_ip, in
     manager->entity_capacity = 1024;
     manager->entity_count = 0;
     manager->entities = malloc(sizeof(NetworkEntity) * manager->entity_capacity);
+    manager->entity_index = entity_index_create(manager->entity_capacity);
     
     // Initialize player array
     manager->player_count = 0;
@@ -292,6 +314,8 @@ void* network_receive_thread(void* arg) {
     struct sockaddr_in from_addr;
     socklen_t addr_len = sizeof(from_addr);
     
+    profiler_set_thread_name("Net receive");
+    
     while (manager->network_active) {
         // Receive packet
         ssize_t received = recvfrom(manager->udp_socket, buffer, sizeof(buffer), 0,
@@ -302,6 +326,7 @@ void* network_receive_thread(void* arg) {
             manager->bytes_received += received;
             
             // Process packet
+            PROFILE_ZONE("Process packet");
             network_process_packet(manager, buffer, (int)received, &from_addr);
         } else if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
             perror("Receive error");
@@ -319,6 +344,8 @@ void* network_send_thread(void* arg) {
     struct timespec last_tick, current_tick;
     clock_gettime(CLOCK_MONOTONIC, &last_tick);
     
+    profiler_set_thread_name("Net send");
+    
     while (manager->network_active) {
         clock_gettime(CLOCK_MONOTONIC, &current_tick);
         
@@ -327,6 +354,7 @@ void* network_send_thread(void* arg) {
         
         // Send at network tick rate
         if (elapsed >= 1.0 / NETWORK_TICK_RATE) {
+            PROFILE_ZONE("Network tick");
             last_tick = current_tick;
             
             if (manager->is_server) {
@@ -596,6 +624,50 @@ void network_send_snapshot(NetworkManager* manager) {
     }
 }
 
+// Register entity (caller must not hold entity_mutex)
+EntityHandle network_entity_add(NetworkManager* manager, NetworkEntity* entity) {
+    pthread_mutex_lock(&manager->entity_mutex);
+    
+    if (manager->entity_count == manager->entity_capacity) {
+        uint32_t new_capacity = manager->entity_capacity * 2;
+        NetworkEntity* entities = realloc(manager->entities, 
+                                          sizeof(NetworkEntity) * new_capacity);
+        if (!entities) {
+            pthread_mutex_unlock(&manager->entity_mutex);
+            return ENTITY_HANDLE_INVALID;
+        }
+        manager->entities = entities;
+        manager->entity_capacity = new_capacity;
+    }
+    
+    EntityHandle handle = entity_index_insert(manager->entity_index, entity->entity_id);
+    if (handle != ENTITY_HANDLE_INVALID) {
+        manager->entities[manager->entity_count++] = *entity;
+    }
+    
+    pthread_mutex_unlock(&manager->entity_mutex);
+    return handle;
+}
+
+// Unregister entity (swap-remove)
+void network_entity_remove(NetworkManager* manager, uint64_t entity_id) {
+    pthread_mutex_lock(&manager->entity_mutex);
+    
+    uint32_t index = entity_index_remove(manager->entity_index, entity_id);
+    if (index != ENTITY_INDEX_NONE) {
+        manager->entities[index] = manager->entities[--manager->entity_count];
+    }
+    
+    pthread_mutex_unlock(&manager->entity_mutex);
+}
+
+// Resolve a stored handle; NULL once the entity has been removed.
+// The pointer is only valid while entity_mutex is held.
+NetworkEntity* network_entity_resolve(NetworkManager* manager, EntityHandle handle) {
+    uint32_t index = entity_index_resolve(manager->entity_index, handle);
+    return index == ENTITY_INDEX_NONE ? NULL : &manager->entities[index];
+}
+
 // Entity interpolation (client side)
 void network_interpolate_entities(NetworkManager* manager) {
     if (manager->is_server) return;
@@ -649,8 +721,8 @@ void network_reconcile_state(NetworkManager* manager) {
         NetworkEntity* server_entity = find_server_entity(manager, entity->entity_id);
         
         if (server_entity && 
-            (vector_distance(entity->position, server_entity->position) > 0.1f ||
-             vector_distance(entity->rotation, server_entity->rotation) > 0.01f)) {
+            (vec3_distance(vec3_load(&entity->position.x), vec3_load(&server_entity->position.x)) > 0.1f ||
+             vec3_distance(vec3_load(&entity->rotation.x), vec3_load(&server_entity->rotation.x)) > 0.01f)) {
             
             // State mismatch detected, need to reconcile
             printf("State mismatch for entity %lu\n", entity->entity_id);
@@ -764,21 +836,10 @@ void network_manager_stop(NetworkManager* manager) {
 }
 
 // Utility functions
-float vector_distance(Vector4 a, Vector4 b) {
-    float dx = a.x - b.x;
-    float dy = a.y - b.y;
-    float dz = a.z - b.z;
-    return sqrtf(dx*dx + dy*dy + dz*dz);
-}
-
 NetworkEntity* find_server_entity(NetworkManager* manager, uint64_t entity_id) {
     // In real implementation, would have separate server entity buffer
-    for (uint32_t i = 0; i < manager->entity_count; i++) {
-        if (manager->entities[i].entity_id == entity_id) {
-            return &manager->entities[i];
-        }
-    }
-    return NULL;
+    uint32_t index = entity_index_lookup(manager->entity_index, entity_id);
+    return index == ENTITY_INDEX_NONE ? NULL : &manager->entities[index];
 }
 
 int main_network_test() {
@@ -809,6 +870,7 @@ int main_network_test() {
     printf("  Average ping: %.2fms\n", server->average_ping);
     
     network_manager_stop(server);
+    entity_index_destroy(server->entity_index);
     free(server->entities);
     free(server);
     
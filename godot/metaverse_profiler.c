@@ -0,0 +1,305 @@
+/*******************************************************************************
+ * METAVERSE PROFILER
+ * Scoped zones into per-thread lock-free rings, Chrome trace JSON export
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_TSC 1
+#endif
+
+#include "metaverse_profiler.h"
+
+#define PROFILER_MAX_THREADS 128
+#define PROFILER_RING_EVENTS 65536      // Per thread, power of two
+#define PROFILER_NAME_LENGTH 32
+
+// Counters share the ring with zones: the top bit of start marks a sample,
+// which stores its value where a zone stores its end
+#define PROFILE_EVENT_COUNTER (1ull << 63)
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+    union {
+        uint64_t end;
+        double value;
+    };
+} ProfileEvent;
+
+// Single producer (the owning thread), read by the exporter. Events older
+// than head - PROFILER_RING_EVENTS have been overwritten.
+typedef struct {
+    ProfileEvent* events;
+    _Atomic uint64_t head;
+    uint32_t thread_index;
+    char name[PROFILER_NAME_LENGTH];
+} ProfileThread;
+
+static ProfileThread* profile_threads[PROFILER_MAX_THREADS];
+static atomic_uint profile_thread_count;
+static atomic_bool profile_enabled;
+static atomic_uint profile_generation;  // Bumped by profiler_shutdown()
+
+// Tick origin, paired with a monotonic clock reading for calibration
+static pthread_once_t profile_once = PTHREAD_ONCE_INIT;
+static uint64_t profile_origin_ticks;
+static uint64_t profile_origin_ns;
+
+// A thread's ring pointer is only trusted while its generation matches:
+// profiler_shutdown() frees every ring but cannot reach other threads' TLS
+static _Thread_local ProfileThread* profile_thread;
+static _Thread_local unsigned profile_thread_generation;
+static _Thread_local char profile_thread_name[PROFILER_NAME_LENGTH];  // Until the ring exists
+
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Raw timestamp: TSC where available (a few ns), monotonic ns otherwise
+static inline uint64_t profile_ticks(void) {
+#ifdef PROFILER_USE_TSC
+    return __rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+static void profiler_init_origin(void) {
+    profile_origin_ns = monotonic_ns();
+    profile_origin_ticks = profile_ticks();
+}
+
+uint64_t profiler_now(void) {
+    return profile_ticks();
+}
+
+// Tick rate is calibrated against the monotonic clock over the time since
+// the profiler started, so no startup spin is needed
+static double profiler_us_per_tick(void) {
+#ifdef PROFILER_USE_TSC
+    pthread_once(&profile_once, profiler_init_origin);
+    uint64_t elapsed_ticks = profile_ticks() - profile_origin_ticks;
+    uint64_t elapsed_ns = monotonic_ns() - profile_origin_ns;
+    if (elapsed_ticks == 0 || elapsed_ns == 0) return 0.0;
+    return (double)elapsed_ns / (double)elapsed_ticks / 1000.0;
+#else
+    return 0.001;
+#endif
+}
+
+double profiler_ticks_to_us(uint64_t ticks) {
+    return (double)ticks * profiler_us_per_tick();
+}
+
+void profiler_set_enabled(bool enabled) {
+    pthread_once(&profile_once, profiler_init_origin);
+    atomic_store_explicit(&profile_enabled, enabled, memory_order_relaxed);
+}
+
+bool profiler_is_enabled(void) {
+    return atomic_load_explicit(&profile_enabled, memory_order_relaxed);
+}
+
+// Calling thread's ring, or NULL if it has none since the last shutdown
+static inline ProfileThread* profiler_current_thread(void) {
+    unsigned generation = atomic_load_explicit(&profile_generation, memory_order_acquire);
+    return profile_thread_generation == generation ? profile_thread : NULL;
+}
+
+// Calling thread's ring, created by the first event it records while
+// enabled; a thread that never records takes no slot
+static ProfileThread* profiler_thread(void) {
+    ProfileThread* current = profiler_current_thread();
+    if (current) return current;
+    
+    profile_thread = NULL;
+    profile_thread_generation = atomic_load_explicit(&profile_generation, memory_order_acquire);
+    
+    uint32_t index = atomic_fetch_add(&profile_thread_count, 1);
+    if (index >= PROFILER_MAX_THREADS) return NULL;
+    
+    ProfileThread* thread = calloc(1, sizeof(ProfileThread));
+    if (!thread) return NULL;
+    
+    thread->events = malloc(sizeof(ProfileEvent) * PROFILER_RING_EVENTS);
+    if (!thread->events) {
+        free(thread);
+        return NULL;
+    }
+    thread->thread_index = index;
+    if (profile_thread_name[0]) {
+        memcpy(thread->name, profile_thread_name, sizeof(thread->name));
+    } else {
+        snprintf(thread->name, sizeof(thread->name), "Thread %u", index);
+    }
+    
+    profile_threads[index] = thread;
+    profile_thread = thread;
+    return thread;
+}
+
+// Label the calling thread in exported traces. Only remembered here; the
+// ring picks the name up when the thread first records.
+void profiler_set_thread_name(const char* name) {
+    strncpy(profile_thread_name, name, sizeof(profile_thread_name) - 1);
+    profile_thread_name[sizeof(profile_thread_name) - 1] = '\0';
+    
+    ProfileThread* thread = profiler_current_thread();
+    if (thread) memcpy(thread->name, profile_thread_name, sizeof(thread->name));
+}
+
+ProfileZone profiler_begin(const char* name) {
+    ProfileZone zone = { NULL, 0 };
+    if (!atomic_load_explicit(&profile_enabled, memory_order_relaxed)) return zone;
+    
+    zone.name = name;
+    zone.start = profile_ticks();
+    return zone;
+}
+
+void profiler_end(ProfileZone* zone) {
+    if (!zone->name) return;  // Opened while disabled
+    
+    uint64_t end = profile_ticks();
+    ProfileThread* thread = profiler_thread();
+    if (!thread) return;
+    
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+    ProfileEvent* event = &thread->events[head & (PROFILER_RING_EVENTS - 1)];
+    event->name = zone->name;
+    event->start = zone->start;
+    event->end = end;
+    atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+}
+
+// Record one sample of a named value (shown as a counter track)
+void profiler_counter(const char* name, double value) {
+    if (!atomic_load_explicit(&profile_enabled, memory_order_relaxed)) return;
+    
+    uint64_t now = profile_ticks();
+    ProfileThread* thread = profiler_thread();
+    if (!thread) return;
+    
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+    ProfileEvent* event = &thread->events[head & (PROFILER_RING_EVENTS - 1)];
+    event->name = name;
+    event->start = now | PROFILE_EVENT_COUNTER;
+    event->value = value;
+    atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+}
+
+static void write_json_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') fputc('\\', file);
+        if ((unsigned char)*text >= 0x20) fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+// Write every buffered zone as Chrome/Perfetto trace JSON ("X" events, one
+// track per thread; counters as "C" events). Safe while other threads keep
+// recording: events that are overwritten during the copy are dropped.
+bool profiler_export_chrome_trace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    
+    double us_per_tick = profiler_us_per_tick();
+    
+    ProfileEvent* copy = malloc(sizeof(ProfileEvent) * PROFILER_RING_EVENTS);
+    if (!copy) {
+        fclose(file);
+        return false;
+    }
+    
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    
+    uint32_t count = atomic_load(&profile_thread_count);
+    if (count > PROFILER_MAX_THREADS) count = PROFILER_MAX_THREADS;
+    
+    for (uint32_t t = 0; t < count; t++) {
+        ProfileThread* thread = profile_threads[t];
+        if (!thread) continue;
+        
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", thread->thread_index);
+        write_json_string(file, thread->name);
+        fprintf(file, "}}");
+        first = false;
+        
+        // Snapshot the live window
+        uint64_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+        uint64_t begin = head > PROFILER_RING_EVENTS ? head - PROFILER_RING_EVENTS : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            copy[i - begin] = thread->events[i & (PROFILER_RING_EVENTS - 1)];
+        }
+        
+        // Drop slots the producer reused during the copy, plus the one it may
+        // be writing now if it is still active
+        uint64_t after = atomic_load_explicit(&thread->head, memory_order_acquire);
+        uint64_t reused = after == head ? after : after + 1;
+        uint64_t valid = reused > PROFILER_RING_EVENTS ? reused - PROFILER_RING_EVENTS : 0;
+        
+        for (uint64_t i = valid > begin ? valid : begin; i < head; i++) {
+            const ProfileEvent* event = &copy[i - begin];
+            uint64_t start = event->start & ~PROFILE_EVENT_COUNTER;
+            if (start < profile_origin_ticks) continue;
+            
+            double ts = (double)(start - profile_origin_ticks) * us_per_tick;
+            if (event->start & PROFILE_EVENT_COUNTER) {
+                fprintf(file, ",\n{\"ph\":\"C\",\"name\":");
+                write_json_string(file, event->name);
+                fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.3f}}",
+                        thread->thread_index, ts, event->value);
+                continue;
+            }
+            
+            double dur = (double)(event->end - event->start) * us_per_tick;
+            
+            fprintf(file, ",\n{\"ph\":\"X\",\"name\":");
+            write_json_string(file, event->name);
+            fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    thread->thread_index, ts, dur);
+        }
+    }
+    
+    fprintf(file, "\n]}\n");
+    free(copy);
+    
+    bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
+
+// Free all rings; only once no thread records any more. Threads keep
+// their names, and if the profiler is enabled again each one gets a fresh
+// ring on its next event.
+void profiler_shutdown(void) {
+    atomic_store(&profile_enabled, false);
+    
+    uint32_t count = atomic_load(&profile_thread_count);
+    if (count > PROFILER_MAX_THREADS) count = PROFILER_MAX_THREADS;
+    
+    for (uint32_t t = 0; t < count; t++) {
+        if (!profile_threads[t]) continue;
+        free(profile_threads[t]->events);
+        free(profile_threads[t]);
+        profile_threads[t] = NULL;
+    }
+    
+    // Stale thread-local ring pointers stop matching; slots are reused
+    atomic_store(&profile_thread_count, 0);
+    atomic_fetch_add_explicit(&profile_generation, 1, memory_order_release);
+}
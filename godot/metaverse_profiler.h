@@ -0,0 +1,43 @@
+/*******************************************************************************
+ * METAVERSE PROFILER
+ * Zone, counter and trace export API of metaverse_profiler.c
+ ******************************************************************************/
+
+#ifndef METAVERSE_PROFILER_H
+#define METAVERSE_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A zone records one event when it closes, so a zone costs two timestamp
+// reads and one 24-byte store into the calling thread's ring. Names must
+// outlive the export (string literals).
+//
+// Usage:
+//   PROFILE_ZONE("Physics");                     // closes at end of scope
+//   ProfileZone zone = profiler_begin("Send");   // or explicitly
+//   ...
+//   profiler_end(&zone);
+typedef struct {
+    const char* name;
+    uint64_t start;
+} ProfileZone;
+
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) \
+    ProfileZone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__) \
+        __attribute__((cleanup(profiler_end))) = profiler_begin(name)
+
+void profiler_set_enabled(bool enabled);
+bool profiler_is_enabled(void);
+void profiler_set_thread_name(const char* name);
+ProfileZone profiler_begin(const char* name);
+void profiler_end(ProfileZone* zone);
+void profiler_counter(const char* name, double value);
+uint64_t profiler_now(void);
+double profiler_ticks_to_us(uint64_t ticks);
+bool profiler_export_chrome_trace(const char* path);
+void profiler_shutdown(void);
+
+#endif // METAVERSE_PROFILER_H
@@ -6,21 +6,243 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include <assert.h>
 #include <pthread.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "metaverse_profiler.h"
+
+// Entity id index (metaverse_entity_index.c)
+typedef struct EntityIndex EntityIndex;
+typedef uint64_t EntityHandle;
+
+#define ENTITY_HANDLE_INVALID 0
+#define ENTITY_INDEX_NONE     UINT32_MAX
+
+EntityIndex* entity_index_create(uint32_t initial_capacity);
+void entity_index_destroy(EntityIndex* index);
+EntityHandle entity_index_insert(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_remove(EntityIndex* index, uint64_t entity_id);
+uint32_t entity_index_lookup(const EntityIndex* index, uint64_t entity_id);
+
+// Job system (metaverse_jobs.c)
+typedef struct JobSystem JobSystem;
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+JobSystem* job_system_create(uint32_t thread_count);
+void job_system_destroy(JobSystem* system);
+
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+
 // Spatial Partitioning Structures
+
+// Loose octree: a node's loose bounds are its cell grown by (k - 1) half
+// extents on every side (k = OCTREE_LOOSENESS). Each entity lives in
+// exactly one node, the deepest one whose cell holds its center and whose
+// loose bounds still hold its whole sphere, so with k = 2 anything with a
+// radius up to half the cell size fits. Queries test loose bounds.
+//
+// Entities are stored densely with their position and radius, keyed by an
+// EntityIndex; each item knows its node and its slot in that node's list,
+// so removal is a swap-remove and a move that stays in its node is a plain
+// position update. Leaves split by real position once they hold more than
+// max_objects_per_node and collapse back when a subtree drops to half that.
+// Entities outside the root cell are kept at the root, whose loose bounds
+// grow to cover them.
+//
+// Each node also keeps its children's loose bounds side by side
+// (structure of arrays), so a query tests all eight children in a few
+// vector operations instead of loading eight nodes.
+#define OCTREE_LOOSENESS    2.0f
+#define OCTREE_MAX_DEPTH    8
+#define OCTREE_DEPTH_LIMIT  16    // Cap on max_depth; bounds the query stack
+#define OCTREE_QUERY_STACK  (OCTREE_DEPTH_LIMIT * 7 + 8)
+#define OCTREE_QUERY_GRAIN  32    // Queries per batch job
+
 typedef struct OctreeNode {
     float bounds[6];  // min_x, max_x, min_y, max_y, min_z, max_z
+    float loose[6];   // Same layout, grown by the looseness factor
+    float fit_radius; // Largest radius this node's loose bounds always hold
+    struct OctreeNode* parent;
     struct OctreeNode* children[8];
-    uint64_t* entity_ids;
-    uint32_t entity_count;
-    uint32_t entity_capacity;
+    float child_loose[6][8];  // children[c]->loose[k] at [k][c], valid unless is_leaf
+    uint32_t* items;  // Dense item indices
+    uint32_t item_count;
+    uint32_t item_capacity;
+    uint32_t subtree_count;  // Items here and below
     bool is_leaf;
     int depth;
 } OctreeNode;
 
+typedef struct {
+    uint64_t entity_id;
+    float position[3];
+    float radius;
+    OctreeNode* node;
+    uint32_t slot;    // Position in node->items
+} OctreeItem;
+
+typedef struct Octree {
+    OctreeNode* root;
+    EntityIndex* index;     // entity_id -> dense item, mirrors items
+    OctreeItem* items;
+    uint32_t item_count;
+    uint32_t item_capacity;
+    float looseness;
+    int max_depth;
+    uint32_t max_objects_per_node;
+    uint32_t node_count;
+} Octree;
+
+// Batched queries: N shapes in, one list of matching entity ids out in
+// compressed sparse row form. Query q's matches are
+// ids[offsets[q] .. offsets[q + 1]). The caller owns the struct (start it
+// zeroed and reuse it across frames); buffers grow as needed and are kept,
+// so a steady-state batch does not allocate. Release with
+// spatial_query_results_free().
+typedef enum {
+    SPATIAL_QUERY_SPHERE = 0,   // 4 floats per query: x, y, z, radius
+    SPATIAL_QUERY_AABB          // 6 floats: min_x, max_x, min_y, max_y, min_z, max_z
+} SpatialQueryShape;
+
+// Matches collected by one query or one batch job
+typedef struct {
+    uint64_t* ids;
+    uint32_t count;         // Matches seen, including any not stored
+    uint32_t capacity;
+    bool growable;          // Grow ids instead of only counting past capacity
+    bool failed;            // A growable buffer could not grow
+} SpatialQueryChunk;
+
+typedef struct {
+    uint32_t* offsets;      // query_count + 1 entries
+    uint64_t* ids;
+    uint32_t query_count;
+    uint32_t id_count;
+    uint32_t offset_capacity;
+    uint32_t id_capacity;
+    SpatialQueryChunk* chunks;  // Per-job scratch
+    uint32_t chunk_capacity;
+} SpatialQueryResults;
+
+// Frustum queries take one set of six planes per view (inward normals, as
+// for metaverse_cull_entities). With two views one traversal serves both
+// eyes of a stereo pair: a node is dropped only once it is outside both,
+// and each visible entity says which eyes see it.
+#define OCTREE_MAX_VIEWS  2
+
+// Dense visible list, in traversal order, so entities close together in
+// the list are close together in space. Caller-owned like
+// SpatialQueryResults: start zeroed, reuse every frame, release with
+// octree_visible_list_free().
+typedef struct {
+    uint64_t* ids;
+    uint8_t* view_masks;    // Bit v set when visible in view v
+    uint32_t count;
+    uint32_t capacity;
+} OctreeVisibleList;
+
+// k-nearest-neighbour queries are best-first: nodes wait in a min-heap
+// keyed by the closest any of their contents could be, and the k best so
+// far sit in a bounded max-heap whose top is the distance to beat. The
+// search ends as soon as the nearest waiting node is further than that.
+// Octree entities are measured by their center, BVH primitives by their
+// box (zero inside it). The node heap lives in caller-owned scratch that
+// only grows, so a warm query does not allocate.
+#define SPATIAL_KNN_GRAIN  32  // Queries per batch job
+
+typedef struct {
+    uint64_t id;
+    float distance;
+} SpatialNeighbor;
+
+typedef struct {
+    float distance;         // Squared lower bound
+    const void* node;       // OctreeNode or BvhNode
+} SpatialKnnEntry;
+
+typedef struct {
+    SpatialKnnEntry* queue;
+    uint32_t count;
+    uint32_t capacity;
+    bool failed;            // The queue could not grow (batch jobs)
+} SpatialKnnScratch;
+
+// Batch output, k slots per query: query q's neighbours are
+// neighbors[q * k .. q * k + counts[q]), nearest first. Caller-owned like
+// SpatialQueryResults; release with spatial_knn_results_free().
+typedef struct {
+    SpatialNeighbor* neighbors;
+    uint32_t* counts;
+    uint32_t query_count;
+    uint32_t k;
+    uint32_t neighbor_capacity;
+    uint32_t count_capacity;
+    SpatialKnnScratch* scratch;     // Per job
+    uint32_t scratch_capacity;
+} SpatialKnnResults;
+
+// Linear octree: a pointerless octree rebuilt from scratch each time.
+// Entity centers are quantized to 21 bits per axis and interleaved into
+// 63-bit Morton codes, which are radix-sorted; every octree cell is then a
+// contiguous run of the sorted array. Nodes are laid out breadth-first in
+// one array with each node's children contiguous, so a node is 32 bytes
+// and a child is reached by offset. Runs that fall entirely in one octant
+// are skipped rather than given single-child nodes.
+//
+// Node bounds are the AABB of the spheres below them, computed bottom-up,
+// so queries test what is actually there rather than the cell. Entity ids
+// and spheres are stored in Morton order next to the leaves.
+//
+// All buffers are kept between builds and only grow; queries use a fixed
+// stack and never allocate.
+#define LINEAR_OCTREE_BITS        21      // Per axis
+#define LINEAR_OCTREE_LEAF_SIZE   16
+#define LINEAR_OCTREE_LEAF        0x80000000u  // Flag in LinearOctreeNode.count
+#define LINEAR_OCTREE_MAX_LEVELS  (LINEAR_OCTREE_BITS + 2)
+#define LINEAR_OCTREE_STACK       (LINEAR_OCTREE_BITS * 7 + 1)
+#define LINEAR_OCTREE_SORT_BLOCK  16384   // Entities per sort/histogram job
+#define LINEAR_OCTREE_NODE_GRAIN  512     // Nodes per build job
+#define LINEAR_OCTREE_RADIX       256
+
+typedef struct {
+    float bounds[6];        // min_x, max_x, min_y, max_y, min_z, max_z
+    uint32_t first;         // First child node, or first entity for a leaf
+    uint32_t count;         // Children, or entities | LINEAR_OCTREE_LEAF
+} LinearOctreeNode;
+
+typedef struct LinearOctree {
+    LinearOctreeNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    uint32_t level_start[LINEAR_OCTREE_MAX_LEVELS + 1];  // Breadth-first levels
+    uint32_t level_count;
+    
+    // Entities in Morton order
+    uint64_t* ids;
+    float* spheres;         // x, y, z, radius
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t leaf_size;
+    float bounds[6];        // Quantization cube
+    
+    // Build scratch
+    uint64_t* codes[2];
+    uint32_t* order[2];
+    uint32_t* histogram;    // Per sort block
+    float* block_bounds;
+    uint32_t* level_scratch;
+    uint32_t block_capacity;
+    uint32_t level_scratch_capacity;
+} LinearOctree;
+
 typedef struct QuadtreeNode {
     float bounds[4];  // min_x, max_x, min_y, max_y
     struct QuadtreeNode* children[4];
@@ -31,16 +253,96 @@ typedef struct QuadtreeNode {
     int depth;
 } QuadtreeNode;
 
-typedef struct BIHNode {
-    int axis;
-    float split;
-    struct BIHNode* left;
-    struct BIHNode* right;
-    uint64_t* entity_ids;
-    uint32_t entity_count;
-    uint32_t start_index;
-    uint32_t end_index;
-} BIHNode;
+// Bounding volume hierarchy over AABB primitives (level geometry, props),
+// built top-down with binned SAH along each range's longest centroid axis.
+// The top of the tree is split on the calling thread, binning large ranges
+// in parallel, until the ranges are small enough to hand out; those
+// subtrees are then built in parallel, each into its own preassigned node
+// range, so the layout is deterministic and a parent always precedes its
+// children. Children are adjacent (first, first + 1), and primitives are
+// reordered to leaf order.
+//
+// Moving primitives are handled by refitting: new boxes are pulled in and
+// node bounds recomputed bottom-up, subtrees in parallel. The SAH cost of
+// the refitted tree is compared with the cost right after the last build,
+// and the tree is rebuilt once it has degraded by BVH_REBUILD_RATIO.
+#define BVH_BINS             16
+#define BVH_LEAF_SIZE        2       // Always a leaf at or below this
+#define BVH_MAX_LEAF         8       // Never a leaf above this
+#define BVH_TRAVERSAL_COST   1.0f
+#define BVH_INTERSECT_COST   1.0f
+#define BVH_MEDIAN_DEPTH     40      // Deeper ranges split at the median
+#define BVH_MAX_DEPTH        (BVH_MEDIAN_DEPTH + 28)  // Halving < 2^31 down to BVH_MAX_LEAF
+#define BVH_STACK            (BVH_MAX_DEPTH + 2)      // One pending sibling per level
+#define BVH_SUBTREE_MIN      1024    // Smallest range built as one job
+#define BVH_SUBTREES         256     // Target subtree count for large builds
+#define BVH_PARALLEL_BIN     65536   // Ranges at least this large bin in parallel
+#define BVH_BLOCK            16384   // Primitives per binning/copy job
+#define BVH_REBUILD_RATIO    1.5f
+
+typedef struct {
+    float bounds[6];        // min_x, max_x, min_y, max_y, min_z, max_z
+    uint32_t first;         // Left child (right is first + 1), or first primitive
+    uint32_t count;         // Primitives in a leaf, 0 for an internal node
+} BvhNode;
+
+typedef struct {
+    uint32_t prim_begin;
+    uint32_t prim_end;
+    uint32_t root;          // Node in the top part of the tree
+    uint32_t depth;
+    uint32_t node_begin;    // Descendants of root go here
+    uint32_t node_used;
+    float bounds[6];
+    float centroid_bounds[6];
+    float cost;             // Unnormalized SAH of the descendants
+} BvhSubtree;
+
+typedef struct {
+    uint64_t id;
+    float distance;
+} BvhHit;
+
+// Exact test for one primitive; returns the hit distance, or a negative
+// value / INFINITY on a miss. NULL means the primitive's box is the shape.
+typedef float (*BvhRayFunc)(void* user, uint64_t id, const float* origin,
+                            const float* direction, float max_distance);
+
+// Build work record: partitions move these, so binning reads sequentially
+typedef struct {
+    float bounds[6];
+    float centroid[3];
+    uint32_t index;         // Caller's order
+} BvhPrim;
+
+typedef struct Bvh {
+    BvhNode* nodes;
+    uint32_t node_count;    // Span in use; may contain unused slots
+    uint32_t node_capacity;
+    uint32_t top_count;     // Nodes [0, top_count) are the serially built top
+    
+    // Primitives in leaf order
+    uint64_t* ids;
+    float* prim_bounds;
+    uint32_t* prim_index;   // Leaf order -> caller's order
+    uint32_t count;
+    uint32_t capacity;
+    
+    BvhSubtree* subtrees;
+    uint32_t subtree_count;
+    uint32_t subtree_capacity;
+    
+    float build_cost;       // SAH right after the last build
+    float cost;             // SAH after the last refit
+    uint32_t builds;
+    uint32_t refits;
+    
+    // Build scratch
+    uint64_t* source_ids;
+    BvhPrim* work;
+    void* bin_scratch;
+    uint32_t bin_scratch_capacity;
+} Bvh;
 
 // LOD System
 typedef struct LODLevel {
@@ -98,14 +400,52 @@ typedef struct WorldStreamer {
 } WorldStreamer;
 
 // Function prototypes
-OctreeNode* octree_create(float* bounds, int max_depth, int max_objects_per_node);
-void octree_insert(OctreeNode* node, uint64_t entity_id, float* position, float radius);
-void octree_remove(OctreeNode* node, uint64_t entity_id);
-void octree_query_range(OctreeNode* node, float* center, float radius, 
-                       uint64_t* results, uint32_t* result_count);
-void octree_query_frustum(OctreeNode* node, float frustum[6][4],
-                         uint64_t* results, uint32_t* result_count);
-void octree_destroy(OctreeNode* node);
+Octree* octree_create(float* bounds, int max_depth, int max_objects_per_node);
+bool octree_insert(Octree* tree, uint64_t entity_id, float* position, float radius);
+bool octree_remove(Octree* tree, uint64_t entity_id);
+bool octree_move(Octree* tree, uint64_t entity_id, float* position, float radius);
+uint32_t octree_query_range(const Octree* tree, const float* center, float radius,
+                            uint64_t* results, uint32_t capacity);
+bool octree_query_batch(const Octree* tree, JobSystem* jobs, SpatialQueryShape shape,
+                        const float* queries, uint32_t query_count,
+                        SpatialQueryResults* results);
+void spatial_query_results_free(SpatialQueryResults* results);
+bool octree_query_frustum(const Octree* tree, const float views[][6][4], uint32_t view_count,
+                          OctreeVisibleList* visible);
+void octree_visible_list_free(OctreeVisibleList* visible);
+bool octree_query_nearest(const Octree* tree, const float* point, uint32_t k, float max_distance,
+                          SpatialNeighbor* results, uint32_t* found, SpatialKnnScratch* scratch);
+bool octree_query_nearest_batch(const Octree* tree, JobSystem* jobs, const float* points,
+                                uint32_t point_count, uint32_t k, float max_distance,
+                                SpatialKnnResults* results);
+void spatial_knn_scratch_free(SpatialKnnScratch* scratch);
+void spatial_knn_results_free(SpatialKnnResults* results);
+void octree_destroy(Octree* tree);
+LinearOctree* linear_octree_create(uint32_t leaf_size);
+void linear_octree_destroy(LinearOctree* tree);
+bool linear_octree_build(LinearOctree* tree, JobSystem* jobs, const uint64_t* ids,
+                         const float* spheres, uint32_t count);
+uint32_t linear_octree_query_range(const LinearOctree* tree, const float* center, float radius,
+                                   uint64_t* results, uint32_t capacity);
+Bvh* bvh_create(void);
+void bvh_destroy(Bvh* bvh);
+bool bvh_build(Bvh* bvh, JobSystem* jobs, const uint64_t* ids, const float* aabbs, uint32_t count);
+bool bvh_refit(Bvh* bvh, JobSystem* jobs, const float* aabbs);
+uint32_t bvh_query_sphere(const Bvh* bvh, const float* center, float radius,
+                          uint64_t* results, uint32_t capacity);
+uint32_t bvh_query_frustum(const Bvh* bvh, const float frustum[6][4],
+                           uint64_t* results, uint32_t capacity);
+bool bvh_raycast(const Bvh* bvh, const float* origin, const float* direction, float max_distance,
+                 BvhRayFunc hit_func, void* user, BvhHit* hit);
+bool bvh_query_nearest(const Bvh* bvh, const float* point, uint32_t k, float max_distance,
+                       SpatialNeighbor* results, uint32_t* found, SpatialKnnScratch* scratch);
+bool bvh_query_nearest_batch(const Bvh* bvh, JobSystem* jobs, const float* points,
+                             uint32_t point_count, uint32_t k, float max_distance,
+                             SpatialKnnResults* results);
+bool aabb_contains_sphere(float* aabb, float* center, float radius);
+bool aabb_intersects_sphere(float* aabb, float* center, float radius);
+uint32_t min(uint32_t a, uint32_t b);
+uint32_t max(uint32_t a, uint32_t b);
 
 LODObject* lod_object_create(uint64_t object_id, Vector4 position, uint32_t lod_count);
 void lod_object_update(LODObject* obj, Vector4 viewer_position);
@@ -119,132 +459,2424 @@ void world_streamer_unload_chunk(WorldStreamer* streamer, int32_t x, int32_t y,
 bool world_streamer_is_chunk_visible(WorldStreamer* streamer, int32_t x, int32_t y, int32_t z);
 void* world_streamer_thread(void* arg);
 
-// Occlusion Culling System
-typedef struct OcclusionBuffer {
-    uint32_t width;
-    uint32_t height;
-    float* depth_buffer;
-    bool* visibility_buffer;
-    uint32_t* hierarchical_buffer;
-    uint32_t hiz_levels;
-} OcclusionBuffer;
+// Occlusion Culling System
+typedef struct OcclusionBuffer {
+    uint32_t width;
+    uint32_t height;
+    float* depth_buffer;
+    bool* visibility_buffer;
+    uint32_t* hierarchical_buffer;
+    uint32_t hiz_levels;
+} OcclusionBuffer;
+
+OcclusionBuffer* occlusion_buffer_create(uint32_t width, uint32_t height);
+void occlusion_buffer_clear(OcclusionBuffer* buffer);
+bool occlusion_buffer_test_aabb(OcclusionBuffer* buffer, float aabb_min[3], float aabb_max[3]);
+void occlusion_buffer_rasterize(OcclusionBuffer* buffer, float* vertices, uint32_t vertex_count);
+void occlusion_buffer_update_hiz(OcclusionBuffer* buffer);
+void occlusion_buffer_destroy(OcclusionBuffer* buffer);
+
+// Shared helpers
+static bool grow_buffer(void** buffer, size_t size) {
+    void* grown = realloc(*buffer, size);
+    if (!grown) return false;
+    *buffer = grown;
+    return true;
+}
+
+// Compare-and-select rather than fminf/fmaxf, which are library calls
+// without -ffast-math; NaN-free inputs are assumed
+static inline float span_min(float a, float b) { return a < b ? a : b; }
+static inline float span_max(float a, float b) { return a > b ? a : b; }
+
+// Squared distance from a point to a box, zero inside
+static inline float bounds_distance_sq(const float* box, const float* point) {
+    float d2 = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float d = span_max(box[axis * 2] - point[axis], 0.0f) +
+                  span_max(point[axis] - box[axis * 2 + 1], 0.0f);
+        d2 += d * d;
+    }
+    return d2;
+}
+
+// Octree implementation
+static OctreeNode* octree_node_create(Octree* tree, const float* bounds, OctreeNode* parent) {
+    OctreeNode* node = malloc(sizeof(OctreeNode));
+    if (!node) return NULL;
+    memset(node, 0, sizeof(OctreeNode));
+    
+    memcpy(node->bounds, bounds, 6 * sizeof(float));
+    
+    float half_min = INFINITY;
+    for (int axis = 0; axis < 3; axis++) {
+        float half = (bounds[axis * 2 + 1] - bounds[axis * 2]) * 0.5f;
+        float grow = (tree->looseness - 1.0f) * half;
+        node->loose[axis * 2] = bounds[axis * 2] - grow;
+        node->loose[axis * 2 + 1] = bounds[axis * 2 + 1] + grow;
+        half_min = fminf(half_min, half);
+    }
+    node->fit_radius = (tree->looseness - 1.0f) * half_min;
+    
+    node->parent = parent;
+    node->is_leaf = true;
+    node->depth = parent ? parent->depth + 1 : 0;
+    tree->node_count++;
+    
+    return node;
+}
+
+static void octree_node_free(Octree* tree, OctreeNode* node) {
+    if (!node->is_leaf) {
+        for (int i = 0; i < 8; i++) {
+            octree_node_free(tree, node->children[i]);
+        }
+    }
+    free(node->items);
+    free(node);
+    tree->node_count--;
+}
+
+Octree* octree_create(float* bounds, int max_depth, int max_objects_per_node) {
+    Octree* tree = malloc(sizeof(Octree));
+    if (!tree) return NULL;
+    memset(tree, 0, sizeof(Octree));
+    
+    tree->looseness = OCTREE_LOOSENESS;
+    tree->max_depth = max_depth > 0 ? max_depth : OCTREE_MAX_DEPTH;
+    if (tree->max_depth > OCTREE_DEPTH_LIMIT) tree->max_depth = OCTREE_DEPTH_LIMIT;
+    tree->max_objects_per_node = max_objects_per_node > 1 ? (uint32_t)max_objects_per_node : 2;
+    tree->index = entity_index_create(1024);
+    tree->root = octree_node_create(tree, bounds, NULL);
+    
+    if (!tree->index || !tree->root) {
+        octree_destroy(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+void octree_destroy(Octree* tree) {
+    if (!tree) return;
+    if (tree->root) octree_node_free(tree, tree->root);
+    if (tree->index) entity_index_destroy(tree->index);
+    free(tree->items);
+    free(tree);
+}
+
+static int octree_octant(const OctreeNode* node, const float* position) {
+    float mid_x = (node->bounds[0] + node->bounds[1]) * 0.5f;
+    float mid_y = (node->bounds[2] + node->bounds[3]) * 0.5f;
+    float mid_z = (node->bounds[4] + node->bounds[5]) * 0.5f;
+    
+    return (position[0] >= mid_x ? 1 : 0) |
+           (position[1] >= mid_y ? 2 : 0) |
+           (position[2] >= mid_z ? 4 : 0);
+}
+
+static bool octree_cell_contains(const OctreeNode* node, const float* position) {
+    return position[0] >= node->bounds[0] && position[0] <= node->bounds[1] &&
+           position[1] >= node->bounds[2] && position[1] <= node->bounds[3] &&
+           position[2] >= node->bounds[4] && position[2] <= node->bounds[5];
+}
+
+// Children all share one fit radius
+static inline bool octree_fits_children(const OctreeNode* node, float radius) {
+    return !node->is_leaf && radius <= node->children[0]->fit_radius;
+}
+
+// The node an entity belongs in under the current shape of the tree
+static OctreeNode* octree_place(Octree* tree, const float* position, float radius) {
+    OctreeNode* node = tree->root;
+    if (!octree_cell_contains(node, position)) return node;
+    
+    while (octree_fits_children(node, radius)) {
+        node = node->children[octree_octant(node, position)];
+    }
+    return node;
+}
+
+static void octree_grow_root(Octree* tree, const float* position, float radius) {
+    OctreeNode* root = tree->root;
+    for (int axis = 0; axis < 3; axis++) {
+        root->loose[axis * 2] = fminf(root->loose[axis * 2], position[axis] - radius);
+        root->loose[axis * 2 + 1] = fmaxf(root->loose[axis * 2 + 1], position[axis] + radius);
+    }
+}
+
+static bool octree_node_add(Octree* tree, OctreeNode* node, uint32_t item) {
+    if (node->item_count == node->item_capacity) {
+        uint32_t capacity = node->item_capacity ? node->item_capacity * 2 : 8;
+        uint32_t* items = realloc(node->items, sizeof(uint32_t) * capacity);
+        if (!items) return false;
+        node->items = items;
+        node->item_capacity = capacity;
+    }
+    
+    tree->items[item].node = node;
+    tree->items[item].slot = node->item_count;
+    node->items[node->item_count++] = item;
+    return true;
+}
+
+static void octree_node_take(Octree* tree, OctreeNode* node, uint32_t slot) {
+    uint32_t last = node->items[--node->item_count];
+    if (slot != node->item_count) {
+        node->items[slot] = last;
+        tree->items[last].slot = slot;
+    }
+}
+
+static void octree_count(OctreeNode* node, int delta) {
+    for (; node; node = node->parent) {
+        node->subtree_count += delta;
+    }
+}
+
+// Push this leaf's items down by their real positions; items too large for
+// a child stay here. Children that end up over capacity split in turn.
+static void octree_split(Octree* tree, OctreeNode* node) {
+    float mid_x = (node->bounds[0] + node->bounds[1]) * 0.5f;
+    float mid_y = (node->bounds[2] + node->bounds[3]) * 0.5f;
+    float mid_z = (node->bounds[4] + node->bounds[5]) * 0.5f;
+    
+    for (int i = 0; i < 8; i++) {
+        float child_bounds[6];
+        
+        // Determine child bounds based on octant
+        child_bounds[0] = (i & 1) ? mid_x : node->bounds[0];  // min_x
+        child_bounds[1] = (i & 1) ? node->bounds[1] : mid_x;  // max_x
+        child_bounds[2] = (i & 2) ? mid_y : node->bounds[2];  // min_y
+        child_bounds[3] = (i & 2) ? node->bounds[3] : mid_y;  // max_y
+        child_bounds[4] = (i & 4) ? mid_z : node->bounds[4];  // min_z
+        child_bounds[5] = (i & 4) ? node->bounds[5] : mid_z;  // max_z
+        
+        node->children[i] = octree_node_create(tree, child_bounds, node);
+        if (!node->children[i]) {
+            while (i-- > 0) octree_node_free(tree, node->children[i]);
+            return;  // Stay a leaf
+        }
+        for (int k = 0; k < 6; k++) {
+            node->child_loose[k][i] = node->children[i]->loose[k];
+        }
+    }
+    node->is_leaf = false;
+    
+    // Redistribute entities to children, in place
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < node->item_count; i++) {
+        uint32_t item = node->items[i];
+        OctreeItem* entry = &tree->items[item];
+        
+        if (entry->radius <= node->children[0]->fit_radius &&
+            octree_cell_contains(node, entry->position)) {
+            OctreeNode* child = node->children[octree_octant(node, entry->position)];
+            if (octree_node_add(tree, child, item)) {
+                child->subtree_count++;
+                continue;
+            }
+        }
+        entry->slot = kept;
+        node->items[kept++] = item;
+    }
+    node->item_count = kept;
+    
+    for (int i = 0; i < 8; i++) {
+        OctreeNode* child = node->children[i];
+        if (child->item_count > tree->max_objects_per_node && child->depth < tree->max_depth) {
+            octree_split(tree, child);
+        }
+    }
+}
+
+// Pull every item below node back into it and drop the children
+static void octree_gather(Octree* tree, OctreeNode* node, OctreeNode* child) {
+    for (uint32_t i = 0; i < child->item_count; i++) {
+        octree_node_add(tree, node, child->items[i]);
+    }
+    if (!child->is_leaf) {
+        for (int i = 0; i < 8; i++) {
+            octree_gather(tree, node, child->children[i]);
+        }
+    }
+}
+
+static void octree_collapse(Octree* tree, OctreeNode* node) {
+    uint32_t needed = node->subtree_count;
+    if (needed > node->item_capacity) {
+        uint32_t* items = realloc(node->items, sizeof(uint32_t) * needed);
+        if (!items) return;  // Keep the children
+        node->items = items;
+        node->item_capacity = needed;
+    }
+    
+    for (int i = 0; i < 8; i++) {
+        octree_gather(tree, node, node->children[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        octree_node_free(tree, node->children[i]);
+        node->children[i] = NULL;
+    }
+    node->is_leaf = true;
+}
+
+static bool octree_link(Octree* tree, uint32_t item) {
+    OctreeItem* entry = &tree->items[item];
+    OctreeNode* node = octree_place(tree, entry->position, entry->radius);
+    
+    if (!octree_node_add(tree, node, item)) {
+        // Try the root, whose list already has room more often than not
+        if (node == tree->root) return false;
+        node = tree->root;
+        if (!octree_node_add(tree, node, item)) return false;
+    }
+    if (node == tree->root) octree_grow_root(tree, entry->position, entry->radius);
+    octree_count(node, 1);
+    
+    if (node->is_leaf && node->item_count > tree->max_objects_per_node &&
+        node->depth < tree->max_depth) {
+        octree_split(tree, node);
+    }
+    return true;
+}
+
+// Detach an item from its node, collapsing the largest ancestor subtree
+// that has become sparse enough
+static void octree_unlink(Octree* tree, uint32_t item) {
+    OctreeNode* node = tree->items[item].node;
+    octree_node_take(tree, node, tree->items[item].slot);
+    octree_count(node, -1);
+    
+    OctreeNode* collapse = NULL;
+    for (OctreeNode* up = node->is_leaf ? node->parent : node; up; up = up->parent) {
+        if (up->subtree_count > tree->max_objects_per_node / 2) break;
+        collapse = up;
+    }
+    if (collapse) octree_collapse(tree, collapse);
+}
+
+bool octree_insert(Octree* tree, uint64_t entity_id, float* position, float radius) {
+    if (tree->item_count == tree->item_capacity) {
+        uint32_t capacity = tree->item_capacity ? tree->item_capacity * 2 : 1024;
+        OctreeItem* items = realloc(tree->items, sizeof(OctreeItem) * capacity);
+        if (!items) return false;
+        tree->items = items;
+        tree->item_capacity = capacity;
+    }
+    
+    // Duplicate ids are rejected by the index
+    if (entity_index_insert(tree->index, entity_id) == ENTITY_HANDLE_INVALID) return false;
+    
+    uint32_t item = tree->item_count++;
+    OctreeItem* entry = &tree->items[item];
+    entry->entity_id = entity_id;
+    memcpy(entry->position, position, 3 * sizeof(float));
+    entry->radius = radius;
+    
+    if (!octree_link(tree, item)) {
+        entity_index_remove(tree->index, entity_id);
+        tree->item_count--;
+        return false;
+    }
+    return true;
+}
+
+// Forget an unlinked item, mirroring the index's swap-remove on the items
+static void octree_drop(Octree* tree, uint32_t item) {
+    entity_index_remove(tree->index, tree->items[item].entity_id);
+    uint32_t last = --tree->item_count;
+    if (item != last) {
+        tree->items[item] = tree->items[last];
+        tree->items[item].node->items[tree->items[item].slot] = item;
+    }
+}
+
+bool octree_remove(Octree* tree, uint64_t entity_id) {
+    uint32_t item = entity_index_lookup(tree->index, entity_id);
+    if (item == ENTITY_INDEX_NONE) return false;
+    
+    octree_unlink(tree, item);
+    octree_drop(tree, item);
+    return true;
+}
+
+// Update an entity's sphere. When it still belongs in the same node this is
+// just a store; otherwise it is relinked from its node (and dropped from
+// the tree if that runs out of memory).
+bool octree_move(Octree* tree, uint64_t entity_id, float* position, float radius) {
+    uint32_t item = entity_index_lookup(tree->index, entity_id);
+    if (item == ENTITY_INDEX_NONE) return false;
+    
+    OctreeItem* entry = &tree->items[item];
+    OctreeNode* node = entry->node;
+    
+    memcpy(entry->position, position, 3 * sizeof(float));
+    entry->radius = radius;
+    
+    if (node == tree->root) {
+        if (!octree_cell_contains(node, position) || !octree_fits_children(node, radius)) {
+            octree_grow_root(tree, position, radius);
+            return true;
+        }
+    } else if (octree_cell_contains(node, position) && radius <= node->fit_radius &&
+               !octree_fits_children(node, radius)) {
+        return true;
+    }
+    
+    octree_unlink(tree, item);
+    if (!octree_link(tree, item)) {
+        octree_drop(tree, item);
+        return false;
+    }
+    return true;
+}
+
+// Octree queries
+static bool spatial_query_chunk_grow(SpatialQueryChunk* out) {
+    uint32_t capacity = out->capacity ? out->capacity * 2 : 256;
+    if (capacity <= out->capacity ||
+        !grow_buffer((void**)&out->ids, sizeof(uint64_t) * capacity)) {
+        out->failed = true;
+        out->growable = false;
+        return false;
+    }
+    out->capacity = capacity;
+    return true;
+}
+
+static inline void spatial_query_emit(SpatialQueryChunk* out, uint64_t id) {
+    if (out->count >= out->capacity && out->growable) spatial_query_chunk_grow(out);
+    if (out->count < out->capacity) out->ids[out->count] = id;
+    out->count++;
+}
+
+static inline bool octree_box_touches(const float* box, SpatialQueryShape shape,
+                                      const float* query) {
+    if (shape == SPATIAL_QUERY_SPHERE) {
+        return bounds_distance_sq(box, query) <= query[3] * query[3];
+    }
+    return box[0] <= query[1] && box[1] >= query[0] &&
+           box[2] <= query[3] && box[3] >= query[2] &&
+           box[4] <= query[5] && box[5] >= query[4];
+}
+
+static inline bool octree_item_touches(const OctreeItem* entry, SpatialQueryShape shape,
+                                       const float* query) {
+    float d2 = 0.0f;
+    float reach = entry->radius;
+    if (shape == SPATIAL_QUERY_SPHERE) {
+        for (int axis = 0; axis < 3; axis++) {
+            float d = entry->position[axis] - query[axis];
+            d2 += d * d;
+        }
+        reach += query[3];
+    } else {
+        for (int axis = 0; axis < 3; axis++) {
+            float d = span_max(query[axis * 2] - entry->position[axis], 0.0f) +
+                      span_max(entry->position[axis] - query[axis * 2 + 1], 0.0f);
+            d2 += d * d;
+        }
+    }
+    return d2 <= reach * reach;
+}
+
+// Bit c set when child c's loose bounds touch the query
+static inline uint32_t octree_children_touch(const OctreeNode* node, SpatialQueryShape shape,
+                                             const float* query) {
+    uint32_t mask = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    for (int half = 0; half < 8; half += 4) {
+        __m128 hit;
+        if (shape == SPATIAL_QUERY_SPHERE) {
+            __m128 d2 = zero;
+            for (int axis = 0; axis < 3; axis++) {
+                __m128 c = _mm_set1_ps(query[axis]);
+                __m128 lo = _mm_loadu_ps(&node->child_loose[axis * 2][half]);
+                __m128 hi = _mm_loadu_ps(&node->child_loose[axis * 2 + 1][half]);
+                __m128 d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(lo, c), zero),
+                                      _mm_max_ps(_mm_sub_ps(c, hi), zero));
+                d2 = _mm_add_ps(d2, _mm_mul_ps(d, d));
+            }
+            hit = _mm_cmple_ps(d2, _mm_set1_ps(query[3] * query[3]));
+        } else {
+            hit = _mm_cmpeq_ps(zero, zero);
+            for (int axis = 0; axis < 3; axis++) {
+                __m128 lo = _mm_loadu_ps(&node->child_loose[axis * 2][half]);
+                __m128 hi = _mm_loadu_ps(&node->child_loose[axis * 2 + 1][half]);
+                hit = _mm_and_ps(hit, _mm_cmple_ps(lo, _mm_set1_ps(query[axis * 2 + 1])));
+                hit = _mm_and_ps(hit, _mm_cmpge_ps(hi, _mm_set1_ps(query[axis * 2])));
+            }
+        }
+        mask |= (uint32_t)_mm_movemask_ps(hit) << half;
+    }
+#else
+    for (int c = 0; c < 8; c++) {
+        float box[6];
+        for (int k = 0; k < 6; k++) box[k] = node->child_loose[k][c];
+        if (octree_box_touches(box, shape, query)) mask |= 1u << c;
+    }
+#endif
+    return mask;
+}
+
+// Depth-first over the nodes whose loose bounds touch the query, children
+// visited in octant order. Read-only, so queries may run concurrently with
+// each other but not with insert/remove/move.
+static void octree_collect(const Octree* tree, SpatialQueryShape shape, const float* query,
+                           SpatialQueryChunk* out) {
+    const OctreeNode* stack[OCTREE_QUERY_STACK];
+    uint32_t top = 0;
+    
+    if (!tree->root->subtree_count || !octree_box_touches(tree->root->loose, shape, query)) {
+        return;
+    }
+    stack[top++] = tree->root;
+    
+    while (top > 0) {
+        const OctreeNode* node = stack[--top];
+        for (uint32_t i = 0; i < node->item_count; i++) {
+            const OctreeItem* entry = &tree->items[node->items[i]];
+            if (octree_item_touches(entry, shape, query)) {
+                spatial_query_emit(out, entry->entity_id);
+            }
+        }
+        if (node->is_leaf) continue;
+        
+        // Highest octant pushed first so the lowest is visited first
+        uint32_t mask = octree_children_touch(node, shape, query);
+        while (mask) {
+            int c = 31 - __builtin_clz(mask);
+            mask &= ~(1u << c);
+            if (node->children[c]->subtree_count) stack[top++] = node->children[c];
+        }
+    }
+}
+
+// Entities whose sphere touches the query sphere. Writes up to capacity ids
+// and returns the total number of matches.
+uint32_t octree_query_range(const Octree* tree, const float* center, float radius,
+                            uint64_t* results, uint32_t capacity) {
+    float query[4] = { center[0], center[1], center[2], radius };
+    SpatialQueryChunk out = { results, 0, capacity, false, false };
+    octree_collect(tree, SPATIAL_QUERY_SPHERE, query, &out);
+    return out.count;
+}
+
+typedef struct {
+    const Octree* tree;
+    SpatialQueryShape shape;
+    const float* queries;
+    uint32_t stride;        // Floats per query
+    uint32_t query_count;
+    SpatialQueryResults* results;
+} OctreeBatchTask;
+
+// Each job collects its queries into its own chunk, leaving per-query
+// counts in offsets[q + 1]
+static void octree_query_chunks(void* data, uint32_t begin, uint32_t end) {
+    OctreeBatchTask* task = (OctreeBatchTask*)data;
+    SpatialQueryResults* results = task->results;
+    
+    for (uint32_t c = begin; c < end; c++) {
+        SpatialQueryChunk* out = &results->chunks[c];
+        out->count = 0;
+        out->growable = true;
+        out->failed = false;
+        
+        uint32_t first = c * OCTREE_QUERY_GRAIN;
+        uint32_t last = min(first + OCTREE_QUERY_GRAIN, task->query_count);
+        for (uint32_t q = first; q < last; q++) {
+            uint32_t before = out->count;
+            octree_collect(task->tree, task->shape, &task->queries[(size_t)q * task->stride], out);
+            results->offsets[q + 1] = out->count - before;
+        }
+    }
+}
+
+// Chunks are in query order, so each lands at its first query's offset
+static void octree_copy_chunks(void* data, uint32_t begin, uint32_t end) {
+    OctreeBatchTask* task = (OctreeBatchTask*)data;
+    SpatialQueryResults* results = task->results;
+    
+    for (uint32_t c = begin; c < end; c++) {
+        const SpatialQueryChunk* out = &results->chunks[c];
+        if (out->count == 0) continue;
+        memcpy(&results->ids[results->offsets[c * OCTREE_QUERY_GRAIN]], out->ids,
+               sizeof(uint64_t) * out->count);
+    }
+}
+
+static bool spatial_query_reserve(void** buffer, uint32_t* capacity, uint32_t count,
+                                  size_t element) {
+    if (count <= *capacity) return true;
+    
+    uint32_t grown = *capacity ? *capacity : 64;
+    while (grown < count) grown = grown > UINT32_MAX / 2 ? UINT32_MAX : grown * 2;
+    if (!grow_buffer(buffer, element * grown)) return false;
+    *capacity = grown;
+    return true;
+}
+
+// Run query_count queries of one shape, packed in queries at 4 (sphere) or
+// 6 (AABB) floats each, and fill results in CSR form. Spheres match
+// entities whose sphere they touch; boxes match entities whose sphere
+// touches the box. Queries are handed to jobs OCTREE_QUERY_GRAIN at a
+// time; jobs may be NULL. Nothing is ever truncated: returns false, with
+// results left empty, only if a buffer could not grow.
+bool octree_query_batch(const Octree* tree, JobSystem* jobs, SpatialQueryShape shape,
+                        const float* queries, uint32_t query_count,
+                        SpatialQueryResults* results) {
+    PROFILE_ZONE("Octree batch query");
+    results->query_count = 0;
+    results->id_count = 0;
+    if (query_count == UINT32_MAX ||
+        !spatial_query_reserve((void**)&results->offsets, &results->offset_capacity,
+                               query_count + 1, sizeof(uint32_t))) {
+        return false;
+    }
+    results->offsets[0] = 0;
+    if (query_count == 0) return true;
+    
+    uint32_t chunk_count = (query_count + OCTREE_QUERY_GRAIN - 1) / OCTREE_QUERY_GRAIN;
+    if (chunk_count > results->chunk_capacity) {
+        if (!grow_buffer((void**)&results->chunks, sizeof(SpatialQueryChunk) * chunk_count)) {
+            return false;
+        }
+        memset(&results->chunks[results->chunk_capacity], 0,
+               sizeof(SpatialQueryChunk) * (chunk_count - results->chunk_capacity));
+        results->chunk_capacity = chunk_count;
+    }
+    
+    OctreeBatchTask task = {
+        tree, shape, queries, shape == SPATIAL_QUERY_SPHERE ? 4 : 6, query_count, results
+    };
+    job_parallel_for(jobs, chunk_count, 1, octree_query_chunks, &task);
+    
+    for (uint32_t c = 0; c < chunk_count; c++) {
+        if (results->chunks[c].failed) return false;
+    }
+    
+    uint64_t total = 0;
+    for (uint32_t q = 1; q <= query_count; q++) {
+        total += results->offsets[q];
+        if (total > UINT32_MAX) return false;
+        results->offsets[q] = (uint32_t)total;
+    }
+    
+    if (!spatial_query_reserve((void**)&results->ids, &results->id_capacity, (uint32_t)total,
+                               sizeof(uint64_t))) {
+        return false;
+    }
+    job_parallel_for(jobs, chunk_count, 1, octree_copy_chunks, &task);
+    
+    results->query_count = query_count;
+    results->id_count = (uint32_t)total;
+    return true;
+}
+
+void spatial_query_results_free(SpatialQueryResults* results) {
+    for (uint32_t c = 0; c < results->chunk_capacity; c++) {
+        free(results->chunks[c].ids);
+    }
+    free(results->chunks);
+    free(results->offsets);
+    free(results->ids);
+    memset(results, 0, sizeof(SpatialQueryResults));
+}
+
+// Frustum traversal state. Bit v * 6 + p of planes is set while plane p of
+// view v still has to be tested below the node; bit v of views is set
+// while view v may still see something there. A node fully inside a plane
+// clears that plane for its whole subtree, so once no planes are left the
+// subtree is accepted without further tests.
+typedef struct {
+    const OctreeNode* node;
+    uint32_t planes;
+    uint32_t views;
+} OctreeFrustumEntry;
+
+typedef struct {
+    const float (*views)[6][4];
+    uint32_t view_count;
+    uint8_t last_reject[OCTREE_MAX_VIEWS];  // Tried first on the next entity
+    OctreeVisibleList* visible;
+    bool failed;
+} OctreeFrustumQuery;
+
+// Box against one plane: -1 entirely behind it, 1 entirely in front, 0 across
+static inline int octree_box_plane_side(const float* box, const float* plane) {
+    float s = plane[3], e = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float center = (box[axis * 2] + box[axis * 2 + 1]) * 0.5f;
+        float half = (box[axis * 2 + 1] - box[axis * 2]) * 0.5f;
+        s += plane[axis] * center;
+        e += fabsf(plane[axis]) * half;
+    }
+    return s + e < 0.0f ? -1 : (s - e >= 0.0f ? 1 : 0);
+}
+
+// Children entirely behind one plane (bit c of *outside) or entirely in
+// front of it (bit c of *inside)
+static inline void octree_children_plane(const OctreeNode* node, const float* plane,
+                                         uint32_t* outside, uint32_t* inside) {
+    *outside = 0;
+    *inside = 0;
+#if defined(__SSE2__)
+    const __m128 half_scale = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (int half = 0; half < 8; half += 4) {
+        __m128 s = _mm_set1_ps(plane[3]);
+        __m128 e = _mm_setzero_ps();
+        for (int axis = 0; axis < 3; axis++) {
+            __m128 lo = _mm_loadu_ps(&node->child_loose[axis * 2][half]);
+            __m128 hi = _mm_loadu_ps(&node->child_loose[axis * 2 + 1][half]);
+            __m128 n = _mm_set1_ps(plane[axis]);
+            s = _mm_add_ps(s, _mm_mul_ps(n, _mm_mul_ps(_mm_add_ps(lo, hi), half_scale)));
+            e = _mm_add_ps(e, _mm_mul_ps(_mm_andnot_ps(sign, n),
+                                         _mm_mul_ps(_mm_sub_ps(hi, lo), half_scale)));
+        }
+        *outside |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(s, e), _mm_setzero_ps())) << half;
+        *inside |= (uint32_t)_mm_movemask_ps(_mm_cmpge_ps(_mm_sub_ps(s, e), _mm_setzero_ps())) << half;
+    }
+#else
+    for (int c = 0; c < 8; c++) {
+        float box[6];
+        for (int k = 0; k < 6; k++) box[k] = node->child_loose[k][c];
+        int side = octree_box_plane_side(box, plane);
+        if (side < 0) *outside |= 1u << c;
+        else if (side > 0) *inside |= 1u << c;
+    }
+#endif
+}
+
+// Views in which the entity's sphere survives the planes still active. The
+// plane that rejected the previous entity is tried first: neighbours in
+// the traversal tend to fall outside the same plane.
+static inline uint32_t octree_item_views(OctreeFrustumQuery* query, const OctreeItem* entry,
+                                         uint32_t planes, uint32_t views) {
+    uint32_t seen = 0;
+    for (uint32_t v = 0; v < query->view_count; v++) {
+        if (!((views >> v) & 1)) continue;
+        
+        const float (*frustum)[4] = query->views[v];
+        uint32_t active = (planes >> (v * 6)) & 0x3F;
+        uint32_t first = query->last_reject[v];
+        bool inside = true;
+        
+        if ((active >> first) & 1) {
+            const float* plane = frustum[first];
+            inside = plane[0] * entry->position[0] + plane[1] * entry->position[1] +
+                     plane[2] * entry->position[2] + plane[3] >= -entry->radius;
+            active &= ~(1u << first);
+        }
+        while (inside && active) {
+            uint32_t p = (uint32_t)__builtin_ctz(active);
+            const float* plane = frustum[p];
+            active &= active - 1;
+            if (plane[0] * entry->position[0] + plane[1] * entry->position[1] +
+                plane[2] * entry->position[2] + plane[3] < -entry->radius) {
+                query->last_reject[v] = (uint8_t)p;
+                inside = false;
+            }
+        }
+        if (inside) seen |= 1u << v;
+    }
+    return seen;
+}
+
+static bool octree_visible_reserve(OctreeVisibleList* visible, uint32_t count) {
+    if (count <= visible->capacity) return true;
+    
+    uint32_t capacity = visible->capacity ? visible->capacity : 256;
+    while (capacity < count) {
+        if (capacity > UINT32_MAX / 2) return false;
+        capacity *= 2;
+    }
+    if (!grow_buffer((void**)&visible->ids, sizeof(uint64_t) * capacity) ||
+        !grow_buffer((void**)&visible->view_masks, capacity)) {
+        return false;
+    }
+    visible->capacity = capacity;
+    return true;
+}
+
+static inline void octree_visible_emit(OctreeFrustumQuery* query, uint64_t id, uint32_t views) {
+    OctreeVisibleList* visible = query->visible;
+    if (!octree_visible_reserve(visible, visible->count + 1)) {
+        query->failed = true;
+        return;
+    }
+    visible->ids[visible->count] = id;
+    visible->view_masks[visible->count] = (uint8_t)views;
+    visible->count++;
+}
+
+// Entities whose sphere is not entirely behind any plane of at least one
+// view, written to visible (which is cleared first). Nodes are tested by
+// their loose bounds, eight children at a time, carrying the planes their
+// parent has not yet passed; a subtree inside every remaining plane is
+// taken whole. Returns false if view_count is not 1..OCTREE_MAX_VIEWS, or
+// if the list could not grow, in which case it holds only part of the set.
+bool octree_query_frustum(const Octree* tree, const float views[][6][4], uint32_t view_count,
+                          OctreeVisibleList* visible) {
+    PROFILE_ZONE("Octree frustum query");
+    visible->count = 0;
+    if (view_count == 0 || view_count > OCTREE_MAX_VIEWS) return false;
+    
+    OctreeFrustumQuery query = { views, view_count, { 0 }, visible, false };
+    OctreeFrustumEntry stack[OCTREE_QUERY_STACK];
+    uint32_t top = 0;
+    
+    // Root against every plane
+    const OctreeNode* root = tree->root;
+    uint32_t planes = 0, alive = 0;
+    for (uint32_t v = 0; v < view_count && root->subtree_count; v++) {
+        uint32_t view_planes = 0;
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; p++) {
+            int side = octree_box_plane_side(root->loose, views[v][p]);
+            if (side < 0) outside = true;
+            else if (side == 0) view_planes |= 1u << p;
+        }
+        if (outside) continue;
+        alive |= 1u << v;
+        planes |= view_planes << (v * 6);
+    }
+    if (alive) stack[top++] = (OctreeFrustumEntry){ root, planes, alive };
+    
+    while (top > 0 && !query.failed) {
+        OctreeFrustumEntry entry = stack[--top];
+        const OctreeNode* node = entry.node;
+        
+        if (!entry.planes) {
+            // Inside everything still in play: take the subtree untested
+            for (uint32_t i = 0; i < node->item_count; i++) {
+                octree_visible_emit(&query, tree->items[node->items[i]].entity_id, entry.views);
+            }
+            if (node->is_leaf) continue;
+            for (int c = 7; c >= 0; c--) {
+                if (node->children[c]->subtree_count) {
+                    stack[top++] = (OctreeFrustumEntry){ node->children[c], 0, entry.views };
+                }
+            }
+            continue;
+        }
+        
+        for (uint32_t i = 0; i < node->item_count; i++) {
+            const OctreeItem* item = &tree->items[node->items[i]];
+            uint32_t seen = octree_item_views(&query, item, entry.planes, entry.views);
+            if (seen) octree_visible_emit(&query, item->entity_id, seen);
+        }
+        if (node->is_leaf) continue;
+        
+        // Only the planes the parent straddles are tested on the children
+        uint32_t dead[OCTREE_MAX_VIEWS] = { 0 };
+        uint32_t inside[OCTREE_MAX_VIEWS * 6];
+        for (uint32_t remaining = entry.planes; remaining; remaining &= remaining - 1) {
+            uint32_t bit = (uint32_t)__builtin_ctz(remaining);
+            uint32_t outside;
+            octree_children_plane(node, views[bit / 6][bit % 6], &outside, &inside[bit]);
+            dead[bit / 6] |= outside;
+        }
+        
+        for (int c = 7; c >= 0; c--) {
+            const OctreeNode* child = node->children[c];
+            if (!child->subtree_count) continue;
+            
+            uint32_t child_views = entry.views;
+            uint32_t child_planes = entry.planes;
+            for (uint32_t v = 0; v < view_count; v++) {
+                if ((dead[v] >> c) & 1) {
+                    child_views &= ~(1u << v);
+                    child_planes &= ~(0x3Fu << (v * 6));
+                }
+            }
+            if (!child_views) continue;
+            for (uint32_t remaining = child_planes; remaining; remaining &= remaining - 1) {
+                uint32_t bit = (uint32_t)__builtin_ctz(remaining);
+                if ((inside[bit] >> c) & 1) child_planes &= ~(1u << bit);
+            }
+            stack[top++] = (OctreeFrustumEntry){ child, child_planes, child_views };
+        }
+    }
+    return !query.failed;
+}
+
+void octree_visible_list_free(OctreeVisibleList* visible) {
+    free(visible->ids);
+    free(visible->view_masks);
+    memset(visible, 0, sizeof(OctreeVisibleList));
+}
+
+// Nearest-neighbour heaps, shared with the BVH
+static bool knn_queue_push(SpatialKnnScratch* scratch, float distance, const void* node) {
+    if (scratch->count == scratch->capacity) {
+        uint32_t capacity = scratch->capacity ? scratch->capacity * 2 : 64;
+        if (capacity <= scratch->capacity ||
+            !grow_buffer((void**)&scratch->queue, sizeof(SpatialKnnEntry) * capacity)) {
+            return false;
+        }
+        scratch->capacity = capacity;
+    }
+    
+    SpatialKnnEntry* queue = scratch->queue;
+    uint32_t i = scratch->count++;
+    while (i > 0 && queue[(i - 1) / 2].distance > distance) {
+        queue[i] = queue[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue[i] = (SpatialKnnEntry){ distance, node };
+    return true;
+}
+
+static SpatialKnnEntry knn_queue_pop(SpatialKnnScratch* scratch) {
+    SpatialKnnEntry* queue = scratch->queue;
+    SpatialKnnEntry top = queue[0];
+    SpatialKnnEntry last = queue[--scratch->count];
+    uint32_t count = scratch->count;
+    
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count && queue[child + 1].distance < queue[child].distance) child++;
+        if (queue[child].distance >= last.distance) break;
+        queue[i] = queue[child];
+        i = child;
+    }
+    if (count) queue[i] = last;
+    return top;
+}
+
+static void knn_best_sift_down(SpatialNeighbor* best, uint32_t count, uint32_t i) {
+    SpatialNeighbor moving = best[i];
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count && best[child + 1].distance > best[child].distance) child++;
+        if (best[child].distance <= moving.distance) break;
+        best[i] = best[child];
+        i = child;
+    }
+    best[i] = moving;
+}
+
+// Offer a candidate to the k best (a max-heap on squared distance)
+static inline void knn_best_offer(SpatialNeighbor* best, uint32_t* found, uint32_t k,
+                                  uint64_t id, float distance) {
+    if (*found < k) {
+        uint32_t i = (*found)++;
+        while (i > 0 && best[(i - 1) / 2].distance < distance) {
+            best[i] = best[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        best[i] = (SpatialNeighbor){ id, distance };
+    } else if (distance < best[0].distance) {
+        best[0] = (SpatialNeighbor){ id, distance };
+        knn_best_sift_down(best, k, 0);
+    }
+}
+
+// Distance to beat: the kth best once there are k, else the search radius
+static inline float knn_limit(const SpatialNeighbor* best, uint32_t found, uint32_t k,
+                              float max_distance_sq) {
+    return found == k ? span_min(best[0].distance, max_distance_sq) : max_distance_sq;
+}
+
+// Heap-sort the k best into nearest-first order with real distances
+static void knn_best_finish(SpatialNeighbor* best, uint32_t found) {
+    for (uint32_t n = found; n > 1; n--) {
+        SpatialNeighbor top = best[0];
+        best[0] = best[n - 1];
+        best[n - 1] = top;
+        knn_best_sift_down(best, n - 1, 0);
+    }
+    for (uint32_t i = 0; i < found; i++) best[i].distance = sqrtf(best[i].distance);
+}
+
+// The k entities whose centers are nearest to point and no further than
+// max_distance (INFINITY for no limit), nearest first, into results (room
+// for k). Below the root every entity's center lies in its node's cell, so
+// children are ranked by their cells rather than their loose bounds.
+// Returns false only if the scratch queue could not grow.
+bool octree_query_nearest(const Octree* tree, const float* point, uint32_t k, float max_distance,
+                          SpatialNeighbor* results, uint32_t* found, SpatialKnnScratch* scratch) {
+    *found = 0;
+    scratch->count = 0;
+    if (k == 0 || !tree->root->subtree_count || !(max_distance >= 0.0f)) return true;
+    
+    float max_distance_sq = max_distance * max_distance;
+    if (!knn_queue_push(scratch, 0.0f, tree->root)) return false;
+    
+    while (scratch->count > 0) {
+        SpatialKnnEntry entry = knn_queue_pop(scratch);
+        float limit = knn_limit(results, *found, k, max_distance_sq);
+        if (entry.distance > limit) break;
+        
+        const OctreeNode* node = entry.node;
+        for (uint32_t i = 0; i < node->item_count; i++) {
+            const OctreeItem* item = &tree->items[node->items[i]];
+            float d2 = 0.0f;
+            for (int axis = 0; axis < 3; axis++) {
+                float d = item->position[axis] - point[axis];
+                d2 += d * d;
+            }
+            if (d2 <= limit) {
+                knn_best_offer(results, found, k, item->entity_id, d2);
+                limit = knn_limit(results, *found, k, max_distance_sq);
+            }
+        }
+        if (node->is_leaf) continue;
+        
+        // Per axis, the distance to the low and the high half of the cell
+        float halves[3][2];
+        for (int axis = 0; axis < 3; axis++) {
+            float lo = node->bounds[axis * 2], hi = node->bounds[axis * 2 + 1];
+            float mid = (lo + hi) * 0.5f;
+            float p = point[axis];
+            float below = span_max(lo - p, 0.0f) + span_max(p - mid, 0.0f);
+            float above = span_max(mid - p, 0.0f) + span_max(p - hi, 0.0f);
+            halves[axis][0] = below * below;
+            halves[axis][1] = above * above;
+        }
+        for (int c = 0; c < 8; c++) {
+            const OctreeNode* child = node->children[c];
+            if (!child->subtree_count) continue;
+            float d2 = halves[0][c & 1] + halves[1][(c >> 1) & 1] + halves[2][(c >> 2) & 1];
+            if (d2 <= limit && !knn_queue_push(scratch, d2, child)) return false;
+        }
+    }
+    knn_best_finish(results, *found);
+    return true;
+}
+
+typedef bool (*SpatialKnnFunc)(const void* index, const float* point, uint32_t k,
+                               float max_distance, SpatialNeighbor* results, uint32_t* found,
+                               SpatialKnnScratch* scratch);
+
+typedef struct {
+    const void* index;
+    SpatialKnnFunc query;
+    const float* points;
+    uint32_t point_count;
+    uint32_t k;
+    float max_distance;
+    SpatialKnnResults* results;
+} SpatialKnnTask;
+
+static void spatial_knn_chunks(void* data, uint32_t begin, uint32_t end) {
+    SpatialKnnTask* task = (SpatialKnnTask*)data;
+    SpatialKnnResults* results = task->results;
+    
+    for (uint32_t c = begin; c < end; c++) {
+        SpatialKnnScratch* scratch = &results->scratch[c];
+        scratch->failed = false;
+        
+        uint32_t first = c * SPATIAL_KNN_GRAIN;
+        uint32_t last = min(first + SPATIAL_KNN_GRAIN, task->point_count);
+        for (uint32_t q = first; q < last; q++) {
+            if (!task->query(task->index, &task->points[(size_t)q * 3], task->k,
+                             task->max_distance, &results->neighbors[(size_t)q * task->k],
+                             &results->counts[q], scratch)) {
+                scratch->failed = true;
+            }
+        }
+    }
+}
+
+// Nearest neighbours of point_count points (3 floats each), spread over
+// jobs SPATIAL_KNN_GRAIN queries at a time; jobs may be NULL. Returns false,
+// with results empty, only if a buffer could not grow.
+static bool spatial_knn_batch(const void* index, SpatialKnnFunc query, JobSystem* jobs,
+                              const float* points, uint32_t point_count, uint32_t k,
+                              float max_distance, SpatialKnnResults* results) {
+    results->query_count = 0;
+    results->k = k;
+    if (point_count == 0) return true;
+    if ((uint64_t)point_count * k > UINT32_MAX) return false;
+    
+    uint32_t slots = point_count * k;
+    if (!spatial_query_reserve((void**)&results->neighbors, &results->neighbor_capacity,
+                               slots ? slots : 1, sizeof(SpatialNeighbor)) ||
+        !spatial_query_reserve((void**)&results->counts, &results->count_capacity,
+                               point_count, sizeof(uint32_t))) {
+        return false;
+    }
+    
+    uint32_t chunk_count = (point_count + SPATIAL_KNN_GRAIN - 1) / SPATIAL_KNN_GRAIN;
+    if (chunk_count > results->scratch_capacity) {
+        if (!grow_buffer((void**)&results->scratch, sizeof(SpatialKnnScratch) * chunk_count)) {
+            return false;
+        }
+        memset(&results->scratch[results->scratch_capacity], 0,
+               sizeof(SpatialKnnScratch) * (chunk_count - results->scratch_capacity));
+        results->scratch_capacity = chunk_count;
+    }
+    
+    SpatialKnnTask task = { index, query, points, point_count, k, max_distance, results };
+    job_parallel_for(jobs, chunk_count, 1, spatial_knn_chunks, &task);
+    
+    for (uint32_t c = 0; c < chunk_count; c++) {
+        if (results->scratch[c].failed) return false;
+    }
+    results->query_count = point_count;
+    return true;
+}
+
+static bool octree_knn_query(const void* index, const float* point, uint32_t k, float max_distance,
+                             SpatialNeighbor* results, uint32_t* found,
+                             SpatialKnnScratch* scratch) {
+    return octree_query_nearest((const Octree*)index, point, k, max_distance, results, found,
+                                scratch);
+}
+
+bool octree_query_nearest_batch(const Octree* tree, JobSystem* jobs, const float* points,
+                                uint32_t point_count, uint32_t k, float max_distance,
+                                SpatialKnnResults* results) {
+    PROFILE_ZONE("Octree nearest batch");
+    return spatial_knn_batch(tree, octree_knn_query, jobs, points, point_count, k, max_distance,
+                             results);
+}
+
+void spatial_knn_scratch_free(SpatialKnnScratch* scratch) {
+    free(scratch->queue);
+    memset(scratch, 0, sizeof(SpatialKnnScratch));
+}
+
+void spatial_knn_results_free(SpatialKnnResults* results) {
+    for (uint32_t c = 0; c < results->scratch_capacity; c++) {
+        free(results->scratch[c].queue);
+    }
+    free(results->scratch);
+    free(results->neighbors);
+    free(results->counts);
+    memset(results, 0, sizeof(SpatialKnnResults));
+}
+
+// Linear octree implementation
+LinearOctree* linear_octree_create(uint32_t leaf_size) {
+    LinearOctree* tree = malloc(sizeof(LinearOctree));
+    if (!tree) return NULL;
+    memset(tree, 0, sizeof(LinearOctree));
+    
+    tree->leaf_size = leaf_size ? leaf_size : LINEAR_OCTREE_LEAF_SIZE;
+    return tree;
+}
+
+void linear_octree_destroy(LinearOctree* tree) {
+    if (!tree) return;
+    free(tree->nodes);
+    free(tree->ids);
+    free(tree->spheres);
+    for (int i = 0; i < 2; i++) {
+        free(tree->codes[i]);
+        free(tree->order[i]);
+    }
+    free(tree->histogram);
+    free(tree->block_bounds);
+    free(tree->level_scratch);
+    free(tree);
+}
+
+static bool linear_octree_reserve(LinearOctree* tree, uint32_t count) {
+    if (count > tree->capacity) {
+        uint32_t capacity = tree->capacity ? tree->capacity : 1024;
+        while (capacity < count) capacity *= 2;
+        
+        if (!grow_buffer((void**)&tree->ids, sizeof(uint64_t) * capacity) ||
+            !grow_buffer((void**)&tree->spheres, sizeof(float) * 4 * capacity) ||
+            !grow_buffer((void**)&tree->codes[0], sizeof(uint64_t) * capacity) ||
+            !grow_buffer((void**)&tree->codes[1], sizeof(uint64_t) * capacity) ||
+            !grow_buffer((void**)&tree->order[0], sizeof(uint32_t) * capacity) ||
+            !grow_buffer((void**)&tree->order[1], sizeof(uint32_t) * capacity)) {
+            return false;
+        }
+        tree->capacity = capacity;
+    }
+    
+    uint32_t blocks = (count + LINEAR_OCTREE_SORT_BLOCK - 1) / LINEAR_OCTREE_SORT_BLOCK;
+    if (blocks > tree->block_capacity) {
+        if (!grow_buffer((void**)&tree->histogram,
+                         sizeof(uint32_t) * LINEAR_OCTREE_RADIX * blocks) ||
+            !grow_buffer((void**)&tree->block_bounds, sizeof(float) * 6 * blocks)) {
+            return false;
+        }
+        tree->block_capacity = blocks;
+    }
+    return true;
+}
+
+static inline uint64_t morton_expand(uint32_t value) {
+    uint64_t x = value & ((1u << LINEAR_OCTREE_BITS) - 1);
+    x = (x | x << 32) & 0x001f00000000ffffULL;
+    x = (x | x << 16) & 0x001f0000ff0000ffULL;
+    x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2)  & 0x1249249249249249ULL;
+    return x;
+}
+
+// x in the lowest bit of each 3-bit digit, matching octree_octant()
+static inline uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z) {
+    return morton_expand(x) | (morton_expand(y) << 1) | (morton_expand(z) << 2);
+}
+
+typedef struct {
+    LinearOctree* tree;
+    const uint64_t* ids;
+    const float* spheres;
+    uint32_t count;
+    uint32_t block_count;
+    uint32_t pass;          // Radix pass, 8 bits each
+    uint32_t level_begin;   // Node passes: the level being processed
+    float scale;
+} LinearOctreeTask;
+
+static void linear_octree_bounds_blocks(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    
+    for (uint32_t block = begin; block < end; block++) {
+        float* bounds = &task->tree->block_bounds[block * 6];
+        uint32_t first = block * LINEAR_OCTREE_SORT_BLOCK;
+        uint32_t last = first + LINEAR_OCTREE_SORT_BLOCK;
+        if (last > task->count) last = task->count;
+        
+        for (int axis = 0; axis < 3; axis++) {
+            bounds[axis * 2] = INFINITY;
+            bounds[axis * 2 + 1] = -INFINITY;
+        }
+        for (uint32_t i = first; i < last; i++) {
+            const float* sphere = &task->spheres[i * 4];
+            for (int axis = 0; axis < 3; axis++) {
+                bounds[axis * 2] = fminf(bounds[axis * 2], sphere[axis]);
+                bounds[axis * 2 + 1] = fmaxf(bounds[axis * 2 + 1], sphere[axis]);
+            }
+        }
+    }
+}
+
+static void linear_octree_code_blocks(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    const float limit = (float)((1u << LINEAR_OCTREE_BITS) - 1);
+    
+    for (uint32_t block = begin; block < end; block++) {
+        uint32_t first = block * LINEAR_OCTREE_SORT_BLOCK;
+        uint32_t last = first + LINEAR_OCTREE_SORT_BLOCK;
+        if (last > task->count) last = task->count;
+        
+        for (uint32_t i = first; i < last; i++) {
+            const float* sphere = &task->spheres[i * 4];
+            uint32_t q[3];
+            for (int axis = 0; axis < 3; axis++) {
+                float v = (sphere[axis] - tree->bounds[axis * 2]) * task->scale;
+                q[axis] = (uint32_t)fminf(fmaxf(v, 0.0f), limit);
+            }
+            tree->codes[0][i] = morton_encode(q[0], q[1], q[2]);
+            tree->order[0][i] = i;
+        }
+    }
+}
+
+static void linear_octree_histogram_blocks(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    const uint64_t* codes = tree->codes[0];
+    uint32_t shift = task->pass * 8;
+    
+    for (uint32_t block = begin; block < end; block++) {
+        uint32_t* histogram = &tree->histogram[block * LINEAR_OCTREE_RADIX];
+        uint32_t first = block * LINEAR_OCTREE_SORT_BLOCK;
+        uint32_t last = first + LINEAR_OCTREE_SORT_BLOCK;
+        if (last > task->count) last = task->count;
+        
+        memset(histogram, 0, sizeof(uint32_t) * LINEAR_OCTREE_RADIX);
+        for (uint32_t i = first; i < last; i++) {
+            histogram[(codes[i] >> shift) & (LINEAR_OCTREE_RADIX - 1)]++;
+        }
+    }
+}
+
+// Each block scatters to the offsets the prefix pass gave it, in input
+// order, so the sort stays stable across blocks
+static void linear_octree_scatter_blocks(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    const uint64_t* codes = tree->codes[0];
+    const uint32_t* order = tree->order[0];
+    uint64_t* codes_out = tree->codes[1];
+    uint32_t* order_out = tree->order[1];
+    uint32_t shift = task->pass * 8;
+    
+    for (uint32_t block = begin; block < end; block++) {
+        uint32_t* offset = &tree->histogram[block * LINEAR_OCTREE_RADIX];
+        uint32_t first = block * LINEAR_OCTREE_SORT_BLOCK;
+        uint32_t last = first + LINEAR_OCTREE_SORT_BLOCK;
+        if (last > task->count) last = task->count;
+        
+        for (uint32_t i = first; i < last; i++) {
+            uint32_t slot = offset[(codes[i] >> shift) & (LINEAR_OCTREE_RADIX - 1)]++;
+            codes_out[slot] = codes[i];
+            order_out[slot] = order[i];
+        }
+    }
+}
+
+static void linear_octree_gather_blocks(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    const uint32_t* order = tree->order[0];
+    
+    uint32_t first = begin * LINEAR_OCTREE_SORT_BLOCK;
+    uint32_t last = end * LINEAR_OCTREE_SORT_BLOCK;
+    if (last > task->count) last = task->count;
+    
+    for (uint32_t i = first; i < last; i++) {
+        tree->ids[i] = task->ids[order[i]];
+        memcpy(&tree->spheres[i * 4], &task->spheres[order[i] * 4], 4 * sizeof(float));
+    }
+}
+
+// LSD radix sort of (code, index) pairs, 8 bits per pass; passes where every
+// code has the same digit are skipped
+static void linear_octree_sort(LinearOctreeTask* task, JobSystem* jobs) {
+    LinearOctree* tree = task->tree;
+    uint32_t blocks = task->block_count;
+    
+    for (uint32_t pass = 0; pass * 8 < LINEAR_OCTREE_BITS * 3; pass++) {
+        task->pass = pass;
+        job_parallel_for(jobs, blocks, 1, linear_octree_histogram_blocks, task);
+        
+        // Exclusive prefix in (digit, block) order
+        uint32_t sum = 0;
+        bool single_digit = false;
+        for (uint32_t digit = 0; digit < LINEAR_OCTREE_RADIX; digit++) {
+            uint32_t digit_total = 0;
+            for (uint32_t block = 0; block < blocks; block++) {
+                uint32_t* slot = &tree->histogram[block * LINEAR_OCTREE_RADIX + digit];
+                uint32_t n = *slot;
+                *slot = sum;
+                sum += n;
+                digit_total += n;
+            }
+            if (digit_total == task->count) single_digit = true;
+        }
+        if (single_digit) continue;
+        
+        job_parallel_for(jobs, blocks, 1, linear_octree_scatter_blocks, task);
+        
+        uint64_t* codes = tree->codes[0];
+        tree->codes[0] = tree->codes[1];
+        tree->codes[1] = codes;
+        uint32_t* order = tree->order[0];
+        tree->order[0] = tree->order[1];
+        tree->order[1] = order;
+    }
+}
+
+// First index in [begin, end) whose code is >= key
+static uint32_t linear_octree_lower_bound(const uint64_t* codes, uint32_t begin, uint32_t end,
+                                          uint64_t key) {
+    while (begin < end) {
+        uint32_t mid = begin + (end - begin) / 2;
+        if (codes[mid] < key) begin = mid + 1;
+        else end = mid;
+    }
+    return begin;
+}
+
+// Split a node's run by the first Morton digit its codes disagree on.
+// Returns the number of non-empty octants, writing their runs if asked.
+static uint32_t linear_octree_split_run(const LinearOctree* tree, uint32_t begin, uint32_t end,
+                                        uint32_t* child_begin, uint32_t* child_end) {
+    const uint64_t* codes = tree->codes[0];
+    if (end - begin <= tree->leaf_size || codes[begin] == codes[end - 1]) return 0;
+    
+    // 63-bit codes: the top bit is always clear
+    uint32_t common = (uint32_t)__builtin_clzll(codes[begin] ^ codes[end - 1]) - 1;
+    uint32_t shift = (LINEAR_OCTREE_BITS - 1 - common / 3) * 3;
+    uint64_t prefix = codes[begin] & ~((8ULL << shift) - 1);
+    
+    uint32_t children = 0;
+    uint32_t start = begin;
+    for (uint64_t digit = 1; digit <= 8 && start < end; digit++) {
+        uint32_t stop = digit == 8 ? end :
+            linear_octree_lower_bound(codes, start, end, prefix | (digit << shift));
+        if (stop > start) {
+            if (child_begin) {
+                child_begin[children] = start;
+                child_end[children] = stop;
+            }
+            children++;
+        }
+        start = stop;
+    }
+    return children;
+}
+
+static void linear_octree_count_children(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    
+    for (uint32_t i = begin; i < end; i++) {
+        const LinearOctreeNode* node = &tree->nodes[task->level_begin + i];
+        tree->level_scratch[i] = linear_octree_split_run(tree, node->first,
+                                                         node->first + (node->count & ~LINEAR_OCTREE_LEAF),
+                                                         NULL, NULL);
+    }
+}
+
+// level_scratch holds each node's first child index by now
+static void linear_octree_emit_children(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    
+    for (uint32_t i = begin; i < end; i++) {
+        LinearOctreeNode* node = &tree->nodes[task->level_begin + i];
+        uint32_t run_begin = node->first;
+        uint32_t run_end = run_begin + (node->count & ~LINEAR_OCTREE_LEAF);
+        uint32_t child_begin[8], child_end[8];
+        
+        uint32_t children = linear_octree_split_run(tree, run_begin, run_end,
+                                                    child_begin, child_end);
+        if (!children) continue;
+        
+        uint32_t first = tree->level_scratch[i];
+        for (uint32_t c = 0; c < children; c++) {
+            LinearOctreeNode* child = &tree->nodes[first + c];
+            child->first = child_begin[c];
+            child->count = (child_end[c] - child_begin[c]) | LINEAR_OCTREE_LEAF;
+        }
+        node->first = first;
+        node->count = children;
+    }
+}
+
+// Bounds of the spheres below each node of one level, children first
+static void linear_octree_bound_nodes(void* data, uint32_t begin, uint32_t end) {
+    LinearOctreeTask* task = (LinearOctreeTask*)data;
+    LinearOctree* tree = task->tree;
+    
+    for (uint32_t i = begin; i < end; i++) {
+        LinearOctreeNode* node = &tree->nodes[task->level_begin + i];
+        float bounds[6] = { INFINITY, -INFINITY, INFINITY, -INFINITY, INFINITY, -INFINITY };
+        
+        if (node->count & LINEAR_OCTREE_LEAF) {
+            uint32_t last = node->first + (node->count & ~LINEAR_OCTREE_LEAF);
+            for (uint32_t e = node->first; e < last; e++) {
+                const float* sphere = &tree->spheres[e * 4];
+                for (int axis = 0; axis < 3; axis++) {
+                    bounds[axis * 2] = fminf(bounds[axis * 2], sphere[axis] - sphere[3]);
+                    bounds[axis * 2 + 1] = fmaxf(bounds[axis * 2 + 1], sphere[axis] + sphere[3]);
+                }
+            }
+        } else {
+            for (uint32_t c = 0; c < node->count; c++) {
+                const float* child = tree->nodes[node->first + c].bounds;
+                for (int axis = 0; axis < 3; axis++) {
+                    bounds[axis * 2] = fminf(bounds[axis * 2], child[axis * 2]);
+                    bounds[axis * 2 + 1] = fmaxf(bounds[axis * 2 + 1], child[axis * 2 + 1]);
+                }
+            }
+        }
+        memcpy(node->bounds, bounds, sizeof(bounds));
+    }
+}
+
+// Rebuild from count entities: ids[i] with sphere spheres[i * 4 .. i * 4 + 3]
+// (x, y, z, radius). jobs may be NULL to build on the calling thread.
+bool linear_octree_build(LinearOctree* tree, JobSystem* jobs, const uint64_t* ids,
+                         const float* spheres, uint32_t count) {
+    PROFILE_ZONE("Linear octree build");
+    tree->node_count = 0;
+    tree->level_count = 0;
+    tree->count = 0;
+    if (count == 0) return true;
+    if (count & LINEAR_OCTREE_LEAF) return false;
+    if (!linear_octree_reserve(tree, count)) return false;
+    
+    LinearOctreeTask task = { 0 };
+    task.tree = tree;
+    task.ids = ids;
+    task.spheres = spheres;
+    task.count = count;
+    task.block_count = (count + LINEAR_OCTREE_SORT_BLOCK - 1) / LINEAR_OCTREE_SORT_BLOCK;
+    
+    // Quantization cube around the centers
+    job_parallel_for(jobs, task.block_count, 1, linear_octree_bounds_blocks, &task);
+    for (int axis = 0; axis < 3; axis++) {
+        tree->bounds[axis * 2] = INFINITY;
+        tree->bounds[axis * 2 + 1] = -INFINITY;
+    }
+    for (uint32_t block = 0; block < task.block_count; block++) {
+        const float* bounds = &tree->block_bounds[block * 6];
+        for (int axis = 0; axis < 3; axis++) {
+            tree->bounds[axis * 2] = fminf(tree->bounds[axis * 2], bounds[axis * 2]);
+            tree->bounds[axis * 2 + 1] = fmaxf(tree->bounds[axis * 2 + 1], bounds[axis * 2 + 1]);
+        }
+    }
+    float extent = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        extent = fmaxf(extent, tree->bounds[axis * 2 + 1] - tree->bounds[axis * 2]);
+    }
+    if (!(extent < INFINITY)) return false;  // Non-finite positions
+    for (int axis = 0; axis < 3; axis++) {
+        tree->bounds[axis * 2 + 1] = tree->bounds[axis * 2] + extent;
+    }
+    task.scale = extent > 0.0f ? (float)((1u << LINEAR_OCTREE_BITS) - 1) / extent : 0.0f;
+    
+    job_parallel_for(jobs, task.block_count, 1, linear_octree_code_blocks, &task);
+    linear_octree_sort(&task, jobs);
+    job_parallel_for(jobs, task.block_count, 1, linear_octree_gather_blocks, &task);
+    tree->count = count;
+    
+    // Topology, one breadth-first level at a time: count children, assign
+    // offsets, then write the children, which form the next level
+    if (!tree->nodes && !grow_buffer((void**)&tree->nodes, sizeof(LinearOctreeNode) * 1024)) {
+        return false;
+    }
+    if (tree->node_capacity < 1024) tree->node_capacity = 1024;
+    tree->nodes[0].first = 0;
+    tree->nodes[0].count = count | LINEAR_OCTREE_LEAF;
+    tree->node_count = 1;
+    tree->level_start[0] = 0;
+    
+    uint32_t level_begin = 0;
+    uint32_t level_end = 1;
+    while (level_begin < level_end && tree->level_count < LINEAR_OCTREE_MAX_LEVELS) {
+        tree->level_start[tree->level_count++] = level_begin;
+        uint32_t level_nodes = level_end - level_begin;
+        
+        if (level_nodes > tree->level_scratch_capacity) {
+            if (!grow_buffer((void**)&tree->level_scratch, sizeof(uint32_t) * level_nodes)) {
+                return false;
+            }
+            tree->level_scratch_capacity = level_nodes;
+        }
+        
+        task.level_begin = level_begin;
+        job_parallel_for(jobs, level_nodes, LINEAR_OCTREE_NODE_GRAIN,
+                         linear_octree_count_children, &task);
+        
+        uint32_t next = level_end;
+        for (uint32_t i = 0; i < level_nodes; i++) {
+            uint32_t children = tree->level_scratch[i];
+            tree->level_scratch[i] = next;
+            next += children;
+        }
+        
+        if (next > tree->node_capacity) {
+            uint32_t capacity = tree->node_capacity;
+            while (capacity < next) capacity *= 2;
+            if (!grow_buffer((void**)&tree->nodes, sizeof(LinearOctreeNode) * capacity)) {
+                return false;
+            }
+            tree->node_capacity = capacity;
+        }
+        
+        job_parallel_for(jobs, level_nodes, LINEAR_OCTREE_NODE_GRAIN,
+                         linear_octree_emit_children, &task);
+        
+        tree->node_count = next;
+        level_begin = level_end;
+        level_end = next;
+    }
+    tree->level_start[tree->level_count] = tree->node_count;
+    
+    // Bounds bottom-up, deepest level first
+    for (uint32_t level = tree->level_count; level-- > 0;) {
+        task.level_begin = tree->level_start[level];
+        job_parallel_for(jobs, tree->level_start[level + 1] - tree->level_start[level],
+                         LINEAR_OCTREE_NODE_GRAIN, linear_octree_bound_nodes, &task);
+    }
+    return true;
+}
+
+// Entities whose sphere touches the query sphere. Writes up to capacity ids
+// and returns the total number of matches.
+uint32_t linear_octree_query_range(const LinearOctree* tree, const float* center, float radius,
+                                   uint64_t* results, uint32_t capacity) {
+    if (tree->node_count == 0) return 0;
+    
+    uint32_t stack[LINEAR_OCTREE_STACK];
+    uint32_t top = 0;
+    uint32_t found = 0;
+    stack[top++] = 0;
+    
+    while (top > 0) {
+        const LinearOctreeNode* node = &tree->nodes[stack[--top]];
+        if (!aabb_intersects_sphere((float*)node->bounds, (float*)center, radius)) continue;
+        
+        if (!(node->count & LINEAR_OCTREE_LEAF)) {
+            for (uint32_t c = node->count; c-- > 0;) {
+                stack[top++] = node->first + c;
+            }
+            continue;
+        }
+        
+        uint32_t last = node->first + (node->count & ~LINEAR_OCTREE_LEAF);
+        for (uint32_t e = node->first; e < last; e++) {
+            const float* sphere = &tree->spheres[e * 4];
+            float dx = sphere[0] - center[0];
+            float dy = sphere[1] - center[1];
+            float dz = sphere[2] - center[2];
+            float reach = radius + sphere[3];
+            
+            if (dx*dx + dy*dy + dz*dz <= reach * reach) {
+                if (found < capacity) results[found] = tree->ids[e];
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+// BVH implementation
+typedef struct {
+    uint32_t count;
+    float bounds[6];
+    float centroid_bounds[6];
+} BvhBin;
+
+typedef struct {
+    Bvh* bvh;
+    const float* centroid_bounds;
+    int axis;
+    uint32_t begin;
+    uint32_t end;
+} BvhTask;
+
+static inline void bounds_empty(float* bounds) {
+    for (int axis = 0; axis < 3; axis++) {
+        bounds[axis * 2] = INFINITY;
+        bounds[axis * 2 + 1] = -INFINITY;
+    }
+}
+
+static inline void bounds_merge(float* bounds, const float* other) {
+    for (int axis = 0; axis < 3; axis++) {
+        bounds[axis * 2] = span_min(bounds[axis * 2], other[axis * 2]);
+        bounds[axis * 2 + 1] = span_max(bounds[axis * 2 + 1], other[axis * 2 + 1]);
+    }
+}
+
+static inline void bounds_add_point(float* bounds, const float* point) {
+    for (int axis = 0; axis < 3; axis++) {
+        bounds[axis * 2] = span_min(bounds[axis * 2], point[axis]);
+        bounds[axis * 2 + 1] = span_max(bounds[axis * 2 + 1], point[axis]);
+    }
+}
+
+// Half the surface area; only ratios matter
+static inline float bounds_area(const float* bounds) {
+    float dx = bounds[1] - bounds[0];
+    float dy = bounds[3] - bounds[2];
+    float dz = bounds[5] - bounds[4];
+    if (!(dx >= 0.0f && dy >= 0.0f && dz >= 0.0f)) return 0.0f;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+Bvh* bvh_create(void) {
+    Bvh* bvh = malloc(sizeof(Bvh));
+    if (!bvh) return NULL;
+    memset(bvh, 0, sizeof(Bvh));
+    return bvh;
+}
+
+void bvh_destroy(Bvh* bvh) {
+    if (!bvh) return;
+    free(bvh->nodes);
+    free(bvh->ids);
+    free(bvh->prim_bounds);
+    free(bvh->prim_index);
+    free(bvh->subtrees);
+    free(bvh->source_ids);
+    free(bvh->work);
+    free(bvh->bin_scratch);
+    free(bvh);
+}
+
+static bool bvh_reserve(Bvh* bvh, uint32_t count) {
+    if (count > bvh->capacity) {
+        uint32_t capacity = bvh->capacity ? bvh->capacity : 1024;
+        while (capacity < count) capacity *= 2;
+        
+        if (!grow_buffer((void**)&bvh->ids, sizeof(uint64_t) * capacity) ||
+            !grow_buffer((void**)&bvh->source_ids, sizeof(uint64_t) * capacity) ||
+            !grow_buffer((void**)&bvh->prim_bounds, sizeof(float) * 6 * capacity) ||
+            !grow_buffer((void**)&bvh->prim_index, sizeof(uint32_t) * capacity) ||
+            !grow_buffer((void**)&bvh->work, sizeof(BvhPrim) * capacity) ||
+            !grow_buffer((void**)&bvh->nodes, sizeof(BvhNode) * (2 * (size_t)capacity - 1))) {
+            return false;
+        }
+        bvh->capacity = capacity;
+        bvh->node_capacity = 2 * capacity - 1;
+    }
+    
+    uint32_t blocks = (count + BVH_BLOCK - 1) / BVH_BLOCK;
+    if (blocks > bvh->bin_scratch_capacity) {
+        if (!grow_buffer(&bvh->bin_scratch, sizeof(BvhBin) * BVH_BINS * blocks)) return false;
+        bvh->bin_scratch_capacity = blocks;
+    }
+    return true;
+}
+
+// Bins per unit along axis; binning and partitioning must use the same value
+static inline float bvh_bin_scale(const float* centroid_bounds, int axis) {
+    float extent = centroid_bounds[axis * 2 + 1] - centroid_bounds[axis * 2];
+    return extent > 0.0f ? BVH_BINS / extent : 0.0f;
+}
+
+static inline uint32_t bvh_bin_index(float origin, float scale, float value) {
+    int bin = (int)((value - origin) * scale);
+    return bin < 0 ? 0 : (bin >= BVH_BINS ? BVH_BINS - 1 : (uint32_t)bin);
+}
+
+static void bvh_bins_clear(BvhBin* bins) {
+    for (int b = 0; b < BVH_BINS; b++) {
+        bins[b].count = 0;
+        bounds_empty(bins[b].bounds);
+        bounds_empty(bins[b].centroid_bounds);
+    }
+}
+
+static void bvh_bin_range(const Bvh* bvh, const float* centroid_bounds, int axis,
+                          uint32_t begin, uint32_t end, BvhBin* bins) {
+    float origin = centroid_bounds[axis * 2];
+    float scale = bvh_bin_scale(centroid_bounds, axis);
+    
+    for (uint32_t i = begin; i < end; i++) {
+        const BvhPrim* prim = &bvh->work[i];
+        BvhBin* bin = &bins[bvh_bin_index(origin, scale, prim->centroid[axis])];
+        bin->count++;
+        bounds_merge(bin->bounds, prim->bounds);
+        bounds_add_point(bin->centroid_bounds, prim->centroid);
+    }
+}
+
+static void bvh_bin_blocks(void* data, uint32_t begin, uint32_t end) {
+    BvhTask* task = (BvhTask*)data;
+    BvhBin* scratch = task->bvh->bin_scratch;
+    
+    for (uint32_t block = begin; block < end; block++) {
+        uint32_t first = task->begin + block * BVH_BLOCK;
+        uint32_t last = first + BVH_BLOCK;
+        if (last > task->end) last = task->end;
+        
+        BvhBin* bins = &scratch[block * BVH_BINS];
+        bvh_bins_clear(bins);
+        bvh_bin_range(task->bvh, task->centroid_bounds, task->axis, first, last, bins);
+    }
+}
+
+typedef struct {
+    int axis;               // -1: make a leaf
+    uint32_t bin;           // Bins below go left
+    uint32_t left_count;
+    float left_bounds[6];
+    float left_centroids[6];
+    float right_bounds[6];
+    float right_centroids[6];
+} BvhSplit;
+
+// Cheapest bin boundary, or a leaf when that is cheaper
+static void bvh_choose_split(const BvhBin* bins, int axis, uint32_t count, const float* bounds,
+                             BvhSplit* split) {
+    split->axis = -1;
+    float best = INFINITY;
+    
+    float right_area[BVH_BINS];
+    uint32_t right_count[BVH_BINS];
+    float acc[6];
+    uint32_t n = 0;
+    
+    bounds_empty(acc);
+    for (int b = BVH_BINS - 1; b > 0; b--) {
+        bounds_merge(acc, bins[b].bounds);
+        n += bins[b].count;
+        right_area[b] = bounds_area(acc);
+        right_count[b] = n;
+    }
+    
+    bounds_empty(acc);
+    n = 0;
+    for (int b = 1; b < BVH_BINS; b++) {
+        bounds_merge(acc, bins[b - 1].bounds);
+        n += bins[b - 1].count;
+        if (n == 0 || right_count[b] == 0) continue;
+        
+        float cost = bounds_area(acc) * n + right_area[b] * right_count[b];
+        if (cost < best) {
+            best = cost;
+            split->axis = axis;
+            split->bin = b;
+        }
+    }
+    
+    float area = bounds_area(bounds);
+    float split_cost = BVH_TRAVERSAL_COST + (area > 0.0f ? best / area : 0.0f) * BVH_INTERSECT_COST;
+    float leaf_cost = count * BVH_INTERSECT_COST;
+    if (split->axis < 0 || (count <= BVH_MAX_LEAF && leaf_cost <= split_cost)) {
+        split->axis = -1;
+        return;
+    }
+    
+    bounds_empty(split->left_bounds);
+    bounds_empty(split->left_centroids);
+    bounds_empty(split->right_bounds);
+    bounds_empty(split->right_centroids);
+    split->left_count = 0;
+    for (uint32_t b = 0; b < BVH_BINS; b++) {
+        const BvhBin* bin = &bins[b];
+        if (b < split->bin) {
+            split->left_count += bin->count;
+            bounds_merge(split->left_bounds, bin->bounds);
+            bounds_merge(split->left_centroids, bin->centroid_bounds);
+        } else {
+            bounds_merge(split->right_bounds, bin->bounds);
+            bounds_merge(split->right_centroids, bin->centroid_bounds);
+        }
+    }
+}
+
+static void bvh_range_bounds(const Bvh* bvh, uint32_t begin, uint32_t end, float* bounds,
+                             float* centroid_bounds) {
+    bounds_empty(bounds);
+    bounds_empty(centroid_bounds);
+    for (uint32_t i = begin; i < end; i++) {
+        bounds_merge(bounds, bvh->work[i].bounds);
+        bounds_add_point(centroid_bounds, bvh->work[i].centroid);
+    }
+}
+
+static int bvh_longest_axis(const float* bounds) {
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (bounds[a * 2 + 1] - bounds[a * 2] > bounds[axis * 2 + 1] - bounds[axis * 2]) {
+            axis = a;
+        }
+    }
+    return axis;
+}
+
+// Median split along the longest centroid axis (quickselect), for ranges
+// that have grown too deep
+static uint32_t bvh_split_median(Bvh* bvh, const float* centroid_bounds, uint32_t begin,
+                                 uint32_t end) {
+    int axis = bvh_longest_axis(centroid_bounds);
+    
+    int64_t mid = begin + (end - begin) / 2;
+    BvhPrim* work = bvh->work;
+    int64_t lo = begin, hi = (int64_t)end - 1;
+    
+    // Three-way partition around the pivot until mid lands in the middle run
+    while (lo < hi) {
+        float pivot = work[lo + (hi - lo) / 2].centroid[axis];
+        int64_t lt = lo, i = lo, gt = hi;
+        while (i <= gt) {
+            float v = work[i].centroid[axis];
+            BvhPrim swap = work[i];
+            if (v < pivot) {
+                work[i++] = work[lt];
+                work[lt++] = swap;
+            } else if (v > pivot) {
+                work[i] = work[gt];
+                work[gt--] = swap;
+            } else {
+                i++;
+            }
+        }
+        if (mid < lt) hi = lt - 1;
+        else if (mid > gt) lo = gt + 1;
+        else break;
+    }
+    return (uint32_t)mid;
+}
+
+static uint32_t bvh_partition(Bvh* bvh, const float* centroid_bounds, uint32_t begin,
+                              uint32_t end, const BvhSplit* split) {
+    BvhPrim* work = bvh->work;
+    uint32_t i = begin, j = end;
+    int axis = split->axis;
+    float origin = centroid_bounds[axis * 2];
+    float scale = bvh_bin_scale(centroid_bounds, axis);
+    
+    while (i < j) {
+        if (bvh_bin_index(origin, scale, work[i].centroid[axis]) < split->bin) {
+            i++;
+        } else {
+            BvhPrim swap = work[i];
+            work[i] = work[--j];
+            work[j] = swap;
+        }
+    }
+    return i;
+}
+
+// Split one range: fills the two child ranges, or returns false for a leaf
+typedef struct {
+    uint32_t begin;
+    uint32_t end;
+    uint32_t node;
+    uint32_t depth;
+    float bounds[6];
+    float centroid_bounds[6];
+} BvhRange;
+
+static bool bvh_split_range(Bvh* bvh, JobSystem* jobs, const BvhRange* range, BvhRange* left,
+                            BvhRange* right) {
+    uint32_t count = range->end - range->begin;
+    if (count <= BVH_LEAF_SIZE) return false;
+    
+    uint32_t mid;
+    const float* cb = range->centroid_bounds;
+    bool degenerate = !(cb[1] > cb[0]) && !(cb[3] > cb[2]) && !(cb[5] > cb[4]);
+    
+    bool median = degenerate || range->depth >= BVH_MEDIAN_DEPTH;
+    if (!median) {
+        BvhBin bins[BVH_BINS];
+        int axis = bvh_longest_axis(cb);
+        
+        if (jobs && count >= BVH_PARALLEL_BIN) {
+            BvhTask task = { bvh, cb, axis, range->begin, range->end };
+            uint32_t blocks = (count + BVH_BLOCK - 1) / BVH_BLOCK;
+            const BvhBin* scratch = bvh->bin_scratch;
+            
+            job_parallel_for(jobs, blocks, 1, bvh_bin_blocks, &task);
+            bvh_bins_clear(bins);
+            for (uint32_t block = 0; block < blocks; block++) {
+                for (int b = 0; b < BVH_BINS; b++) {
+                    const BvhBin* part = &scratch[block * BVH_BINS + b];
+                    bins[b].count += part->count;
+                    bounds_merge(bins[b].bounds, part->bounds);
+                    bounds_merge(bins[b].centroid_bounds, part->centroid_bounds);
+                }
+            }
+        } else {
+            bvh_bins_clear(bins);
+            bvh_bin_range(bvh, cb, axis, range->begin, range->end, bins);
+        }
+        
+        BvhSplit split;
+        bvh_choose_split(bins, axis, count, range->bounds, &split);
+        if (split.axis >= 0) {
+            mid = bvh_partition(bvh, cb, range->begin, range->end, &split);
+            memcpy(left->bounds, split.left_bounds, sizeof(left->bounds));
+            memcpy(left->centroid_bounds, split.left_centroids, sizeof(left->centroid_bounds));
+            memcpy(right->bounds, split.right_bounds, sizeof(right->bounds));
+            memcpy(right->centroid_bounds, split.right_centroids, sizeof(right->centroid_bounds));
+        } else {
+            // SAH found no usable bin boundary (all centroids in one bin)
+            median = true;
+        }
+    }
+    
+    // Median splits halve the range, which bounds depth by BVH_MAX_DEPTH
+    if (median) {
+        if (count <= BVH_MAX_LEAF) return false;
+        mid = degenerate ? range->begin + count / 2 : bvh_split_median(bvh, cb, range->begin, range->end);
+        bvh_range_bounds(bvh, range->begin, mid, left->bounds, left->centroid_bounds);
+        bvh_range_bounds(bvh, mid, range->end, right->bounds, right->centroid_bounds);
+    }
+    
+    left->begin = range->begin;
+    left->end = mid;
+    right->begin = mid;
+    right->end = range->end;
+    left->depth = right->depth = range->depth + 1;
+    return true;
+}
+
+typedef struct {
+    Bvh* bvh;
+    const float* aabbs;
+    const uint64_t* ids;
+    uint32_t count;
+} BvhBuildTask;
 
-OcclusionBuffer* occlusion_buffer_create(uint32_t width, uint32_t height);
-void occlusion_buffer_clear(OcclusionBuffer* buffer);
-bool occlusion_buffer_test_aabb(OcclusionBuffer* buffer, float aabb_min[3], float aabb_max[3]);
-void occlusion_buffer_rasterize(OcclusionBuffer* buffer, float* vertices, uint32_t vertex_count);
-void occlusion_buffer_update_hiz(OcclusionBuffer* buffer);
-void occlusion_buffer_destroy(OcclusionBuffer* buffer);
+static void bvh_centroid_blocks(void* data, uint32_t begin, uint32_t end) {
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    Bvh* bvh = task->bvh;
+    
+    uint32_t first = begin * BVH_BLOCK;
+    uint32_t last = end * BVH_BLOCK;
+    if (last > task->count) last = task->count;
+    
+    for (uint32_t i = first; i < last; i++) {
+        const float* box = &task->aabbs[i * 6];
+        BvhPrim* prim = &bvh->work[i];
+        memcpy(prim->bounds, box, sizeof(prim->bounds));
+        prim->centroid[0] = (box[0] + box[1]) * 0.5f;
+        prim->centroid[1] = (box[2] + box[3]) * 0.5f;
+        prim->centroid[2] = (box[4] + box[5]) * 0.5f;
+        prim->index = i;
+    }
+}
 
-// Octree implementation
-OctreeNode* octree_create(float* bounds, int max_depth, int max_objects_per_node) {
-    OctreeNode* node = malloc(sizeof(OctreeNode));
+// Build one subtree below its root, allocating nodes from its own range
+static void bvh_build_subtrees(void* data, uint32_t begin, uint32_t end) {
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    Bvh* bvh = task->bvh;
     
-    memcpy(node->bounds, bounds, 6 * sizeof(float));
+    for (uint32_t s = begin; s < end; s++) {
+        BvhSubtree* subtree = &bvh->subtrees[s];
+        BvhRange stack[BVH_STACK];
+        uint32_t top = 0;
+        uint32_t next = subtree->node_begin;
+        
+        BvhRange* root = &stack[top++];
+        root->begin = subtree->prim_begin;
+        root->end = subtree->prim_end;
+        root->node = subtree->root;
+        root->depth = subtree->depth;
+        memcpy(root->bounds, subtree->bounds, sizeof(root->bounds));
+        memcpy(root->centroid_bounds, subtree->centroid_bounds, sizeof(root->centroid_bounds));
+        
+        while (top > 0) {
+            BvhRange range = stack[--top];
+            BvhNode* node = &bvh->nodes[range.node];
+            memcpy(node->bounds, range.bounds, sizeof(node->bounds));
+            
+            BvhRange left, right;
+            if (!bvh_split_range(bvh, NULL, &range, &left, &right)) {
+                assert(range.end - range.begin <= BVH_MAX_LEAF);
+                node->first = range.begin;
+                node->count = range.end - range.begin;
+                continue;
+            }
+            assert(range.depth < BVH_MAX_DEPTH && top + 2 <= BVH_STACK);
+            
+            node->first = next;
+            node->count = 0;
+            left.node = next;
+            right.node = next + 1;
+            next += 2;
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+        subtree->node_used = next - subtree->node_begin;
+    }
+}
+
+static void bvh_gather_blocks(void* data, uint32_t begin, uint32_t end) {
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    Bvh* bvh = task->bvh;
     
-    for (int i = 0; i < 8; i++) {
-        node->children[i] = NULL;
+    uint32_t first = begin * BVH_BLOCK;
+    uint32_t last = end * BVH_BLOCK;
+    if (last > task->count) last = task->count;
+    
+    for (uint32_t i = first; i < last; i++) {
+        const BvhPrim* prim = &bvh->work[i];
+        bvh->prim_index[i] = prim->index;
+        bvh->ids[i] = task->ids[prim->index];
+        memcpy(&bvh->prim_bounds[i * 6], prim->bounds, sizeof(prim->bounds));
     }
+}
+
+static void bvh_refit_blocks(void* data, uint32_t begin, uint32_t end) {
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    Bvh* bvh = task->bvh;
     
-    node->entity_capacity = max_objects_per_node;
-    node->entity_ids = malloc(max_objects_per_node * sizeof(uint64_t));
-    node->entity_count = 0;
-    node->is_leaf = true;
-    node->depth = 0;
+    uint32_t first = begin * BVH_BLOCK;
+    uint32_t last = end * BVH_BLOCK;
+    if (last > task->count) last = task->count;
     
-    return node;
+    for (uint32_t i = first; i < last; i++) {
+        memcpy(&bvh->prim_bounds[i * 6], &task->aabbs[bvh->prim_index[i] * 6], 6 * sizeof(float));
+    }
 }
 
-void octree_insert(OctreeNode* node, uint64_t entity_id, float* position, float radius) {
-    // Check if entity fits in this node
-    if (!aabb_contains_sphere(node->bounds, position, radius)) {
-        return;  // Entity doesn't belong in this node
+// Recompute a node from its children or primitives; returns its SAH term
+static inline float bvh_refit_node(Bvh* bvh, BvhNode* node) {
+    float bounds[6];
+    bounds_empty(bounds);
+    
+    if (node->count) {
+        for (uint32_t p = node->first; p < node->first + node->count; p++) {
+            bounds_merge(bounds, &bvh->prim_bounds[p * 6]);
+        }
+        memcpy(node->bounds, bounds, sizeof(bounds));
+        return bounds_area(bounds) * node->count * BVH_INTERSECT_COST;
     }
     
-    // If leaf node and has capacity, add entity
-    if (node->is_leaf && node->entity_count < node->entity_capacity) {
-        node->entity_ids[node->entity_count++] = entity_id;
-        return;
+    bounds_merge(bounds, bvh->nodes[node->first].bounds);
+    bounds_merge(bounds, bvh->nodes[node->first + 1].bounds);
+    memcpy(node->bounds, bounds, sizeof(bounds));
+    return bounds_area(bounds) * BVH_TRAVERSAL_COST;
+}
+
+// Children come after their parent within a subtree's range
+static void bvh_refit_subtrees(void* data, uint32_t begin, uint32_t end) {
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    Bvh* bvh = task->bvh;
+    
+    for (uint32_t s = begin; s < end; s++) {
+        BvhSubtree* subtree = &bvh->subtrees[s];
+        float cost = 0.0f;
+        for (uint32_t n = subtree->node_begin + subtree->node_used; n-- > subtree->node_begin;) {
+            cost += bvh_refit_node(bvh, &bvh->nodes[n]);
+        }
+        subtree->cost = cost;
     }
+}
+
+// Refit everything below the subtrees first, then the top; returns the SAH
+// cost normalized by the root's area
+static float bvh_refit_all(Bvh* bvh, JobSystem* jobs) {
+    BvhBuildTask task = { bvh, NULL, NULL, bvh->count };
+    job_parallel_for(jobs, bvh->subtree_count, 1, bvh_refit_subtrees, &task);
     
-    // If leaf node but full, split if not at max depth
-    if (node->is_leaf && node->depth < 8) {  // Max depth
-        octree_split(node);
+    float cost = 0.0f;
+    for (uint32_t s = 0; s < bvh->subtree_count; s++) {
+        cost += bvh->subtrees[s].cost;
+    }
+    for (uint32_t n = bvh->top_count; n-- > 0;) {
+        cost += bvh_refit_node(bvh, &bvh->nodes[n]);
     }
     
-    // If not leaf, insert into children
-    if (!node->is_leaf) {
-        for (int i = 0; i < 8; i++) {
-            if (node->children[i]) {
-                octree_insert(node->children[i], entity_id, position, radius);
+    float root_area = bounds_area(bvh->nodes[0].bounds);
+    return root_area > 0.0f ? cost / root_area : cost;
+}
+
+static int bvh_subtree_larger(const void* a, const void* b) {
+    uint32_t na = ((const BvhSubtree*)a)->prim_end - ((const BvhSubtree*)a)->prim_begin;
+    uint32_t nb = ((const BvhSubtree*)b)->prim_end - ((const BvhSubtree*)b)->prim_begin;
+    return na < nb ? 1 : (na > nb ? -1 : 0);
+}
+
+// Build over count primitives: ids[i] with box aabbs[i * 6 .. i * 6 + 5]
+// (min_x, max_x, min_y, max_y, min_z, max_z). jobs may be NULL.
+bool bvh_build(Bvh* bvh, JobSystem* jobs, const uint64_t* ids, const float* aabbs, uint32_t count) {
+    PROFILE_ZONE("BVH build");
+    bvh->node_count = 0;
+    bvh->top_count = 0;
+    bvh->subtree_count = 0;
+    bvh->count = 0;
+    bvh->cost = bvh->build_cost = 0.0f;
+    if (count == 0) return true;
+    if (count > UINT32_MAX / 2 || !bvh_reserve(bvh, count)) return false;
+    
+    if (ids != bvh->source_ids) memcpy(bvh->source_ids, ids, sizeof(uint64_t) * count);
+    
+    BvhBuildTask task = { bvh, aabbs, bvh->source_ids, count };
+    uint32_t blocks = (count + BVH_BLOCK - 1) / BVH_BLOCK;
+    job_parallel_for(jobs, blocks, 1, bvh_centroid_blocks, &task);
+    
+    // Top: split breadth-first on this thread until ranges are job-sized.
+    // Uneven splits can leave many small ranges, so both lists grow.
+    uint32_t subtree_size = count / BVH_SUBTREES;
+    if (subtree_size < BVH_SUBTREE_MIN) subtree_size = BVH_SUBTREE_MIN;
+    
+    uint32_t queue_capacity = 64;
+    BvhRange* queue = malloc(sizeof(BvhRange) * queue_capacity);
+    if (!queue) return false;
+    uint32_t head = 0, tail = 0;
+    
+    BvhRange* root = &queue[tail++];
+    root->begin = 0;
+    root->end = count;
+    root->node = 0;
+    root->depth = 0;
+    bvh_range_bounds(bvh, 0, count, root->bounds, root->centroid_bounds);
+    uint32_t next_node = 1;
+    
+    while (head < tail) {
+        BvhRange range = queue[head++];
+        BvhNode* node = &bvh->nodes[range.node];
+        memcpy(node->bounds, range.bounds, sizeof(node->bounds));
+        
+        BvhRange left, right;
+        if (range.end - range.begin <= subtree_size ||
+            !bvh_split_range(bvh, jobs, &range, &left, &right)) {
+            // Built (or made a leaf) by a job below
+            if (bvh->subtree_count == bvh->subtree_capacity) {
+                uint32_t capacity = bvh->subtree_capacity ? bvh->subtree_capacity * 2 : 64;
+                if (!grow_buffer((void**)&bvh->subtrees, sizeof(BvhSubtree) * capacity)) {
+                    free(queue);
+                    return false;
+                }
+                bvh->subtree_capacity = capacity;
             }
+            BvhSubtree* subtree = &bvh->subtrees[bvh->subtree_count++];
+            subtree->prim_begin = range.begin;
+            subtree->prim_end = range.end;
+            subtree->root = range.node;
+            subtree->depth = range.depth;
+            memcpy(subtree->bounds, range.bounds, sizeof(subtree->bounds));
+            memcpy(subtree->centroid_bounds, range.centroid_bounds, sizeof(subtree->centroid_bounds));
+            continue;
         }
+        
+        node->first = next_node;
+        node->count = 0;
+        left.node = next_node;
+        right.node = next_node + 1;
+        next_node += 2;
+        
+        if (tail + 2 > queue_capacity) {
+            // Drop what has been processed before growing
+            memmove(queue, queue + head, sizeof(BvhRange) * (tail - head));
+            tail -= head;
+            head = 0;
+            if (tail + 2 > queue_capacity) {
+                queue_capacity *= 2;
+                if (!grow_buffer((void**)&queue, sizeof(BvhRange) * queue_capacity)) {
+                    free(queue);
+                    return false;
+                }
+            }
+        }
+        queue[tail++] = left;
+        queue[tail++] = right;
+    }
+    free(queue);
+    bvh->top_count = next_node;
+    
+    // Largest subtrees first for balance; a k-primitive subtree has at most
+    // 2k - 2 nodes below its root
+    qsort(bvh->subtrees, bvh->subtree_count, sizeof(BvhSubtree), bvh_subtree_larger);
+    uint32_t node_end = next_node;
+    for (uint32_t s = 0; s < bvh->subtree_count; s++) {
+        bvh->subtrees[s].node_begin = node_end;
+        node_end += 2 * (bvh->subtrees[s].prim_end - bvh->subtrees[s].prim_begin) - 2;
     }
+    bvh->node_count = node_end;
+    
+    job_parallel_for(jobs, bvh->subtree_count, 1, bvh_build_subtrees, &task);
+    job_parallel_for(jobs, blocks, 1, bvh_gather_blocks, &task);
+    bvh->count = count;
+    
+    bvh->build_cost = bvh->cost = bvh_refit_all(bvh, jobs);
+    bvh->builds++;
+    return true;
 }
 
-void octree_split(OctreeNode* node) {
-    float mid_x = (node->bounds[0] + node->bounds[1]) * 0.5f;
-    float mid_y = (node->bounds[2] + node->bounds[3]) * 0.5f;
-    float mid_z = (node->bounds[4] + node->bounds[5]) * 0.5f;
+// New boxes for the primitives of the last build, in the caller's order.
+// Refits in place, rebuilding instead when the tree has degraded. Returns
+// false only if a needed rebuild failed.
+bool bvh_refit(Bvh* bvh, JobSystem* jobs, const float* aabbs) {
+    PROFILE_ZONE("BVH refit");
+    if (bvh->count == 0) return true;
     
-    // Create 8 children
-    for (int i = 0; i < 8; i++) {
-        float child_bounds[6];
-        
-        // Determine child bounds based on octant
-        child_bounds[0] = (i & 1) ? mid_x : node->bounds[0];  // min_x
-        child_bounds[1] = (i & 1) ? node->bounds[1] : mid_x;  // max_x
-        child_bounds[2] = (i & 2) ? mid_y : node->bounds[2];  // min_y
-        child_bounds[3] = (i & 2) ? node->bounds[3] : mid_y;  // max_y
-        child_bounds[4] = (i & 4) ? mid_z : node->bounds[4];  // min_z
-        child_bounds[5] = (i & 4) ? node->bounds[5] : mid_z;  // max_z
-        
-        node->children[i] = octree_create(child_bounds, 8, node->entity_capacity);
-        node->children[i]->depth = node->depth + 1;
+    BvhBuildTask task = { bvh, aabbs, NULL, bvh->count };
+    job_parallel_for(jobs, (bvh->count + BVH_BLOCK - 1) / BVH_BLOCK, 1, bvh_refit_blocks, &task);
+    
+    bvh->cost = bvh_refit_all(bvh, jobs);
+    bvh->refits++;
+    
+    if (bvh->cost > bvh->build_cost * BVH_REBUILD_RATIO) {
+        return bvh_build(bvh, jobs, bvh->source_ids, aabbs, bvh->count);
+    }
+    return true;
+}
+
+static inline bool bvh_box_touches_sphere(const float* box, const float* center, float radius) {
+    return bounds_distance_sq(box, center) <= radius * radius;
+}
+
+// Outside if the corner furthest along the plane normal is still behind it
+static inline bool bvh_box_outside_plane(const float* box, const float* plane) {
+    float x = plane[0] >= 0.0f ? box[1] : box[0];
+    float y = plane[1] >= 0.0f ? box[3] : box[2];
+    float z = plane[2] >= 0.0f ? box[5] : box[4];
+    return plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f;
+}
+
+static inline bool bvh_box_in_frustum(const float* box, const float frustum[6][4]) {
+    for (int p = 0; p < 6; p++) {
+        if (bvh_box_outside_plane(box, frustum[p])) return false;
     }
+    return true;
+}
+
+// Primitives whose box touches the sphere. Writes up to capacity ids and
+// returns the total number of matches.
+uint32_t bvh_query_sphere(const Bvh* bvh, const float* center, float radius,
+                          uint64_t* results, uint32_t capacity) {
+    if (bvh->count == 0) return 0;
     
-    // Redistribute entities to children
-    for (uint32_t i = 0; i < node->entity_count; i++) {
-        uint64_t entity_id = node->entity_ids[i];
-        // In real implementation, would get entity position and radius
-        // For demo, redistribute randomly
-        int child_index = rand() % 8;
-        node->children[child_index]->entity_ids[node->children[child_index]->entity_count++] = entity_id;
+    uint32_t stack[BVH_STACK];
+    uint32_t top = 0;
+    uint32_t found = 0;
+    stack[top++] = 0;
+    
+    while (top > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--top]];
+        if (!bvh_box_touches_sphere(node->bounds, center, radius)) continue;
+        
+        if (!node->count) {
+            stack[top++] = node->first + 1;
+            stack[top++] = node->first;
+            continue;
+        }
+        for (uint32_t p = node->first; p < node->first + node->count; p++) {
+            if (bvh_box_touches_sphere(&bvh->prim_bounds[p * 6], center, radius)) {
+                if (found < capacity) results[found] = bvh->ids[p];
+                found++;
+            }
+        }
     }
+    return found;
+}
+
+// Primitives whose box is not fully behind any plane (planes face inward,
+// as for metaverse_cull_entities). Same result convention as above.
+uint32_t bvh_query_frustum(const Bvh* bvh, const float frustum[6][4],
+                           uint64_t* results, uint32_t capacity) {
+    if (bvh->count == 0) return 0;
     
-    // Clear this node's entities
-    node->entity_count = 0;
-    node->is_leaf = false;
+    uint32_t stack[BVH_STACK];
+    uint32_t top = 0;
+    uint32_t found = 0;
+    stack[top++] = 0;
     
-    // Free entity array (entities now in children)
-    free(node->entity_ids);
-    node->entity_ids = NULL;
+    while (top > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--top]];
+        if (!bvh_box_in_frustum(node->bounds, frustum)) continue;
+        
+        if (!node->count) {
+            stack[top++] = node->first + 1;
+            stack[top++] = node->first;
+            continue;
+        }
+        for (uint32_t p = node->first; p < node->first + node->count; p++) {
+            if (bvh_box_in_frustum(&bvh->prim_bounds[p * 6], frustum)) {
+                if (found < capacity) results[found] = bvh->ids[p];
+                found++;
+            }
+        }
+    }
+    return found;
 }
 
-void octree_query_range(OctreeNode* node, float* center, float radius,
-                       uint64_t* results, uint32_t* result_count) {
-    // Check if node intersects query sphere
-    if (!aabb_intersects_sphere(node->bounds, center, radius)) {
-        return;
+// Slab test: entry distance, or INFINITY on a miss within [0, max_distance]
+static inline float bvh_ray_box(const float* box, const float* origin, const float* inv_dir,
+                                float max_distance) {
+    float t_min = 0.0f, t_max = max_distance;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (box[axis * 2] - origin[axis]) * inv_dir[axis];
+        float t1 = (box[axis * 2 + 1] - origin[axis]) * inv_dir[axis];
+        t_min = fmaxf(t_min, fminf(t0, t1));  // NaN (0 * inf) leaves the slab open
+        t_max = fminf(t_max, fmaxf(t0, t1));
+    }
+    return t_min <= t_max ? t_min : INFINITY;
+}
+
+// Nearest hit along the ray, children visited near-first and skipped once
+// they start beyond the current hit
+bool bvh_raycast(const Bvh* bvh, const float* origin, const float* direction, float max_distance,
+                 BvhRayFunc hit_func, void* user, BvhHit* hit) {
+    if (bvh->count == 0) return false;
+    
+    float inv_dir[3];
+    for (int axis = 0; axis < 3; axis++) {
+        inv_dir[axis] = 1.0f / direction[axis];
     }
     
-    // Add entities in this node
-    for (uint32_t i = 0; i < node->entity_count; i++) {
-        if (*result_count < 1024) {  // Safety limit
-            results[*result_count] = node->entity_ids[i];
-            (*result_count)++;
+    float best = max_distance;
+    bool found = false;
+    uint32_t stack[BVH_STACK];
+    float stack_t[BVH_STACK];
+    uint32_t top = 0;
+    
+    float t = bvh_ray_box(bvh->nodes[0].bounds, origin, inv_dir, best);
+    if (t == INFINITY) return false;
+    stack[top] = 0;
+    stack_t[top++] = t;
+    
+    while (top > 0) {
+        top--;
+        if (stack_t[top] > best) continue;
+        const BvhNode* node = &bvh->nodes[stack[top]];
+        
+        if (node->count) {
+            for (uint32_t p = node->first; p < node->first + node->count; p++) {
+                float d = bvh_ray_box(&bvh->prim_bounds[p * 6], origin, inv_dir, best);
+                if (d == INFINITY) continue;
+                if (hit_func) {
+                    d = hit_func(user, bvh->ids[p], origin, direction, best);
+                    if (!(d >= 0.0f && d <= best)) continue;
+                }
+                best = d;
+                found = true;
+                hit->id = bvh->ids[p];
+                hit->distance = d;
+            }
+            continue;
+        }
+        
+        uint32_t near = node->first, far = node->first + 1;
+        float t_near = bvh_ray_box(bvh->nodes[near].bounds, origin, inv_dir, best);
+        float t_far = bvh_ray_box(bvh->nodes[far].bounds, origin, inv_dir, best);
+        if (t_far < t_near) {
+            uint32_t swap = near; near = far; far = swap;
+            float swap_t = t_near; t_near = t_far; t_far = swap_t;
+        }
+        if (t_far != INFINITY) {
+            stack[top] = far;
+            stack_t[top++] = t_far;
+        }
+        if (t_near != INFINITY) {
+            stack[top] = near;
+            stack_t[top++] = t_near;
         }
     }
+    return found;
+}
+
+// The k primitives whose boxes are nearest to point (distance zero inside
+// a box) and no further than max_distance, nearest first. Same conventions
+// as octree_query_nearest().
+bool bvh_query_nearest(const Bvh* bvh, const float* point, uint32_t k, float max_distance,
+                       SpatialNeighbor* results, uint32_t* found, SpatialKnnScratch* scratch) {
+    *found = 0;
+    scratch->count = 0;
+    if (k == 0 || bvh->count == 0 || !(max_distance >= 0.0f)) return true;
     
-    // Query children
-    if (!node->is_leaf) {
-        for (int i = 0; i < 8; i++) {
-            if (node->children[i]) {
-                octree_query_range(node->children[i], center, radius, 
-                                  results, result_count);
+    float max_distance_sq = max_distance * max_distance;
+    float root_distance = bounds_distance_sq(bvh->nodes[0].bounds, point);
+    if (root_distance > max_distance_sq) return true;
+    if (!knn_queue_push(scratch, root_distance, &bvh->nodes[0])) return false;
+    
+    while (scratch->count > 0) {
+        SpatialKnnEntry entry = knn_queue_pop(scratch);
+        float limit = knn_limit(results, *found, k, max_distance_sq);
+        if (entry.distance > limit) break;
+        
+        const BvhNode* node = entry.node;
+        if (node->count) {
+            for (uint32_t p = node->first; p < node->first + node->count; p++) {
+                float d2 = bounds_distance_sq(&bvh->prim_bounds[p * 6], point);
+                if (d2 <= limit) {
+                    knn_best_offer(results, found, k, bvh->ids[p], d2);
+                    limit = knn_limit(results, *found, k, max_distance_sq);
+                }
             }
+            continue;
+        }
+        
+        for (uint32_t c = node->first; c < node->first + 2; c++) {
+            float d2 = bounds_distance_sq(bvh->nodes[c].bounds, point);
+            if (d2 <= limit && !knn_queue_push(scratch, d2, &bvh->nodes[c])) return false;
         }
     }
+    knn_best_finish(results, *found);
+    return true;
+}
+
+static bool bvh_knn_query(const void* index, const float* point, uint32_t k, float max_distance,
+                          SpatialNeighbor* results, uint32_t* found, SpatialKnnScratch* scratch) {
+    return bvh_query_nearest((const Bvh*)index, point, k, max_distance, results, found, scratch);
+}
+
+bool bvh_query_nearest_batch(const Bvh* bvh, JobSystem* jobs, const float* points,
+                             uint32_t point_count, uint32_t k, float max_distance,
+                             SpatialKnnResults* results) {
+    PROFILE_ZONE("BVH nearest batch");
+    return spatial_knn_batch(bvh, bvh_knn_query, jobs, points, point_count, k, max_distance,
+                             results);
 }
 
 // LOD Object implementation
@@ -354,6 +2986,7 @@ WorldStreamer* world_streamer_create(int32_t view_distance, uint32_t chunk_size)
 }
 
 void world_streamer_update(WorldStreamer* streamer, Vector4 viewer_position) {
+    PROFILE_ZONE("World streaming");
     streamer->viewer_position = viewer_position;
     
     // Determine which chunks should be loaded
@@ -524,6 +3157,7 @@ bool occlusion_buffer_test_aabb(OcclusionBuffer* buffer,
 }
 
 void occlusion_buffer_update_hiz(OcclusionBuffer* buffer) {
+    PROFILE_ZONE("Hi-Z build");
     // Build hierarchical Z-buffer from depth buffer
     uint32_t width = buffer->width;
     uint32_t height = buffer->height;
@@ -603,14 +3237,571 @@ bool aabb_intersects_sphere(float* aabb, float* center, float radius) {
 uint32_t min(uint32_t a, uint32_t b) { return a < b ? a : b; }
 uint32_t max(uint32_t a, uint32_t b) { return a > b ? a : b; }
 
+// Self-test: each index is compared with brute force over the same
+// entities. A fixed seed keeps failures reproducible.
+#define SPATIAL_TEST_SEED     20240611u
+#define SPATIAL_TEST_ENTITIES 4000
+#define SPATIAL_TEST_QUERIES  200
+
+static float spatial_test_random(float lo, float hi) {
+    return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+// Spheres (x, y, z, radius) spread over the test world, with a clump of
+// coincident centres and a few large radii to stress splitting
+static void spatial_test_spheres(float* spheres, uint64_t* ids, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        float* sphere = &spheres[i * 4];
+        if (i % 16 == 0) {
+            sphere[0] = sphere[1] = sphere[2] = 100.0f;
+        } else {
+            sphere[0] = spatial_test_random(-990.0f, 990.0f);
+            sphere[1] = spatial_test_random(-200.0f, 200.0f);
+            sphere[2] = spatial_test_random(-990.0f, 990.0f);
+        }
+        sphere[3] = i % 300 == 0 ? spatial_test_random(50.0f, 300.0f)
+                                 : spatial_test_random(0.1f, 3.0f);
+        ids[i] = i * 7 + 3;
+    }
+}
+
+static bool spatial_test_sphere_hit(const float* sphere, const float* center, float radius) {
+    float dx = sphere[0] - center[0];
+    float dy = sphere[1] - center[1];
+    float dz = sphere[2] - center[2];
+    float reach = sphere[3] + radius;
+    return dx*dx + dy*dy + dz*dz <= reach * reach;
+}
+
+static int spatial_test_compare_ids(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Same ids in any order; sorts both lists
+static bool spatial_test_same_ids(uint64_t* found, uint64_t* expected, uint32_t count) {
+    qsort(found, count, sizeof(uint64_t), spatial_test_compare_ids);
+    qsort(expected, count, sizeof(uint64_t), spatial_test_compare_ids);
+    return memcmp(found, expected, sizeof(uint64_t) * count) == 0;
+}
+
+static bool spatial_test_linear_octree(JobSystem* jobs) {
+    uint32_t count = SPATIAL_TEST_ENTITIES;
+    float* spheres = malloc(sizeof(float) * 4 * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    uint64_t* found = malloc(sizeof(uint64_t) * count);
+    uint64_t* expected = malloc(sizeof(uint64_t) * count);
+    LinearOctree* tree = linear_octree_create(0);
+    bool passed = spheres && ids && found && expected && tree;
+    
+    if (passed) {
+        spatial_test_spheres(spheres, ids, count);
+        passed = linear_octree_build(tree, jobs, ids, spheres, count);
+    }
+    
+    for (uint32_t q = 0; passed && q < SPATIAL_TEST_QUERIES; q++) {
+        float center[3] = {
+            spatial_test_random(-1000.0f, 1000.0f),
+            spatial_test_random(-200.0f, 200.0f),
+            spatial_test_random(-1000.0f, 1000.0f)
+        };
+        if (q % 10 == 0) center[0] = center[1] = center[2] = 100.0f;
+        float radius = spatial_test_random(1.0f, 60.0f);
+        
+        uint32_t matches = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (spatial_test_sphere_hit(&spheres[i * 4], center, radius)) expected[matches++] = ids[i];
+        }
+        
+        // The total comes back even when the buffer is too small
+        uint32_t total = linear_octree_query_range(tree, center, radius, found, matches / 2);
+        uint32_t n = linear_octree_query_range(tree, center, radius, found, count);
+        passed = total == matches && n == matches && spatial_test_same_ids(found, expected, n);
+    }
+    
+    // A rebuild with a single entity is one leaf
+    passed = passed && linear_octree_build(tree, jobs, ids, spheres, 1) && tree->node_count == 1;
+    
+    if (!passed) fprintf(stderr, "Linear octree range query differs from brute force\n");
+    linear_octree_destroy(tree);
+    free(spheres);
+    free(ids);
+    free(found);
+    free(expected);
+    return passed;
+}
+
+// Loose octree over the test spheres after insert, remove, move and
+// re-insert churn; alive[i] says whether entity i is still in the tree
+static Octree* spatial_test_octree(float* spheres, const uint64_t* ids, bool* alive,
+                                   uint32_t count) {
+    float bounds[6] = { -1000.0f, 1000.0f, -1000.0f, 1000.0f, -1000.0f, 1000.0f };
+    Octree* tree = octree_create(bounds, OCTREE_MAX_DEPTH, 16);
+    if (!tree) return NULL;
+    
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ok = octree_insert(tree, ids[i], &spheres[i * 4], spheres[i * 4 + 3]);
+        alive[i] = true;
+    }
+    for (uint32_t i = 0; ok && i < count; i += 5) {
+        ok = octree_remove(tree, ids[i]);
+        alive[i] = false;
+    }
+    for (uint32_t i = 1; ok && i < count; i += 3) {
+        if (!alive[i]) continue;
+        float* sphere = &spheres[i * 4];
+        sphere[0] = span_min(span_max(sphere[0] + spatial_test_random(-60.0f, 60.0f), -990.0f), 990.0f);
+        sphere[2] = span_min(span_max(sphere[2] + spatial_test_random(-60.0f, 60.0f), -990.0f), 990.0f);
+        ok = octree_move(tree, ids[i], sphere, sphere[3]);
+    }
+    for (uint32_t i = 0; ok && i < count; i += 10) {
+        spheres[i * 4] = spatial_test_random(-990.0f, 990.0f);
+        ok = octree_insert(tree, ids[i], &spheres[i * 4], spheres[i * 4 + 3]);
+        alive[i] = true;
+    }
+    
+    if (!ok) {
+        octree_destroy(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+// Sphere and box batches, and single range queries, on the loose octree
+static bool spatial_test_octree_batch(JobSystem* jobs) {
+    uint32_t count = SPATIAL_TEST_ENTITIES;
+    uint32_t query_count = SPATIAL_TEST_QUERIES;
+    float* spheres = malloc(sizeof(float) * 4 * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    bool* alive = malloc(sizeof(bool) * count);
+    uint64_t* found = malloc(sizeof(uint64_t) * count);
+    uint64_t* expected = malloc(sizeof(uint64_t) * count);
+    float* queries = malloc(sizeof(float) * 6 * query_count);
+    SpatialQueryResults results = { 0 };
+    Octree* tree = NULL;
+    bool passed = spheres && ids && alive && found && expected && queries;
+    
+    if (passed) {
+        spatial_test_spheres(spheres, ids, count);
+        tree = spatial_test_octree(spheres, ids, alive, count);
+        passed = tree != NULL;
+    }
+    
+    for (int shape = SPATIAL_QUERY_SPHERE; passed && shape <= SPATIAL_QUERY_AABB; shape++) {
+        uint32_t stride = shape == SPATIAL_QUERY_SPHERE ? 4 : 6;
+        for (uint32_t q = 0; q < query_count; q++) {
+            float* query = &queries[q * stride];
+            float x = spatial_test_random(-1000.0f, 1000.0f);
+            float y = spatial_test_random(-200.0f, 200.0f);
+            float z = spatial_test_random(-1000.0f, 1000.0f);
+            float extent = q % 50 == 0 ? 800.0f : spatial_test_random(1.0f, 60.0f);
+            if (shape == SPATIAL_QUERY_SPHERE) {
+                query[0] = x;
+                query[1] = y;
+                query[2] = z;
+                query[3] = extent;
+            } else {
+                float box[6] = { x - extent, x + extent, y - extent, y + extent,
+                                 z - extent, z + extent };
+                memcpy(query, box, sizeof(box));
+            }
+        }
+        
+        passed = octree_query_batch(tree, jobs, (SpatialQueryShape)shape, queries, query_count,
+                                    &results) &&
+                 results.query_count == query_count &&
+                 results.offsets[query_count] == results.id_count;
+        
+        for (uint32_t q = 0; passed && q < query_count; q++) {
+            const float* query = &queries[q * stride];
+            uint32_t matches = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                if (!alive[i]) continue;
+                const float* sphere = &spheres[i * 4];
+                bool hit = shape == SPATIAL_QUERY_SPHERE
+                    ? spatial_test_sphere_hit(sphere, query, query[3])
+                    : bounds_distance_sq(query, sphere) <= sphere[3] * sphere[3];
+                if (hit) expected[matches++] = ids[i];
+            }
+            
+            uint32_t n = results.offsets[q + 1] - results.offsets[q];
+            memcpy(found, &results.ids[results.offsets[q]], sizeof(uint64_t) * n);
+            passed = n == matches && spatial_test_same_ids(found, expected, n);
+            
+            // The single query reports the full total past its capacity
+            if (passed && shape == SPATIAL_QUERY_SPHERE) {
+                passed = octree_query_range(tree, query, query[3], found, matches / 2) == matches;
+            }
+        }
+    }
+    
+    // An empty batch still has its one offset
+    passed = passed && octree_query_batch(tree, jobs, SPATIAL_QUERY_SPHERE, queries, 0, &results) &&
+             results.query_count == 0 && results.offsets[0] == 0;
+    
+    if (!passed) fprintf(stderr, "Octree batch query differs from brute force\n");
+    spatial_query_results_free(&results);
+    if (tree) octree_destroy(tree);
+    free(spheres);
+    free(ids);
+    free(alive);
+    free(found);
+    free(expected);
+    free(queries);
+    return passed;
+}
+
+// Spheres as their enclosing boxes
+static void spatial_test_boxes(float* boxes, const float* spheres, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            boxes[i * 6 + axis * 2] = spheres[i * 4 + axis] - spheres[i * 4 + 3];
+            boxes[i * 6 + axis * 2 + 1] = spheres[i * 4 + axis] + spheres[i * 4 + 3];
+        }
+    }
+}
+
+// Six random inward planes a few hundred units around center
+static void spatial_test_frustum(float frustum[6][4], const float* center) {
+    for (int p = 0; p < 6; p++) {
+        float n[3] = {
+            spatial_test_random(-1.0f, 1.0f),
+            spatial_test_random(-1.0f, 1.0f),
+            spatial_test_random(-1.0f, 1.0f)
+        };
+        float length = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (length < 1e-3f) n[0] = length = 1.0f;
+        for (int axis = 0; axis < 3; axis++) frustum[p][axis] = n[axis] / length;
+        frustum[p][3] = 400.0f - (frustum[p][0] * center[0] + frustum[p][1] * center[1] +
+                                  frustum[p][2] * center[2]);
+    }
+}
+
+// Leaves hold at most BVH_MAX_LEAF primitives and cover all of them
+static bool spatial_test_bvh_leaves(const Bvh* bvh) {
+    uint32_t stack[BVH_STACK];
+    uint32_t top = 0;
+    uint32_t primitives = 0;
+    stack[top++] = 0;
+    
+    while (top > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--top]];
+        if (node->count) {
+            if (node->count > BVH_MAX_LEAF) return false;
+            primitives += node->count;
+        } else {
+            if (top + 2 > BVH_STACK) return false;
+            stack[top++] = node->first + 1;
+            stack[top++] = node->first;
+        }
+    }
+    return primitives == bvh->count;
+}
+
+// Sphere, frustum and ray queries on the BVH against a scan of the boxes
+static bool spatial_test_bvh_queries(const Bvh* bvh, const float* boxes, const uint64_t* ids,
+                                     uint32_t count, uint64_t* found, uint64_t* expected) {
+    if (!spatial_test_bvh_leaves(bvh)) return false;
+    
+    for (uint32_t q = 0; q < SPATIAL_TEST_QUERIES; q++) {
+        float center[3] = {
+            spatial_test_random(-1000.0f, 1000.0f),
+            spatial_test_random(-200.0f, 200.0f),
+            spatial_test_random(-1000.0f, 1000.0f)
+        };
+        float radius = spatial_test_random(1.0f, 100.0f);
+        
+        uint32_t matches = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (bvh_box_touches_sphere(&boxes[i * 6], center, radius)) expected[matches++] = ids[i];
+        }
+        uint32_t n = bvh_query_sphere(bvh, center, radius, found, count);
+        if (n != matches || !spatial_test_same_ids(found, expected, n)) return false;
+        
+        float frustum[6][4];
+        spatial_test_frustum(frustum, center);
+        matches = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (bvh_box_in_frustum(&boxes[i * 6], frustum)) expected[matches++] = ids[i];
+        }
+        n = bvh_query_frustum(bvh, frustum, found, count);
+        if (n != matches || !spatial_test_same_ids(found, expected, n)) return false;
+        
+        // Nearest box entry along a random ray
+        float direction[3] = {
+            spatial_test_random(-1.0f, 1.0f),
+            spatial_test_random(-1.0f, 1.0f),
+            spatial_test_random(-1.0f, 1.0f)
+        };
+        float inv_dir[3];
+        for (int axis = 0; axis < 3; axis++) inv_dir[axis] = 1.0f / direction[axis];
+        float nearest = INFINITY;
+        for (uint32_t i = 0; i < count; i++) {
+            nearest = span_min(nearest, bvh_ray_box(&boxes[i * 6], center, inv_dir, 3000.0f));
+        }
+        BvhHit hit;
+        bool any = bvh_raycast(bvh, center, direction, 3000.0f, NULL, NULL, &hit);
+        if (any != (nearest != INFINITY) || (any && hit.distance != nearest)) return false;
+    }
+    return true;
+}
+
+static bool spatial_test_bvh(JobSystem* jobs) {
+    uint32_t count = SPATIAL_TEST_ENTITIES;
+    float* spheres = malloc(sizeof(float) * 4 * count);
+    float* boxes = malloc(sizeof(float) * 6 * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    uint64_t* found = malloc(sizeof(uint64_t) * count);
+    uint64_t* expected = malloc(sizeof(uint64_t) * count);
+    Bvh* bvh = bvh_create();
+    bool passed = spheres && boxes && ids && found && expected && bvh;
+    
+    if (passed) {
+        spatial_test_spheres(spheres, ids, count);
+        spatial_test_boxes(boxes, spheres, count);
+        passed = bvh_build(bvh, jobs, ids, boxes, count) &&
+                 spatial_test_bvh_queries(bvh, boxes, ids, count, found, expected);
+    }
+    
+    // Refit after moving a third of the boxes each frame; the drift is large
+    // enough that some frames only refit and others rebuild
+    for (uint32_t frame = 0; passed && frame < 4; frame++) {
+        for (uint32_t i = frame % 3; i < count; i += 3) {
+            float dx = spatial_test_random(-120.0f, 120.0f);
+            float dz = spatial_test_random(-120.0f, 120.0f);
+            boxes[i * 6] += dx;
+            boxes[i * 6 + 1] += dx;
+            boxes[i * 6 + 4] += dz;
+            boxes[i * 6 + 5] += dz;
+        }
+        passed = bvh_refit(bvh, jobs, boxes) &&
+                 spatial_test_bvh_queries(bvh, boxes, ids, count, found, expected);
+    }
+    passed = passed && bvh->builds > 1 && bvh->builds < 5;
+    
+    // Degenerate input: every box identical, then a single box, then none
+    if (passed) {
+        for (uint32_t i = 0; i < count; i++) memcpy(&boxes[i * 6], boxes, sizeof(float) * 6);
+        passed = bvh_build(bvh, jobs, ids, boxes, count) &&
+                 spatial_test_bvh_queries(bvh, boxes, ids, count, found, expected) &&
+                 bvh_build(bvh, jobs, ids, boxes, 1) &&
+                 spatial_test_bvh_queries(bvh, boxes, ids, 1, found, expected) &&
+                 bvh_build(bvh, jobs, ids, boxes, 0);
+    }
+    
+    if (!passed) fprintf(stderr, "BVH query differs from brute force\n");
+    bvh_destroy(bvh);
+    free(spheres);
+    free(boxes);
+    free(ids);
+    free(found);
+    free(expected);
+    return passed;
+}
+
+// Frustum query with one and two views; each id is paired with its view
+// mask (id << 8 | mask) so both are compared
+static bool spatial_test_octree_frustum(void) {
+    uint32_t count = SPATIAL_TEST_ENTITIES;
+    float* spheres = malloc(sizeof(float) * 4 * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    bool* alive = malloc(sizeof(bool) * count);
+    uint64_t* found = malloc(sizeof(uint64_t) * count);
+    uint64_t* expected = malloc(sizeof(uint64_t) * count);
+    OctreeVisibleList visible = { 0 };
+    Octree* tree = NULL;
+    bool passed = spheres && ids && alive && found && expected;
+    
+    if (passed) {
+        spatial_test_spheres(spheres, ids, count);
+        tree = spatial_test_octree(spheres, ids, alive, count);
+        passed = tree != NULL;
+    }
+    
+    for (uint32_t q = 0; passed && q < SPATIAL_TEST_QUERIES; q++) {
+        float views[OCTREE_MAX_VIEWS][6][4];
+        float center[3] = {
+            spatial_test_random(-900.0f, 900.0f),
+            spatial_test_random(-100.0f, 100.0f),
+            spatial_test_random(-900.0f, 900.0f)
+        };
+        spatial_test_frustum(views[0], center);
+        center[0] += spatial_test_random(-300.0f, 300.0f);
+        spatial_test_frustum(views[1], center);
+        uint32_t view_count = 1 + q % OCTREE_MAX_VIEWS;
+        
+        uint32_t matches = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!alive[i]) continue;
+            const float* sphere = &spheres[i * 4];
+            uint8_t mask = 0;
+            for (uint32_t v = 0; v < view_count; v++) {
+                bool inside = true;
+                for (int p = 0; p < 6 && inside; p++) {
+                    const float* plane = views[v][p];
+                    inside = plane[0] * sphere[0] + plane[1] * sphere[1] +
+                             plane[2] * sphere[2] + plane[3] >= -sphere[3];
+                }
+                if (inside) mask |= 1u << v;
+            }
+            if (mask) expected[matches++] = ids[i] << 8 | mask;
+        }
+        
+        passed = octree_query_frustum(tree, (const float (*)[6][4])views, view_count, &visible) &&
+                 visible.count == matches;
+        for (uint32_t i = 0; passed && i < matches; i++) {
+            found[i] = visible.ids[i] << 8 | visible.view_masks[i];
+        }
+        passed = passed && spatial_test_same_ids(found, expected, matches);
+    }
+    
+    // Out-of-range view counts are rejected
+    passed = passed && !octree_query_frustum(tree, NULL, 0, &visible);
+    
+    if (!passed) fprintf(stderr, "Octree frustum query differs from brute force\n");
+    octree_visible_list_free(&visible);
+    if (tree) octree_destroy(tree);
+    free(spheres);
+    free(ids);
+    free(alive);
+    free(found);
+    free(expected);
+    return passed;
+}
+
+static int spatial_test_compare_floats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return x < y ? -1 : x > y;
+}
+
+// One k-nearest result against per-entity distances (INFINITY when out of
+// the query). Ids map back to entities as spatial_test_spheres made them.
+static bool spatial_test_neighbors(const SpatialNeighbor* neighbors, uint32_t found, uint32_t k,
+                                   const float* distances, float* sorted, uint32_t count) {
+    uint32_t candidates = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (distances[i] != INFINITY) sorted[candidates++] = distances[i];
+    }
+    qsort(sorted, candidates, sizeof(float), spatial_test_compare_floats);
+    if (found != (candidates < k ? candidates : k)) return false;
+    
+    for (uint32_t j = 0; j < found; j++) {
+        uint64_t index = (neighbors[j].id - 3) / 7;
+        if (neighbors[j].distance != sorted[j] || index >= count ||
+            distances[index] != neighbors[j].distance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// k-nearest on the octree (entity centres) and the BVH (boxes), single and
+// batched, with and without a distance limit
+static bool spatial_test_nearest(JobSystem* jobs) {
+    static const uint32_t ks[] = { 1, 8, 32, 0, 16 };
+    static const float limits[] = { INFINITY, INFINITY, INFINITY, INFINITY, 150.0f };
+    uint32_t count = SPATIAL_TEST_ENTITIES;
+    uint32_t query_count = SPATIAL_TEST_QUERIES;
+    float* spheres = malloc(sizeof(float) * 4 * count);
+    float* boxes = malloc(sizeof(float) * 6 * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    bool* alive = malloc(sizeof(bool) * count);
+    float* distances = malloc(sizeof(float) * count);
+    float* sorted = malloc(sizeof(float) * count);
+    float* points = malloc(sizeof(float) * 3 * query_count);
+    SpatialNeighbor* neighbors = malloc(sizeof(SpatialNeighbor) * 32);
+    SpatialKnnScratch scratch = { 0 };
+    SpatialKnnResults results = { 0 };
+    Octree* tree = NULL;
+    Bvh* bvh = bvh_create();
+    bool passed = spheres && boxes && ids && alive && distances && sorted && points &&
+                  neighbors && bvh;
+    
+    if (passed) {
+        spatial_test_spheres(spheres, ids, count);
+        tree = spatial_test_octree(spheres, ids, alive, count);
+        spatial_test_boxes(boxes, spheres, count);
+        passed = tree != NULL && bvh_build(bvh, jobs, ids, boxes, count);
+        
+        for (uint32_t q = 0; q < query_count; q++) {
+            points[q * 3] = spatial_test_random(-1200.0f, 1200.0f);
+            points[q * 3 + 1] = spatial_test_random(-300.0f, 300.0f);
+            points[q * 3 + 2] = spatial_test_random(-1200.0f, 1200.0f);
+        }
+    }
+    
+    for (int use_bvh = 0; passed && use_bvh < 2; use_bvh++) {
+        for (uint32_t c = 0; passed && c < sizeof(ks) / sizeof(ks[0]); c++) {
+            uint32_t k = ks[c];
+            float limit = limits[c];
+            passed = use_bvh
+                ? bvh_query_nearest_batch(bvh, jobs, points, query_count, k, limit, &results)
+                : octree_query_nearest_batch(tree, jobs, points, query_count, k, limit, &results);
+            passed = passed && results.query_count == query_count && results.k == k;
+            
+            for (uint32_t q = 0; passed && q < query_count; q++) {
+                const float* point = &points[q * 3];
+                for (uint32_t i = 0; i < count; i++) {
+                    float d2;
+                    if (use_bvh) {
+                        d2 = bounds_distance_sq(&boxes[i * 6], point);
+                    } else {
+                        float dx = spheres[i * 4] - point[0];
+                        float dy = spheres[i * 4 + 1] - point[1];
+                        float dz = spheres[i * 4 + 2] - point[2];
+                        d2 = alive[i] ? dx*dx + dy*dy + dz*dz : INFINITY;
+                    }
+                    distances[i] = d2 <= limit * limit ? sqrtf(d2) : INFINITY;
+                }
+                
+                uint32_t found = 0;
+                passed = use_bvh
+                    ? bvh_query_nearest(bvh, point, k, limit, neighbors, &found, &scratch)
+                    : octree_query_nearest(tree, point, k, limit, neighbors, &found, &scratch);
+                passed = passed &&
+                         spatial_test_neighbors(neighbors, found, k, distances, sorted, count) &&
+                         spatial_test_neighbors(&results.neighbors[q * k], results.counts[q], k,
+                                                distances, sorted, count);
+            }
+        }
+    }
+    
+    if (!passed) fprintf(stderr, "Nearest-neighbour query differs from brute force\n");
+    spatial_knn_scratch_free(&scratch);
+    spatial_knn_results_free(&results);
+    if (tree) octree_destroy(tree);
+    bvh_destroy(bvh);
+    free(spheres);
+    free(boxes);
+    free(ids);
+    free(alive);
+    free(distances);
+    free(sorted);
+    free(points);
+    free(neighbors);
+    return passed;
+}
+
 int main_spatial_test() {
     printf("Metaverse Spatial Optimization System\n");
+    srand(SPATIAL_TEST_SEED);
     
     // Test octree
     float world_bounds[6] = {-1000, 1000, -1000, 1000, -1000, 1000};
-    OctreeNode* octree = octree_create(world_bounds, 8, 32);
+    Octree* octree = octree_create(world_bounds, OCTREE_MAX_DEPTH, 32);
     
-    printf("Octree created\n");
+    for (uint64_t id = 1; id <= 1000; id++) {
+        float position[3] = {
+            (float)(rand() % 2000) - 1000.0f,
+            (float)(rand() % 2000) - 1000.0f,
+            (float)(rand() % 2000) - 1000.0f
+        };
+        octree_insert(octree, id, position, 1.0f);
+    }
+    printf("Octree created: %u entities in %u nodes\n", octree->item_count, octree->node_count);
     
     // Test LOD system
     LODObject* lod_obj = lod_object_create(1, (Vector4){10, 0, 10, 0}, 4);
@@ -624,13 +3815,22 @@ int main_spatial_test() {
     OcclusionBuffer* occlusion = occlusion_buffer_create(1920, 1080);
     printf("Occlusion buffer created: %dx%d\n", occlusion->width, occlusion->height);
     
+    // Indexes against brute force; two workers so the parallel paths run
+    JobSystem* jobs = job_system_create(2);
+    bool passed = jobs != NULL && spatial_test_linear_octree(jobs) && spatial_test_bvh(jobs) &&
+                  spatial_test_octree_batch(jobs) && spatial_test_octree_frustum() &&
+                  spatial_test_nearest(jobs);
+    job_system_destroy(jobs);
+    
     // Cleanup
     free(lod_obj->lod_levels);
     free(lod_obj);
     free(streamer->chunks);
     free(streamer);
     occlusion_buffer_destroy(occlusion);
+    octree_destroy(octree);
     
+    if (!passed) return 1;
     printf("Spatial optimization tests completed\n");
     return 0;
 }
\ No newline at end of file
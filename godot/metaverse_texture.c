@@ -0,0 +1,1342 @@
+/*******************************************************************************
+ * METAVERSE TEXTURE COMPRESSION
+ * BC1/BC3/BC7 block encoders with SIMD index fitting, parallel over block rows
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#ifdef METAVERSE_HEADLESS
+#include "metaverse_gl_stub.h"
+#else
+#include <GL/glew.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Texture formats
+typedef enum {
+    TEXTURE_FORMAT_RGBA8 = 0,   // Uncompressed, `channels` bytes per pixel
+    TEXTURE_FORMAT_BC1,         // 8 bytes per 4x4 block, opaque RGB
+    TEXTURE_FORMAT_BC3,         // 16 bytes per block, RGB + interpolated alpha
+    TEXTURE_FORMAT_BC7          // 16 bytes per block, RGBA (mode 6)
+} TextureFormat;
+
+// Texture layout (shared with godot_metaverse_core.c)
+typedef struct {
+    uint8_t* texture_data;      // Mip levels back to back, largest first
+    size_t data_size;           // Bytes in texture_data
+    int width;
+    int height;
+    int channels;
+    TextureFormat format;
+    uint32_t mip_count;         // Levels in texture_data (0 is treated as 1)
+    GLuint gl_texture_id;
+    bool srgb;                  // Colour channels are sRGB encoded
+    bool mipmapped;
+    bool compressed;
+} TextureData;
+
+// Mip filters
+typedef enum {
+    MIP_FILTER_BOX = 0,         // 2x2 average, streamed through cache
+    MIP_FILTER_KAISER,          // Kaiser-windowed sinc, 3 lobes
+    MIP_FILTER_LANCZOS          // Lanczos-3
+} MipFilter;
+
+// Job system (metaverse_jobs.c)
+typedef struct JobSystem JobSystem;
+typedef void (*JobRangeFunc)(void* data, uint32_t begin, uint32_t end);
+
+void job_parallel_for(JobSystem* system, uint32_t count, uint32_t grain,
+                      JobRangeFunc func, void* data);
+
+// Quality tiers for metaverse_texture_compress()
+#define TEXTURE_QUALITY_PCA      40   // 40-79: principal-axis endpoints + least squares
+#define TEXTURE_QUALITY_BC7      80   // 80-100: BC7; below: BC1/BC3
+#define TEXTURE_REFINE_PASSES    2
+#define TEXTURE_PARALLEL_BLOCKS  256  // Smaller images are encoded inline
+
+// Mip generation
+#define MIP_MAX_LEVELS           32
+#define MIP_MAX_TAPS             16
+#define MIP_BAND_ROWS            32     // Level-1 rows per streamed band (power of two)
+#define MIP_ENCODE_TABLE_SIZE    65536  // Linear -> sRGB table resolution
+#define MIP_KAISER_BETA          4.0
+#define MIP_PARALLEL_PIXELS      (256 * 256)
+
+typedef enum {
+    ENCODE_TIER_FAST = 0,       // Bounding-box endpoints, inset
+    ENCODE_TIER_PCA,
+    ENCODE_TIER_BC7
+} EncodeTier;
+
+// One 4x4 block, channel-planar for the SIMD fitters
+typedef struct {
+    alignas(16) float r[16];
+    alignas(16) float g[16];
+    alignas(16) float b[16];
+    alignas(16) float a[16];
+} BlockPixels;
+
+typedef struct {
+    const TextureData* source;
+    uint8_t* output;
+    uint32_t blocks_x;
+    uint32_t block_bytes;
+    TextureFormat format;
+    EncodeTier tier;
+} CompressTask;
+
+// Filter taps for one destination row or column
+typedef struct {
+    int32_t index[MIP_MAX_TAPS];
+    float weight[MIP_MAX_TAPS];
+    uint32_t count;
+} MipTaps;
+
+typedef struct {
+    const float* decode[4];
+    bool srgb[4];
+    int channels;
+} MipCodec;
+
+typedef struct {
+    TextureData* texture;
+    const size_t* offsets;      // Byte offset of every level
+    uint32_t band_levels;       // Box cascade: levels produced per band
+    uint32_t level;             // Windowed pass: level being produced
+    MipTaps* horizontal;
+    MipTaps* vertical;
+    atomic_bool failed;
+} MipTask;
+
+// Function prototypes
+TextureData* metaverse_texture_compress(TextureData* texture, int quality);
+TextureData* metaverse_texture_compress_with(JobSystem* jobs, TextureData* texture, int quality);
+void metaverse_texture_set_job_system(JobSystem* jobs);
+size_t metaverse_texture_compressed_size(TextureFormat format, int width, int height);
+bool metaverse_texture_generate_mips(JobSystem* jobs, TextureData* texture, MipFilter filter);
+bool generate_mipmaps(TextureData* texture);
+
+static JobSystem* texture_jobs = NULL;
+
+// Worker pool used by metaverse_texture_compress(); NULL encodes inline
+void metaverse_texture_set_job_system(JobSystem* jobs) {
+    texture_jobs = jobs;
+}
+
+size_t metaverse_texture_compressed_size(TextureFormat format, int width, int height) {
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case TEXTURE_FORMAT_BC1: return blocks * 8;
+        case TEXTURE_FORMAT_BC3:
+        case TEXTURE_FORMAT_BC7: return blocks * 16;
+        default: return 0;
+    }
+}
+
+// Gather a block, clamping at the right/bottom edges
+static void load_block(const TextureData* tex, uint32_t bx, uint32_t by, BlockPixels* px) {
+    int channels = tex->channels;
+    for (int y = 0; y < 4; y++) {
+        int sy = (int)by * 4 + y;
+        if (sy >= tex->height) sy = tex->height - 1;
+        for (int x = 0; x < 4; x++) {
+            int sx = (int)bx * 4 + x;
+            if (sx >= tex->width) sx = tex->width - 1;
+            
+            const uint8_t* p = &tex->texture_data[((size_t)sy * tex->width + sx) * channels];
+            int i = y * 4 + x;
+            if (channels >= 3) {
+                px->r[i] = p[0]; px->g[i] = p[1]; px->b[i] = p[2];
+                px->a[i] = channels == 4 ? p[3] : 255.0f;
+            } else {
+                // Luminance (+ alpha)
+                px->r[i] = px->g[i] = px->b[i] = p[0];
+                px->a[i] = channels == 2 ? p[1] : 255.0f;
+            }
+        }
+    }
+}
+
+// Index fitting
+// Nearest palette entry for every pixel and the block's total squared error.
+// This is the inner loop of every endpoint search, so it is vectorized four
+// pixels at a time.
+#if defined(__SSE2__)
+static float fit_indices(const BlockPixels* px, const float (*palette)[4], int palette_size,
+                         bool use_alpha, uint8_t* indices) {
+    __m128 total = _mm_setzero_ps();
+    __m128 alpha_weight = _mm_set1_ps(use_alpha ? 1.0f : 0.0f);
+    
+    for (int i = 0; i < 16; i += 4) {
+        __m128 r = _mm_load_ps(px->r + i);
+        __m128 g = _mm_load_ps(px->g + i);
+        __m128 b = _mm_load_ps(px->b + i);
+        __m128 a = _mm_load_ps(px->a + i);
+        
+        __m128 best = _mm_set1_ps(INFINITY);
+        __m128 best_index = _mm_setzero_ps();
+        
+        for (int p = 0; p < palette_size; p++) {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+            __m128 da = _mm_mul_ps(_mm_sub_ps(a, _mm_set1_ps(palette[p][3])), alpha_weight);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                                  _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+            
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)p)),
+                                   _mm_andnot_ps(closer, best_index));
+        }
+        
+        total = _mm_add_ps(total, best);
+        
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128((__m128i*)lanes, _mm_cvttps_epi32(best_index));
+        for (int k = 0; k < 4; k++) indices[i + k] = (uint8_t)lanes[k];
+    }
+    
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+}
+#else
+static float fit_indices(const BlockPixels* px, const float (*palette)[4], int palette_size,
+                         bool use_alpha, uint8_t* indices) {
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float best = INFINITY;
+        int best_index = 0;
+        for (int p = 0; p < palette_size; p++) {
+            float dr = px->r[i] - palette[p][0];
+            float dg = px->g[i] - palette[p][1];
+            float db = px->b[i] - palette[p][2];
+            float da = use_alpha ? px->a[i] - palette[p][3] : 0.0f;
+            float d = dr*dr + dg*dg + db*db + da*da;
+            if (d < best) {
+                best = d;
+                best_index = p;
+            }
+        }
+        indices[i] = (uint8_t)best_index;
+        total += best;
+    }
+    return total;
+}
+#endif
+
+// Endpoint search
+// Start endpoints: bounding box (fast tier) or the extremes of the pixels
+// projected on the principal axis.
+static void block_endpoints(const BlockPixels* px, int dims, EncodeTier tier,
+                            float* e0, float* e1) {
+    const float* ch[4] = {px->r, px->g, px->b, px->a};
+    
+    if (tier == ENCODE_TIER_FAST) {
+        for (int c = 0; c < dims; c++) {
+            float lo = ch[c][0], hi = ch[c][0];
+            for (int i = 1; i < 16; i++) {
+                lo = fminf(lo, ch[c][i]);
+                hi = fmaxf(hi, ch[c][i]);
+            }
+            // Inset by 1/16 of the range to cut quantization error at the ends
+            float inset = (hi - lo) / 16.0f;
+            e0[c] = hi - inset;
+            e1[c] = lo + inset;
+        }
+        return;
+    }
+    
+    float mean[4] = {0};
+    for (int c = 0; c < dims; c++) {
+        for (int i = 0; i < 16; i++) mean[c] += ch[c][i];
+        mean[c] /= 16.0f;
+    }
+    
+    float cov[4][4] = {{0}};
+    for (int i = 0; i < 16; i++) {
+        float d[4];
+        for (int c = 0; c < dims; c++) d[c] = ch[c][i] - mean[c];
+        for (int c = 0; c < dims; c++) {
+            for (int k = c; k < dims; k++) cov[c][k] += d[c] * d[k];
+        }
+    }
+    for (int c = 0; c < dims; c++) {
+        for (int k = 0; k < c; k++) cov[c][k] = cov[k][c];
+    }
+    
+    // Power iteration for the principal axis
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 8; iter++) {
+        float next[4] = {0};
+        float len = 0.0f;
+        for (int c = 0; c < dims; c++) {
+            for (int k = 0; k < dims; k++) next[c] += cov[c][k] * axis[k];
+            len += next[c] * next[c];
+        }
+        if (len <= 1e-12f) break;
+        len = 1.0f / sqrtf(len);
+        for (int c = 0; c < dims; c++) axis[c] = next[c] * len;
+    }
+    
+    float lo = INFINITY, hi = -INFINITY;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < dims; c++) t += (ch[c][i] - mean[c]) * axis[c];
+        lo = fminf(lo, t);
+        hi = fmaxf(hi, t);
+    }
+    for (int c = 0; c < dims; c++) {
+        e0[c] = fminf(fmaxf(mean[c] + axis[c] * hi, 0.0f), 255.0f);
+        e1[c] = fminf(fmaxf(mean[c] + axis[c] * lo, 0.0f), 255.0f);
+    }
+}
+
+// Least-squares endpoints for fixed indices; weights[i] is the e1 share
+static bool refine_endpoints(const BlockPixels* px, int dims, const uint8_t* indices,
+                             const float* weights, float* e0, float* e1) {
+    const float* ch[4] = {px->r, px->g, px->b, px->a};
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {0}, bx[4] = {0};
+    
+    for (int i = 0; i < 16; i++) {
+        float beta = weights[indices[i]];
+        float alpha = 1.0f - beta;
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+        for (int c = 0; c < dims; c++) {
+            ax[c] += alpha * ch[c][i];
+            bx[c] += beta * ch[c][i];
+        }
+    }
+    
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f) return false;
+    det = 1.0f / det;
+    
+    for (int c = 0; c < dims; c++) {
+        e0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) * det, 0.0f), 255.0f);
+        e1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) * det, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+// BC1
+static inline uint16_t pack_565(const float* c) {
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpack_565(uint16_t v, float* c) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (float)((r << 3) | (r >> 2));
+    c[1] = (float)((g << 2) | (g >> 4));
+    c[2] = (float)((b << 3) | (b >> 2));
+    c[3] = 255.0f;
+}
+
+// Quantize endpoints (c0 > c1 selects four-colour mode) and fit indices
+static float bc1_fit(const BlockPixels* px, const float* e0, const float* e1,
+                     uint16_t* c0, uint16_t* c1, uint8_t* indices) {
+    uint16_t q0 = pack_565(e0), q1 = pack_565(e1);
+    if (q0 < q1) {
+        uint16_t t = q0; q0 = q1; q1 = t;
+    }
+    *c0 = q0;
+    *c1 = q1;
+    
+    float palette[4][4];
+    unpack_565(q0, palette[0]);
+    unpack_565(q1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+    palette[2][3] = palette[3][3] = 255.0f;
+    
+    // Equal endpoints decode in three-colour mode; index 0 is still exact
+    return fit_indices(px, (const float (*)[4])palette, q0 == q1 ? 1 : 4, false, indices);
+}
+
+static void encode_bc1_block(const BlockPixels* px, EncodeTier tier, uint8_t* out) {
+    static const float bc1_weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    
+    float e0[4], e1[4];
+    block_endpoints(px, 3, tier, e0, e1);
+    
+    uint16_t c0, c1;
+    uint8_t indices[16];
+    float error = bc1_fit(px, e0, e1, &c0, &c1, indices);
+    
+    for (int pass = 0; tier != ENCODE_TIER_FAST && pass < TEXTURE_REFINE_PASSES; pass++) {
+        float r0[4], r1[4];
+        if (!refine_endpoints(px, 3, indices, bc1_weights, r0, r1)) break;
+        
+        uint16_t n0, n1;
+        uint8_t candidate[16];
+        float candidate_error = bc1_fit(px, r0, r1, &n0, &n1, candidate);
+        if (candidate_error >= error) break;
+        
+        error = candidate_error;
+        c0 = n0;
+        c1 = n1;
+        memcpy(indices, candidate, sizeof(indices));
+    }
+    
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= (uint32_t)indices[i] << (i * 2);
+    
+    out[0] = (uint8_t)c0; out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1; out[3] = (uint8_t)(c1 >> 8);
+    out[4] = (uint8_t)bits; out[5] = (uint8_t)(bits >> 8);
+    out[6] = (uint8_t)(bits >> 16); out[7] = (uint8_t)(bits >> 24);
+}
+
+// BC3 alpha (BC4 layout, eight-value mode)
+static void encode_bc4_alpha(const BlockPixels* px, uint8_t* out) {
+    float lo = px->a[0], hi = px->a[0];
+    for (int i = 1; i < 16; i++) {
+        lo = fminf(lo, px->a[i]);
+        hi = fmaxf(hi, px->a[i]);
+    }
+    uint8_t a0 = (uint8_t)hi, a1 = (uint8_t)lo;
+    
+    uint64_t bits = 0;
+    if (a0 > a1) {
+        float scale = 7.0f / (a0 - a1);
+        for (int i = 0; i < 16; i++) {
+            // Ramp position 0..7 from a1 to a0, then BC4 index order
+            int t = (int)((px->a[i] - a1) * scale + 0.5f);
+            uint64_t index = t == 7 ? 0 : t == 0 ? 1 : (uint64_t)(8 - t);
+            bits |= index << (i * 3);
+        }
+    }
+    
+    out[0] = a0;
+    out[1] = a1;
+    for (int k = 0; k < 6; k++) out[2 + k] = (uint8_t)(bits >> (k * 8));
+}
+
+static void encode_bc3_block(const BlockPixels* px, EncodeTier tier, uint8_t* out) {
+    encode_bc4_alpha(px, out);
+    encode_bc1_block(px, tier, out + 8);
+}
+
+// BC7 mode 6: one subset, 7.7.7.7 endpoints with a shared p-bit each, and
+// 4-bit indices over RGBA
+static const float bc7_weights[16] = {
+    0/64.0f, 4/64.0f, 9/64.0f, 13/64.0f, 17/64.0f, 21/64.0f, 26/64.0f, 30/64.0f,
+    34/64.0f, 38/64.0f, 43/64.0f, 47/64.0f, 51/64.0f, 55/64.0f, 60/64.0f, 64/64.0f
+};
+
+static inline int bc7_quantize(float v, int pbit) {
+    int q = (int)((v - pbit) * 0.5f + 0.5f);
+    return q < 0 ? 0 : q > 127 ? 127 : q;
+}
+
+static float bc7_fit(const BlockPixels* px, const float* e0, const float* e1,
+                     int q0[4], int q1[4], int* p0, int* p1, uint8_t* indices) {
+    float best_error = INFINITY;
+    
+    // Try every p-bit pair; each shifts all four channels of an endpoint
+    for (int pb = 0; pb < 4; pb++) {
+        int pa = pb & 1, pc = pb >> 1;
+        int t0[4], t1[4];
+        float palette[16][4];
+        float end0[4], end1[4];
+        
+        for (int c = 0; c < 4; c++) {
+            t0[c] = bc7_quantize(e0[c], pa);
+            t1[c] = bc7_quantize(e1[c], pc);
+            end0[c] = (float)((t0[c] << 1) | pa);
+            end1[c] = (float)((t1[c] << 1) | pc);
+        }
+        for (int i = 0; i < 16; i++) {
+            int w = (int)(bc7_weights[i] * 64.0f + 0.5f);
+            for (int c = 0; c < 4; c++) {
+                palette[i][c] = (float)(((64 - w) * (int)end0[c] + w * (int)end1[c] + 32) >> 6);
+            }
+        }
+        
+        uint8_t candidate[16];
+        float error = fit_indices(px, (const float (*)[4])palette, 16, true, candidate);
+        if (error < best_error) {
+            best_error = error;
+            memcpy(q0, t0, sizeof(t0));
+            memcpy(q1, t1, sizeof(t1));
+            *p0 = pa;
+            *p1 = pc;
+            memcpy(indices, candidate, 16);
+        }
+    }
+    return best_error;
+}
+
+static inline void put_bits(uint8_t* block, uint32_t* pos, uint32_t value, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, (*pos)++) {
+        if (value & (1u << i)) block[*pos >> 3] |= (uint8_t)(1u << (*pos & 7));
+    }
+}
+
+static void encode_bc7_block(const BlockPixels* px, uint8_t* out) {
+    float e0[4], e1[4];
+    block_endpoints(px, 4, ENCODE_TIER_PCA, e0, e1);
+    
+    int q0[4], q1[4], p0, p1;
+    uint8_t indices[16];
+    float error = bc7_fit(px, e0, e1, q0, q1, &p0, &p1, indices);
+    
+    for (int pass = 0; pass < TEXTURE_REFINE_PASSES; pass++) {
+        float r0[4], r1[4];
+        if (!refine_endpoints(px, 4, indices, bc7_weights, r0, r1)) break;
+        
+        int n0[4], n1[4], np0, np1;
+        uint8_t candidate[16];
+        float candidate_error = bc7_fit(px, r0, r1, n0, n1, &np0, &np1, candidate);
+        if (candidate_error >= error) break;
+        
+        error = candidate_error;
+        memcpy(q0, n0, sizeof(n0));
+        memcpy(q1, n1, sizeof(n1));
+        p0 = np0;
+        p1 = np1;
+        memcpy(indices, candidate, sizeof(indices));
+    }
+    
+    // The anchor (pixel 0) index is stored with its top bit implied zero
+    if (indices[0] & 8) {
+        int t[4];
+        memcpy(t, q0, sizeof(t)); memcpy(q0, q1, sizeof(t)); memcpy(q1, t, sizeof(t));
+        int tp = p0; p0 = p1; p1 = tp;
+        for (int i = 0; i < 16; i++) indices[i] = (uint8_t)(15 - indices[i]);
+    }
+    
+    memset(out, 0, 16);
+    uint32_t pos = 0;
+    put_bits(out, &pos, 1u << 6, 7);  // Mode 6
+    for (int c = 0; c < 4; c++) {
+        put_bits(out, &pos, (uint32_t)q0[c], 7);
+        put_bits(out, &pos, (uint32_t)q1[c], 7);
+    }
+    put_bits(out, &pos, (uint32_t)p0, 1);
+    put_bits(out, &pos, (uint32_t)p1, 1);
+    put_bits(out, &pos, indices[0], 3);
+    for (int i = 1; i < 16; i++) put_bits(out, &pos, indices[i], 4);
+}
+
+// Encode rows of blocks [begin, end)
+static void compress_rows(void* data, uint32_t begin, uint32_t end) {
+    CompressTask* task = (CompressTask*)data;
+    BlockPixels px;
+    
+    for (uint32_t by = begin; by < end; by++) {
+        uint8_t* out = task->output + (size_t)by * task->blocks_x * task->block_bytes;
+        for (uint32_t bx = 0; bx < task->blocks_x; bx++, out += task->block_bytes) {
+            load_block(task->source, bx, by, &px);
+            switch (task->format) {
+                case TEXTURE_FORMAT_BC1: encode_bc1_block(&px, task->tier, out); break;
+                case TEXTURE_FORMAT_BC3: encode_bc3_block(&px, task->tier, out); break;
+                default: encode_bc7_block(&px, out); break;
+            }
+        }
+    }
+}
+
+// Mip chain generation
+// Filtering runs in linear light: sRGB colour channels are decoded through a
+// table, filtered in float and re-encoded through a 64K-entry table. Alpha
+// is always linear.
+//
+// The box filter streams: each worker owns a band of MIP_BAND_ROWS level-1
+// rows and keeps halving it in place in a float scratch buffer, so levels
+// 1..log2(MIP_BAND_ROWS)+1 are produced from cache without re-reading the
+// previous level. Windowed kernels, and the small levels left after the
+// band phase, are filtered level by level (separable, vertical then
+// horizontal), split into row tiles across workers.
+static float srgb_decode_table[256];
+static float unorm_decode_table[256];
+static uint8_t srgb_encode_table[MIP_ENCODE_TABLE_SIZE];
+static pthread_once_t mip_tables_once = PTHREAD_ONCE_INIT;
+
+static void mip_init_tables(void) {
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgb_decode_table[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        unorm_decode_table[i] = c;
+    }
+    for (int i = 0; i < MIP_ENCODE_TABLE_SIZE; i++) {
+        float l = (float)i / (MIP_ENCODE_TABLE_SIZE - 1);
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        srgb_encode_table[i] = (uint8_t)(c * 255.0f + 0.5f);
+    }
+}
+
+static inline bool mip_is_color(int channel, int channels) {
+    return channels <= 2 ? channel == 0 : channel < 3;
+}
+
+// Channel transfer functions, resolved once per task
+static void mip_codec_init(MipCodec* codec, const TextureData* texture) {
+    codec->channels = texture->channels;
+    for (int c = 0; c < 4; c++) {
+        codec->srgb[c] = texture->srgb && mip_is_color(c, texture->channels);
+        codec->decode[c] = codec->srgb[c] ? srgb_decode_table : unorm_decode_table;
+    }
+}
+
+static inline void mip_decode(const MipCodec* codec, const uint8_t* p, float* out) {
+    out[0] = out[1] = out[2] = out[3] = 0.0f;
+    for (int c = 0; c < codec->channels; c++) {
+        out[c] = codec->decode[c][p[c]];
+    }
+}
+
+static inline void mip_encode(const MipCodec* codec, const float* v, uint8_t* p) {
+    for (int c = 0; c < codec->channels; c++) {
+        float x = fminf(fmaxf(v[c], 0.0f), 1.0f);  // Windowed kernels overshoot
+        p[c] = codec->srgb[c] ? srgb_encode_table[(int)(x * (MIP_ENCODE_TABLE_SIZE - 1) + 0.5f)]
+                              : (uint8_t)(x * 255.0f + 0.5f);
+    }
+}
+
+// RGBA pixel ops; a whole pixel fits one SSE register
+#if defined(__SSE2__)
+static inline void mip_box4(const float* a, const float* b, const float* c, const float* d,
+                            float* out) {
+    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)),
+                            _mm_add_ps(_mm_loadu_ps(c), _mm_loadu_ps(d)));
+    _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+}
+
+// acc[0..count) += w * src[0..count), RGBA pixels
+static inline void mip_madd_row(float* acc, const float* src, float w, int count) {
+    __m128 weight = _mm_set1_ps(w);
+    for (int x = 0; x < count; x++) {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(acc + x * 4), _mm_mul_ps(_mm_loadu_ps(src + x * 4), weight));
+        _mm_storeu_ps(acc + x * 4, v);
+    }
+}
+
+static inline void mip_madd(float* acc, const float* src, float w) {
+    _mm_storeu_ps(acc, _mm_add_ps(_mm_loadu_ps(acc), _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(w))));
+}
+#else
+static inline void mip_box4(const float* a, const float* b, const float* c, const float* d,
+                            float* out) {
+    for (int k = 0; k < 4; k++) out[k] = (a[k] + b[k] + c[k] + d[k]) * 0.25f;
+}
+
+static inline void mip_madd_row(float* acc, const float* src, float w, int count) {
+    for (int i = 0; i < count * 4; i++) acc[i] += src[i] * w;
+}
+
+static inline void mip_madd(float* acc, const float* src, float w) {
+    for (int k = 0; k < 4; k++) acc[k] += src[k] * w;
+}
+#endif
+
+static inline int mip_dim(int size, uint32_t level) {
+    int d = size >> level;
+    return d > 0 ? d : 1;
+}
+
+static uint32_t mip_full_count(int width, int height) {
+    uint32_t levels = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+// Byte offset of `level` in a chain stored level after level
+static size_t mip_level_offset(const TextureData* texture, uint32_t level) {
+    size_t offset = 0;
+    for (uint32_t l = 0; l < level; l++) {
+        int w = mip_dim(texture->width, l), h = mip_dim(texture->height, l);
+        offset += texture->format == TEXTURE_FORMAT_RGBA8
+                ? (size_t)w * h * texture->channels
+                : metaverse_texture_compressed_size(texture->format, w, h);
+    }
+    return offset;
+}
+
+// Resampling kernels, in destination pixel units
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x * 0.5 / k) * (x * 0.5 / k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+static inline double sinc(double x) {
+    if (fabs(x) < 1e-8) return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static float mip_kernel_support(MipFilter filter) {
+    return filter == MIP_FILTER_BOX ? 0.5f : 3.0f;
+}
+
+static double mip_kernel(MipFilter filter, double t) {
+    double a = fabs(t);
+    switch (filter) {
+        case MIP_FILTER_LANCZOS:
+            return a < 3.0 ? sinc(t) * sinc(t / 3.0) : 0.0;
+        case MIP_FILTER_KAISER: {
+            if (a >= 3.0) return 0.0;
+            double r = t / 3.0;
+            return sinc(t) * bessel_i0(MIP_KAISER_BETA * sqrt(1.0 - r * r)) / bessel_i0(MIP_KAISER_BETA);
+        }
+        default:
+            return a <= 0.5 ? 1.0 : 0.0;
+    }
+}
+
+// Normalized taps for every destination sample along one axis
+static MipTaps* mip_build_taps(MipFilter filter, int src_size, int dst_size) {
+    MipTaps* taps = malloc(sizeof(MipTaps) * dst_size);
+    if (!taps) return NULL;
+    
+    double scale = (double)src_size / dst_size;
+    double support = mip_kernel_support(filter) * scale;
+    
+    for (int x = 0; x < dst_size; x++) {
+        double center = (x + 0.5) * scale - 0.5;
+        int first = (int)floor(center - support) + 1;
+        int last = (int)floor(center + support);
+        if (last - first + 1 > MIP_MAX_TAPS) {
+            int excess = last - first + 1 - MIP_MAX_TAPS;
+            first += excess / 2;
+            last = first + MIP_MAX_TAPS - 1;
+        }
+        
+        MipTaps* t = &taps[x];
+        double total = 0.0;
+        t->count = 0;
+        for (int s = first; s <= last; s++) {
+            double w = mip_kernel(filter, (s - center) / scale);
+            if (w == 0.0) continue;
+            t->index[t->count] = s < 0 ? 0 : s >= src_size ? src_size - 1 : s;
+            t->weight[t->count] = (float)w;
+            t->count++;
+            total += w;
+        }
+        if (t->count == 0 || total == 0.0) {
+            // Degenerate kernel window: nearest sample
+            int s = (int)floor(center + 0.5);
+            t->index[0] = s < 0 ? 0 : s >= src_size ? src_size - 1 : s;
+            t->weight[0] = 1.0f;
+            t->count = 1;
+            continue;
+        }
+        for (uint32_t i = 0; i < t->count; i++) t->weight[i] = (float)(t->weight[i] / total);
+    }
+    return taps;
+}
+
+// Box cascade over one band of level-1 rows
+static void mip_box_bands(void* data, uint32_t begin, uint32_t end) {
+    MipTask* task = (MipTask*)data;
+    TextureData* tex = task->texture;
+    int channels = tex->channels;
+    MipCodec codec;
+    mip_codec_init(&codec, tex);
+    int w0 = tex->width, h0 = tex->height;
+    int w1 = mip_dim(w0, 1);
+    
+    float* band = malloc(sizeof(float) * 4 * (size_t)w1 * MIP_BAND_ROWS);
+    if (!band) {
+        atomic_store(&task->failed, true);
+        return;
+    }
+    
+    const uint8_t* level0 = tex->texture_data;
+    
+    for (uint32_t b = begin; b < end; b++) {
+        // Level 1 straight from the source bytes
+        int h1 = mip_dim(h0, 1);
+        int y0 = (int)b * MIP_BAND_ROWS;
+        int y1 = y0 + MIP_BAND_ROWS < h1 ? y0 + MIP_BAND_ROWS : h1;
+        uint8_t* out = tex->texture_data + task->offsets[1];
+        
+        for (int y = y0; y < y1; y++) {
+            int r0 = 2 * y < h0 ? 2 * y : h0 - 1;
+            int r1 = 2 * y + 1 < h0 ? 2 * y + 1 : h0 - 1;
+            const uint8_t* row0 = level0 + (size_t)r0 * w0 * channels;
+            const uint8_t* row1 = level0 + (size_t)r1 * w0 * channels;
+            float* dst = band + (size_t)(y - y0) * w1 * 4;
+            
+            for (int x = 0; x < w1; x++) {
+                int c0 = 2 * x < w0 ? 2 * x : w0 - 1;
+                int c1 = 2 * x + 1 < w0 ? 2 * x + 1 : w0 - 1;
+                float p[4][4];
+                mip_decode(&codec, row0 + c0 * channels, p[0]);
+                mip_decode(&codec, row0 + c1 * channels, p[1]);
+                mip_decode(&codec, row1 + c0 * channels, p[2]);
+                mip_decode(&codec, row1 + c1 * channels, p[3]);
+                mip_box4(p[0], p[1], p[2], p[3], dst + x * 4);
+                mip_encode(&codec, dst + x * 4, out + ((size_t)y * w1 + x) * channels);
+            }
+        }
+        
+        // Deeper levels halve the band in place while it is still in cache
+        for (uint32_t level = 2; level <= task->band_levels; level++) {
+            int sw = mip_dim(w0, level - 1), sh = mip_dim(h0, level - 1);
+            int dw = mip_dim(w0, level), dh = mip_dim(h0, level);
+            int src_y0 = (int)((b * MIP_BAND_ROWS) >> (level - 2));
+            int dy0 = (int)((b * MIP_BAND_ROWS) >> (level - 1));
+            int dy1 = (int)(((b + 1) * MIP_BAND_ROWS) >> (level - 1));
+            if (dy1 > dh) dy1 = dh;
+            out = tex->texture_data + task->offsets[level];
+            
+            for (int y = dy0; y < dy1; y++) {
+                int r0 = 2 * y < sh ? 2 * y : sh - 1;
+                int r1 = 2 * y + 1 < sh ? 2 * y + 1 : sh - 1;
+                const float* row0 = band + (size_t)(r0 - src_y0) * sw * 4;
+                const float* row1 = band + (size_t)(r1 - src_y0) * sw * 4;
+                float* dst = band + (size_t)(y - dy0) * dw * 4;
+                
+                for (int x = 0; x < dw; x++) {
+                    int c0 = 2 * x < sw ? 2 * x : sw - 1;
+                    int c1 = 2 * x + 1 < sw ? 2 * x + 1 : sw - 1;
+                    float p[4];
+                    mip_box4(row0 + c0 * 4, row0 + c1 * 4, row1 + c0 * 4, row1 + c1 * 4, p);
+                    memcpy(dst + x * 4, p, sizeof(p));
+                    mip_encode(&codec, p, out + ((size_t)y * dw + x) * channels);
+                }
+            }
+        }
+    }
+    
+    free(band);
+}
+
+// Box levels left after the band phase are small; finish them serially in
+// float from a single decode of the last streamed level
+static bool mip_box_tail(TextureData* tex, const size_t* offsets, uint32_t first, uint32_t levels) {
+    int channels = tex->channels;
+    MipCodec codec;
+    mip_codec_init(&codec, tex);
+    
+    int sw = mip_dim(tex->width, first - 1), sh = mip_dim(tex->height, first - 1);
+    float* buffer = malloc(sizeof(float) * 4 * (size_t)sw * sh);
+    if (!buffer) return false;
+    
+    const uint8_t* src = tex->texture_data + offsets[first - 1];
+    for (size_t i = 0; i < (size_t)sw * sh; i++) {
+        mip_decode(&codec, src + i * channels, buffer + i * 4);
+    }
+    
+    for (uint32_t level = first; level < levels; level++) {
+        int dw = mip_dim(tex->width, level), dh = mip_dim(tex->height, level);
+        uint8_t* out = tex->texture_data + offsets[level];
+        
+        // In place: destination pixel i never overtakes the source pixels it reads
+        for (int y = 0; y < dh; y++) {
+            int r0 = 2 * y < sh ? 2 * y : sh - 1;
+            int r1 = 2 * y + 1 < sh ? 2 * y + 1 : sh - 1;
+            for (int x = 0; x < dw; x++) {
+                int c0 = 2 * x < sw ? 2 * x : sw - 1;
+                int c1 = 2 * x + 1 < sw ? 2 * x + 1 : sw - 1;
+                float p[4];
+                mip_box4(buffer + ((size_t)r0 * sw + c0) * 4, buffer + ((size_t)r0 * sw + c1) * 4,
+                         buffer + ((size_t)r1 * sw + c0) * 4, buffer + ((size_t)r1 * sw + c1) * 4, p);
+                memcpy(buffer + ((size_t)y * dw + x) * 4, p, sizeof(p));
+                mip_encode(&codec, p, out + ((size_t)y * dw + x) * channels);
+            }
+        }
+        sw = dw;
+        sh = dh;
+    }
+    
+    free(buffer);
+    return true;
+}
+
+// One level from the previous one with a separable kernel, rows [begin, end)
+static void mip_filter_rows(void* data, uint32_t begin, uint32_t end) {
+    MipTask* task = (MipTask*)data;
+    TextureData* tex = task->texture;
+    int channels = tex->channels;
+    MipCodec codec;
+    mip_codec_init(&codec, tex);
+    uint32_t level = task->level;
+    int sw = mip_dim(tex->width, level - 1);
+    int dw = mip_dim(tex->width, level);
+    const uint8_t* src = tex->texture_data + task->offsets[level - 1];
+    uint8_t* out = tex->texture_data + task->offsets[level];
+    
+    float* decoded = malloc(sizeof(float) * 4 * (size_t)sw);
+    float* column = malloc(sizeof(float) * 4 * (size_t)sw);
+    if (!decoded || !column) {
+        free(decoded);
+        free(column);
+        atomic_store(&task->failed, true);
+        return;
+    }
+    
+    for (uint32_t y = begin; y < end; y++) {
+        const MipTaps* vt = &task->vertical[y];
+        
+        // Vertical pass into a full-width row
+        memset(column, 0, sizeof(float) * 4 * (size_t)sw);
+        for (uint32_t i = 0; i < vt->count; i++) {
+            const uint8_t* row = src + (size_t)vt->index[i] * sw * channels;
+            for (int x = 0; x < sw; x++) {
+                mip_decode(&codec, row + x * channels, decoded + x * 4);
+            }
+            mip_madd_row(column, decoded, vt->weight[i], sw);
+        }
+        
+        // Horizontal pass and encode
+        for (int x = 0; x < dw; x++) {
+            const MipTaps* ht = &task->horizontal[x];
+            float p[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (uint32_t i = 0; i < ht->count; i++) {
+                mip_madd(p, column + ht->index[i] * 4, ht->weight[i]);
+            }
+            mip_encode(&codec, p, out + ((size_t)y * dw + x) * channels);
+        }
+    }
+    
+    free(decoded);
+    free(column);
+}
+
+static void mip_run(JobSystem* jobs, uint32_t count, JobRangeFunc func, MipTask* task,
+                    size_t work) {
+    if (jobs && work >= MIP_PARALLEL_PIXELS) {
+        job_parallel_for(jobs, count, 1, func, task);
+    } else {
+        func(task, 0, count);
+    }
+}
+
+// Build the full mip chain of an uncompressed texture in place. Level 0 is
+// kept; texture_data is reallocated to hold every level back to back.
+bool metaverse_texture_generate_mips(JobSystem* jobs, TextureData* texture, MipFilter filter) {
+    if (!texture || texture->compressed || !texture->texture_data ||
+        texture->width <= 0 || texture->height <= 0 ||
+        texture->channels < 1 || texture->channels > 4) {
+        return false;
+    }
+    
+    pthread_once(&mip_tables_once, mip_init_tables);
+    
+    uint32_t levels = mip_full_count(texture->width, texture->height);
+    size_t offsets[MIP_MAX_LEVELS + 1];
+    texture->format = TEXTURE_FORMAT_RGBA8;
+    for (uint32_t l = 0; l <= levels && l <= MIP_MAX_LEVELS; l++) {
+        offsets[l] = mip_level_offset(texture, l);
+    }
+    
+    uint8_t* chain = realloc(texture->texture_data, offsets[levels]);
+    if (!chain) return false;
+    texture->texture_data = chain;
+    texture->data_size = offsets[levels];
+    texture->mip_count = 1;
+    
+    MipTask task;
+    memset(&task, 0, sizeof(task));
+    task.texture = texture;
+    task.offsets = offsets;
+    atomic_init(&task.failed, false);
+    
+    uint32_t level = 1;
+    
+    // Streamed box levels
+    if (filter == MIP_FILTER_BOX && levels > 1) {
+        uint32_t band_levels = 1;
+        while ((MIP_BAND_ROWS >> (band_levels - 1)) > 1 && band_levels + 1 < levels) band_levels++;
+        task.band_levels = band_levels;
+        
+        int h1 = mip_dim(texture->height, 1);
+        uint32_t bands = (uint32_t)(h1 + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS;
+        mip_run(jobs, bands, mip_box_bands, &task, (size_t)texture->width * texture->height);
+        
+        if (!atomic_load(&task.failed) &&
+            !mip_box_tail(texture, offsets, band_levels + 1, levels)) {
+            atomic_store(&task.failed, true);
+        }
+        level = levels;
+    }
+    
+    // Windowed kernels, one level at a time
+    for (; level < levels && !atomic_load(&task.failed); level++) {
+        int sw = mip_dim(texture->width, level - 1), sh = mip_dim(texture->height, level - 1);
+        int dw = mip_dim(texture->width, level), dh = mip_dim(texture->height, level);
+        
+        task.level = level;
+        task.horizontal = mip_build_taps(filter, sw, dw);
+        task.vertical = mip_build_taps(filter, sh, dh);
+        if (task.horizontal && task.vertical) {
+            mip_run(jobs, (uint32_t)dh, mip_filter_rows, &task, (size_t)sw * sh);
+        } else {
+            atomic_store(&task.failed, true);
+        }
+        free(task.horizontal);
+        free(task.vertical);
+    }
+    
+    if (atomic_load(&task.failed)) return false;
+    
+    texture->mip_count = levels;
+    texture->mipmapped = true;
+    return true;
+}
+
+// Box-filtered chain on the module's job system
+bool generate_mipmaps(TextureData* texture) {
+    return metaverse_texture_generate_mips(texture_jobs, texture, MIP_FILTER_BOX);
+}
+
+static bool texture_has_alpha(const TextureData* texture) {
+    if (texture->channels != 2 && texture->channels != 4) return false;
+    
+    size_t pixels = (size_t)texture->width * texture->height;
+    int stride = texture->channels;
+    for (size_t i = 0; i < pixels; i++) {
+        if (texture->texture_data[i * stride + stride - 1] != 255) return true;
+    }
+    return false;
+}
+
+// Block-compress an uncompressed texture. quality 0-39 is fast BC1/BC3,
+// 40-79 PCA-fitted BC1/BC3, 80-100 BC7; BC3 is used only when some texel is
+// not opaque. Every mip level is compressed; a mipmapped texture that only
+// carries level 0 gets its chain generated (box, linear light) first.
+TextureData* metaverse_texture_compress_with(JobSystem* jobs, TextureData* texture, int quality) {
+    if (!texture || texture->compressed || !texture->texture_data ||
+        texture->width <= 0 || texture->height <= 0 ||
+        texture->channels < 1 || texture->channels > 4) {
+        return texture;
+    }
+    
+    TextureFormat format;
+    EncodeTier tier;
+    if (quality >= TEXTURE_QUALITY_BC7) {
+        format = TEXTURE_FORMAT_BC7;
+        tier = ENCODE_TIER_BC7;
+    } else {
+        format = texture_has_alpha(texture) ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1;
+        tier = quality >= TEXTURE_QUALITY_PCA ? ENCODE_TIER_PCA : ENCODE_TIER_FAST;
+    }
+    
+    TextureData source = *texture;
+    source.format = TEXTURE_FORMAT_RGBA8;
+    if (source.mip_count == 0) source.mip_count = 1;
+    
+    bool owns_source = false;
+    if (texture->mipmapped && source.mip_count == 1) {
+        size_t level0 = (size_t)texture->width * texture->height * texture->channels;
+        source.texture_data = malloc(level0);
+        if (source.texture_data) {
+            memcpy(source.texture_data, texture->texture_data, level0);
+            owns_source = true;
+            if (!metaverse_texture_generate_mips(jobs, &source, MIP_FILTER_BOX)) {
+                source.mip_count = 1;
+            }
+        } else {
+            source.texture_data = texture->texture_data;
+        }
+    }
+    
+    TextureData* compressed = malloc(sizeof(TextureData));
+    if (!compressed) {
+        if (owns_source) free(source.texture_data);
+        return NULL;
+    }
+    
+    *compressed = source;
+    compressed->format = format;
+    compressed->compressed = true;
+    compressed->gl_texture_id = 0;
+    compressed->data_size = mip_level_offset(compressed, source.mip_count);
+    compressed->texture_data = malloc(compressed->data_size);
+    if (!compressed->texture_data) {
+        if (owns_source) free(source.texture_data);
+        free(compressed);
+        return NULL;
+    }
+    
+    for (uint32_t level = 0; level < source.mip_count; level++) {
+        TextureData view = source;
+        view.width = mip_dim(source.width, level);
+        view.height = mip_dim(source.height, level);
+        view.texture_data = source.texture_data + mip_level_offset(&source, level);
+        
+        CompressTask task;
+        task.source = &view;
+        task.output = compressed->texture_data + mip_level_offset(compressed, level);
+        task.blocks_x = (uint32_t)(view.width + 3) / 4;
+        task.block_bytes = format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+        task.format = format;
+        task.tier = tier;
+        
+        uint32_t blocks_y = (uint32_t)(view.height + 3) / 4;
+        if (jobs && task.blocks_x * blocks_y >= TEXTURE_PARALLEL_BLOCKS) {
+            job_parallel_for(jobs, blocks_y, 1, compress_rows, &task);
+        } else {
+            compress_rows(&task, 0, blocks_y);
+        }
+    }
+    
+    if (owns_source) free(source.texture_data);
+    return compressed;
+}
+
+TextureData* metaverse_texture_compress(TextureData* texture, int quality) {
+    return metaverse_texture_compress_with(texture_jobs, texture, quality);
+}
+
+// Reference decoders for the self-test. BC7 handles mode 6 only, the one the
+// encoder emits.
+static void texture_test_decode_bc1(const uint8_t* block, uint8_t out[16][4]) {
+    uint16_t c0 = (uint16_t)(block[0] | block[1] << 8);
+    uint16_t c1 = (uint16_t)(block[2] | block[3] << 8);
+    float palette[4][4];
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+            palette[3][c] = 0.0f;
+        }
+    }
+    
+    uint32_t bits = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+    for (int i = 0; i < 16; i++) {
+        const float* color = palette[(bits >> (i * 2)) & 3];
+        for (int c = 0; c < 3; c++) out[i][c] = (uint8_t)(color[c] + 0.5f);
+        out[i][3] = 255;
+    }
+}
+
+static void texture_test_decode_bc4_alpha(const uint8_t* block, uint8_t out[16][4]) {
+    int a0 = block[0], a1 = block[1];
+    int palette[8] = {a0, a1};
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    
+    uint64_t bits = 0;
+    for (int k = 0; k < 6; k++) bits |= (uint64_t)block[2 + k] << (k * 8);
+    for (int i = 0; i < 16; i++) out[i][3] = (uint8_t)palette[(bits >> (i * 3)) & 7];
+}
+
+static uint32_t texture_test_get_bits(const uint8_t* block, uint32_t* pos, uint32_t count) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++, (*pos)++) {
+        value |= (uint32_t)((block[*pos >> 3] >> (*pos & 7)) & 1) << i;
+    }
+    return value;
+}
+
+static bool texture_test_decode_bc7(const uint8_t* block, uint8_t out[16][4]) {
+    uint32_t pos = 0;
+    if (texture_test_get_bits(block, &pos, 7) != 1u << 6) return false;
+    
+    int e0[4], e1[4];
+    for (int c = 0; c < 4; c++) {
+        e0[c] = (int)texture_test_get_bits(block, &pos, 7) << 1;
+        e1[c] = (int)texture_test_get_bits(block, &pos, 7) << 1;
+    }
+    int p0 = (int)texture_test_get_bits(block, &pos, 1);
+    int p1 = (int)texture_test_get_bits(block, &pos, 1);
+    
+    for (int i = 0; i < 16; i++) {
+        uint32_t index = texture_test_get_bits(block, &pos, i == 0 ? 3 : 4);
+        int w = (int)(bc7_weights[index] * 64.0f + 0.5f);
+        for (int c = 0; c < 4; c++) {
+            out[i][c] = (uint8_t)(((64 - w) * (e0[c] | p0) + w * (e1[c] | p1) + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+// PSNR of level 0 over every source channel, or 0 if a block fails to decode
+static double texture_test_psnr(const TextureData* source, const TextureData* compressed) {
+    uint32_t blocks_x = (uint32_t)(source->width + 3) / 4;
+    uint32_t blocks_y = (uint32_t)(source->height + 3) / 4;
+    size_t block_bytes = compressed->format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+    double squared_error = 0.0;
+    size_t samples = 0;
+    
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            const uint8_t* block = compressed->texture_data + (by * blocks_x + bx) * block_bytes;
+            uint8_t texels[16][4];
+            switch (compressed->format) {
+                case TEXTURE_FORMAT_BC1:
+                    texture_test_decode_bc1(block, texels);
+                    break;
+                case TEXTURE_FORMAT_BC3:
+                    texture_test_decode_bc1(block + 8, texels);
+                    texture_test_decode_bc4_alpha(block, texels);
+                    break;
+                default:
+                    if (!texture_test_decode_bc7(block, texels)) return 0.0;
+                    break;
+            }
+            
+            for (int i = 0; i < 16; i++) {
+                int x = (int)bx * 4 + i % 4, y = (int)by * 4 + i / 4;
+                if (x >= source->width || y >= source->height) continue;
+                
+                const uint8_t* texel = source->texture_data +
+                                       ((size_t)y * source->width + x) * source->channels;
+                for (int c = 0; c < source->channels; c++) {
+                    double d = (double)texel[c] - texels[i][c];
+                    squared_error += d * d;
+                    samples++;
+                }
+            }
+        }
+    }
+    
+    if (squared_error == 0.0) return INFINITY;
+    return 10.0 * log10(255.0 * 255.0 * samples / squared_error);
+}
+
+// Smooth gradients with some curvature; alpha is a ramp when present
+static TextureData texture_test_image(int width, int height, int channels) {
+    TextureData texture;
+    memset(&texture, 0, sizeof(texture));
+    texture.width = width;
+    texture.height = height;
+    texture.channels = channels;
+    texture.format = TEXTURE_FORMAT_RGBA8;
+    texture.mip_count = 1;
+    texture.data_size = (size_t)width * height * channels;
+    texture.texture_data = malloc(texture.data_size);
+    if (!texture.texture_data) return texture;
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* texel = texture.texture_data + ((size_t)y * width + x) * channels;
+            texel[0] = (uint8_t)(128.0f + 100.0f * sinf(x * 0.1f));
+            texel[1] = (uint8_t)(y * 255 / height);
+            texel[2] = (uint8_t)(128.0f + 100.0f * cosf((x + y) * 0.05f));
+            if (channels == 4) texel[3] = (uint8_t)(x * 255 / width);
+        }
+    }
+    return texture;
+}
+
+// Generate a chain for a flat width x height image and check the level count,
+// every level's size (floor halving, clamped to 1) and that no texel drifted
+static bool texture_test_mips(int width, int height, MipFilter filter) {
+    TextureData texture;
+    memset(&texture, 0, sizeof(texture));
+    texture.width = width;
+    texture.height = height;
+    texture.channels = 4;
+    texture.srgb = true;
+    texture.data_size = (size_t)width * height * 4;
+    texture.texture_data = malloc(texture.data_size);
+    if (!texture.texture_data) return false;
+    memset(texture.texture_data, 77, texture.data_size);
+    
+    uint32_t expected_levels = 1;
+    size_t expected_size = 0;
+    for (int w = width, h = height;; expected_levels++) {
+        expected_size += (size_t)w * h * 4;
+        if (w == 1 && h == 1) break;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    
+    bool ok = metaverse_texture_generate_mips(NULL, &texture, filter) &&
+              texture.mip_count == expected_levels && texture.data_size == expected_size &&
+              mip_level_offset(&texture, texture.mip_count) == expected_size;
+    for (size_t i = 0; ok && i < texture.data_size; i++) {
+        if (abs(texture.texture_data[i] - 77) > 1) ok = false;
+    }
+    
+    free(texture.texture_data);
+    return ok;
+}
+
+int main_texture_test() {
+    printf("Metaverse Texture Test\n");
+    
+    // BC1 (opaque), BC3 (alpha) and BC7 round trips against a PSNR floor;
+    // 70x50 leaves partial blocks on both edges
+    static const struct {
+        int channels;
+        int quality;
+        TextureFormat format;
+        double min_psnr;
+    } cases[] = {
+        {3, 50, TEXTURE_FORMAT_BC1, 32.0},
+        {4, 50, TEXTURE_FORMAT_BC3, 32.0},
+        {4, 100, TEXTURE_FORMAT_BC7, 35.0},
+    };
+    
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TextureData source = texture_test_image(70, 50, cases[i].channels);
+        if (!source.texture_data) {
+            fprintf(stderr, "Failed to create test texture\n");
+            return 1;
+        }
+        
+        TextureData* compressed = metaverse_texture_compress_with(NULL, &source, cases[i].quality);
+        double psnr = 0.0;
+        bool format_ok = compressed && compressed != &source && compressed->format == cases[i].format;
+        if (format_ok) psnr = texture_test_psnr(&source, compressed);
+        printf("Format %d: %.2f dB\n", (int)cases[i].format, psnr);
+        
+        if (compressed && compressed != &source) {
+            free(compressed->texture_data);
+            free(compressed);
+        }
+        free(source.texture_data);
+        
+        if (!format_ok || psnr < cases[i].min_psnr) {
+            fprintf(stderr, "Block compression round trip below %.0f dB\n", cases[i].min_psnr);
+            return 1;
+        }
+    }
+    
+    // Non-power-of-two and degenerate sizes, through both mip paths
+    static const int mip_sizes[][2] = {{1000, 37}, {513, 1}, {1, 300}, {257, 129}, {1, 1}};
+    for (size_t i = 0; i < sizeof(mip_sizes) / sizeof(mip_sizes[0]); i++) {
+        int width = mip_sizes[i][0], height = mip_sizes[i][1];
+        if (!texture_test_mips(width, height, MIP_FILTER_BOX) ||
+            !texture_test_mips(width, height, MIP_FILTER_LANCZOS)) {
+            fprintf(stderr, "Mip chain for %dx%d has wrong levels or sizes\n", width, height);
+            return 1;
+        }
+    }
+    
+    printf("Texture tests completed\n");
+    return 0;
+}